@@ -40,7 +40,7 @@ typedef bool lto_bool_t;
  * @{
  */
 
-#define LTO_API_VERSION 13
+#define LTO_API_VERSION 16
 
 /**
  * \since prior to LTO_API_VERSION=3
@@ -523,6 +523,92 @@ lto_codegen_optimize(lto_code_gen_t cg);
 extern const void*
 lto_codegen_compile_optimized(lto_code_gen_t cg, size_t* length);
 
+/**
+ * Sets the number of partitions the optimized merged module is split into by
+ * lto_codegen_compile_optimized_to_files(). Code for the partitions is
+ * generated in parallel, one thread per partition. The default is 1.
+ *
+ * \since LTO_API_VERSION=14
+ */
+extern void
+lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned int parallelism);
+
+/**
+ * Generates code for the optimized merged module into one native object file
+ * per partition (see lto_codegen_set_parallelism()). It will not run any IR
+ * optimizations on the merged module. Returns true on error (check
+ * lto_get_error_message() for details).
+ *
+ * The names of the object files are available through
+ * lto_codegen_get_num_object_files() and lto_codegen_get_object_file_name().
+ * It is up to the linker to remove the object files.
+ *
+ * \since LTO_API_VERSION=14
+ */
+extern lto_bool_t
+lto_codegen_compile_optimized_to_files(lto_code_gen_t cg);
+
+/**
+ * Returns the number of object files generated by the last successful call to
+ * lto_codegen_compile_optimized_to_files().
+ *
+ * \since LTO_API_VERSION=14
+ */
+extern unsigned int
+lto_codegen_get_num_object_files(lto_code_gen_t cg);
+
+/**
+ * Returns the name of the object file at the given index generated by the last
+ * successful call to lto_codegen_compile_optimized_to_files().
+ *
+ * \since LTO_API_VERSION=14
+ */
+extern const char*
+lto_codegen_get_object_file_name(lto_code_gen_t cg, unsigned int index);
+
+/**
+ * Sets the directory in which the object files generated by the code
+ * generator are cached. When a later link optimizes the same merged module
+ * with the same options, lto_codegen_optimize() does not run any
+ * optimization and the cached object files are returned. The directory is
+ * created if needed. Caching is disabled by default.
+ *
+ * \since LTO_API_VERSION=16
+ */
+extern void
+lto_codegen_set_cache_dir(lto_code_gen_t cg, const char *cache_dir);
+
+/**
+ * Sets the minimum time, in seconds, between two prunings of the cache
+ * directory. A negative interval disables pruning. The default is 1200.
+ *
+ * \since LTO_API_VERSION=16
+ */
+extern void
+lto_codegen_set_cache_pruning_interval(lto_code_gen_t cg, int interval);
+
+/**
+ * Sets the time, in seconds, after which a cache entry that has not been used
+ * is removed when the cache is pruned. Zero disables expiration. The default
+ * is one week.
+ *
+ * \since LTO_API_VERSION=16
+ */
+extern void
+lto_codegen_set_cache_entry_expiration(lto_code_gen_t cg,
+                                       unsigned int expiration);
+
+/**
+ * Sets the maximum size, in bytes, of the cache. When the cache is pruned,
+ * the least recently used entries are removed until it fits. Zero, the
+ * default, disables the limit.
+ *
+ * \since LTO_API_VERSION=16
+ */
+extern void
+lto_codegen_set_cache_size_bytes(lto_code_gen_t cg,
+                                 unsigned long long max_size_bytes);
+
 /**
  * Returns the runtime API version.
  *
@@ -548,6 +634,173 @@ lto_codegen_debug_options(lto_code_gen_t cg, const char *);
 extern void
 lto_initialize_disassembler(void);
 
+/**
+ * @} // endgroup LLVMCLTO
+ * @defgroup LLVMCTLTO ThinLTO
+ * @ingroup LLVMC
+ *
+ * In thin LTO mode, the modules of a link are not merged. A combined index
+ * is built from the function summaries stored in the bitcode of each module,
+ * and each module is then optimized and compiled on its own, in parallel,
+ * after importing the bodies of the small functions it calls from the other
+ * modules.
+ *
+ * @{
+ */
+
+/**
+ * Opaque reference to a thin code generator.
+ *
+ * \since LTO_API_VERSION=15
+ */
+typedef struct LLVMOpaqueThinLTOCodeGenerator *thinlto_code_gen_t;
+
+/**
+ * Type to wrap a single object returned by thin LTO.
+ *
+ * \since LTO_API_VERSION=15
+ */
+typedef struct {
+  const char *Buffer;
+  size_t Size;
+} LTOObjectBuffer;
+
+/**
+ * Returns true if the memory buffer contains bitcode with a function summary,
+ * which can be compiled with the thin code generator.
+ *
+ * \since LTO_API_VERSION=15
+ */
+extern lto_bool_t
+lto_module_is_thinlto_in_memory(const void *mem, size_t length);
+
+/**
+ * Instantiates a thin code generator.
+ * Returns NULL on error (check lto_get_error_message() for details).
+ *
+ * \since LTO_API_VERSION=15
+ */
+extern thinlto_code_gen_t
+thinlto_create_codegen(void);
+
+/**
+ * Frees the generator and all memory it internally allocated, including the
+ * object files it produced.
+ * Upon return the thinlto_code_gen_t is no longer valid.
+ *
+ * \since LTO_API_VERSION=15
+ */
+extern void
+thinlto_codegen_dispose(thinlto_code_gen_t cg);
+
+/**
+ * Adds a module to the link. The identifier must be unique among the modules
+ * of the link. The module data is not copied: the buffer must stay valid until
+ * the generator is disposed.
+ *
+ * \since LTO_API_VERSION=15
+ */
+extern void
+thinlto_codegen_add_module(thinlto_code_gen_t cg, const char *identifier,
+                           const char *data, int length);
+
+/**
+ * Sets the cpu to generate code for.
+ *
+ * \since LTO_API_VERSION=15
+ */
+extern void
+thinlto_codegen_set_cpu(thinlto_code_gen_t cg, const char *cpu);
+
+/**
+ * Sets the kind of position independent code to generate.
+ * Returns true on error (check lto_get_error_message() for details).
+ *
+ * \since LTO_API_VERSION=15
+ */
+extern lto_bool_t
+thinlto_codegen_set_pic_model(thinlto_code_gen_t cg, lto_codegen_model);
+
+/**
+ * Sets the number of modules that are optimized and compiled concurrently.
+ * The default is 1.
+ *
+ * \since LTO_API_VERSION=15
+ */
+extern void
+thinlto_codegen_set_parallelism(thinlto_code_gen_t cg,
+                                unsigned int parallelism);
+
+/**
+ * Sets the directory in which the object file of each module is cached. The
+ * object file of a module is reused when the module, the functions it imports
+ * and the options are the same as in a previous link. Caching is disabled by
+ * default.
+ *
+ * \since LTO_API_VERSION=16
+ */
+extern void
+thinlto_codegen_set_cache_dir(thinlto_code_gen_t cg, const char *cache_dir);
+
+/**
+ * Sets the minimum time, in seconds, between two prunings of the cache
+ * directory. A negative interval disables pruning. The default is 1200.
+ *
+ * \since LTO_API_VERSION=16
+ */
+extern void
+thinlto_codegen_set_cache_pruning_interval(thinlto_code_gen_t cg,
+                                           int interval);
+
+/**
+ * Sets the time, in seconds, after which a cache entry that has not been used
+ * is removed when the cache is pruned. Zero disables expiration. The default
+ * is one week.
+ *
+ * \since LTO_API_VERSION=16
+ */
+extern void
+thinlto_codegen_set_cache_entry_expiration(thinlto_code_gen_t cg,
+                                           unsigned int expiration);
+
+/**
+ * Sets the maximum size, in bytes, of the cache. When the cache is pruned,
+ * the least recently used entries are removed until it fits. Zero, the
+ * default, disables the limit.
+ *
+ * \since LTO_API_VERSION=16
+ */
+extern void
+thinlto_codegen_set_cache_size_bytes(thinlto_code_gen_t cg,
+                                     unsigned long long max_size_bytes);
+
+/**
+ * Optimizes and compiles all the modules added to the generator, producing
+ * one object file per module.
+ * Returns true on error (check lto_get_error_message() for details).
+ *
+ * \since LTO_API_VERSION=15
+ */
+extern lto_bool_t
+thinlto_codegen_process(thinlto_code_gen_t cg);
+
+/**
+ * Returns the number of object files produced by thinlto_codegen_process().
+ *
+ * \since LTO_API_VERSION=15
+ */
+extern unsigned int
+thinlto_module_get_num_objects(thinlto_code_gen_t cg);
+
+/**
+ * Returns the object file produced by thinlto_codegen_process() for the
+ * module added at the given index. The buffer is owned by the generator.
+ *
+ * \since LTO_API_VERSION=15
+ */
+extern LTOObjectBuffer
+thinlto_module_get_object(thinlto_code_gen_t cg, unsigned int index);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,580 @@
+//===- MemorySSA.h - Build Memory SSA ---------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// \file
+// \brief This file exposes an interface to building/using memory SSA to
+// walk memory instructions using a use/def graph.
+//
+// Memory SSA class builds an SSA form that links together memory access
+// instructions such as loads, stores, atomics, and calls.  Additionally, it
+// does a trivial form of "heap versioning": every time the memory state
+// changes in the program, we generate a new heap version.  It generates
+// MemoryDef/Uses/Phis that are overlayed on top of the existing instructions.
+//
+// As a trivial example,
+//   define i32 @main() #0 {
+//   entry:
+//     %call = call noalias i8* @_Znwm(i64 4) #2
+//     %0 = bitcast i8* %call to i32*
+//     %call1 = call noalias i8* @_Znwm(i64 4) #2
+//     %1 = bitcast i8* %call1 to i32*
+//     store i32 5, i32* %0, align 4
+//     store i32 7, i32* %1, align 4
+//     %2 = load i32* %0, align 4
+//     %3 = load i32* %1, align 4
+//     %add = add nsw i32 %2, %3
+//     ret i32 %add
+//   }
+//
+// Will become
+//   define i32 @main() #0 {
+//   entry:
+//     ; 1 = MemoryDef(liveOnEntry)
+//     %call = call noalias i8* @_Znwm(i64 4) #3
+//     %2 = bitcast i8* %call to i32*
+//     ; 2 = MemoryDef(1)
+//     %call1 = call noalias i8* @_Znwm(i64 4) #3
+//     %4 = bitcast i8* %call1 to i32*
+//     ; 3 = MemoryDef(2)
+//     store i32 5, i32* %2, align 4
+//     ; 4 = MemoryDef(3)
+//     store i32 7, i32* %4, align 4
+//     ; MemoryUse(4)
+//     %7 = load i32* %2, align 4
+//     ; MemoryUse(4)
+//     %8 = load i32* %4, align 4
+//     %add = add nsw i32 %7, %8
+//     ret i32 %add
+//   }
+//
+// Given this form, all the stores that could ever affect the load at %8 can be
+// gotten by using the MemoryUse associated with it, and walking from use to
+// def until you hit the top of the function.
+//
+// Each def also has a list of users associated with it, so you can walk from
+// both def to users, and users to defs.  The builder links every access to the
+// nearest dominating MemoryDef or MemoryPhi without asking alias analysis, so
+// construction is linear in the number of memory instructions.  Precise
+// clobbering information is available on demand through a MemorySSAWalker:
+// asking the caching walker about the load at %7 skips the store to %4 (which
+// does not alias %2) and returns 3.  The walker caches its answers, so passes
+// can query it repeatedly in near-constant time.
+//
+// Memory SSA is kept up to date by passes that use it when they delete memory
+// instructions (see MemorySSA::removeMemoryAccess).  Because the walker's
+// answers depend on the use/def chains, the cache is invalidated whenever the
+// form changes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_MEMORYSSA_H
+#define LLVM_ANALYSIS_MEMORYSSA_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/ilist.h"
+#include "llvm/ADT/ilist_node.h"
+#include "llvm/ADT/iterator_range.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/Pass.h"
+#include <memory>
+
+namespace llvm {
+
+class BasicBlock;
+class Function;
+class Instruction;
+class MemoryAccess;
+class MemorySSAWalker;
+class raw_ostream;
+
+template <>
+struct ilist_traits<MemoryAccess> : public ilist_default_traits<MemoryAccess> {
+  MemoryAccess *createSentinel() const;
+  static void destroySentinel(MemoryAccess *) {}
+
+  MemoryAccess *provideInitialHead() const { return createSentinel(); }
+  MemoryAccess *ensureHead(MemoryAccess *) const { return createSentinel(); }
+  static void noteHead(MemoryAccess *, MemoryAccess *) {}
+
+private:
+  mutable ilist_half_node<MemoryAccess> Sentinel;
+};
+
+/// \brief The base class for all memory accesses.
+///
+/// All memory accesses in a block are linked together using an intrusive list.
+class MemoryAccess : public ilist_node<MemoryAccess> {
+public:
+  enum MemoryAccessKind { MemoryUseKind, MemoryDefKind, MemoryPhiKind };
+
+  virtual ~MemoryAccess();
+
+  MemoryAccessKind getKind() const { return Kind; }
+
+  /// \brief Get the block this access belongs to.  This is null for the
+  /// live-on-entry definition.
+  BasicBlock *getBlock() const { return Block; }
+
+  virtual void print(raw_ostream &OS) const = 0;
+  void dump() const;
+
+  typedef SmallVectorImpl<MemoryAccess *>::iterator user_iterator;
+  typedef SmallVectorImpl<MemoryAccess *>::const_iterator const_user_iterator;
+
+  /// \brief The accesses that use this one as their defining access or as an
+  /// incoming value.  A MemoryPhi that uses this access on several edges
+  /// appears once per edge.
+  user_iterator user_begin() { return Users.begin(); }
+  user_iterator user_end() { return Users.end(); }
+  const_user_iterator user_begin() const { return Users.begin(); }
+  const_user_iterator user_end() const { return Users.end(); }
+  iterator_range<user_iterator> users() {
+    return iterator_range<user_iterator>(user_begin(), user_end());
+  }
+  iterator_range<const_user_iterator> users() const {
+    return iterator_range<const_user_iterator>(user_begin(), user_end());
+  }
+  bool hasUsers() const { return !Users.empty(); }
+  unsigned getNumUsers() const { return Users.size(); }
+
+protected:
+  friend class MemorySSA;
+  friend class MemoryUseOrDef;
+  friend class MemoryPhi;
+
+  MemoryAccess(MemoryAccessKind K, BasicBlock *BB) : Kind(K), Block(BB) {}
+
+  void addUser(MemoryAccess *User) { Users.push_back(User); }
+  void removeUser(MemoryAccess *User);
+
+private:
+  MemoryAccess(const MemoryAccess &) = delete;
+  void operator=(const MemoryAccess &) = delete;
+
+  MemoryAccessKind Kind;
+  BasicBlock *Block;
+  SmallVector<MemoryAccess *, 4> Users;
+};
+
+inline raw_ostream &operator<<(raw_ostream &OS, const MemoryAccess &MA) {
+  MA.print(OS);
+  return OS;
+}
+
+/// \brief Class that has the common methods + fields of memory uses/defs.
+class MemoryUseOrDef : public MemoryAccess {
+public:
+  /// \brief Get the instruction that this MemoryUse or MemoryDef represents.
+  Instruction *getMemoryInst() const { return MemoryInst; }
+
+  /// \brief Get the access that produces the memory state used by this access.
+  MemoryAccess *getDefiningAccess() const { return DefiningAccess; }
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryUseKind || MA->getKind() == MemoryDefKind;
+  }
+
+protected:
+  friend class MemorySSA;
+
+  MemoryUseOrDef(MemoryAccessKind K, MemoryAccess *DMA, Instruction *MI,
+                 BasicBlock *BB)
+      : MemoryAccess(K, BB), MemoryInst(MI), DefiningAccess(nullptr) {
+    setDefiningAccess(DMA);
+  }
+
+  void setDefiningAccess(MemoryAccess *DMA) {
+    if (DefiningAccess)
+      DefiningAccess->removeUser(this);
+    DefiningAccess = DMA;
+    if (DMA)
+      DMA->addUser(this);
+  }
+
+private:
+  Instruction *MemoryInst;
+  MemoryAccess *DefiningAccess;
+};
+
+/// \brief Represents read-only accesses to memory
+///
+/// In particular, the set of Instructions that will be represented by
+/// MemoryUse's is exactly the set of Instructions for which
+/// AliasAnalysis::getModRefInfo returns "Ref".
+class MemoryUse final : public MemoryUseOrDef {
+public:
+  MemoryUse(MemoryAccess *DMA, Instruction *MI, BasicBlock *BB)
+      : MemoryUseOrDef(MemoryUseKind, DMA, MI, BB) {}
+
+  void print(raw_ostream &OS) const override;
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryUseKind;
+  }
+};
+
+/// \brief Represents a read-write access to memory, whether it is a
+/// must-alias, or a may-alias.
+///
+/// In particular, the set of Instructions that will be represented by
+/// MemoryDef's is exactly the set of Instructions for which
+/// AliasAnalysis::getModRefInfo returns "Mod" or "ModRef".
+/// Note that, in order to provide def-def chains, all defs also have a use
+/// associated with them.  This use points to the nearest reaching
+/// MemoryDef/MemoryPhi.
+class MemoryDef final : public MemoryUseOrDef {
+public:
+  MemoryDef(MemoryAccess *DMA, Instruction *MI, BasicBlock *BB, unsigned Ver)
+      : MemoryUseOrDef(MemoryDefKind, DMA, MI, BB), ID(Ver) {}
+
+  /// \brief The version number of the memory state this definition creates.
+  unsigned getID() const { return ID; }
+
+  void print(raw_ostream &OS) const override;
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryDefKind;
+  }
+
+private:
+  const unsigned ID;
+};
+
+/// \brief Represents phi nodes for memory accesses.
+///
+/// These have the same semantic as regular phi nodes, with the exception that
+/// only one phi will ever exist in a given basic block.
+/// Guaranteeing one phi per block means guaranteeing there is only ever one
+/// valid reaching MemoryDef/MemoryPHI along each path to the phi node.
+/// This is ensured by not allowing disambiguation of the RHS of a MemoryDef or
+/// a MemoryPhi's operands.
+/// That is, given
+/// if (a) {
+///   store %a
+///   store %b
+/// }
+/// it *must* be transformed into
+/// if (a) {
+///    1 = MemoryDef(liveOnEntry)
+///    store %a
+///    2 = MemoryDef(1)
+///    store %b
+/// }
+/// and *not*
+/// if (a) {
+///    1 = MemoryDef(liveOnEntry)
+///    store %a
+///    2 = MemoryDef(liveOnEntry)
+///    store %b
+/// }
+/// even if the two stores do not conflict.  Otherwise, both 1 and 2 reach the
+/// end of the branch, and if there are not two phi nodes, one will be
+/// disconnected completely from the SSA graph below that point.
+class MemoryPhi final : public MemoryAccess {
+  typedef std::pair<MemoryAccess *, BasicBlock *> IncomingPair;
+
+public:
+  MemoryPhi(BasicBlock *BB, unsigned Ver)
+      : MemoryAccess(MemoryPhiKind, BB), ID(Ver) {}
+
+  unsigned getNumIncomingValues() const { return Operands.size(); }
+  MemoryAccess *getIncomingValue(unsigned I) const { return Operands[I].first; }
+  BasicBlock *getIncomingBlock(unsigned I) const { return Operands[I].second; }
+
+  /// \brief Add an incoming value for the edge from \p BB.
+  void addIncoming(MemoryAccess *MA, BasicBlock *BB) {
+    Operands.push_back(std::make_pair(MA, BB));
+    MA->addUser(this);
+  }
+
+  /// \brief Replace the incoming value at index \p I with \p MA.
+  void setIncomingValue(unsigned I, MemoryAccess *MA) {
+    Operands[I].first->removeUser(this);
+    Operands[I].first = MA;
+    MA->addUser(this);
+  }
+
+  /// \brief Return the incoming value for the edge from \p BB, or null if
+  /// \p BB is not a predecessor of this phi.
+  MemoryAccess *getIncomingValueForBlock(const BasicBlock *BB) const {
+    for (const auto &Op : Operands)
+      if (Op.second == BB)
+        return Op.first;
+    return nullptr;
+  }
+
+  unsigned getID() const { return ID; }
+
+  void print(raw_ostream &OS) const override;
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryPhiKind;
+  }
+
+private:
+  friend class MemorySSA;
+
+  SmallVector<IncomingPair, 8> Operands;
+  const unsigned ID;
+};
+
+/// \brief Encapsulates MemorySSA, including all data associated with memory
+/// accesses.
+class MemorySSA {
+public:
+  typedef iplist<MemoryAccess> AccessListType;
+
+  MemorySSA(Function &F, AliasAnalysis *AA, DominatorTree *DT);
+  ~MemorySSA();
+
+  /// \brief Return the walker used to query clobbering accesses.  The walker
+  /// is owned by MemorySSA and caches its answers across queries.
+  MemorySSAWalker *getWalker();
+
+  /// \brief Given a memory Mod/Ref'ing instruction, get the MemorySSA access
+  /// associated with it.  If passed a basic block gets the memory phi node
+  /// that exists for that block, if there is one.
+  MemoryUseOrDef *getMemoryAccess(const Instruction *I) const;
+  MemoryPhi *getMemoryAccess(const BasicBlock *BB) const;
+
+  void dump() const;
+  void print(raw_ostream &OS) const;
+
+  /// \brief Return true if \p MA represents the live on entry value
+  ///
+  /// Loads and stores from pointer arguments and other global values may be
+  /// defined by memory operations that do not occur in the current function,
+  /// so they may be live on entry to the function.  MemorySSA represents such
+  /// memory state by the live on entry definition, which is guaranteed to
+  /// occur before any other memory access in the function.
+  bool isLiveOnEntryDef(const MemoryAccess *MA) const {
+    return MA == LiveOnEntryDef.get();
+  }
+
+  MemoryAccess *getLiveOnEntryDef() const { return LiveOnEntryDef.get(); }
+
+  /// \brief Return the list of MemoryAccess's for a given basic block, or null
+  /// if the block has none.
+  ///
+  /// This list is not modifiable by the user.
+  const AccessListType *getBlockAccesses(const BasicBlock *BB) const {
+    auto It = PerBlockAccesses.find(BB);
+    return It == PerBlockAccesses.end() ? nullptr : It->second.get();
+  }
+
+  /// \brief Remove a MemoryAccess from MemorySSA, including updating all
+  /// definitions and uses.
+  ///
+  /// This should be called when a memory instruction that has a MemoryAccess
+  /// associated with it is erased from the program.  For example, if a store
+  /// or load is simply erased (not replaced), removeMemoryAccess should be
+  /// called on the MemoryAccess for that store/load.  The users of a removed
+  /// MemoryDef are rewired to its defining access.  A MemoryPhi may only be
+  /// removed once it has no users or all of its incoming values agree.
+  void removeMemoryAccess(MemoryAccess *MA);
+
+  /// \brief Given two memory accesses in the same basic block, determine
+  /// whether MemoryAccess \p A dominates MemoryAccess \p B.
+  bool locallyDominates(const MemoryAccess *A, const MemoryAccess *B) const;
+
+  /// \brief Given two memory accesses in potentially different blocks,
+  /// determine whether MemoryAccess \p A dominates MemoryAccess \p B.
+  bool dominates(const MemoryAccess *A, const MemoryAccess *B) const;
+
+  /// \brief Verify that MemorySSA is self consistent (IE definitions dominate
+  /// all uses, uses appear in the right places).  This is used by unit tests.
+  void verifyMemorySSA() const;
+
+private:
+  void buildMemorySSA();
+  void verifyUseInDefs(MemoryAccess *, MemoryAccess *) const;
+  void verifyDefUses(Function &F) const;
+  void verifyDomination(Function &F) const;
+  void verifyOrdering(Function &F) const;
+
+  MemoryUseOrDef *createNewAccess(Instruction *, BasicBlock *);
+  void placePHINodes(const SmallPtrSetImpl<BasicBlock *> &DefiningBlocks);
+  MemoryAccess *renameBlock(BasicBlock *, MemoryAccess *);
+  void renamePass(DomTreeNode *, MemoryAccess *IncomingVal,
+                  SmallPtrSetImpl<BasicBlock *> &Visited);
+  void markUnreachableAsLiveOnEntry(BasicBlock *BB);
+  AccessListType *getOrCreateAccessList(const BasicBlock *);
+  void renumberBlock(const BasicBlock *) const;
+
+  Function &F;
+  AliasAnalysis *AA;
+  DominatorTree *DT;
+
+  // Memory SSA mappings
+  DenseMap<const Value *, MemoryAccess *> ValueToMemoryAccess;
+  typedef DenseMap<const BasicBlock *, std::unique_ptr<AccessListType>>
+      AccessMap;
+  AccessMap PerBlockAccesses;
+  std::unique_ptr<MemoryAccess> LiveOnEntryDef;
+
+  /// \brief The position of each access within its block, computed lazily
+  /// for the blocks where locallyDominates was asked about.  Removing an
+  /// access does not change the relative order of the others, so this only
+  /// needs to be dropped for the removed access itself.
+  mutable DenseMap<const MemoryAccess *, unsigned> BlockNumbering;
+  mutable SmallPtrSet<const BasicBlock *, 16> BlockNumberingValid;
+
+  // Memory SSA building info
+  std::unique_ptr<MemorySSAWalker> Walker;
+  unsigned NextID;
+};
+
+/// \brief This is the generic walker interface for walkers of MemorySSA.
+/// Walkers are used to be able to further disambiguate the def-use chains
+/// MemorySSA gives you, or otherwise produce better info than MemorySSA gives
+/// you.
+class MemorySSAWalker {
+public:
+  MemorySSAWalker(MemorySSA *);
+  virtual ~MemorySSAWalker() {}
+
+  /// \brief Given a memory Mod/Ref/ModRef'ing instruction, calling this
+  /// will give you the nearest dominating MemoryAccess that Mod's the location
+  /// the instruction accesses (by skipping any def which AA can prove does not
+  /// alias the location(s) accessed by the instruction given).
+  ///
+  /// Note that this will return a single access, and it must dominate the
+  /// Instruction, so if an operand of a MemoryPhi node Mod's the instruction,
+  /// this will return the MemoryPhi, not the operand.  This means that
+  /// given:
+  /// if (a) {
+  ///   1 = MemoryDef(liveOnEntry)
+  ///   store %a
+  /// } else {
+  ///   2 = MemoryDef(liveOnEntry)
+  ///    store %b
+  /// }
+  /// 3 = MemoryPhi(2, 1)
+  /// MemoryUse(3)
+  /// load %a
+  ///
+  /// calling this API on load(%a) will return the MemoryPhi, not the MemoryDef
+  /// in the if (a) branch.
+  virtual MemoryAccess *getClobberingMemoryAccess(const Instruction *) = 0;
+
+  /// \brief Given a potentially clobbering memory access and a new location,
+  /// calling this will give you the nearest dominating clobbering MemoryAccess
+  /// (by skipping non-aliasing def links).
+  ///
+  /// This version of the function is mainly used to disambiguate phi
+  /// translated pointers, where the value of a pointer may have changed from
+  /// the initial memory access.  Note that this expects to be handed either a
+  /// MemoryUse, or an already potentially clobbering access.  Unlike the above
+  /// API, if given a MemoryDef that clobbers the pointer as the starting
+  /// access, it will return that MemoryDef, whereas the above would return the
+  /// clobber starting from the use side of the memory def.
+  virtual MemoryAccess *
+  getClobberingMemoryAccess(MemoryAccess *,
+                            const AliasAnalysis::Location &) = 0;
+
+  /// \brief Given a memory access, invalidate anything this walker knows
+  /// about that access.
+  ///
+  /// This API is used by MemorySSA when it changes the use/def chains, so that
+  /// no stale answers are handed out afterwards.
+  virtual void invalidateInfo(MemoryAccess *) {}
+
+protected:
+  MemorySSA *MSSA;
+};
+
+/// \brief A MemorySSAWalker that does no alias queries, or anything else.  It
+/// simply returns the links as they were constructed by the builder.
+class DoNothingMemorySSAWalker final : public MemorySSAWalker {
+public:
+  DoNothingMemorySSAWalker(MemorySSA *MSSA) : MemorySSAWalker(MSSA) {}
+
+  MemoryAccess *getClobberingMemoryAccess(const Instruction *) override;
+  MemoryAccess *
+  getClobberingMemoryAccess(MemoryAccess *,
+                            const AliasAnalysis::Location &) override;
+};
+
+/// \brief A MemorySSAWalker that does AA walks and caching of lookups to
+/// disambiguate accesses.
+///
+/// The walk follows the def chain upwards from the access being queried and
+/// skips every MemoryDef that AA proves does not modify the queried location.
+/// At a MemoryPhi it walks each incoming value; if they all lead to the same
+/// clobber, the walk continues past the phi, otherwise the phi itself is the
+/// answer.  Results for instructions and for (phi, location) pairs are cached
+/// until MemorySSA changes, so repeated queries are constant time.
+class CachingMemorySSAWalker final : public MemorySSAWalker {
+public:
+  CachingMemorySSAWalker(MemorySSA *, AliasAnalysis *, DominatorTree *);
+  ~CachingMemorySSAWalker() override;
+
+  MemoryAccess *getClobberingMemoryAccess(const Instruction *) override;
+  MemoryAccess *
+  getClobberingMemoryAccess(MemoryAccess *,
+                            const AliasAnalysis::Location &) override;
+  void invalidateInfo(MemoryAccess *) override;
+
+private:
+  struct UpwardsMemoryQuery;
+
+  MemoryAccess *walkUpwards(MemoryAccess *, const UpwardsMemoryQuery &,
+                            unsigned &LowLink);
+  MemoryAccess *walkPhi(MemoryPhi *, const UpwardsMemoryQuery &,
+                        unsigned &LowLink);
+  MemoryAccess *getClobberingMemoryAccess(MemoryAccess *,
+                                          const UpwardsMemoryQuery &);
+  bool instructionClobbersQuery(const MemoryDef *,
+                                const UpwardsMemoryQuery &) const;
+
+  /// \brief Clobbers of the instruction queries, keyed by the access of the
+  /// queried instruction.
+  DenseMap<const MemoryAccess *, MemoryAccess *> CachedClobbers;
+  /// \brief Clobbers of location queries that had to walk through a phi,
+  /// keyed by the phi and the location.
+  DenseMap<std::pair<const MemoryAccess *, AliasAnalysis::Location>,
+           MemoryAccess *>
+      CachedPhiClobbers;
+  /// \brief The phis the current walk is in the middle of, mapped to their
+  /// depth in the walk.  Used to detect cycles through loop backedges.
+  DenseMap<const MemoryPhi *, unsigned> ActivePhis;
+
+  AliasAnalysis *AA;
+  DominatorTree *DT;
+};
+
+/// \brief Legacy analysis pass which computes MemorySSA.
+///
+/// Run with -analyze to print the function annotated with its memory
+/// accesses.
+class MemorySSAWrapperPass : public FunctionPass {
+public:
+  MemorySSAWrapperPass();
+
+  static char ID;
+  bool runOnFunction(Function &) override;
+  void releaseMemory() override;
+  MemorySSA &getMSSA() { return *MSSA; }
+  const MemorySSA &getMSSA() const { return *MSSA; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override;
+
+  void verifyAnalysis() const override;
+  void print(raw_ostream &OS, const Module *M = nullptr) const override;
+
+private:
+  std::unique_ptr<MemorySSA> MSSA;
+};
+
+} // end namespace llvm
+
+#endif
@@ -104,6 +104,18 @@ public:
   /// \brief Retrieve the current position in the stream, in bits.
   uint64_t GetCurrentBitNo() const { return GetBufferOffset() * 8 + CurBit; }
 
+  /// \brief Backpatch a 32-bit value at the given bit position, which need
+  /// not be aligned. The bits must already have been flushed to the output,
+  /// e.g. by exiting the block that contains them.
+  void BackpatchWordAtBit(uint64_t BitNo, uint32_t NewWord) {
+    assert(BitNo + 32 <= GetBufferOffset() * 8 && "Bits not flushed yet");
+    for (unsigned I = 0; I != 32; ++I, ++BitNo) {
+      char &Byte = Out[BitNo / 8];
+      char Mask = char(1 << (BitNo % 8));
+      Byte = (NewWord >> I) & 1 ? (Byte | Mask) : (Byte & ~Mask);
+    }
+  }
+
   //===--------------------------------------------------------------------===//
   // Basic Primitives for emitting bits to the stream.
   //===--------------------------------------------------------------------===//
@@ -42,7 +42,14 @@ namespace bitc {
 
     TYPE_BLOCK_ID_NEW,
 
-    USELIST_BLOCK_ID
+    USELIST_BLOCK_ID,
+
+    // Top-level block holding the function summaries used by thin LTO.
+    FUNCTION_SUMMARY_BLOCK_ID,
+
+    // Module sub-block holding the METADATA_KIND records, which used to be
+    // written to a METADATA_BLOCK.
+    METADATA_KIND_BLOCK_ID
   };
 
 
@@ -167,6 +174,8 @@ namespace bitc {
     METADATA_EXPRESSION    = 29,  // [distinct, n x element]
     METADATA_OBJC_PROPERTY = 30,  // [distinct, name, file, line, ...]
     METADATA_IMPORTED_ENTITY=31,  // [distinct, tag, scope, entity, line, name]
+    METADATA_INDEX_OFFSET  = 32,  // [offset lo, offset hi]
+    METADATA_INDEX         = 33,  // [n x bitpos delta]
   };
 
   // The constants block (CONSTANTS_BLOCK_ID) describes emission for each
@@ -355,6 +364,18 @@ namespace bitc {
     USELIST_CODE_BB      = 2  // BB: [index..., bb-id]
   };
 
+  /// FUNCTION_SUMMARY blocks describe the function definitions of one module,
+  /// or of all modules of a program in a combined index.
+  enum FunctionSummaryCodes {
+    // MODULE_PATH: [modid, strchr x N]
+    FS_CODE_MODULE_PATH = 1,
+    // NAME: [strchr x N]; names are numbered in the order they appear.
+    FS_CODE_NAME = 2,
+    // ENTRY: [nameid, modid, linkage, instcount, flags,
+    //         n x (calleenameid, numcallsites)]
+    FS_CODE_ENTRY = 3
+  };
+
   enum AttributeKindCodes {
     // = 0 is unused
     ATTR_KIND_ALIGNMENT = 1,
@@ -0,0 +1,42 @@
+//===-- llvm/CodeGen/ParallelCG.h - Parallel code generation ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This header declares functions that can be used for parallel code generation.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CODEGEN_PARALLELCG_H
+#define LLVM_CODEGEN_PARALLELCG_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Target/TargetMachine.h"
+
+namespace llvm {
+
+class Module;
+class raw_pwrite_stream;
+
+/// Split M into OSs.size() partitions, and generate code for each. Writes
+/// OSs.size() output files to the output streams in OSs. The resulting output
+/// files if linked together are intended to be equivalent to the single output
+/// file that would have been code generated from M.
+///
+/// TM is used directly when OSs.size() == 1. Otherwise each partition is moved
+/// into its own LLVMContext and compiled on its own thread by a TargetMachine
+/// configured like TM. Diagnostics raised while compiling a partition are
+/// forwarded, one at a time, to the diagnostic handler of M's context.
+///
+/// Returns true if TM does not support emitting files of type FT.
+bool splitCodeGen(Module &M, ArrayRef<raw_pwrite_stream *> OSs,
+                  TargetMachine &TM, TargetMachine::CodeGenFileType FT =
+                                         TargetMachine::CGFT_ObjectFile);
+
+} // End llvm namespace
+
+#endif
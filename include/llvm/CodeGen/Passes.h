@@ -372,6 +372,10 @@ namespace llvm {
   /// matching during instruction selection.
   FunctionPass *createCodeGenPreparePass(const TargetMachine *TM = nullptr);
 
+  /// createScalarizeMaskedGatherScatterPass - Replace the masked gathers and
+  /// scatters that the target does not support with scalar loads and stores.
+  FunctionPass *createScalarizeMaskedGatherScatterPass();
+
   /// AtomicExpandID -- Lowers atomic operations in terms of either cmpxchg
   /// load-linked/store-conditional loops.
   extern char &AtomicExpandID;
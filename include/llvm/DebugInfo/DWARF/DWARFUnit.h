@@ -11,6 +11,7 @@
 #define LLVM_LIB_DEBUGINFO_DWARFUNIT_H
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/DebugInfo/DWARF/DWARFDebugAbbrev.h"
 #include "llvm/DebugInfo/DWARF/DWARFDebugInfoEntry.h"
 #include "llvm/DebugInfo/DWARF/DWARFDebugRangeList.h"
@@ -124,6 +125,22 @@ class DWARFUnit {
   // The compile unit debug information entry items.
   std::vector<DWARFDebugInfoEntryMinimal> DieArray;
 
+  /// An address range of a subprogram or inlined subroutine DIE.
+  struct SubroutineRange {
+    uint64_t LowPC;
+    uint64_t HighPC;
+    /// The largest HighPC of this range and of the ranges before it.
+    uint64_t MaxHighPC;
+    uint32_t DIEIndex;
+    /// The index of the first DIE after the children of this DIE.
+    uint32_t SubtreeEnd;
+  };
+  /// The address ranges of all the subroutine DIEs, sorted by LowPC, so that
+  /// the DIEs for an address are found without walking the DIE tree. Built on
+  /// the first address lookup.
+  std::vector<SubroutineRange> SubroutineRanges;
+  bool SubroutineRangesBuilt;
+
   class DWOHolder {
     object::OwningBinary<object::ObjectFile> DWOFile;
     std::unique_ptr<DWARFContext> DWOContext;
@@ -275,10 +292,18 @@ private:
   /// it was actually constructed.
   bool parseDWO();
 
-  /// getSubprogramForAddress - Returns subprogram DIE with address range
-  /// encompassing the provided address. The pointer is alive as long as parsed
-  /// compile unit DIEs are not cleared.
-  const DWARFDebugInfoEntryMinimal *getSubprogramForAddress(uint64_t Address);
+  /// buildSubroutineRanges - Builds the address index of the subroutine DIEs
+  /// if it hasn't already been done.
+  void buildSubroutineRanges();
+  /// Adds the ranges of the subroutine DIEs among the children of DIE, whose
+  /// subtree ends before the DIE at index SubtreeEnd.
+  void collectSubroutineRanges(const DWARFDebugInfoEntryMinimal *DIE,
+                               uint32_t SubtreeEnd);
+
+  /// getSubroutineChainForAddress - Returns the indices of the subprogram
+  /// DIE with address range encompassing the provided address, followed by
+  /// the inlined subroutine DIEs nested in it that also encompass it.
+  SmallVector<uint32_t, 4> getSubroutineChainForAddress(uint64_t Address);
 };
 
 }
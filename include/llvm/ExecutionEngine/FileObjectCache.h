@@ -0,0 +1,95 @@
+//===- FileObjectCache.h - Persistent on-disk object cache ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the declaration of an ObjectCache that keeps compiled
+// objects in a directory, so that they survive the process.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/FileCache.h"
+#include <mutex>
+#include <string>
+
+namespace llvm {
+
+class TargetMachine;
+
+/// An ObjectCache that keeps compiled objects in a directory.
+///
+/// Objects are keyed by a hash of the module's bitcode and of a target key,
+/// which describes everything else that affects code generation: the target
+/// machine with its options, and the version of LLVM. A module that is
+/// unchanged is therefore found again by later processes, however it is
+/// named, and a module compiled with other settings is not.
+///
+/// The objects are kept in a FileCache, which several processes may share.
+/// The directory is pruned when the cache is destroyed, at most once per
+/// pruning interval of the FileCache.
+class FileObjectCache : public ObjectCache {
+  FileObjectCache(const FileObjectCache&) = delete;
+  void operator=(const FileObjectCache&) = delete;
+
+public:
+  /// Create a cache in \p CacheDir for objects compiled with the target key
+  /// \p TargetKey. If \p MaxSize is not zero, the objects in the directory
+  /// are kept below that many bytes.
+  FileObjectCache(StringRef CacheDir, StringRef TargetKey,
+                  uint64_t MaxSize = 0);
+
+  /// Create a cache in \p CacheDir for objects compiled by \p TM.
+  FileObjectCache(StringRef CacheDir, const TargetMachine &TM,
+                  uint64_t MaxSize = 0);
+
+  ~FileObjectCache() override;
+
+  /// Return a target key describing the code generated by \p TM.
+  static std::string getTargetKey(const TargetMachine &TM);
+
+  /// Set the minimum time between two prunings of the directory; see
+  /// FileCache::setPruningInterval.
+  void setPruningInterval(int Seconds) { Cache.setPruningInterval(Seconds); }
+
+  /// Return the key under which the object for \p M is cached.
+  std::string getCacheKey(const Module &M) const;
+
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override;
+
+  std::unique_ptr<MemoryBuffer> getObject(const Module *M) override;
+
+  /// Remove the least recently used objects until the objects in the
+  /// directory fit the size limit, unless the directory was pruned less than
+  /// the pruning interval ago. Returns true if the directory was pruned.
+  bool prune();
+
+  /// Return the number of objects that were found in the cache.
+  unsigned getNumHits() const;
+
+  /// Return the number of objects that were looked up but not found.
+  unsigned getNumMisses() const;
+
+private:
+  FileCache Cache;
+  std::string TargetKey;
+
+  mutable std::mutex CacheMutex;
+  // The keys of the modules that missed the cache, computed before code
+  // generation could change them.
+  DenseMap<const Module *, std::string> PendingKeys;
+  unsigned NumHits;
+  unsigned NumMisses;
+};
+
+}
+
+#endif // LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
@@ -78,6 +78,12 @@ public:
   /// a previously emitted object is released.
   virtual void NotifyFreeingObject(const object::ObjectFile &Obj) {}
 
+  /// NotifyFunctionTierUp - Called after a tiered JIT has recompiled a
+  /// function at a higher tier and pointed the function's callers at the new
+  /// code, which starts at Address. Tier 0 is the baseline compile.
+  virtual void NotifyFunctionTierUp(StringRef Name, uint64_t Address,
+                                    unsigned Tier) {}
+
   // Get a pointe to the GDB debugger registration listener.
   static JITEventListener *createGDBRegistrationListener();
 
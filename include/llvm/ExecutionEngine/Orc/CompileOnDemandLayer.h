@@ -19,7 +19,14 @@
 #include "LambdaResolver.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include <condition_variable>
 #include <list>
+#include <mutex>
+#include <set>
 
 namespace llvm {
 namespace orc {
@@ -34,6 +41,17 @@ namespace orc {
 /// It is expected that this layer will frequently be used on top of a
 /// LazyEmittingLayer. The combination of the two ensures that each function is
 /// compiled only when it is first called.
+///
+///   If the layer is constructed with speculative compilation, functions may
+/// be called from several threads, and whenever a function is compiled
+/// because it was called, the functions it calls directly are compiled
+/// speculatively on a compile thread. Stubs are updated with an atomic store,
+/// so a thread calling through a stub sees either the old or the new target.
+/// The layers below are not required to be thread-safe: all work on them is
+/// serialized by this layer, so a single compile thread is used. A thread
+/// that calls a function that has not been compiled yet compiles it itself,
+/// and queued speculative compiles wait until it is done; at most the one
+/// speculative compile that is already running delays it.
 template <typename BaseLayerT, typename CompileCallbackMgrT>
 class CompileOnDemandLayer {
 private:
@@ -137,6 +155,35 @@ private:
   typedef typename BaseLayerT::ModuleSetHandleT BaseLayerModuleSetHandleT;
   typedef std::vector<BaseLayerModuleSetHandleT> BaseLayerModuleSetHandleListT;
 
+  /// @brief The compilation state of a single function body.
+  struct FunctionBody {
+    enum BodyState { NotCompiled, Compiling, Compiled, Abandoned };
+
+    FunctionBody() : State(NotCompiled), Addr(0), TrampolineAddr(0),
+                     CallbackID(0) {}
+
+    // The name of the function, for debug output.
+    std::string Name;
+
+    // Guards State and Addr.
+    std::mutex StateMutex;
+    std::condition_variable StateChanged;
+    BodyState State;
+    TargetAddress Addr;
+
+    // Emits the body in the base layer and returns its address.
+    std::function<TargetAddress()> Compile;
+    // Points the function's stub at the given address.
+    std::function<void(TargetAddress)> Update;
+
+    // The compile callback that the stub jumps to until the body is compiled.
+    TargetAddress TrampolineAddr;
+    uint64_t CallbackID;
+
+    // Functions of the same logical module that this body calls directly.
+    std::vector<FunctionBody*> Callees;
+  };
+
   struct ModuleSetInfo {
     // Symbol lookup - just one for the whole module set.
     std::shared_ptr<CODScopedLookup> Lookup;
@@ -149,9 +196,21 @@ private:
     // exploded modules for that logical module in the base layer.
     BaseLayerModuleSetHandleListT BaseLayerModuleSetHandles;
 
+    // The bodies of the functions defined in this module set.
+    std::vector<std::unique_ptr<FunctionBody>> Bodies;
+
     ModuleSetInfo(std::shared_ptr<CODScopedLookup> Lookup)
         : Lookup(std::move(Lookup)) {}
 
+    // Prevent bodies that have not been compiled yet from being compiled.
+    void abandonBodies() {
+      for (auto &Body : Bodies) {
+        std::lock_guard<std::mutex> Lock(Body->StateMutex);
+        if (Body->State == FunctionBody::NotCompiled)
+          Body->State = FunctionBody::Abandoned;
+      }
+    }
+
     void releaseResources(BaseLayerT &BaseLayer) {
       for (auto LMH : LMHandles)
         Lookup->removeLogicalModule(LMH);
@@ -166,9 +225,32 @@ public:
   /// @brief Handle to a set of loaded modules.
   typedef typename ModuleSetInfoListT::iterator ModuleSetHandleT;
 
+  /// @brief Builder for the memory managers of the modules that are added to
+  ///        the base layer.
+  typedef std::function<std::unique_ptr<RuntimeDyld::MemoryManager>()>
+    MemoryManagerBuilderT;
+
   /// @brief Construct a compile-on-demand layer instance.
-  CompileOnDemandLayer(BaseLayerT &BaseLayer, CompileCallbackMgrT &CallbackMgr)
-      : BaseLayer(BaseLayer), CompileCallbackMgr(CallbackMgr) {}
+  ///
+  ///   If CompileSpeculatively is true, the callees of each function that is
+  /// compiled on demand are compiled speculatively on a compile thread.
+  /// Each module added to the base layer gets a memory manager from
+  /// BuildMemMgr, or a SectionMemoryManager if BuildMemMgr is null.
+  CompileOnDemandLayer(BaseLayerT &BaseLayer, CompileCallbackMgrT &CallbackMgr,
+                       bool CompileSpeculatively = false,
+                       MemoryManagerBuilderT BuildMemMgr = nullptr)
+      : BaseLayer(BaseLayer), CompileCallbackMgr(CallbackMgr),
+        BuildMemMgr(std::move(BuildMemMgr)), OnDemandCompiles(0) {
+    if (CompileSpeculatively)
+      CompileThread = llvm::make_unique<ThreadPool>(1);
+  }
+
+  ~CompileOnDemandLayer() {
+    // Speculative compiles that are still queued when CompileThread is
+    // destroyed find their bodies abandoned and return immediately.
+    for (auto &MSI : ModuleSetInfos)
+      MSI.abandonBodies();
+  }
 
   /// @brief Add a module to the compile-on-demand layer.
   template <typename ModuleSetT, typename MemoryManagerPtrT,
@@ -180,12 +262,14 @@ public:
     assert(MemMgr == nullptr &&
            "User supplied memory managers not supported with COD yet.");
 
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+
     // Create a lookup context and ModuleSetInfo for this module set.
     // For the purposes of symbol resolution the set Ms will be treated as if
     // the modules it contained had been linked together as a dylib.
     auto DylibLookup = createCODScopedLookup(BaseLayer, std::move(Resolver));
     ModuleSetHandleT H =
-        ModuleSetInfos.insert(ModuleSetInfos.end(), ModuleSetInfo(DylibLookup));
+        ModuleSetInfos.emplace(ModuleSetInfos.end(), std::move(DylibLookup));
     ModuleSetInfo &MSI = ModuleSetInfos.back();
 
     // Process each of the modules in this module set.
@@ -200,6 +284,14 @@ public:
   ///   This will remove all modules in the layers below that were derived from
   /// the module represented by H.
   void removeModuleSet(ModuleSetHandleT H) {
+    // Let the compiles that are already running finish before the modules
+    // below are removed. This must not hold LayerMutex, which the compile
+    // threads need.
+    H->abandonBodies();
+    if (CompileThread)
+      CompileThread->wait();
+
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
     H->releaseResources(BaseLayer);
     ModuleSetInfos.erase(H);
   }
@@ -209,6 +301,7 @@ public:
   /// @param ExportedSymbolsOnly If true, search only for exported symbols.
   /// @return A handle for the given named symbol, if it exists.
   JITSymbol findSymbol(StringRef Name, bool ExportedSymbolsOnly) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
     return BaseLayer.findSymbol(Name, ExportedSymbolsOnly);
   }
 
@@ -216,7 +309,7 @@ public:
   ///        below this one.
   JITSymbol findSymbolIn(ModuleSetHandleT H, const std::string &Name,
                          bool ExportedSymbolsOnly) {
-
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
     for (auto &BH : H->BaseLayerModuleSetHandles) {
       if (auto Symbol = BaseLayer.findSymbolIn(BH, Name, ExportedSymbolsOnly))
         return Symbol;
@@ -256,6 +349,11 @@ private:
       StubInfoMap;
     StubInfoMap StubInfos;
 
+    // The body of each definition, and the names of the definitions that it
+    // calls directly.
+    std::map<std::string, FunctionBody*> BodiesByName;
+    std::vector<std::pair<FunctionBody*, std::set<std::string>>> CalleeNames;
+
     // Now we need to take each of the extracted Modules and add them to
     // base layer. Each Module will be added individually to make sure they
     // can be compiled separately, and each will get its own lookaside
@@ -287,21 +385,33 @@ private:
         F.setName(Name + BodySuffix);
         F.setVisibility(GlobalValue::HiddenVisibility);
 
+        MSI.Bodies.push_back(llvm::make_unique<FunctionBody>());
+        FunctionBody *Body = MSI.Bodies.back().get();
+        Body->Name = Name;
+        Body->TrampolineAddr = CallbackInfo.getAddress();
+        Body->CallbackID = CallbackInfo.getID();
+        BodiesByName[Name] = Body;
+        CalleeNames.push_back(std::make_pair(Body, getDirectCallees(F)));
+
         auto KV = std::make_pair(std::move(Name), std::move(CallbackInfo));
         NewStubInfos.push_back(StubInfos.insert(StubInfos.begin(), KV));
       }
 
       auto H = addModule(std::move(SubM), MSI, LogicalModule);
 
-      // Set the compile actions for this module:
+      // Set the compile actions for this module. The compile callbacks go
+      // through getBodyAddress, which updates the stubs itself.
       for (auto &KVPair : NewStubInfos) {
         std::string BodyName = Mangle(KVPair->first + BodySuffix,
                                       M.getDataLayout());
+        FunctionBody *Body = BodiesByName[KVPair->first];
+        Body->Compile = [=]() {
+          return BaseLayer.findSymbolIn(H, BodyName, false).getAddress();
+        };
         auto &CCInfo = KVPair->second;
         CCInfo.setCompileAction(
-          [=](){
-            return BaseLayer.findSymbolIn(H, BodyName, false).getAddress();
-          });
+            [=]() { return getBodyAddress(*Body, false); });
+        CCInfo.setUpdateAction([](TargetAddress) {});
       }
 
     }
@@ -314,10 +424,104 @@ private:
     for (auto &KVPair : StubInfos) {
       std::string AddrName = Mangle(KVPair.first + AddrSuffix,
                                     M.getDataLayout());
-      auto &CCInfo = KVPair.second;
-      CCInfo.setUpdateAction(
-        getLocalFPUpdater(BaseLayer, StubsH, AddrName));
+      BodiesByName[KVPair.first]->Update =
+        getLocalFPUpdater(BaseLayer, StubsH, AddrName);
+    }
+
+    // Now that every body exists, link each one to the bodies it calls.
+    for (auto &BodyAndCallees : CalleeNames)
+      for (auto &CalleeName : BodyAndCallees.second) {
+        auto I = BodiesByName.find(CalleeName);
+        if (I != BodiesByName.end() && I->second != BodyAndCallees.first)
+          BodyAndCallees.first->Callees.push_back(I->second);
+      }
+  }
+
+  // Return the names of the functions that F calls directly.
+  static std::set<std::string> getDirectCallees(Function &F) {
+    std::set<std::string> Callees;
+    for (auto &BB : F)
+      for (auto &I : BB) {
+        CallSite CS(&I);
+        if (!CS)
+          continue;
+        if (Function *Callee = CS.getCalledFunction())
+          if (!Callee->isIntrinsic())
+            Callees.insert(Callee->getName());
+      }
+    return Callees;
+  }
+
+  // Compile the given body, unless it has been compiled already, and point
+  // its stub at it. If another thread is compiling the body, wait for it.
+  // Speculative is true on the compile thread. Otherwise the body was called,
+  // and if there is a compile thread, its callees are then queued for
+  // compilation.
+  TargetAddress getBodyAddress(FunctionBody &Body, bool Speculative) {
+    // Let the threads that wait for a body to be compiled go first.
+    if (Speculative) {
+      std::unique_lock<std::mutex> Lock(OnDemandMutex);
+      OnDemandDone.wait(Lock, [&]() { return OnDemandCompiles == 0; });
+    }
+
+    {
+      std::unique_lock<std::mutex> Lock(Body.StateMutex);
+      Body.StateChanged.wait(Lock, [&]() {
+        return Body.State != FunctionBody::Compiling;
+      });
+      if (Body.State != FunctionBody::NotCompiled)
+        return Body.Addr;
+      Body.State = FunctionBody::Compiling;
+    }
+
+    if (!Speculative) {
+      std::lock_guard<std::mutex> Lock(OnDemandMutex);
+      ++OnDemandCompiles;
+    }
+
+    TargetAddress Addr;
+    {
+      std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+      Addr = Body.Compile();
+      if (Addr)
+        Body.Update(Addr);
+      // Calling the body released its trampoline already. A speculatively
+      // compiled body releases it here, once the stub no longer uses it.
+      if (Addr && Speculative)
+        CompileCallbackMgr.releaseCompileCallback(Body.TrampolineAddr,
+                                                  Body.CallbackID);
+      DEBUG_WITH_TYPE("orc-cod", dbgs() << "Compiled " << Body.Name
+                                        << (Speculative ? " speculatively\n"
+                                                        : " on demand\n"));
     }
+
+    {
+      std::lock_guard<std::mutex> Lock(Body.StateMutex);
+      Body.Addr = Addr;
+      Body.State = FunctionBody::Compiled;
+    }
+    Body.StateChanged.notify_all();
+
+    if (!Speculative) {
+      {
+        std::lock_guard<std::mutex> Lock(OnDemandMutex);
+        --OnDemandCompiles;
+      }
+      OnDemandDone.notify_all();
+    }
+
+    if (!Speculative && CompileThread)
+      for (FunctionBody *Callee : Body.Callees) {
+        {
+          std::lock_guard<std::mutex> Lock(Callee->StateMutex);
+          if (Callee->State != FunctionBody::NotCompiled)
+            continue;
+        }
+        CompileThread->async(
+            [this, Callee]() { getBodyAddress(*Callee, true); });
+      }
+
+    return Addr;
   }
 
   // Add the given Module to the base layer using a memory manager that will
@@ -350,9 +554,14 @@ private:
           return nullptr;
         });
 
+    std::unique_ptr<RuntimeDyld::MemoryManager> MemMgr;
+    if (BuildMemMgr)
+      MemMgr = BuildMemMgr();
+    else
+      MemMgr = llvm::make_unique<SectionMemoryManager>();
+
     BaseLayerModuleSetHandleT H =
-      BaseLayer.addModuleSet(std::move(MSet),
-                             make_unique<SectionMemoryManager>(),
+      BaseLayer.addModuleSet(std::move(MSet), std::move(MemMgr),
                              std::move(Resolver));
     // Add this module to the logical module lookup.
     DylibLookup->addToLogicalModule(LogicalModule, H);
@@ -373,7 +582,21 @@ private:
 
   BaseLayerT &BaseLayer;
   CompileCallbackMgrT &CompileCallbackMgr;
+  MemoryManagerBuilderT BuildMemMgr;
   ModuleSetInfoListT ModuleSetInfos;
+
+  // Serializes all work on the base layer.
+  std::recursive_mutex LayerMutex;
+
+  // The number of compiles of bodies that were called. Speculative compiles
+  // do not start while it is non-zero.
+  std::mutex OnDemandMutex;
+  std::condition_variable OnDemandDone;
+  unsigned OnDemandCompiles;
+
+  // Declared last so that its destructor, which runs the queued speculative
+  // compiles, runs while the rest of the layer is still alive.
+  std::unique_ptr<ThreadPool> CompileThread;
 };
 
 } // End namespace orc.
@@ -20,6 +20,8 @@
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Mangler.h"
 #include "llvm/IR/Module.h"
+#include <atomic>
+#include <mutex>
 #include <sstream>
 
 namespace llvm {
@@ -39,10 +41,13 @@ public:
   class CompileCallbackInfo {
   public:
     CompileCallbackInfo(TargetAddress Addr, CompileFtor &Compile,
-                        UpdateFtor &Update)
-      : Addr(Addr), Compile(Compile), Update(Update) {}
+                        UpdateFtor &Update, uint64_t ID)
+      : Addr(Addr), Compile(Compile), Update(Update), ID(ID) {}
 
     TargetAddress getAddress() const { return Addr; }
+    /// @brief Identifies this callback among all the callbacks that have used
+    ///        the same trampoline.
+    uint64_t getID() const { return ID; }
     void setCompileAction(CompileFtor Compile) {
       this->Compile = std::move(Compile);
     }
@@ -53,6 +58,7 @@ public:
     TargetAddress Addr;
     CompileFtor &Compile;
     UpdateFtor &Update;
+    uint64_t ID;
   };
 
   /// @brief Construct a JITCompileCallbackManagerBase.
@@ -64,31 +70,38 @@ public:
   JITCompileCallbackManagerBase(TargetAddress ErrorHandlerAddress,
                                 unsigned NumTrampolinesPerBlock)
     : ErrorHandlerAddress(ErrorHandlerAddress),
-      NumTrampolinesPerBlock(NumTrampolinesPerBlock) {}
+      NumTrampolinesPerBlock(NumTrampolinesPerBlock), NextCallbackID(0) {}
 
   virtual ~JITCompileCallbackManagerBase() {}
 
   /// @brief Execute the callback for the given trampoline id. Called by the JIT
   ///        to compile functions on demand.
+  ///
+  ///   Several threads may execute callbacks at the same time. The compile and
+  /// update actions run without holding the manager's lock.
   TargetAddress executeCompileCallback(TargetAddress TrampolineID) {
-    TrampolineMapT::iterator I = ActiveTrampolines.find(TrampolineID);
-    // FIXME: Also raise an error in the Orc error-handler when we finally have
-    //        one.
-    if (I == ActiveTrampolines.end())
-      return ErrorHandlerAddress;
-
-    // Found a callback handler. Yank this trampoline out of the active list and
-    // put it back in the available trampolines list, then try to run the
-    // handler's compile and update actions.
-    // Moving the trampoline ID back to the available list first means there's at
-    // least one available trampoline if the compile action triggers a request for
-    // a new one.
-    AvailableTrampolines.push_back(I->first);
-    auto CallbackHandler = std::move(I->second);
-    ActiveTrampolines.erase(I);
+    CallbackHandler Handler;
+    {
+      std::lock_guard<std::mutex> Lock(TrampolinesMutex);
+      TrampolineMapT::iterator I = ActiveTrampolines.find(TrampolineID);
+      // FIXME: Also raise an error in the Orc error-handler when we finally
+      //        have one.
+      if (I == ActiveTrampolines.end())
+        return ErrorHandlerAddress;
+
+      // Found a callback handler. Yank this trampoline out of the active list
+      // and put it back in the available trampolines list, then try to run
+      // the handler's compile and update actions.
+      // Moving the trampoline ID back to the available list first means
+      // there's at least one available trampoline if the compile action
+      // triggers a request for a new one.
+      AvailableTrampolines.push_back(I->first);
+      Handler = std::move(I->second);
+      ActiveTrampolines.erase(I);
+    }
 
-    if (auto Addr = CallbackHandler.Compile()) {
-      CallbackHandler.Update(Addr);
+    if (auto Addr = Handler.Compile()) {
+      Handler.Update(Addr);
       return Addr;
     }
     return ErrorHandlerAddress;
@@ -97,11 +110,25 @@ public:
   /// @brief Get/create a compile callback with the given signature.
   virtual CompileCallbackInfo getCompileCallback(LLVMContext &Context) = 0;
 
+  /// @brief Return the trampoline of a callback that is no longer needed,
+  ///        e.g. because its function was compiled by other means, to the
+  ///        available trampolines. Does nothing if the callback has been
+  ///        executed, even if the trampoline has been reused since.
+  void releaseCompileCallback(TargetAddress TrampolineAddr, uint64_t ID) {
+    std::lock_guard<std::mutex> Lock(TrampolinesMutex);
+    TrampolineMapT::iterator I = ActiveTrampolines.find(TrampolineAddr);
+    if (I == ActiveTrampolines.end() || I->second.ID != ID)
+      return;
+    AvailableTrampolines.push_back(I->first);
+    ActiveTrampolines.erase(I);
+  }
+
 protected:
 
   struct CallbackHandler {
     CompileFtor Compile;
     UpdateFtor Update;
+    uint64_t ID;
   };
 
   TargetAddress ErrorHandlerAddress;
@@ -110,6 +137,10 @@ protected:
   typedef std::map<TargetAddress, CallbackHandler> TrampolineMapT;
   TrampolineMapT ActiveTrampolines;
   std::vector<TargetAddress> AvailableTrampolines;
+  uint64_t NextCallbackID;
+  /// @brief Guards ActiveTrampolines, AvailableTrampolines and
+  ///        NextCallbackID.
+  std::mutex TrampolinesMutex;
 };
 
 /// @brief Manage compile callbacks.
@@ -138,12 +169,14 @@ public:
 
   /// @brief Get/create a compile callback with the given signature.
   CompileCallbackInfo getCompileCallback(LLVMContext &Context) final {
+    std::lock_guard<std::mutex> Lock(this->TrampolinesMutex);
     TargetAddress TrampolineAddr = getAvailableTrampolineAddr(Context);
     auto &CallbackHandler =
       this->ActiveTrampolines[TrampolineAddr];
+    CallbackHandler.ID = this->NextCallbackID++;
 
     return CompileCallbackInfo(TrampolineAddr, CallbackHandler.Compile,
-                               CallbackHandler.Update);
+                               CallbackHandler.Update, CallbackHandler.ID);
   }
 
 private:
@@ -203,6 +236,17 @@ private:
   TargetAddress ResolverBlockAddr;
 };
 
+/// @brief Store \p Addr into the function pointer at \p FPAddr.
+///
+///   The store is atomic, so threads calling through the pointer concurrently
+/// either jump to the old target or to \p Addr.
+inline void updateImplPointer(void *FPAddr, TargetAddress Addr) {
+  static_assert(sizeof(std::atomic<uintptr_t>) == sizeof(uintptr_t),
+                "Function pointers can't be updated atomically");
+  reinterpret_cast<std::atomic<uintptr_t> *>(FPAddr)->store(
+      static_cast<uintptr_t>(Addr), std::memory_order_release);
+}
+
 /// @brief Get an update functor that updates the value of a named function
 ///        pointer.
 template <typename JITLayerT>
@@ -215,7 +259,7 @@ getLocalFPUpdater(JITLayerT &JIT, typename JITLayerT::ModuleSetHandleT H,
       assert(FPSym && "Cannot find function pointer to update.");
       void *FPAddr = reinterpret_cast<void*>(
                        static_cast<uintptr_t>(FPSym.getAddress()));
-      memcpy(FPAddr, &Addr, sizeof(uintptr_t));
+      updateImplPointer(FPAddr, Addr);
     };
   }
 
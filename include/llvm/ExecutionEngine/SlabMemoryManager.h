@@ -0,0 +1,171 @@
+//===- SlabMemoryManager.h - Pooled memory manager for JITed code -*- C++ -*-=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the declaration of a memory manager that takes section
+// memory from large slabs shared by many memory managers.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_SLABMEMORYMANAGER_H
+#define LLVM_EXECUTIONENGINE_SLABMEMORYMANAGER_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
+#include "llvm/Support/Memory.h"
+#include <map>
+#include <mutex>
+
+namespace llvm {
+
+/// A pool of memory for JITed sections, shared by SlabMemoryManagers.
+///
+/// The pool reserves memory from the system in large slabs, optionally backed
+/// by transparent huge pages, and hands it out in page ranges. Each slab holds
+/// a single kind of section, so that code, and hot code in particular, is
+/// packed contiguously instead of being interleaved with data. Page ranges
+/// that are returned to the pool are made read-write again and reused.
+///
+/// The pool may be shared by memory managers on several threads. It must
+/// outlive the memory managers that use it.
+class SlabMemoryPool {
+  SlabMemoryPool(const SlabMemoryPool&) = delete;
+  void operator=(const SlabMemoryPool&) = delete;
+
+public:
+  /// The kinds of memory that the pool keeps apart.
+  enum SegmentKind { HotCode, Code, ROData, RWData, NumSegmentKinds };
+
+  static const size_t DefaultSlabSize = 4 * 1024 * 1024;
+
+  /// Create a pool that reserves memory SlabSize bytes at a time. If
+  /// UseHugePages is true, the slabs are hinted to be backed by huge pages.
+  explicit SlabMemoryPool(size_t SlabSize = DefaultSlabSize,
+                          bool UseHugePages = false);
+  ~SlabMemoryPool();
+
+  /// \brief Take a read-write, page-aligned range of at least \p Size bytes
+  /// from the pool.
+  ///
+  /// Ranges are taken from the lowest free address first, so ranges that are
+  /// taken one after the other are usually adjacent.
+  sys::MemoryBlock allocate(SegmentKind Kind, size_t Size,
+                            std::error_code &EC);
+
+  /// \brief Return a range taken with allocate() to the pool.
+  ///
+  /// The range may have been split or merged with adjacent ranges of the same
+  /// kind, and may have any protection.
+  std::error_code release(SegmentKind Kind, sys::MemoryBlock Range);
+
+  /// Return the number of bytes that the pool has reserved from the system.
+  size_t getReservedSize() const;
+
+  /// Return the number of bytes that are currently handed out.
+  size_t getAllocatedSize() const;
+
+private:
+  struct Segment {
+    SmallVector<sys::MemoryBlock, 4> Slabs;
+    // Free page ranges, keyed by start address. Adjacent ranges are merged.
+    std::map<uintptr_t, size_t> FreeRanges;
+  };
+
+  void addFreeRange(Segment &S, uintptr_t Start, size_t Size);
+
+  const size_t SlabSize;
+  const bool UseHugePages;
+  mutable std::mutex PoolMutex;
+  Segment Segments[NumSegmentKinds];
+  size_t ReservedSize;
+  size_t AllocatedSize;
+};
+
+/// A memory manager that takes its memory from a SlabMemoryPool.
+///
+/// Unlike SectionMemoryManager, which maps memory for each group of sections
+/// separately, this memory manager takes page ranges from a shared pool and
+/// packs sections into them. finalizeMemory() changes the permissions of each
+/// run of adjacent ranges with a single call. No page is both writable and
+/// executable once memory is finalized, and pages that hold finalized code or
+/// read-only data are never handed out for writing again until the memory
+/// manager is destroyed. At that point all its memory returns to the pool.
+///
+/// Code goes to the pool's hot code slabs if the memory manager is created
+/// with HotCode set. JITs can use this to keep their most frequently executed
+/// code together.
+class SlabMemoryManager : public RTDyldMemoryManager {
+  SlabMemoryManager(const SlabMemoryManager&) = delete;
+  void operator=(const SlabMemoryManager&) = delete;
+
+public:
+  explicit SlabMemoryManager(SlabMemoryPool &Pool, bool HotCode = false);
+  ~SlabMemoryManager() override;
+
+  /// \brief Allocates a memory block of (at least) the given size suitable for
+  /// executable code.
+  ///
+  /// The value of \p Alignment must be a power of two.  If \p Alignment is zero
+  /// a default alignment of 16 will be used.
+  uint8_t *allocateCodeSection(uintptr_t Size, unsigned Alignment,
+                               unsigned SectionID,
+                               StringRef SectionName) override;
+
+  /// \brief Allocates a memory block of (at least) the given size suitable for
+  /// data.
+  ///
+  /// The value of \p Alignment must be a power of two.  If \p Alignment is zero
+  /// a default alignment of 16 will be used.
+  uint8_t *allocateDataSection(uintptr_t Size, unsigned Alignment,
+                               unsigned SectionID, StringRef SectionName,
+                               bool isReadOnly) override;
+
+  /// \brief Make the code allocated since the last call executable and the
+  /// read-only data read-only, and flush the instruction cache.
+  ///
+  /// \returns true if an error occurred, false otherwise.
+  bool finalizeMemory(std::string *ErrMsg = nullptr) override;
+
+  /// \brief Invalidate instruction cache for code sections that were
+  /// allocated since the last call to finalizeMemory.
+  ///
+  /// This method is called from finalizeMemory.
+  virtual void invalidateInstructionCache();
+
+private:
+  struct MemoryGroup {
+    MemoryGroup(SlabMemoryPool::SegmentKind Kind)
+        : Kind(Kind), FirstPending(0), Cur(0), End(0) {}
+
+    SlabMemoryPool::SegmentKind Kind;
+    // The page ranges taken from the pool, in the order they were taken.
+    SmallVector<sys::MemoryBlock, 8> Ranges;
+    // Ranges[FirstPending...] have not been finalized yet.
+    unsigned FirstPending;
+    // Unused space at the end of the last range.
+    uintptr_t Cur, End;
+  };
+
+  uint8_t *allocateSection(MemoryGroup &MemGroup, uintptr_t Size,
+                           unsigned Alignment);
+
+  /// Return the unused pages at the end of the last range to the pool.
+  void trimLastRange(MemoryGroup &MemGroup);
+
+  std::error_code applyMemoryGroupPermissions(MemoryGroup &MemGroup,
+                                              unsigned Permissions);
+
+  SlabMemoryPool &Pool;
+  MemoryGroup CodeMem;
+  MemoryGroup RWDataMem;
+  MemoryGroup RODataMem;
+};
+
+}
+
+#endif // LLVM_EXECUTIONENGINE_SLABMEMORYMANAGER_H
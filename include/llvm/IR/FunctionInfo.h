@@ -0,0 +1,153 @@
+//===-- llvm/IR/FunctionInfo.h - Function summary index ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// @file
+/// This file defines FunctionSummary, a compact description of a function
+/// definition, and FunctionInfoIndex, the index of function summaries used to
+/// drive summary-based ("thin") link time optimization.
+///
+/// A summary records what a link-time importer needs to decide whether a
+/// function is worth bringing into another module without having to load the
+/// IR of the module defining it: the linkage, the size, a coarse hotness
+/// estimate and the outgoing call edges.
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_FUNCTIONINFO_H
+#define LLVM_IR_FUNCTIONINFO_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/GlobalValue.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+class Function;
+class Module;
+
+/// \brief An outgoing edge of the call graph recorded in a FunctionSummary.
+struct CalleeInfo {
+  /// The name of the called function.
+  std::string Name;
+  /// The number of call sites of the callee in the caller.
+  unsigned NumCallSites;
+
+  CalleeInfo(StringRef Name, unsigned NumCallSites)
+      : Name(Name), NumCallSites(NumCallSites) {}
+};
+
+/// \brief Summary of a single function definition.
+class FunctionSummary {
+public:
+  /// Bits of the summary flags field, as stored in bitcode.
+  enum Flags {
+    /// The body can be copied into another module as an available_externally
+    /// definition without changing the meaning of the program.
+    FF_Importable = 1 << 0,
+    /// The function is unlikely to be executed (it is marked cold).
+    FF_Cold = 1 << 1
+  };
+
+private:
+  /// Path of the module defining the function. Owned by the index.
+  StringRef ModulePath;
+  GlobalValue::LinkageTypes Linkage;
+  unsigned InstCount;
+  unsigned FunctionFlags;
+  std::vector<CalleeInfo> Calls;
+
+public:
+  FunctionSummary(GlobalValue::LinkageTypes Linkage, unsigned InstCount,
+                  unsigned FunctionFlags)
+      : Linkage(Linkage), InstCount(InstCount), FunctionFlags(FunctionFlags) {}
+
+  StringRef getModulePath() const { return ModulePath; }
+  void setModulePath(StringRef Path) { ModulePath = Path; }
+
+  GlobalValue::LinkageTypes getLinkage() const { return Linkage; }
+  unsigned getInstCount() const { return InstCount; }
+  unsigned getFlags() const { return FunctionFlags; }
+  bool isImportable() const { return FunctionFlags & FF_Importable; }
+  bool isCold() const { return FunctionFlags & FF_Cold; }
+
+  ArrayRef<CalleeInfo> calls() const { return Calls; }
+  void addCall(StringRef Callee, unsigned NumCallSites) {
+    Calls.emplace_back(Callee, NumCallSites);
+  }
+
+  /// Compute the summary of the definition F.
+  static std::unique_ptr<FunctionSummary> create(const Function &F);
+};
+
+/// \brief The list of summaries recorded for a function name. There is more
+/// than one entry when several modules define a function of that name, as
+/// is the case for linkonce_odr and weak_odr functions.
+typedef std::vector<std::unique_ptr<FunctionSummary>> FunctionSummaryList;
+
+/// \brief Index of the function summaries of one or more modules.
+///
+/// A per-module index, as stored in the bitcode of a single module, only
+/// knows about one module. The combined index that is built at link time by
+/// merging per-module indexes knows which module defines each function, so
+/// that a backend compiling one module can find and import the bodies of the
+/// functions it calls.
+class FunctionInfoIndex {
+  /// Map from function name to the summaries of its definitions.
+  StringMap<FunctionSummaryList> FunctionMap;
+
+  /// Map from module path to the module ID used when writing the index.
+  StringMap<uint64_t> ModulePathStringTable;
+
+public:
+  typedef StringMap<FunctionSummaryList>::const_iterator const_iterator;
+
+  FunctionInfoIndex() = default;
+  FunctionInfoIndex(const FunctionInfoIndex &) = delete;
+  FunctionInfoIndex &operator=(const FunctionInfoIndex &) = delete;
+
+  const_iterator begin() const { return FunctionMap.begin(); }
+  const_iterator end() const { return FunctionMap.end(); }
+  bool empty() const { return FunctionMap.empty(); }
+
+  /// Register a module path and return the copy owned by the index. The ID is
+  /// assigned in registration order.
+  StringRef addModulePath(StringRef ModPath);
+
+  /// Return the ID of the registered module path ModPath.
+  uint64_t getModuleId(StringRef ModPath) const {
+    return ModulePathStringTable.lookup(ModPath);
+  }
+
+  const StringMap<uint64_t> &modulePaths() const {
+    return ModulePathStringTable;
+  }
+
+  /// Add the summary of a definition of FuncName in ModPath, which is
+  /// registered if needed.
+  void addFunctionSummary(StringRef FuncName, StringRef ModPath,
+                          std::unique_ptr<FunctionSummary> Summary);
+
+  /// Return the summaries of the definitions of FuncName, or nullptr if there
+  /// is none.
+  const FunctionSummaryList *findFunctionSummaryList(StringRef FuncName) const;
+
+  /// Move all summaries of Other into this index.
+  void mergeFrom(std::unique_ptr<FunctionInfoIndex> Other);
+};
+
+/// Build the index of the function definitions of M that are visible to
+/// other modules. Local functions are never imported, so they are left out;
+/// a function that refers to one is recorded as not importable.
+std::unique_ptr<FunctionInfoIndex> buildFunctionInfoIndex(const Module &M);
+
+} // End llvm namespace
+
+#endif
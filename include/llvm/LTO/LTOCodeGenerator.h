@@ -40,6 +40,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Linker/Linker.h"
+#include "llvm/Support/FileCache.h"
 #include "llvm/Target/TargetOptions.h"
 #include <string>
 #include <vector>
@@ -79,8 +80,22 @@ struct LTOCodeGenerator {
   void setAttr(const char *mAttr) { MAttr = mAttr; }
   void setOptLevel(unsigned optLevel) { OptLevel = optLevel; }
 
+  // Set the number of partitions the merged module is split into by
+  // compileOptimizedToFiles(). Each partition is compiled on its own thread.
+  void setParallelism(unsigned parallelism) { Parallelism = parallelism; }
+
   void addMustPreserveSymbol(const char *sym) { MustPreserveSymbols[sym] = 1; }
 
+  // Reuse the object files of a previous link when the merged module and all
+  // the options are the same. The object files are cached in the given
+  // directory; see FileCache for the other settings.
+  void setCacheDir(const char *path) { Cache.setPath(path); }
+  void setCachePruningInterval(int seconds) {
+    Cache.setPruningInterval(seconds);
+  }
+  void setCacheExpiration(unsigned seconds) { Cache.setExpiration(seconds); }
+  void setCacheMaxSize(uint64_t bytes) { Cache.setMaxSize(bytes); }
+
   // To pass options to the driver and optimization passes. These options are
   // not necessarily for debugging purpose (The function name is misleading).
   // This function should be called before LTOCodeGenerator::compilexxx(),
@@ -120,7 +135,9 @@ struct LTOCodeGenerator {
                       bool disableVectorization,
                       std::string &errMsg);
 
-  // Optimizes the merged module. Returns true on success.
+  // Optimizes the merged module. Returns true on success. With a cache
+  // directory, the optimization is skipped if the object files for the
+  // merged module are found in the cache.
   bool optimize(bool disableInline,
                 bool disableGVNLoadPRE,
                 bool disableVectorization,
@@ -131,6 +148,22 @@ struct LTOCodeGenerator {
   // if the compilation was not successful.
   const void *compileOptimized(size_t *length, std::string &errMsg);
 
+  // Compiles the merged optimized module into one object file per partition
+  // (see setParallelism()), generating code for the partitions in parallel.
+  // The paths to the object files are available through getNumObjectFiles()
+  // and getObjectFilePath(). Return true on success.
+  //
+  // NOTE that, as with compile_to_file(), it is up to the linker to remove the
+  // object files.
+  bool compileOptimizedToFiles(std::string &errMsg);
+
+  unsigned getNumObjectFiles() const { return NativeObjectPaths.size(); }
+  const char *getObjectFilePath(unsigned index) const {
+    if (index < NativeObjectPaths.size())
+      return NativeObjectPaths[index].c_str();
+    return nullptr;
+  }
+
   void setDiagnosticHandler(lto_diagnostic_handler_t, void *);
 
   LLVMContext &getContext() { return Context; }
@@ -138,7 +171,13 @@ struct LTOCodeGenerator {
 private:
   void initializeLTOPasses();
 
-  bool compileOptimized(raw_pwrite_stream &out, std::string &errMsg);
+  void runOptimizationPasses(bool disableInline, bool disableGVNLoadPRE,
+                             bool disableVectorization);
+  std::string computeCacheKey(bool disableInline, bool disableGVNLoadPRE,
+                              bool disableVectorization);
+
+  bool compileOptimized(ArrayRef<raw_pwrite_stream *> out,
+                        std::string &errMsg);
   bool compileOptimizedToFile(const char **name, std::string &errMsg);
   void applyScopeRestrictions();
   void applyRestriction(GlobalValue &GV, ArrayRef<StringRef> Libcalls,
@@ -169,11 +208,24 @@ private:
   std::string MCpu;
   std::string MAttr;
   std::string NativeObjectPath;
+  std::vector<std::string> NativeObjectPaths;
   TargetOptions Options;
   unsigned OptLevel;
+  unsigned Parallelism;
   lto_diagnostic_handler_t DiagHandler;
   void *DiagContext;
   LTOModule *OwnedModule;
+
+  FileCache Cache;
+  // The key of the objects that compileOptimized() generates, when caching.
+  std::string CacheKey;
+  // The objects found in the cache by optimize(), which then does not run
+  // the optimization passes. The options it was called with are kept in case
+  // the objects are for a different number of outputs.
+  std::vector<std::unique_ptr<MemoryBuffer>> CachedObjects;
+  bool DeferredDisableInline;
+  bool DeferredDisableGVNLoadPRE;
+  bool DeferredDisableVectorization;
 };
 }
 #endif
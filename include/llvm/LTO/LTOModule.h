@@ -70,6 +70,10 @@ public:
   static bool isBitcodeFile(const void *mem, size_t length);
   static bool isBitcodeFile(const char *path);
 
+  /// Returns 'true' if the bitcode in the memory range carries a function
+  /// summary, and can thus take part in thin LTO.
+  static bool isThinLTO(const void *mem, size_t length);
+
   /// Returns 'true' if the memory buffer is LLVM bitcode for the specified
   /// triple.
   static bool isBitcodeForTarget(MemoryBuffer *memBuffer,
@@ -0,0 +1,108 @@
+//===-ThinLTOCodeGenerator.h - LLVM Link Time Optimizer -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the ThinLTOCodeGenerator class, which drives summary-based
+// ("thin") link time optimization.
+//
+// Unlike LTOCodeGenerator, which links every module into a single merged
+// module, the thin code generator only reads the function summaries of the
+// modules to build a combined index. Each module is then compiled on its own,
+// in its own LLVMContext: it imports the bodies of the small functions it
+// calls from the other modules, is optimized, and is compiled to an object
+// file. Modules are compiled in parallel and memory use is bounded by the
+// size of the largest modules rather than by the size of the program.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LTO_THINLTOCODEGENERATOR_H
+#define LLVM_LTO_THINLTOCODEGENERATOR_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CodeGen.h"
+#include "llvm/Support/FileCache.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Target/TargetOptions.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class FunctionInfoIndex;
+
+/// C++ class which implements the opaque thinlto_code_gen_t type.
+class ThinLTOCodeGenerator {
+public:
+  ThinLTOCodeGenerator();
+  ~ThinLTOCodeGenerator();
+
+  /// Add the bitcode module in Data to the link. Identifier names the module
+  /// in the combined index and must be unique among the modules of the link.
+  /// The data is not copied and must outlive the code generator.
+  void addModule(StringRef Identifier, StringRef Data);
+
+  void setTargetOptions(TargetOptions Options) { this->Options = Options; }
+  void setCpu(StringRef Cpu) { MCpu = Cpu; }
+  void setAttr(StringRef Attr) { MAttr = Attr; }
+  void setCodePICModel(Reloc::Model Model) { RelocModel = Model; }
+
+  /// Set the IR optimization and code generation level, between 0 and 3.
+  void setOptLevel(unsigned Level) { OptLevel = Level; }
+
+  /// Set the number of modules compiled concurrently. The default is 1.
+  void setParallelism(unsigned N) { Parallelism = N ? N : 1; }
+
+  /// Reuse the object file of a module from a previous link when the module,
+  /// the functions it imports and the options are the same. The object files
+  /// are cached in the given directory; see FileCache for the other settings.
+  void setCacheDir(StringRef Path) { Cache.setPath(Path); }
+  void setCachePruningInterval(int Seconds) {
+    Cache.setPruningInterval(Seconds);
+  }
+  void setCacheExpiration(unsigned Seconds) { Cache.setExpiration(Seconds); }
+  void setCacheMaxSize(uint64_t Bytes) { Cache.setMaxSize(Bytes); }
+
+  /// Merge the function summaries of all modules into a combined index.
+  /// Returns nullptr and sets ErrMsg on error.
+  std::unique_ptr<FunctionInfoIndex> linkCombinedIndex(std::string &ErrMsg);
+
+  /// Import, optimize and compile every module to an object file. Returns
+  /// false and sets ErrMsg on error.
+  bool run(std::string &ErrMsg);
+
+  /// Return the object files produced by run(), in the order in which the
+  /// modules were added.
+  ArrayRef<std::unique_ptr<MemoryBuffer>> getProducedBinaries() const {
+    return ProducedBinaries;
+  }
+
+private:
+  /// Import into, optimize and compile the module with the given index.
+  bool processModule(unsigned ModuleIndex, const FunctionInfoIndex &Index,
+                     std::string &ErrMsg);
+
+  struct InputModule {
+    std::string Identifier;
+    StringRef Data;
+  };
+  std::vector<InputModule> Modules;
+  std::vector<std::unique_ptr<MemoryBuffer>> ProducedBinaries;
+
+  TargetOptions Options;
+  std::string MCpu;
+  std::string MAttr;
+  Reloc::Model RelocModel;
+  unsigned OptLevel;
+  unsigned Parallelism;
+  FileCache Cache;
+};
+
+} // End llvm namespace
+
+#endif
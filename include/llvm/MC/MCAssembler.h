@@ -306,11 +306,45 @@ class MCRelaxableFragment : public MCEncodedFragmentWithFixups {
   /// Fixups - The list of fixups in this fragment.
   SmallVector<MCFixup, 1> Fixups;
 
+public:
+  /// The value of the only fixup of the fragment, as last evaluated during
+  /// relaxation. When the fixup is PC-relative to a label in the same section,
+  /// its value only depends on the distance between the fragment and the
+  /// fragment of the label, so it need not be evaluated again until that
+  /// distance changes.
+  struct FixupValueCache {
+    /// Whether TargetFragment has been computed for the current fixup.
+    bool Analyzed;
+    /// Whether Distance, Value and IsResolved hold an evaluation.
+    bool HasValue;
+    bool IsResolved;
+    /// The fragment of the label the fixup refers to, or null if the value of
+    /// the fixup depends on more than the distance to it.
+    const MCFragment *TargetFragment;
+    int64_t Distance;
+    uint64_t Value;
+
+    FixupValueCache() { reset(); }
+    void reset() {
+      Analyzed = HasValue = IsResolved = false;
+      TargetFragment = nullptr;
+      Distance = 0;
+      Value = 0;
+    }
+  };
+
+private:
+  mutable FixupValueCache Cache;
+
 public:
   MCRelaxableFragment(const MCInst &Inst, const MCSubtargetInfo &STI,
                       MCSectionData *SD = nullptr)
       : MCEncodedFragmentWithFixups(FT_Relaxable, SD), Inst(Inst), STI(STI) {}
 
+  /// Get the cached value of the fixup. The assembler must reset it whenever
+  /// the fixups of the fragment change.
+  FixupValueCache &getFixupValueCache() const { return Cache; }
+
   SmallVectorImpl<char> &getContents() override { return Contents; }
   const SmallVectorImpl<char> &getContents() const override { return Contents; }
 
@@ -947,6 +981,12 @@ private:
                      const MCFixup &Fixup, const MCFragment *DF,
                      MCValue &Target, uint64_t &Value) const;
 
+  /// Evaluate the fixup of a relaxable fragment, like evaluateFixup, reusing
+  /// the value cached in the fragment when the layout did not change it.
+  bool evaluateRelaxableFixup(const MCAsmLayout &Layout, const MCFixup &Fixup,
+                              const MCRelaxableFragment *DF,
+                              uint64_t &Value) const;
+
   /// Check whether a fixup can be satisfied, or whether it needs to be relaxed
   /// (increased in size, in order to hold its value correctly).
   bool fixupNeedsRelaxation(const MCFixup &Fixup, const MCRelaxableFragment *DF,
@@ -997,10 +1037,16 @@ public:
   /// defining a separate atom.
   bool isSymbolLinkerVisible(const MCSymbol &SD) const;
 
-  /// Emit the section contents using the given object writer.
+  /// Emit the section contents using the assembler's object writer.
   void writeSectionData(const MCSectionData *Section,
                         const MCAsmLayout &Layout) const;
 
+  /// Emit the section contents using the given object writer. Once layout is
+  /// final this only reads the assembler and the layout, so the contents of
+  /// different sections can be written concurrently to different writers.
+  void writeSectionData(const MCSectionData *Section,
+                        const MCAsmLayout &Layout, MCObjectWriter *OW) const;
+
   /// Check whether a given symbol has been flagged with .thumb_func.
   bool isThumbFunc(const MCSymbol *Func) const;
 
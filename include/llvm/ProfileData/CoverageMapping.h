@@ -18,6 +18,7 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/ADT/iterator.h"
 #include "llvm/Support/Debug.h"
@@ -277,6 +278,9 @@ class FunctionRecordIterator
   ArrayRef<FunctionRecord> Records;
   ArrayRef<FunctionRecord>::iterator Current;
   StringRef Filename;
+  /// \brief If not null, the indices into Records of the only records that
+  /// may have \c Filename as their primary file, starting with \c Current.
+  const unsigned *Candidate, *CandidatesEnd;
 
   /// \brief Skip records whose primary file is not \c Filename.
   void skipOtherFiles();
@@ -284,11 +288,22 @@ class FunctionRecordIterator
 public:
   FunctionRecordIterator(ArrayRef<FunctionRecord> Records_,
                          StringRef Filename = "")
-      : Records(Records_), Current(Records.begin()), Filename(Filename) {
+      : Records(Records_), Current(Records.begin()), Filename(Filename),
+        Candidate(nullptr), CandidatesEnd(nullptr) {
     skipOtherFiles();
   }
 
-  FunctionRecordIterator() : Current(Records.begin()) {}
+  /// \brief Iterate over the records of \p Filename among the records at
+  /// \p Candidates, which are sorted indices into \p Records_.
+  FunctionRecordIterator(ArrayRef<FunctionRecord> Records_, StringRef Filename,
+                         ArrayRef<unsigned> Candidates)
+      : Records(Records_), Current(Records.end()), Filename(Filename),
+        Candidate(Candidates.begin()), CandidatesEnd(Candidates.end()) {
+    skipOtherFiles();
+  }
+
+  FunctionRecordIterator()
+      : Current(Records.begin()), Candidate(nullptr), CandidatesEnd(nullptr) {}
 
   bool operator==(const FunctionRecordIterator &RHS) const {
     return Current == RHS.Current && Filename == RHS.Filename;
@@ -298,7 +313,10 @@ public:
 
   FunctionRecordIterator &operator++() {
     assert(Current != Records.end() && "incremented past end");
-    ++Current;
+    if (Candidate)
+      ++Candidate;
+    else
+      ++Current;
     skipOtherFiles();
     return *this;
   }
@@ -398,9 +416,18 @@ public:
 class CoverageMapping {
   std::vector<FunctionRecord> Functions;
   unsigned MismatchedFunctionCount;
+  /// \brief Map every covered file to the indices into Functions of the
+  /// functions that have regions in it, in increasing order.
+  StringMap<std::vector<unsigned>> FileFunctions;
 
   CoverageMapping() : MismatchedFunctionCount(0) {}
 
+  /// \brief Fill FileFunctions once every function has been loaded.
+  void buildFileIndex();
+
+  /// \brief Return the indices of the functions with regions in \p Filename.
+  ArrayRef<unsigned> getFileFunctions(StringRef Filename) const;
+
 public:
   /// \brief Load the coverage mapping using the given readers.
   static ErrorOr<std::unique_ptr<CoverageMapping>>
@@ -426,7 +453,10 @@ public:
   /// The given filename must be the name as recorded in the coverage
   /// information. That is, only names returned from getUniqueSourceFiles will
   /// yield a result.
-  CoverageData getCoverageForFile(StringRef Filename);
+  ///
+  /// This, like the other queries, does not modify the coverage mapping, so
+  /// the coverage of several files may be computed concurrently.
+  CoverageData getCoverageForFile(StringRef Filename) const;
 
   /// \brief Gets all of the functions covered by this profile.
   iterator_range<FunctionRecordIterator> getCoveredFunctions() const {
@@ -437,7 +467,8 @@ public:
   /// \brief Gets all of the functions in a particular file.
   iterator_range<FunctionRecordIterator>
   getCoveredFunctions(StringRef Filename) const {
-    return make_range(FunctionRecordIterator(Functions, Filename),
+    return make_range(FunctionRecordIterator(Functions, Filename,
+                                             getFileFunctions(Filename)),
                       FunctionRecordIterator());
   }
 
@@ -445,13 +476,14 @@ public:
   ///
   /// Fucntions that are instantiated more than once, such as C++ template
   /// specializations, have distinct coverage records for each instantiation.
-  std::vector<const FunctionRecord *> getInstantiations(StringRef Filename);
+  std::vector<const FunctionRecord *>
+  getInstantiations(StringRef Filename) const;
 
   /// \brief Get the coverage for a particular function.
-  CoverageData getCoverageForFunction(const FunctionRecord &Function);
+  CoverageData getCoverageForFunction(const FunctionRecord &Function) const;
 
   /// \brief Get the coverage for an expansion within a coverage set.
-  CoverageData getCoverageForExpansion(const ExpansionRecord &Expansion);
+  CoverageData getCoverageForExpansion(const ExpansionRecord &Expansion) const;
 };
 
 } // end namespace coverage
@@ -32,6 +32,8 @@ public:
   typedef SmallDenseMap<uint64_t, std::vector<uint64_t>, 1> CounterData;
 private:
   StringMap<CounterData> FunctionData;
+  /// The name and hash of each function, in the order they were first added.
+  std::vector<std::pair<StringRef, uint64_t>> FunctionOrder;
   uint64_t MaxFunctionCount;
 public:
   InstrProfWriter() : MaxFunctionCount(0) {}
@@ -42,6 +44,12 @@ public:
   std::error_code addFunctionCounts(StringRef FunctionName,
                                     uint64_t FunctionHash,
                                     ArrayRef<uint64_t> Counters);
+  /// Add the counts of every function of \c IPW, in the order they were first
+  /// added to it. When no error is returned, merging the writers of
+  /// consecutive runs of inputs this way produces the same profile as adding
+  /// all the inputs to one writer. Otherwise the first error is returned, and
+  /// the records that could be merged are.
+  std::error_code mergeRecordsFromWriter(InstrProfWriter &&IPW);
   /// Write the profile to \c OS
   void write(raw_fd_ostream &OS);
   /// Write the profile, returning the raw data. For testing.
@@ -32,7 +32,8 @@ enum class sampleprof_error {
   too_large,
   truncated,
   malformed,
-  unrecognized_format
+  unrecognized_format,
+  zlib_unavailable
 };
 
 inline std::error_code make_error_code(sampleprof_error E) {
@@ -59,6 +60,27 @@ static inline uint64_t SPMagic() {
 
 static inline uint64_t SPVersion() { return 100; }
 
+/// \brief Magic identifier of the indexed binary format.
+///
+/// Profiles in this format start with a name table and an index of the
+/// offset of each function profile, so that readers can load the profiles of
+/// a few functions without decoding the whole file.
+static inline uint64_t SPIndexedMagic() {
+  return uint64_t('S') << (64 - 8) | uint64_t('P') << (64 - 16) |
+         uint64_t('R') << (64 - 24) | uint64_t('O') << (64 - 32) |
+         uint64_t('F') << (64 - 40) | uint64_t('I') << (64 - 48) |
+         uint64_t('D') << (64 - 56) | uint64_t(0xff);
+}
+
+static inline uint64_t SPIndexedVersion() { return 1; }
+
+/// \brief Flags of the indexed binary format header.
+enum SPIndexedFlags {
+  /// The name table, the function index and the function profiles are
+  /// compressed with zlib.
+  SPIF_Compressed = 1 << 0
+};
+
 /// \brief Represents the relative location of an instruction.
 ///
 /// Instruction locations are specified by the line offset from the
@@ -16,6 +16,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/Function.h"
@@ -55,9 +56,11 @@ namespace sampleprof {
 ///      protection against source code shuffling, line numbers should
 ///      be relative to the start of the function.
 ///
-/// The reader supports two file formats: text and binary. The text format
-/// is useful for debugging and testing, while the binary format is more
-/// compact. They can both be used interchangeably.
+/// The reader supports three file formats: text, binary and indexed binary.
+/// The text format is useful for debugging and testing, while the binary
+/// formats are more compact. The indexed binary format also lets the reader
+/// load only the profiles of the functions defined in a module. They can all
+/// be used interchangeably.
 class SampleProfileReader {
 public:
   SampleProfileReader(std::unique_ptr<MemoryBuffer> B, LLVMContext &C)
@@ -71,6 +74,14 @@ public:
   /// \brief Read sample profiles from the associated file.
   virtual std::error_code read() = 0;
 
+  /// \brief Restrict the profiles loaded by read() to the functions defined
+  /// in \p M.
+  ///
+  /// Readers of formats that can locate the profile of a function without
+  /// decoding the others skip the remaining profiles. The other readers
+  /// still load every profile of the file.
+  virtual void collectFuncsToUse(const Module &M) {}
+
   /// \brief Print the profile for \p FName on stream \p OS.
   void dumpFunctionProfile(StringRef FName, raw_ostream &OS = dbgs());
 
@@ -163,6 +174,58 @@ protected:
   const uint8_t *End;
 };
 
+/// \brief Reader of the indexed binary format.
+///
+/// readHeader() decodes the name table and the function index. read() then
+/// only decodes the profiles of the functions given to collectFuncsToUse(),
+/// or every profile if it was not called.
+class SampleProfileReaderIndexed : public SampleProfileReaderBinary {
+public:
+  SampleProfileReaderIndexed(std::unique_ptr<MemoryBuffer> B, LLVMContext &C)
+      : SampleProfileReaderBinary(std::move(B), C), BodiesStart(nullptr),
+        UseAllFunctions(true) {}
+
+  /// \brief Read and validate the file header, the name table and the
+  /// function index.
+  std::error_code readHeader() override;
+
+  /// \brief Read the sample profiles of the functions to use.
+  std::error_code read() override;
+
+  /// \brief Only load the profiles of the functions defined in \p M.
+  void collectFuncsToUse(const Module &M) override;
+
+  /// \brief Return true if \p Buffer is in the format supported by this class.
+  static bool hasFormat(const MemoryBuffer &Buffer);
+
+private:
+  /// \brief Read an index into the name table and return the name.
+  ErrorOr<StringRef> readNameRef();
+
+  /// \brief Read the function profile starting at the current location.
+  std::error_code readFunctionProfile(FunctionSamples &FProfile);
+
+  /// \brief Holds the contents of the file after the header, if they are
+  /// compressed.
+  SmallVector<char, 0> Uncompressed;
+
+  /// \brief Function names, indexed by the profiles.
+  std::vector<StringRef> NameTable;
+
+  /// \brief The name of each function profile, as an index into NameTable,
+  /// and its offset from BodiesStart.
+  std::vector<std::pair<uint32_t, uint64_t>> FunctionIndex;
+
+  /// \brief Points to the first function profile.
+  const uint8_t *BodiesStart;
+
+  /// \brief Names of the functions whose profiles are loaded by read().
+  StringSet<> FuncsToUse;
+
+  /// \brief Whether read() loads every profile of the file.
+  bool UseAllFunctions;
+};
+
 } // End namespace sampleprof
 
 } // End namespace llvm
@@ -25,7 +25,13 @@ namespace llvm {
 
 namespace sampleprof {
 
-enum SampleProfileFormat { SPF_None = 0, SPF_Text, SPF_Binary, SPF_GCC };
+enum SampleProfileFormat {
+  SPF_None = 0,
+  SPF_Text,
+  SPF_Binary,
+  SPF_Indexed,
+  SPF_GCC
+};
 
 /// \brief Sample-based profile writer. Base class.
 class SampleProfileWriter {
@@ -54,7 +60,7 @@ public:
       if (!write(Name, P[Name]))
         return false;
     }
-    return true;
+    return finalize();
   }
 
   /// \brief Write all the sample profiles in the given map of samples.
@@ -67,13 +73,23 @@ public:
       if (!write(FName, Profile))
         return false;
     }
-    return true;
+    return finalize();
   }
 
+  /// \brief Finish writing the file once every profile has been written.
+  ///
+  /// Writers that cannot emit a profile until they know all of them emit the
+  /// file here. The writers of whole modules and of maps of samples call it,
+  /// after which no more profiles may be written.
+  ///
+  /// \returns true if the file was updated successfully. False, otherwise.
+  virtual bool finalize() { return true; }
+
   /// \brief Profile writer factory. Create a new writer based on the value of
-  /// \p Format.
+  /// \p Format. \p Compress is only meaningful for the indexed format.
   static ErrorOr<std::unique_ptr<SampleProfileWriter>>
-  create(StringRef Filename, SampleProfileFormat Format);
+  create(StringRef Filename, SampleProfileFormat Format,
+         bool Compress = false);
 
 protected:
   /// \brief Output stream where to emit the profile to.
@@ -103,6 +119,42 @@ public:
   }
 };
 
+/// \brief Sample-based profile writer (indexed binary format).
+///
+/// The profiles are buffered as they are written, and the file is emitted by
+/// finalize(), once the name table and the function index are complete.
+class SampleProfileWriterIndexed : public SampleProfileWriter {
+public:
+  SampleProfileWriterIndexed(StringRef F, std::error_code &EC, bool Compress);
+
+  bool write(StringRef F, const FunctionSamples &S) override;
+  bool write(const Module &M, StringMap<FunctionSamples> &P) {
+    return SampleProfileWriter::write(M, P);
+  }
+  bool finalize() override;
+
+private:
+  /// \brief Return the index of \p Name in the name table, adding it if
+  /// needed.
+  uint32_t getNameIndex(StringRef Name);
+
+  /// \brief Whether to compress everything after the file header.
+  bool Compress;
+
+  /// \brief Map every name of the name table to its index.
+  StringMap<uint32_t> NameIndex;
+
+  /// \brief The names of the name table, in order.
+  std::vector<StringRef> NameTable;
+
+  /// \brief The name of each function profile, as an index into NameTable,
+  /// and its offset in Bodies.
+  std::vector<std::pair<uint32_t, uint64_t>> FunctionIndex;
+
+  /// \brief The encoded function profiles.
+  std::string Bodies;
+};
+
 } // End namespace sampleprof
 
 } // End namespace llvm
@@ -0,0 +1,103 @@
+//===- FileCache.h - Content-addressed on-disk file cache -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the FileCache class, a content-addressed directory of
+// generated files such as the object files of LTO or of a JIT, and
+// FileCacheKeyBuilder, which computes the keys of its entries.
+//
+// A tool that repeatedly compiles the same input can reuse the output of a
+// previous run as long as the input and all the options that affect the
+// output are the same. The key of an entry is a hash of all of these; the
+// tool never needs to compare the inputs themselves.
+//
+// Several processes may share a cache directory concurrently. Entries are
+// written to a temporary file that is atomically renamed into place, so a
+// lookup never sees a partial entry, and a lock file makes sure that only one
+// process at a time prunes the directory.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_FILECACHE_H
+#define LLVM_SUPPORT_FILECACHE_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <memory>
+#include <string>
+
+namespace llvm {
+
+/// Computes the key of a cache entry from everything that determines its
+/// contents. The version of LLVM is always part of the key. The options of a
+/// TargetMachine are added with TargetMachine::addToCacheKey.
+class FileCacheKeyBuilder {
+public:
+  FileCacheKeyBuilder();
+
+  void add(StringRef Data);
+  void add(uint64_t Value);
+
+  /// Return the key, as a string of hexadecimal digits. No data can be added
+  /// afterwards.
+  std::string getKey();
+
+private:
+  MD5 Hasher;
+};
+
+class FileCache {
+public:
+  FileCache();
+
+  /// Set the directory of the cache, which is created if needed. The cache is
+  /// disabled while the path is empty.
+  void setPath(StringRef Path) { this->Path = Path; }
+  StringRef getPath() const { return Path; }
+  bool isEnabled() const { return !Path.empty(); }
+
+  /// Set the minimum time between two prunings of the directory. A negative
+  /// interval disables pruning. The default is 20 minutes.
+  void setPruningInterval(int Seconds) { PruningInterval = Seconds; }
+
+  /// Set the time after which an entry that has not been used is removed when
+  /// the directory is pruned. Zero disables expiration. The default is one
+  /// week.
+  void setExpiration(unsigned Seconds) { Expiration = Seconds; }
+
+  /// Set the maximum total size of the entries. When the directory is pruned,
+  /// the least recently used entries are removed until the total fits. Zero
+  /// disables the limit, which is the default.
+  void setMaxSize(uint64_t Bytes) { MaxSize = Bytes; }
+
+  /// Return the contents of the entry with the given key, or nullptr if there
+  /// is no such entry. A hit marks the entry as recently used.
+  std::unique_ptr<MemoryBuffer> lookup(StringRef Key) const;
+
+  /// Add an entry with the given key and contents, replacing any existing
+  /// one. Errors are ignored: a missing entry only costs a recompilation.
+  void store(StringRef Key, StringRef Data) const;
+
+  /// Prune the directory according to the expiration and size limits, unless
+  /// it was pruned less than the pruning interval ago or another process is
+  /// pruning it. Returns true if the directory was pruned.
+  bool prune() const;
+
+private:
+  std::string getEntryPath(StringRef Key) const;
+
+  std::string Path;
+  int PruningInterval;
+  unsigned Expiration;
+  uint64_t MaxSize;
+};
+
+} // End llvm namespace
+
+#endif
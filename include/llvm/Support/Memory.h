@@ -47,7 +47,11 @@ namespace sys {
     enum ProtectionFlags {
       MF_READ  = 0x1000000,
       MF_WRITE = 0x2000000,
-      MF_EXEC  = 0x4000000
+      MF_EXEC  = 0x4000000,
+      /// Only for allocateMappedMemory: a hint that the block should be
+      /// backed by huge pages where the system supports them. The hint may be
+      /// ignored.
+      MF_HUGE_HINT = 0x0000001
     };
 
     /// This method allocates a block of memory that is suitable for loading
@@ -58,12 +62,13 @@ namespace sys {
     /// The actual allocated address is not guaranteed to be near the requested
     /// address.
     /// \p Flags is used to set the initial protection flags for the block
-    /// of the memory.
+    /// of the memory. It may also include MF_HUGE_HINT.
     /// \p EC [out] returns an object describing any error that occurs.
     ///
     /// This method may allocate more than the number of bytes requested.  The
     /// actual number of bytes allocated is indicated in the returned
-    /// MemoryBlock.
+    /// MemoryBlock. With MF_HUGE_HINT, the size is rounded up to a multiple
+    /// of the huge page size, and the block is aligned to a huge page.
     ///
     /// The start of the allocated block must be aligned with the
     /// system allocation granularity (64K on Windows, page size on Linux).
@@ -0,0 +1,193 @@
+//===-- llvm/Support/Parallel.h - Parallel algorithms -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares parallel versions of some of the algorithms of the
+// standard library. They run on a thread pool shared by the whole process and
+// fall back to the sequential algorithms when LLVM is built without threads.
+//
+// The callbacks are called concurrently from several threads, so they must be
+// safe to call that way.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_PARALLEL_H
+#define LLVM_SUPPORT_PARALLEL_H
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/ThreadPool.h"
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <iterator>
+
+namespace llvm {
+
+/// Return the pool that the parallel algorithms run on. It has one worker per
+/// hardware thread and is created on first use.
+ThreadPool &getDefaultThreadPool();
+
+namespace detail {
+/// Ranges smaller than this are sorted sequentially.
+const ptrdiff_t MinParallelSortSize = 1024;
+
+/// Return the number of elements per task for a range of Size elements:
+/// enough tasks to balance the load between the workers, but not so many that
+/// queuing them costs more than the work they do.
+inline size_t getParallelChunkSize(size_t Size, unsigned ThreadCount) {
+  return std::max<size_t>(1, Size / (size_t(ThreadCount) * 8));
+}
+
+template <class RandomAccessIterator, class Comparator>
+RandomAccessIterator medianOf3(RandomAccessIterator Start,
+                               RandomAccessIterator End,
+                               const Comparator &Comp) {
+  RandomAccessIterator Mid = Start + (std::distance(Start, End) / 2);
+  return Comp(*Start, *(End - 1))
+             ? (Comp(*Mid, *(End - 1)) ? (Comp(*Start, *Mid) ? Mid : Start)
+                                       : End - 1)
+             : (Comp(*Mid, *Start) ? (Comp(*(End - 1), *Mid) ? Mid : End - 1)
+                                   : Start);
+}
+
+template <class RandomAccessIterator, class Comparator>
+void parallelQuickSort(RandomAccessIterator Start, RandomAccessIterator End,
+                       const Comparator &Comp, TaskGroup &TG, unsigned Depth) {
+  // Fall back to std::sort for small ranges, and for badly partitioned ones
+  // that would otherwise take quadratic time.
+  if (std::distance(Start, End) < MinParallelSortSize || Depth == 0) {
+    std::sort(Start, End, Comp);
+    return;
+  }
+
+  // Partition around the median of three, which is moved out of the way.
+  RandomAccessIterator Pivot = medianOf3(Start, End, Comp);
+  std::swap(*(End - 1), *Pivot);
+  Pivot = std::partition(Start, End - 1, [&Comp, End](decltype(*Start) V) {
+    return Comp(V, *(End - 1));
+  });
+  std::swap(*Pivot, *(End - 1));
+
+  // Sort the two halves in parallel.
+  TG.spawn([=, &Comp, &TG] {
+    parallelQuickSort(Start, Pivot, Comp, TG, Depth - 1);
+  });
+  parallelQuickSort(Pivot + 1, End, Comp, TG, Depth - 1);
+}
+} // End detail namespace
+
+/// Call Fn on every element of [Begin, End), in no particular order.
+template <class IterTy, class FuncTy>
+void parallel_for_each(IterTy Begin, IterTy End, FuncTy Fn) {
+#if LLVM_ENABLE_THREADS
+  ThreadPool &Pool = getDefaultThreadPool();
+  size_t ChunkSize = detail::getParallelChunkSize(std::distance(Begin, End),
+                                                  Pool.getThreadCount());
+  TaskGroup TG(Pool);
+  while (size_t(std::distance(Begin, End)) > ChunkSize) {
+    IterTy ChunkEnd = std::next(Begin, ChunkSize);
+    TG.spawn([=, &Fn] { std::for_each(Begin, ChunkEnd, Fn); });
+    Begin = ChunkEnd;
+  }
+  // The calling thread takes the last chunk, then helps with the others.
+  std::for_each(Begin, End, Fn);
+  TG.wait();
+#else
+  std::for_each(Begin, End, Fn);
+#endif
+}
+
+/// Call Fn on every index in [Begin, End), in no particular order.
+template <class IndexTy, class FuncTy>
+void parallel_for_each_n(IndexTy Begin, IndexTy End, FuncTy Fn) {
+#if LLVM_ENABLE_THREADS
+  ThreadPool &Pool = getDefaultThreadPool();
+  size_t ChunkSize = detail::getParallelChunkSize(
+      Begin < End ? End - Begin : 0, Pool.getThreadCount());
+  TaskGroup TG(Pool);
+  for (; Begin < End && size_t(End - Begin) > ChunkSize; Begin += ChunkSize) {
+    IndexTy ChunkBegin = Begin;
+    TG.spawn([=, &Fn] {
+      for (IndexTy I = ChunkBegin, E = ChunkBegin + ChunkSize; I != E; ++I)
+        Fn(I);
+    });
+  }
+  for (; Begin < End; ++Begin)
+    Fn(Begin);
+  TG.wait();
+#else
+  for (; Begin < End; ++Begin)
+    Fn(Begin);
+#endif
+}
+
+/// Sort [Start, End) with Comp. Like std::sort, the sort is not stable.
+template <class RandomAccessIterator, class Comparator>
+void parallel_sort(RandomAccessIterator Start, RandomAccessIterator End,
+                   const Comparator &Comp) {
+#if LLVM_ENABLE_THREADS
+  TaskGroup TG(getDefaultThreadPool());
+  detail::parallelQuickSort(Start, End, Comp, TG,
+                            Log2_64(std::distance(Start, End)) + 1);
+  TG.wait();
+#else
+  std::sort(Start, End, Comp);
+#endif
+}
+
+template <class RandomAccessIterator>
+void parallel_sort(RandomAccessIterator Start, RandomAccessIterator End) {
+  parallel_sort(Start, End,
+                std::less<typename std::iterator_traits<
+                    RandomAccessIterator>::value_type>());
+}
+
+/// Apply Transform to every element of [Begin, End) and combine the results
+/// with Reduce. Init must be an identity of Reduce, since each task starts
+/// from it, and Reduce must be associative: the results are combined in an
+/// unspecified grouping, though always in the order of the range.
+template <class IterTy, class ResultTy, class ReduceFuncTy,
+          class TransformFuncTy>
+ResultTy parallel_transform_reduce(IterTy Begin, IterTy End, ResultTy Init,
+                                   ReduceFuncTy Reduce,
+                                   TransformFuncTy Transform) {
+#if LLVM_ENABLE_THREADS
+  ThreadPool &Pool = getDefaultThreadPool();
+  size_t Size = std::distance(Begin, End);
+  size_t ChunkSize = detail::getParallelChunkSize(Size, Pool.getThreadCount());
+  // Not a vector, which would pack booleans into shared words.
+  std::deque<ResultTy> Results((Size + ChunkSize - 1) / ChunkSize, Init);
+  {
+    TaskGroup TG(Pool);
+    for (size_t Chunk = 0; Chunk != Results.size(); ++Chunk) {
+      IterTy ChunkBegin = std::next(Begin, Chunk * ChunkSize);
+      IterTy ChunkEnd = Chunk + 1 == Results.size()
+                            ? End
+                            : std::next(ChunkBegin, ChunkSize);
+      ResultTy &Result = Results[Chunk];
+      TG.spawn([=, &Reduce, &Transform, &Result] {
+        for (IterTy I = ChunkBegin; I != ChunkEnd; ++I)
+          Result = Reduce(Result, Transform(*I));
+      });
+    }
+    TG.wait();
+  }
+  for (ResultTy &Result : Results)
+    Init = Reduce(Init, Result);
+  return Init;
+#else
+  for (; Begin != End; ++Begin)
+    Init = Reduce(Init, Transform(*Begin));
+  return Init;
+#endif
+}
+
+} // End llvm namespace
+
+#endif
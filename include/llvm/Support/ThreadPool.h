@@ -0,0 +1,155 @@
+//===-- llvm/Support/ThreadPool.h - A pool of worker threads ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the ThreadPool class, which runs tasks on a fixed set of
+// worker threads, and the TaskGroup class, which waits for a set of tasks.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADPOOL_H
+#define LLVM_SUPPORT_THREADPOOL_H
+
+#include "llvm/Config/llvm-config.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace llvm {
+class TaskGroup;
+
+/// A pool of worker threads that run tasks asynchronously.
+///
+/// Every worker has its own queue of tasks. A task queued by a worker, usually
+/// one that splits its work into smaller tasks, goes to the queue of that
+/// worker, which runs the most recently queued task first. A worker whose
+/// queue is empty steals the oldest task of another worker. Tasks queued by
+/// other threads are spread over the workers in turn.
+///
+/// When LLVM is built without threads the pool has no workers: the tasks run
+/// on the thread that waits for them.
+class ThreadPool {
+public:
+  typedef std::function<void()> TaskTy;
+
+  /// Construct a pool with one worker per hardware thread.
+  ThreadPool();
+
+  /// Construct a pool with the given number of workers, at least one.
+  explicit ThreadPool(unsigned ThreadCount);
+
+  /// Wait for the queued tasks to run, then join the workers.
+  ~ThreadPool();
+
+  /// Queue a call of F with the given arguments. The returned future is ready
+  /// once the call has returned.
+  template <typename Function, typename... Args>
+  std::shared_future<void> async(Function &&F, Args &&... ArgList) {
+    auto Task =
+        std::bind(std::forward<Function>(F), std::forward<Args>(ArgList)...);
+    return asyncImpl(std::move(Task));
+  }
+
+  /// Block until every queued task, including the ones queued by running
+  /// tasks, has run. A task of this pool must not call this; it can wait with
+  /// a TaskGroup instead.
+  void wait();
+
+  /// Return the number of workers. This is one when LLVM is built without
+  /// threads.
+  unsigned getThreadCount() const { return ThreadCount; }
+
+private:
+  friend class TaskGroup;
+  struct WorkerQueue;
+
+  std::shared_future<void> asyncImpl(TaskTy Task);
+
+  /// Queue a task without a future.
+  void enqueue(TaskTy Task);
+
+  /// Run one queued task on the calling thread. Returns false if there was
+  /// none.
+  bool runPendingTask();
+
+#if LLVM_ENABLE_THREADS
+  /// Take a task from the given queue, or steal one from another queue if it
+  /// is empty. Own is null if the caller is not a worker of this pool.
+  bool takeTask(WorkerQueue *Own, TaskTy &Task);
+
+  void runTask(TaskTy &Task);
+  void runWorker(unsigned Index);
+
+  std::vector<std::unique_ptr<WorkerQueue>> Queues;
+  std::vector<std::thread> Threads;
+
+  /// The queue that the next task from outside the pool goes to.
+  std::atomic<unsigned> NextQueue;
+
+  /// The number of tasks in the queues. It only grows with SleepLock held, so
+  /// that a worker going to sleep cannot miss a new task.
+  std::atomic<unsigned> QueuedTasks;
+
+  /// The number of tasks that are queued or running.
+  std::atomic<unsigned> PendingTasks;
+
+  /// Idle workers, and TaskGroup::wait() callers with nothing to run, sleep on
+  /// SleepCondition.
+  std::mutex SleepLock;
+  std::condition_variable SleepCondition;
+
+  /// wait() sleeps on CompletionCondition.
+  std::mutex CompletionLock;
+  std::condition_variable CompletionCondition;
+
+  /// Set by the destructor, with SleepLock held.
+  bool Stopping;
+#else
+  /// The tasks that have not run yet, in the order they were queued.
+  std::vector<std::shared_future<void>> DeferredTasks;
+#endif
+
+  unsigned ThreadCount;
+};
+
+/// A set of tasks that run on a pool and are waited for together.
+///
+/// Unlike ThreadPool::wait(), TaskGroup::wait() may be called from a task of
+/// the pool: while the tasks of the group are not done, the waiting thread
+/// runs other queued tasks of the pool, and sleeps when there are none. Nested
+/// parallel work therefore cannot leave every worker blocked.
+class TaskGroup {
+public:
+  explicit TaskGroup(ThreadPool &Pool) : Pool(Pool), PendingTasks(0) {}
+
+  /// Wait for the tasks of the group.
+  ~TaskGroup() { wait(); }
+
+  /// Queue a task in the group. When LLVM is built without threads the task
+  /// runs immediately.
+  void spawn(ThreadPool::TaskTy Task);
+
+  /// Block until every task of the group has run.
+  void wait();
+
+private:
+  TaskGroup(const TaskGroup &) = delete;
+  void operator=(const TaskGroup &) = delete;
+
+  ThreadPool &Pool;
+  std::atomic<unsigned> PendingTasks;
+};
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,105 @@
+//===- llvm/Support/TimeProfiler.h - Hierarchical time trace ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares a profiler that records nested begin/end events, such as
+// a pass running on a function inside the pass manager running on a module,
+// and writes them in the Chrome Trace Event format. The output can be opened
+// in chrome://tracing or any other trace viewer that reads that format.
+//
+// Unlike -time-passes, which only reports a total per pass, the trace shows
+// every invocation with what it ran on, so it points at the function that
+// takes the time.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_TIMEPROFILER_H
+#define LLVM_SUPPORT_TIMEPROFILER_H
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+#include <system_error>
+
+namespace llvm {
+class raw_ostream;
+
+struct TimeTraceProfiler;
+extern TimeTraceProfiler *TimeTraceProfilerInstance;
+
+/// Start recording events. Events shorter than Granularity microseconds are
+/// left out of the trace, though they still count towards the totals. The
+/// process is named ProcName in the trace.
+///
+/// The profiler must be initialized, written and cleaned up while no other
+/// thread records events.
+void timeTraceProfilerInitialize(unsigned Granularity, StringRef ProcName);
+
+/// Stop recording and free the recorded events.
+void timeTraceProfilerCleanup();
+
+/// Return true if events are being recorded.
+inline bool timeTraceProfilerEnabled() {
+  return TimeTraceProfilerInstance != nullptr;
+}
+
+/// Write the recorded events as a Chrome Trace Event JSON object.
+void timeTraceProfilerWrite(raw_ostream &OS);
+
+/// Write the recorded events to the file at Path.
+std::error_code timeTraceProfilerWrite(StringRef Path);
+
+/// Begin an event on the calling thread. Detail usually names what the event
+/// is about, such as a function.
+void timeTraceProfilerBegin(StringRef Name, StringRef Detail);
+
+/// Begin an event whose detail is only computed if events are recorded.
+void timeTraceProfilerBegin(StringRef Name,
+                            function_ref<std::string()> Detail);
+
+/// End the innermost event of the calling thread.
+void timeTraceProfilerEnd();
+
+/// Record an event for the lifetime of the object, if the profiler is enabled
+/// when it is constructed.
+class TimeTraceScope {
+public:
+  explicit TimeTraceScope(StringRef Name) : Active(timeTraceProfilerEnabled()) {
+    if (Active)
+      timeTraceProfilerBegin(Name, StringRef());
+  }
+  TimeTraceScope(StringRef Name, StringRef Detail)
+      : Active(timeTraceProfilerEnabled()) {
+    if (Active)
+      timeTraceProfilerBegin(Name, Detail);
+  }
+  // function_ref converts from anything, so strings need exact overloads.
+  TimeTraceScope(StringRef Name, const std::string &Detail)
+      : TimeTraceScope(Name, StringRef(Detail)) {}
+  TimeTraceScope(StringRef Name, const char *Detail)
+      : TimeTraceScope(Name, StringRef(Detail)) {}
+  TimeTraceScope(StringRef Name, function_ref<std::string()> Detail)
+      : Active(timeTraceProfilerEnabled()) {
+    if (Active)
+      timeTraceProfilerBegin(Name, Detail);
+  }
+  ~TimeTraceScope() {
+    if (Active)
+      timeTraceProfilerEnd();
+  }
+
+private:
+  TimeTraceScope(const TimeTraceScope &) = delete;
+  void operator=(const TimeTraceScope &) = delete;
+
+  bool Active;
+};
+
+} // End llvm namespace
+
+#endif
@@ -12,6 +12,7 @@
 
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/DataTypes.h"
+#include "llvm/Support/TimeProfiler.h"
 #include <cassert>
 #include <string>
 #include <utility>
@@ -144,11 +145,17 @@ public:
 /// time, all in one statement.  All timers with the same name are merged.  This
 /// is primarily used for debugging and for hunting performance problems.
 ///
+/// The region is also recorded by the time trace profiler when that is
+/// enabled, whether or not the timer is.
+///
 struct NamedRegionTimer : public TimeRegion {
   explicit NamedRegionTimer(StringRef Name,
                             bool Enabled = true);
   explicit NamedRegionTimer(StringRef Name, StringRef GroupName,
                             bool Enabled = true);
+
+private:
+  TimeTraceScope TraceScope;
 };
 
 
@@ -36,6 +36,7 @@ class MCSubtargetInfo;
 class MCSymbol;
 class Target;
 class DataLayout;
+class FileCacheKeyBuilder;
 class TargetLibraryInfo;
 class TargetFrameLowering;
 class TargetIRAnalysis;
@@ -127,6 +128,11 @@ public:
   /// be unchanging for every subtarget.
   const DataLayout *getDataLayout() const { return &DL; }
 
+  /// Add everything that affects the code this machine generates: the
+  /// triple, CPU, features, relocation and code models, optimization level
+  /// and target options.
+  void addToCacheKey(FileCacheKeyBuilder &Key) const;
+
   /// \brief Reset the target options based on the function's attributes.
   // FIXME: Remove TargetOptions that affect per-function code generation
   // from TargetMachine.
@@ -19,6 +19,7 @@
 
 namespace llvm {
 
+class FunctionInfoIndex;
 class ModulePass;
 class Pass;
 class Function;
@@ -203,6 +204,12 @@ ModulePass *createBarrierNoopPass();
 /// to bitsets.
 ModulePass *createLowerBitSetsPass();
 
+//===----------------------------------------------------------------------===//
+/// \brief This pass imports the bodies of small functions defined in other
+/// modules, as directed by a combined function summary index. If Index is
+/// null, the index is read from the file given by -summary-file.
+ModulePass *createFunctionImportPass(const FunctionInfoIndex *Index = nullptr);
+
 } // End llvm namespace
 
 #endif
@@ -0,0 +1,68 @@
+//===- llvm/Transforms/IPO/FunctionImport.h - ThinLTO importing -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares FunctionImporter, which brings the bodies of functions
+// defined in other modules into a module so that they can be inlined, as
+// directed by a combined function summary index.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_IPO_FUNCTIONIMPORT_H
+#define LLVM_TRANSFORMS_IPO_FUNCTIONIMPORT_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include <functional>
+#include <memory>
+
+namespace llvm {
+class FunctionInfoIndex;
+class Module;
+
+/// The function importer is automatically importing function from other
+/// modules based on the provided summary informations.
+///
+/// Starting from the functions that the destination module declares, a
+/// function is imported when the index knows an importable, non-cold
+/// definition no larger than the import threshold. The callees of imported
+/// functions are then considered in turn, with a lower threshold. Imported
+/// functions are given available_externally linkage: they are only used for
+/// inlining and are never emitted in the destination module.
+class FunctionImporter {
+public:
+  /// Load the module with the given path in the context of the destination
+  /// module, lazily if possible. Returns nullptr on error.
+  typedef std::function<std::unique_ptr<Module>(StringRef ModulePath)>
+      ModuleLoaderTy;
+
+private:
+  /// The summaries index used to trigger importing.
+  const FunctionInfoIndex &Index;
+
+  /// Diagnostic will be sent to this handler.
+  DiagnosticHandlerFunction DiagnosticHandler;
+
+  /// Factory function to load a Module for a given identifier.
+  ModuleLoaderTy ModuleLoader;
+
+public:
+  /// Create a Function Importer.
+  FunctionImporter(const FunctionInfoIndex &Index,
+                   DiagnosticHandlerFunction DiagnosticHandler,
+                   ModuleLoaderTy ModuleLoader)
+      : Index(Index), DiagnosticHandler(DiagnosticHandler),
+        ModuleLoader(ModuleLoader) {}
+
+  /// Import functions in Module \p M based on the summary informations.
+  /// Returns true if any function was imported.
+  bool importFunctions(Module &M);
+};
+}
+
+#endif // LLVM_TRANSFORMS_IPO_FUNCTIONIMPORT_H
@@ -145,6 +145,13 @@ Pass *createLICMPass();
 //
 Pass *createLoopInterchangePass();
 
+//===----------------------------------------------------------------------===//
+//
+// LoopDistribute - Distribute loops to isolate the parts with unsafe memory
+// dependences so that the rest of the loop can be vectorized.
+//
+FunctionPass *createLoopDistributePass();
+
 //===----------------------------------------------------------------------===//
 //
 // LoopStrengthReduce - This pass is strength reduces GEP instructions that use
@@ -312,9 +319,10 @@ extern char &LCSSAID;
 //===----------------------------------------------------------------------===//
 //
 // EarlyCSE - This pass performs a simple and fast CSE pass over the dominator
-// tree.
+// tree.  With UseMemorySSA, loads and read-only calls are also CSE'd across
+// stores that MemorySSA proves do not clobber them.
 //
-FunctionPass *createEarlyCSEPass();
+FunctionPass *createEarlyCSEPass(bool UseMemorySSA = false);
 
 //===----------------------------------------------------------------------===//
 //
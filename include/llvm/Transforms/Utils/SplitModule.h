@@ -0,0 +1,46 @@
+//===- SplitModule.h - Split a module into partitions -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the function llvm::SplitModule, which splits a module
+// into multiple linkable partitions. It can be used to implement parallel code
+// generation for link-time optimization.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+#define LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+
+#include <functional>
+#include <memory>
+
+namespace llvm {
+
+class Module;
+
+/// Splits the module M into N linkable partitions. The function ModuleCallback
+/// is called N times passing each individual partition as the MPart argument.
+///
+/// Every definition in M ends up in exactly one partition; the other
+/// partitions see it as an external declaration. Definitions that must stay
+/// together are never separated: a global is kept with any local-linkage
+/// global it refers to, with the other members of its comdat, with the base
+/// object of an alias, and with any function whose block address it takes.
+/// No symbol is renamed and no linkage is changed, so the partitions, once
+/// compiled and linked, behave exactly like M. Appending-linkage globals such
+/// as llvm.global_ctors and llvm.used are distributed so that each entry is
+/// emitted by the partition that defines the global it names, and module-level
+/// inline asm is emitted by the first partition only. Partitions are balanced
+/// by instruction count.
+void SplitModule(
+    const Module &M, unsigned N,
+    std::function<void(std::unique_ptr<Module> MPart)> ModuleCallback);
+
+} // End llvm namespace
+
+#endif
@@ -43,6 +43,7 @@ analysis_SRC_FILES := \
   MemDerefPrinter.cpp \
   MemoryBuiltins.cpp \
   MemoryDependenceAnalysis.cpp \
+  MemorySSA.cpp \
   ModuleDebugInfoPrinter.cpp \
   NoAliasAnalysis.cpp \
   PHITransAddr.cpp \
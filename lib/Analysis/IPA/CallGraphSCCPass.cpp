@@ -16,6 +16,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Analysis/CallGraphSCCPass.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SCCIterator.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/CallGraph.h"
@@ -25,6 +26,7 @@
 #include "llvm/IR/LegacyPassManagers.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
@@ -107,6 +109,23 @@ private:
 
 char CGPassManager::ID = 0;
 
+/// Name an SCC for the time trace by the functions in it.
+static std::string getSCCName(CallGraphSCC &SCC) {
+  std::string Name;
+  raw_string_ostream OS(Name);
+  bool First = true;
+  for (CallGraphNode *CGN : SCC) {
+    if (!First)
+      OS << ", ";
+    First = false;
+    if (Function *F = CGN->getFunction())
+      OS << F->getName();
+    else
+      OS << "<external node>";
+  }
+  return OS.str();
+}
+
 
 bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
                                  CallGraph &CG, bool &CallGraphUpToDate,
@@ -123,6 +142,9 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
 
     {
       TimeRegion PassTimer(getPassTimer(CGSP));
+      Optional<TimeTraceScope> TraceScope;
+      if (timeTraceProfilerEnabled())
+        TraceScope.emplace(CGSP->getPassName(), getSCCName(CurSCC));
       Changed = CGSP->runOnSCC(CurSCC);
     }
     
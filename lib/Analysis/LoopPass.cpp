@@ -14,9 +14,11 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Analysis/LoopPass.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
@@ -247,6 +249,11 @@ bool LPPassManager::runOnFunction(Function &F) {
       {
         PassManagerPrettyStackEntry X(P, *CurrentLoop->getHeader());
         TimeRegion PassTimer(getPassTimer(P));
+        Optional<TimeTraceScope> TraceScope;
+        if (timeTraceProfilerEnabled())
+          TraceScope.emplace(
+              P->getPassName(),
+              (F.getName() + ":" + CurrentLoop->getHeader()->getName()).str());
 
         Changed |= P->runOnLoop(CurrentLoop, *this);
       }
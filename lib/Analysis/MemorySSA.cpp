@@ -0,0 +1,930 @@
+//===-- MemorySSA.cpp - Memory SSA Builder --------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the MemorySSA class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/AssemblyAnnotationWriter.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <queue>
+
+#define DEBUG_TYPE "memoryssa"
+using namespace llvm;
+
+STATISTIC(NumClobberCacheLookups, "Number of Memory SSA version cache lookups");
+STATISTIC(NumClobberCacheHits, "Number of Memory SSA version cache hits");
+
+static cl::opt<bool>
+    VerifyMemorySSA("verify-memoryssa", cl::init(false), cl::Hidden,
+                    cl::desc("Verify MemorySSA in legacy printer pass."));
+
+// The walker recurses through MemoryPhis; this bounds the recursion depth.
+// Walks that would go deeper conservatively stop at the phi.
+static cl::opt<unsigned> MaxPhiWalkDepth(
+    "memssa-max-phi-walk-depth", cl::init(100), cl::Hidden,
+    cl::desc("The maximum number of nested MemoryPhis the clobber walker "
+             "looks through"));
+
+INITIALIZE_PASS_BEGIN(MemorySSAWrapperPass, "memoryssa", "Memory SSA", false,
+                      true)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_PASS_END(MemorySSAWrapperPass, "memoryssa", "Memory SSA", false,
+                    true)
+
+namespace llvm {
+
+/// \brief An assembly annotator class to print Memory SSA information in
+/// comments.
+class MemorySSAAnnotatedWriter : public AssemblyAnnotationWriter {
+  friend class MemorySSA;
+  const MemorySSA *MSSA;
+
+public:
+  MemorySSAAnnotatedWriter(const MemorySSA *M) : MSSA(M) {}
+
+  void emitBasicBlockStartAnnot(const BasicBlock *BB,
+                                formatted_raw_ostream &OS) override {
+    if (MemoryAccess *MA = MSSA->getMemoryAccess(BB))
+      OS << "; " << *MA << "\n";
+  }
+
+  void emitInstructionAnnot(const Instruction *I,
+                            formatted_raw_ostream &OS) override {
+    if (MemoryAccess *MA = MSSA->getMemoryAccess(I))
+      OS << "; " << *MA << "\n";
+  }
+};
+
+} // end namespace llvm
+
+MemoryAccess *ilist_traits<MemoryAccess>::createSentinel() const {
+  return static_cast<MemoryAccess *>(&Sentinel);
+}
+
+//===----------------------------------------------------------------------===//
+// MemoryAccess and subclasses
+//===----------------------------------------------------------------------===//
+
+MemoryAccess::~MemoryAccess() {}
+
+void MemoryAccess::removeUser(MemoryAccess *User) {
+  // Users are most often removed shortly after being added, so search from
+  // the back.  The order of the users is not significant.
+  auto I = std::find(Users.rbegin(), Users.rend(), User);
+  assert(I != Users.rend() && "Removing an access that is not a user");
+  std::swap(*I, Users.back());
+  Users.pop_back();
+}
+
+void MemoryAccess::dump() const {
+  print(dbgs());
+  dbgs() << "\n";
+}
+
+static void printAccessID(raw_ostream &OS, const MemoryAccess *MA) {
+  if (const auto *MD = dyn_cast<MemoryDef>(MA)) {
+    if (MD->getID() == 0)
+      OS << "liveOnEntry";
+    else
+      OS << MD->getID();
+  } else {
+    OS << cast<MemoryPhi>(MA)->getID();
+  }
+}
+
+void MemoryDef::print(raw_ostream &OS) const {
+  OS << getID() << " = MemoryDef(";
+  printAccessID(OS, getDefiningAccess());
+  OS << ")";
+}
+
+void MemoryUse::print(raw_ostream &OS) const {
+  OS << "MemoryUse(";
+  printAccessID(OS, getDefiningAccess());
+  OS << ")";
+}
+
+void MemoryPhi::print(raw_ostream &OS) const {
+  OS << getID() << " = MemoryPhi(";
+  bool First = true;
+  for (const auto &Op : Operands) {
+    if (!First)
+      OS << ',';
+    First = false;
+
+    OS << '{';
+    if (Op.second->hasName())
+      OS << Op.second->getName();
+    else
+      Op.second->printAsOperand(OS, false);
+    OS << ',';
+    printAccessID(OS, Op.first);
+    OS << '}';
+  }
+  OS << ')';
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSA construction
+//===----------------------------------------------------------------------===//
+
+MemorySSA::MemorySSA(Function &Func, AliasAnalysis *AA, DominatorTree *DT)
+    : F(Func), AA(AA), DT(DT), NextID(0) {
+  buildMemorySSA();
+}
+
+MemorySSA::~MemorySSA() {
+  // The accesses are owned by the per-block lists; the use lists only point
+  // between them, so they can be torn down in any order.
+}
+
+MemorySSA::AccessListType *
+MemorySSA::getOrCreateAccessList(const BasicBlock *BB) {
+  std::unique_ptr<AccessListType> &Accesses = PerBlockAccesses[BB];
+  if (!Accesses)
+    Accesses.reset(new AccessListType());
+  return Accesses.get();
+}
+
+/// \brief Helper function to create new memory accesses.
+MemoryUseOrDef *MemorySSA::createNewAccess(Instruction *I, BasicBlock *BB) {
+  // Find out what affect this instruction has on memory.
+  AliasAnalysis::ModRefResult ModRef = AA->getModRefInfo(I);
+  bool Def = ModRef & AliasAnalysis::Mod;
+  bool Use = ModRef & AliasAnalysis::Ref;
+
+  // It's possible for an instruction to not modify memory at all.  During
+  // construction, we ignore them.
+  if (!Def && !Use)
+    return nullptr;
+
+  MemoryUseOrDef *MA;
+  if (Def)
+    MA = new MemoryDef(nullptr, I, BB, NextID++);
+  else
+    MA = new MemoryUse(nullptr, I, BB);
+  ValueToMemoryAccess.insert(std::make_pair(I, MA));
+  return MA;
+}
+
+/// \brief Place MemoryPhis at the iterated dominance frontier of the blocks
+/// that define memory.
+///
+/// This follows the same approach as mem2reg: the frontier is found by
+/// walking the dominator tree from the definitions upwards, handling the
+/// deepest nodes first.  Since every block may use memory, the phis are not
+/// pruned by liveness.
+void MemorySSA::placePHINodes(
+    const SmallPtrSetImpl<BasicBlock *> &DefiningBlocks) {
+  DenseMap<DomTreeNode *, unsigned> DomLevels;
+  SmallVector<DomTreeNode *, 32> Worklist;
+
+  DomTreeNode *Root = DT->getRootNode();
+  DomLevels[Root] = 0;
+  Worklist.push_back(Root);
+  while (!Worklist.empty()) {
+    DomTreeNode *Node = Worklist.pop_back_val();
+    unsigned ChildLevel = DomLevels[Node] + 1;
+    for (DomTreeNode *Child : *Node) {
+      DomLevels[Child] = ChildLevel;
+      Worklist.push_back(Child);
+    }
+  }
+
+  // Use a priority queue keyed on dominator tree level so that inserted nodes
+  // are handled from the bottom of the dominator tree upwards.
+  typedef std::pair<DomTreeNode *, unsigned> DomTreeNodePair;
+  typedef std::priority_queue<DomTreeNodePair, SmallVector<DomTreeNodePair, 32>,
+                              less_second> IDFPriorityQueue;
+  IDFPriorityQueue PQ;
+
+  for (BasicBlock *BB : DefiningBlocks)
+    if (DomTreeNode *Node = DT->getNode(BB))
+      PQ.push(std::make_pair(Node, DomLevels[Node]));
+
+  SmallPtrSet<BasicBlock *, 32> PHIBlocks;
+  SmallPtrSet<DomTreeNode *, 32> VisitedPQ;
+  SmallPtrSet<DomTreeNode *, 32> VisitedWorklist;
+
+  while (!PQ.empty()) {
+    DomTreeNodePair RootPair = PQ.top();
+    PQ.pop();
+    DomTreeNode *Root = RootPair.first;
+    unsigned RootLevel = RootPair.second;
+
+    // Walk all dominator tree children of Root, inspecting their CFG edges with
+    // targets elsewhere on the dominator tree. Only targets whose level is at
+    // most Root's level are added to the iterated dominance frontier of the
+    // definition set.
+    Worklist.clear();
+    Worklist.push_back(Root);
+    VisitedWorklist.insert(Root);
+
+    while (!Worklist.empty()) {
+      DomTreeNode *Node = Worklist.pop_back_val();
+      BasicBlock *BB = Node->getBlock();
+
+      for (BasicBlock *Succ : successors(BB)) {
+        DomTreeNode *SuccNode = DT->getNode(Succ);
+
+        // Quickly skip all CFG edges that are also dominator tree edges instead
+        // of catching them below.
+        if (SuccNode->getIDom() == Node)
+          continue;
+
+        unsigned SuccLevel = DomLevels[SuccNode];
+        if (SuccLevel > RootLevel)
+          continue;
+
+        if (!VisitedPQ.insert(SuccNode).second)
+          continue;
+
+        PHIBlocks.insert(Succ);
+        if (!DefiningBlocks.count(Succ))
+          PQ.push(std::make_pair(SuccNode, SuccLevel));
+      }
+
+      for (DomTreeNode *Child : *Node)
+        if (VisitedWorklist.insert(Child).second)
+          Worklist.push_back(Child);
+    }
+  }
+
+  // Create the phis in function order so that the numbering is deterministic.
+  for (BasicBlock &BB : F) {
+    if (!PHIBlocks.count(&BB))
+      continue;
+    MemoryPhi *Phi = new MemoryPhi(&BB, NextID++);
+    ValueToMemoryAccess.insert(std::make_pair(&BB, Phi));
+    // Phi's always are placed at the front of the block.
+    getOrCreateAccessList(&BB)->push_front(Phi);
+  }
+}
+
+/// \brief Link the accesses of \p BB to the reaching definition and return
+/// the definition that reaches the end of the block.
+MemoryAccess *MemorySSA::renameBlock(BasicBlock *BB,
+                                     MemoryAccess *IncomingVal) {
+  auto It = PerBlockAccesses.find(BB);
+  // Skip most processing if the list is empty.
+  if (It != PerBlockAccesses.end()) {
+    for (MemoryAccess &L : *It->second) {
+      if (auto *MUD = dyn_cast<MemoryUseOrDef>(&L)) {
+        MUD->setDefiningAccess(IncomingVal);
+        if (isa<MemoryDef>(MUD))
+          IncomingVal = MUD;
+      } else {
+        IncomingVal = &L;
+      }
+    }
+  }
+
+  // Pass through values to our successors.
+  for (BasicBlock *S : successors(BB)) {
+    auto It = PerBlockAccesses.find(S);
+    // Rename the phi nodes in our successor block.
+    if (It == PerBlockAccesses.end())
+      continue;
+    if (auto *Phi = dyn_cast<MemoryPhi>(&It->second->front()))
+      Phi->addIncoming(IncomingVal, BB);
+  }
+
+  return IncomingVal;
+}
+
+/// \brief This is the standard SSA renaming algorithm.
+///
+/// We walk the dominator tree in preorder, renaming accesses, and then filling
+/// in phi nodes in our successors.
+void MemorySSA::renamePass(DomTreeNode *Root, MemoryAccess *IncomingVal,
+                           SmallPtrSetImpl<BasicBlock *> &Visited) {
+  struct RenamePassData {
+    DomTreeNode *DTN;
+    DomTreeNode::const_iterator ChildIt;
+    MemoryAccess *IncomingVal;
+
+    RenamePassData(DomTreeNode *D, DomTreeNode::const_iterator It,
+                   MemoryAccess *M)
+        : DTN(D), ChildIt(It), IncomingVal(M) {}
+  };
+  SmallVector<RenamePassData, 32> WorkStack;
+
+  IncomingVal = renameBlock(Root->getBlock(), IncomingVal);
+  WorkStack.push_back(RenamePassData(Root, Root->begin(), IncomingVal));
+  Visited.insert(Root->getBlock());
+
+  while (!WorkStack.empty()) {
+    DomTreeNode *Node = WorkStack.back().DTN;
+    DomTreeNode::const_iterator ChildIt = WorkStack.back().ChildIt;
+    IncomingVal = WorkStack.back().IncomingVal;
+
+    if (ChildIt == Node->end()) {
+      WorkStack.pop_back();
+    } else {
+      DomTreeNode *Child = *ChildIt;
+      ++WorkStack.back().ChildIt;
+      BasicBlock *BB = Child->getBlock();
+      Visited.insert(BB);
+      IncomingVal = renameBlock(BB, IncomingVal);
+      WorkStack.push_back(RenamePassData(Child, Child->begin(), IncomingVal));
+    }
+  }
+}
+
+/// \brief Link the accesses of an unreachable block to the live on entry
+/// definition.
+///
+/// Nothing in an unreachable block can affect reachable code, but its
+/// successors may be reachable and need an incoming value for the edge.
+void MemorySSA::markUnreachableAsLiveOnEntry(BasicBlock *BB) {
+  assert(!DT->isReachableFromEntry(BB) &&
+         "Reachable block found while handling unreachable blocks");
+
+  auto It = PerBlockAccesses.find(BB);
+  if (It != PerBlockAccesses.end())
+    for (MemoryAccess &L : *It->second)
+      if (auto *MUD = dyn_cast<MemoryUseOrDef>(&L))
+        MUD->setDefiningAccess(LiveOnEntryDef.get());
+
+  for (BasicBlock *S : successors(BB)) {
+    auto It = PerBlockAccesses.find(S);
+    if (It == PerBlockAccesses.end())
+      continue;
+    if (auto *Phi = dyn_cast<MemoryPhi>(&It->second->front()))
+      Phi->addIncoming(LiveOnEntryDef.get(), BB);
+  }
+}
+
+void MemorySSA::buildMemorySSA() {
+  // We create an access to represent "live on entry", for things like
+  // arguments or users of globals, where the memory they use is defined before
+  // the beginning of the function.  We do not actually insert it into the IR.
+  // We do not define a live on exit for the immediate uses, and thus our
+  // semantics do *not* imply that something with no immediate uses can simply
+  // be removed.
+  LiveOnEntryDef.reset(new MemoryDef(nullptr, nullptr, nullptr, NextID++));
+
+  // We maintain lists of memory accesses per-block, trading memory for time.
+  // We could just look up the memory access for every possible instruction in
+  // the stream.
+  SmallPtrSet<BasicBlock *, 32> DefiningBlocks;
+
+  // Go through each block, figure out where defs occur, and chain together all
+  // the accesses.
+  for (BasicBlock &B : F) {
+    bool InsertIntoDef = false;
+    AccessListType *Accesses = nullptr;
+    for (Instruction &I : B) {
+      MemoryUseOrDef *MUD = createNewAccess(&I, &B);
+      if (!MUD)
+        continue;
+      InsertIntoDef |= isa<MemoryDef>(MUD);
+
+      if (!Accesses)
+        Accesses = getOrCreateAccessList(&B);
+      Accesses->push_back(MUD);
+    }
+    if (InsertIntoDef)
+      DefiningBlocks.insert(&B);
+  }
+
+  placePHINodes(DefiningBlocks);
+
+  // Now do regular SSA renaming on the MemoryDef/MemoryUse.  Visited will get
+  // filled in with all blocks.
+  SmallPtrSet<BasicBlock *, 16> Visited;
+  renamePass(DT->getRootNode(), LiveOnEntryDef.get(), Visited);
+
+  // Now handle the blocks that the dominator tree walk did not reach.
+  for (BasicBlock &BB : F)
+    if (!Visited.count(&BB))
+      markUnreachableAsLiveOnEntry(&BB);
+
+  Walker.reset(new CachingMemorySSAWalker(this, AA, DT));
+}
+
+MemorySSAWalker *MemorySSA::getWalker() { return Walker.get(); }
+
+MemoryUseOrDef *MemorySSA::getMemoryAccess(const Instruction *I) const {
+  return cast_or_null<MemoryUseOrDef>(ValueToMemoryAccess.lookup(I));
+}
+
+MemoryPhi *MemorySSA::getMemoryAccess(const BasicBlock *BB) const {
+  return cast_or_null<MemoryPhi>(ValueToMemoryAccess.lookup(BB));
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSA updating
+//===----------------------------------------------------------------------===//
+
+void MemorySSA::removeMemoryAccess(MemoryAccess *MA) {
+  assert(!isLiveOnEntryDef(MA) && "Trying to remove the live on entry def");
+
+  // We can only delete phi nodes if they have no uses, or we can replace all
+  // uses with a single definition.
+  MemoryAccess *NewDefTarget = nullptr;
+  if (MemoryPhi *MP = dyn_cast<MemoryPhi>(MA)) {
+    for (unsigned I = 0, E = MP->getNumIncomingValues(); I != E; ++I) {
+      MemoryAccess *Incoming = MP->getIncomingValue(I);
+      if (Incoming == MP)
+        continue;
+      if (NewDefTarget && NewDefTarget != Incoming) {
+        NewDefTarget = nullptr;
+        break;
+      }
+      NewDefTarget = Incoming;
+    }
+    assert((NewDefTarget || !MP->hasUsers()) &&
+           "We can't delete this memory phi");
+  } else {
+    NewDefTarget = cast<MemoryUseOrDef>(MA)->getDefiningAccess();
+  }
+
+  // Re-point the uses at our defining access.
+  while (MA->hasUsers()) {
+    MemoryAccess *User = MA->Users.back();
+    if (auto *MUD = dyn_cast<MemoryUseOrDef>(User)) {
+      MUD->setDefiningAccess(NewDefTarget);
+    } else {
+      auto *Phi = cast<MemoryPhi>(User);
+      for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I)
+        if (Phi->getIncomingValue(I) == MA) {
+          Phi->setIncomingValue(I, NewDefTarget);
+          break;
+        }
+    }
+  }
+
+  // Drop our own operands.
+  if (auto *MUD = dyn_cast<MemoryUseOrDef>(MA)) {
+    MUD->setDefiningAccess(nullptr);
+    ValueToMemoryAccess.erase(MUD->getMemoryInst());
+  } else {
+    auto *Phi = cast<MemoryPhi>(MA);
+    for (auto &Op : Phi->Operands)
+      Op.first->removeUser(Phi);
+    Phi->Operands.clear();
+    ValueToMemoryAccess.erase(Phi->getBlock());
+  }
+
+  // Invalidate our walker's cache if necessary.
+  Walker->invalidateInfo(MA);
+  BlockNumbering.erase(MA);
+
+  auto AccessIt = PerBlockAccesses.find(MA->getBlock());
+  std::unique_ptr<AccessListType> &Accesses = AccessIt->second;
+  Accesses->erase(MA);
+  if (Accesses->empty()) {
+    BlockNumberingValid.erase(AccessIt->first);
+    PerBlockAccesses.erase(AccessIt);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSA queries and verification
+//===----------------------------------------------------------------------===//
+
+void MemorySSA::renumberBlock(const BasicBlock *B) const {
+  unsigned Number = 0;
+  for (const MemoryAccess &MA : *getBlockAccesses(B))
+    BlockNumbering[&MA] = Number++;
+  BlockNumberingValid.insert(B);
+}
+
+bool MemorySSA::locallyDominates(const MemoryAccess *Dominator,
+                                 const MemoryAccess *Dominatee) const {
+  assert((Dominator->getBlock() == Dominatee->getBlock()) &&
+         "Asking for local domination when accesses are in different blocks!");
+
+  // A node dominates itself.
+  if (Dominatee == Dominator)
+    return true;
+
+  // When Dominatee is defined on function entry, it is not dominated by another
+  // memory access.
+  if (isLiveOnEntryDef(Dominatee))
+    return false;
+
+  // When Dominator is defined on function entry, it dominates the other memory
+  // access.
+  if (isLiveOnEntryDef(Dominator))
+    return true;
+
+  const BasicBlock *BB = Dominator->getBlock();
+  if (!BlockNumberingValid.count(BB))
+    renumberBlock(BB);
+  return BlockNumbering.lookup(Dominator) < BlockNumbering.lookup(Dominatee);
+}
+
+bool MemorySSA::dominates(const MemoryAccess *Dominator,
+                          const MemoryAccess *Dominatee) const {
+  if (Dominator == Dominatee)
+    return true;
+  if (isLiveOnEntryDef(Dominatee))
+    return false;
+  if (isLiveOnEntryDef(Dominator))
+    return true;
+  if (Dominator->getBlock() != Dominatee->getBlock())
+    return DT->dominates(Dominator->getBlock(), Dominatee->getBlock());
+  return locallyDominates(Dominator, Dominatee);
+}
+
+void MemorySSA::verifyMemorySSA() const {
+  verifyDefUses(F);
+  verifyDomination(F);
+  verifyOrdering(F);
+}
+
+/// \brief Verify that the order and existence of MemoryAccesses matches the
+/// order and existence of memory affecting instructions.
+void MemorySSA::verifyOrdering(Function &F) const {
+  // Walk all the blocks, comparing what the lookups think and what the access
+  // lists think, as well as the order in the blocks vs the order in the access
+  // lists.
+  SmallVector<const MemoryAccess *, 32> ActualAccesses;
+  for (BasicBlock &B : F) {
+    const AccessListType *AL = getBlockAccesses(&B);
+    if (MemoryPhi *Phi = getMemoryAccess(&B))
+      ActualAccesses.push_back(Phi);
+    for (Instruction &I : B)
+      if (MemoryAccess *MA = getMemoryAccess(&I))
+        ActualAccesses.push_back(MA);
+
+    // Either we hit the assert, really have no accesses, or we have both
+    // accesses and an access list.
+    if (!AL)
+      continue;
+    assert(AL->size() == ActualAccesses.size() &&
+           "We don't have the same number of accesses in the block as on the "
+           "access list");
+    auto ALI = AL->begin();
+    auto AAI = ActualAccesses.begin();
+    while (ALI != AL->end() && AAI != ActualAccesses.end()) {
+      assert(&*ALI == *AAI && "Not the same accesses in the same order");
+      ++ALI;
+      ++AAI;
+    }
+    ActualAccesses.clear();
+  }
+}
+
+/// \brief Verify the domination properties of MemorySSA by checking that each
+/// definition dominates all of its uses.
+void MemorySSA::verifyDomination(Function &F) const {
+  for (BasicBlock &B : F) {
+    // Phi nodes are attached to basic blocks
+    if (MemoryPhi *MP = getMemoryAccess(&B)) {
+      for (MemoryAccess *U : MP->users()) {
+        BasicBlock *UseBlock = nullptr;
+        // Phi operands are used on edges, we simulate the right domination by
+        // acting as if the use occurred at the end of the predecessor block.
+        if (MemoryPhi *P = dyn_cast<MemoryPhi>(U)) {
+          for (unsigned I = 0, E = P->getNumIncomingValues(); I != E; ++I)
+            if (P->getIncomingValue(I) == MP) {
+              UseBlock = P->getIncomingBlock(I);
+              break;
+            }
+        } else {
+          UseBlock = U->getBlock();
+        }
+        (void)UseBlock;
+        assert(DT->dominates(MP->getBlock(), UseBlock) &&
+               "Memory PHI does not dominate it's uses");
+      }
+    }
+
+    for (Instruction &I : B) {
+      MemoryAccess *MD = dyn_cast_or_null<MemoryDef>(getMemoryAccess(&I));
+      if (!MD)
+        continue;
+
+      for (MemoryAccess *U : MD->users()) {
+        BasicBlock *UseBlock = nullptr;
+        (void)UseBlock;
+        // Things are allowed to flow to phi nodes over their predecessor edge.
+        if (auto *P = dyn_cast<MemoryPhi>(U)) {
+          for (unsigned I = 0, E = P->getNumIncomingValues(); I != E; ++I)
+            if (P->getIncomingValue(I) == MD) {
+              UseBlock = P->getIncomingBlock(I);
+              break;
+            }
+        } else {
+          UseBlock = U->getBlock();
+        }
+        assert(DT->dominates(MD->getBlock(), UseBlock) &&
+               "Memory Def does not dominate it's uses");
+      }
+    }
+  }
+}
+
+/// \brief Verify the def-use lists in MemorySSA, by verifying that \p Use
+/// appears in the use list of \p Def.
+///
+/// llvm_unreachable is used instead of asserts because this may be called in
+/// a build without asserts.  In that case, we don't want this to turn into a
+/// nop.
+void MemorySSA::verifyUseInDefs(MemoryAccess *Def, MemoryAccess *Use) const {
+  // The live on entry use may cause us to get a NULL def here
+  if (!Def) {
+    if (!isLiveOnEntryDef(Use))
+      llvm_unreachable("Null def but use not point to live on entry def");
+  } else if (std::find(Def->user_begin(), Def->user_end(), Use) ==
+             Def->user_end()) {
+    llvm_unreachable("Did not find use in def's use list");
+  }
+}
+
+/// \brief Verify the immediate use information, by walking all the memory
+/// accesses and verifying that, for each use, it appears in the
+/// appropriate def's use list
+void MemorySSA::verifyDefUses(Function &F) const {
+  for (BasicBlock &B : F) {
+    // Phi nodes are attached to basic blocks
+    if (MemoryPhi *Phi = getMemoryAccess(&B)) {
+      assert(Phi->getNumIncomingValues() ==
+                 (unsigned)std::distance(pred_begin(&B), pred_end(&B)) &&
+             "Incomplete MemoryPhi Node");
+      for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I)
+        verifyUseInDefs(Phi->getIncomingValue(I), Phi);
+    }
+
+    for (Instruction &I : B)
+      if (MemoryUseOrDef *MA = getMemoryAccess(&I))
+        verifyUseInDefs(MA->getDefiningAccess(), MA);
+  }
+}
+
+void MemorySSA::print(raw_ostream &OS) const {
+  MemorySSAAnnotatedWriter Writer(this);
+  F.print(OS, &Writer);
+}
+
+void MemorySSA::dump() const { print(dbgs()); }
+
+//===----------------------------------------------------------------------===//
+// MemorySSAWrapperPass
+//===----------------------------------------------------------------------===//
+
+char MemorySSAWrapperPass::ID = 0;
+
+MemorySSAWrapperPass::MemorySSAWrapperPass() : FunctionPass(ID) {
+  initializeMemorySSAWrapperPassPass(*PassRegistry::getPassRegistry());
+}
+
+void MemorySSAWrapperPass::releaseMemory() { MSSA.reset(); }
+
+void MemorySSAWrapperPass::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesAll();
+  AU.addRequiredTransitive<DominatorTreeWrapperPass>();
+  AU.addRequiredTransitive<AliasAnalysis>();
+}
+
+bool MemorySSAWrapperPass::runOnFunction(Function &F) {
+  auto &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  auto &AA = getAnalysis<AliasAnalysis>();
+  MSSA.reset(new MemorySSA(F, &AA, &DT));
+  return false;
+}
+
+void MemorySSAWrapperPass::verifyAnalysis() const {
+  if (VerifyMemorySSA)
+    MSSA->verifyMemorySSA();
+}
+
+void MemorySSAWrapperPass::print(raw_ostream &OS, const Module *M) const {
+  MSSA->print(OS);
+}
+
+//===----------------------------------------------------------------------===//
+// Walkers
+//===----------------------------------------------------------------------===//
+
+MemorySSAWalker::MemorySSAWalker(MemorySSA *M) : MSSA(M) {}
+
+MemoryAccess *
+DoNothingMemorySSAWalker::getClobberingMemoryAccess(const Instruction *I) {
+  return MSSA->getMemoryAccess(I)->getDefiningAccess();
+}
+
+MemoryAccess *DoNothingMemorySSAWalker::getClobberingMemoryAccess(
+    MemoryAccess *StartingAccess, const AliasAnalysis::Location &) {
+  if (auto *Use = dyn_cast<MemoryUseOrDef>(StartingAccess))
+    return Use->getDefiningAccess();
+  return StartingAccess;
+}
+
+/// \brief What the caching walker is looking for: the nearest access that
+/// may modify either a memory location or the memory read by a call.
+struct CachingMemorySSAWalker::UpwardsMemoryQuery {
+  // True if the query is for a call site rather than a single location.
+  bool IsCall;
+  // The pointer location we started the query with. This will be empty if
+  // IsCall is true.
+  AliasAnalysis::Location StartingLoc;
+  // This is the instruction we were querying about.
+  const Instruction *Inst;
+
+  UpwardsMemoryQuery() : IsCall(false), Inst(nullptr) {}
+};
+
+CachingMemorySSAWalker::CachingMemorySSAWalker(MemorySSA *M, AliasAnalysis *A,
+                                               DominatorTree *D)
+    : MemorySSAWalker(M), AA(A), DT(D) {}
+
+CachingMemorySSAWalker::~CachingMemorySSAWalker() {}
+
+void CachingMemorySSAWalker::invalidateInfo(MemoryAccess *MA) {
+  // Removing an access can change the answer for anything that walked
+  // through it, which we do not track, so drop everything.
+  CachedClobbers.clear();
+  CachedPhiClobbers.clear();
+}
+
+/// \brief Return true if \p MD may modify the memory that \p Q is asking
+/// about.
+bool CachingMemorySSAWalker::instructionClobbersQuery(
+    const MemoryDef *MD, const UpwardsMemoryQuery &Q) const {
+  Instruction *DefInst = MD->getMemoryInst();
+  assert(DefInst && "Defining instruction not actually an instruction");
+
+  if (Q.IsCall) {
+    // AliasAnalysis can only answer this for calls and for instructions that
+    // access a single location.
+    if (isa<FenceInst>(DefInst) || isa<VAArgInst>(DefInst))
+      return true;
+    return AA->getModRefInfo(DefInst, ImmutableCallSite(Q.Inst)) !=
+           AliasAnalysis::NoModRef;
+  }
+  return AA->getModRefInfo(DefInst, Q.StartingLoc) & AliasAnalysis::Mod;
+}
+
+/// \brief Walk the def chain upwards from \p Current (inclusive) and return
+/// the first access that may clobber \p Q.
+///
+/// Returns null if every path from \p Current leads back into a phi that is
+/// still being walked, i.e. no clobber is found before the cycle closes.
+/// \p LowLink is lowered to the depth of the outermost such phi.
+MemoryAccess *
+CachingMemorySSAWalker::walkUpwards(MemoryAccess *Current,
+                                    const UpwardsMemoryQuery &Q,
+                                    unsigned &LowLink) {
+  while (true) {
+    if (MSSA->isLiveOnEntryDef(Current))
+      return Current;
+    if (auto *Phi = dyn_cast<MemoryPhi>(Current))
+      return walkPhi(Phi, Q, LowLink);
+
+    auto *MD = cast<MemoryDef>(Current);
+    if (instructionClobbersQuery(MD, Q))
+      return MD;
+    Current = MD->getDefiningAccess();
+  }
+}
+
+/// \brief Find the clobber of \p Q for the memory state at \p Phi.
+///
+/// If every incoming value leads to the same clobber, that clobber also
+/// dominates the phi and is the answer; otherwise the phi is.  Paths around
+/// a loop lead back into the phi itself and do not contribute.  A result is
+/// only cached when it does not depend on a phi further up the walk.
+MemoryAccess *CachingMemorySSAWalker::walkPhi(MemoryPhi *Phi,
+                                              const UpwardsMemoryQuery &Q,
+                                              unsigned &LowLink) {
+  auto Active = ActivePhis.find(Phi);
+  if (Active != ActivePhis.end()) {
+    LowLink = std::min(LowLink, Active->second);
+    return nullptr;
+  }
+
+  if (!Q.IsCall) {
+    ++NumClobberCacheLookups;
+    auto CacheIt = CachedPhiClobbers.find(std::make_pair(Phi, Q.StartingLoc));
+    if (CacheIt != CachedPhiClobbers.end()) {
+      ++NumClobberCacheHits;
+      return CacheIt->second;
+    }
+  }
+
+  unsigned Depth = ActivePhis.size();
+  if (Depth >= MaxPhiWalkDepth)
+    return Phi;
+  ActivePhis[Phi] = Depth;
+
+  MemoryAccess *Result = nullptr;
+  unsigned PhiLowLink = ~0U;
+  for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I) {
+    MemoryAccess *Clobber = walkUpwards(Phi->getIncomingValue(I), Q,
+                                        PhiLowLink);
+    if (!Clobber)
+      continue;
+    if (Result && Result != Clobber) {
+      Result = Phi;
+      break;
+    }
+    Result = Clobber;
+  }
+  ActivePhis.erase(Phi);
+
+  if (PhiLowLink < Depth) {
+    // Part of the answer depends on a phi we are still walking; let it decide.
+    LowLink = std::min(LowLink, PhiLowLink);
+    return Result;
+  }
+
+  // Every path that did not loop back to this phi was accounted for.
+  if (!Result)
+    Result = Phi;
+  if (!Q.IsCall)
+    CachedPhiClobbers[std::make_pair(Phi, Q.StartingLoc)] = Result;
+  return Result;
+}
+
+MemoryAccess *
+CachingMemorySSAWalker::getClobberingMemoryAccess(MemoryAccess *StartingAccess,
+                                                  const UpwardsMemoryQuery &Q) {
+  assert(ActivePhis.empty() && "Clobber walk is not reentrant");
+  unsigned LowLink = ~0U;
+  MemoryAccess *Result = walkUpwards(StartingAccess, Q, LowLink);
+  assert(Result && "Walk from the top level found no clobber");
+  return Result;
+}
+
+MemoryAccess *CachingMemorySSAWalker::getClobberingMemoryAccess(
+    MemoryAccess *StartingAccess, const AliasAnalysis::Location &Loc) {
+  if (isa<MemoryPhi>(StartingAccess) || MSSA->isLiveOnEntryDef(StartingAccess))
+    return StartingAccess;
+
+  auto *StartingUseOrDef = cast<MemoryUseOrDef>(StartingAccess);
+  // A MemoryDef handed in may itself be the clobber.
+  UpwardsMemoryQuery Q;
+  Q.StartingLoc = Loc;
+  Q.Inst = StartingUseOrDef->getMemoryInst();
+  if (auto *MD = dyn_cast<MemoryDef>(StartingUseOrDef))
+    if (instructionClobbersQuery(MD, Q))
+      return MD;
+
+  return getClobberingMemoryAccess(StartingUseOrDef->getDefiningAccess(), Q);
+}
+
+MemoryAccess *
+CachingMemorySSAWalker::getClobberingMemoryAccess(const Instruction *I) {
+  MemoryUseOrDef *StartingAccess = MSSA->getMemoryAccess(I);
+  // There should be no way to lookup an instruction and get a phi as the
+  // access, since we only map BB's to PHI's.
+  assert(StartingAccess && "Querying an instruction without a memory access");
+
+  ++NumClobberCacheLookups;
+  auto CacheIt = CachedClobbers.find(StartingAccess);
+  if (CacheIt != CachedClobbers.end()) {
+    ++NumClobberCacheHits;
+    return CacheIt->second;
+  }
+
+  MemoryAccess *DefiningAccess = StartingAccess->getDefiningAccess();
+  UpwardsMemoryQuery Q;
+  Q.Inst = I;
+  if (ImmutableCallSite(I)) {
+    Q.IsCall = true;
+  } else if (auto *LI = dyn_cast<LoadInst>(I)) {
+    // Ordered loads are defs and are not disambiguated further.
+    if (!LI->isUnordered())
+      return DefiningAccess;
+    Q.StartingLoc = AA->getLocation(LI);
+  } else if (auto *SI = dyn_cast<StoreInst>(I)) {
+    if (!SI->isUnordered())
+      return DefiningAccess;
+    Q.StartingLoc = AA->getLocation(SI);
+  } else {
+    // Fences, atomics and va_arg are conservatively clobbered by the nearest
+    // definition.
+    return DefiningAccess;
+  }
+
+  MemoryAccess *Result = getClobberingMemoryAccess(DefiningAccess, Q);
+  CachedClobbers[StartingAccess] = Result;
+  DEBUG(dbgs() << "Starting Memory SSA clobber for " << *I << " is ");
+  DEBUG(dbgs() << *StartingAccess << "\n");
+  DEBUG(dbgs() << "Final Memory SSA clobber for " << *I << " is ");
+  DEBUG(dbgs() << *Result << "\n");
+  return Result;
+}
@@ -14,8 +14,10 @@
 //
 //===----------------------------------------------------------------------===//
 #include "llvm/Analysis/RegionPass.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/Analysis/RegionIterator.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
@@ -96,6 +98,11 @@ bool RGPassManager::runOnFunction(Function &F) {
         PassManagerPrettyStackEntry X(P, *CurrentRegion->getEntry());
 
         TimeRegion PassTimer(getPassTimer(P));
+        Optional<TimeTraceScope> TraceScope;
+        if (timeTraceProfilerEnabled())
+          TraceScope.emplace(
+              P->getPassName(),
+              (F.getName() + ":" + CurrentRegion->getNameStr()).str());
         Changed |= P->runOnRegion(CurrentRegion, *this);
       }
 
@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
@@ -20,6 +21,7 @@
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/FunctionInfo.h"
 #include "llvm/IR/GVMaterializer.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -32,6 +34,7 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/raw_ostream.h"
 #include <deque>
 using namespace llvm;
@@ -194,6 +197,23 @@ class BitcodeReader : public GVMaterializer {
   /// which Metadata blocks are deferred.
   std::vector<uint64_t> DeferredMetadataInfo;
 
+  /// When the module-level metadata block has an index, a deferred block is
+  /// not parsed at once: each node is parsed when something refers to it,
+  /// from its position in MetadataOffsets. MetadataCursor is positioned in the
+  /// block, with its abbreviations read.
+  BitstreamCursor MetadataCursor;
+  std::vector<uint64_t> MetadataOffsets;
+
+  /// Indexed nodes that have been referred to, and those that have been
+  /// parsed. The ones in between are in PendingMetadata.
+  BitVector MetadataRequested;
+  BitVector MetadataLoaded;
+  SmallVector<unsigned, 16> PendingMetadata;
+
+  /// The position of the named metadata of the indexed block, or 0 if it has
+  /// been parsed. Parsing it loads every node that is reachable from it.
+  uint64_t DeferredNamedMetadataBit;
+
   /// These are basic blocks forward-referenced by block addresses.  They are
   /// inserted lazily into functions when they're loaded.  The basic block ID is
   /// its index into the vector.
@@ -267,11 +287,15 @@ private:
 
   Type *getTypeByID(unsigned ID);
   Value *getFnValueByID(unsigned ID, Type *Ty) {
-    if (Ty && Ty->isMetadataTy())
-      return MetadataAsValue::get(Ty->getContext(), getFnMetadataByID(ID));
+    if (Ty && Ty->isMetadataTy()) {
+      Metadata *MD = getFnMetadataByID(ID);
+      return MD ? MetadataAsValue::get(Ty->getContext(), MD) : nullptr;
+    }
     return ValueList.getValueFwdRef(ID, Ty);
   }
   Metadata *getFnMetadataByID(unsigned ID) {
+    if (loadMetadata(ID))
+      return nullptr;
     return MDValueList.getValueFwdRef(ID);
   }
   BasicBlock *getBasicBlock(unsigned ID) const {
@@ -370,6 +394,29 @@ private:
   std::error_code GlobalCleanup();
   std::error_code ResolveGlobalAndAliasInits();
   std::error_code ParseMetadata();
+  std::error_code parseMetadataRecord(unsigned Code,
+                                      SmallVectorImpl<uint64_t> &Record,
+                                      unsigned &NextMDValueNo);
+  std::error_code parseNamedMetadata(BitstreamCursor &Cursor,
+                                     SmallVectorImpl<uint64_t> &Record);
+  std::error_code parseMetadataKindRecord(SmallVectorImpl<uint64_t> &Record);
+  std::error_code parseMetadataKinds();
+  ErrorOr<bool> parseMetadataIndex();
+  std::error_code parseDeferredMetadataBlocks();
+
+  /// Return the metadata with the given ID, or a placeholder for it. An
+  /// indexed node that has not been parsed is queued for loading.
+  Metadata *getMetadataFwdRef(unsigned ID);
+
+  /// Parse the record of the indexed node with the given ID.
+  std::error_code parseIndexedMetadata(unsigned ID);
+
+  /// Parse the queued indexed nodes and the nodes they refer to.
+  std::error_code loadPendingMetadata();
+
+  /// Make sure that the metadata with the given ID is not a placeholder for
+  /// an indexed node.
+  std::error_code loadMetadata(unsigned ID);
   std::error_code ParseMetadataAttachment();
   ErrorOr<std::string> parseModuleTriple();
   std::error_code ParseUseLists();
@@ -426,7 +473,8 @@ BitcodeReader::BitcodeReader(MemoryBuffer *buffer, LLVMContext &C,
     : Context(C), DiagnosticHandler(getDiagHandler(DiagnosticHandler, C)),
       TheModule(nullptr), Buffer(buffer), LazyStreamer(nullptr),
       NextUnreadBit(0), SeenValueSymbolTable(false), ValueList(C),
-      MDValueList(C), SeenFirstFunctionBody(false), UseRelativeIDs(false),
+      MDValueList(C), SeenFirstFunctionBody(false),
+      DeferredNamedMetadataBit(0), UseRelativeIDs(false),
       WillMaterializeAllForwardRefs(false), IsMetadataMaterialized(false) {}
 
 BitcodeReader::BitcodeReader(DataStreamer *streamer, LLVMContext &C,
@@ -434,7 +482,8 @@ BitcodeReader::BitcodeReader(DataStreamer *streamer, LLVMContext &C,
     : Context(C), DiagnosticHandler(getDiagHandler(DiagnosticHandler, C)),
       TheModule(nullptr), Buffer(nullptr), LazyStreamer(streamer),
       NextUnreadBit(0), SeenValueSymbolTable(false), ValueList(C),
-      MDValueList(C), SeenFirstFunctionBody(false), UseRelativeIDs(false),
+      MDValueList(C), SeenFirstFunctionBody(false),
+      DeferredNamedMetadataBit(0), UseRelativeIDs(false),
       WillMaterializeAllForwardRefs(false), IsMetadataMaterialized(false) {}
 
 std::error_code BitcodeReader::materializeForwardReferencedFunctions() {
@@ -482,6 +531,11 @@ void BitcodeReader::FreeState() {
   std::vector<Function*>().swap(FunctionsWithBodies);
   DeferredFunctionInfo.clear();
   DeferredMetadataInfo.clear();
+  std::vector<uint64_t>().swap(MetadataOffsets);
+  MetadataRequested.clear();
+  MetadataLoaded.clear();
+  PendingMetadata.clear();
+  DeferredNamedMetadataBit = 0;
   MDKindMap.clear();
 
   assert(BasicBlockFwdRefs.empty() && "Unresolved blockaddress fwd references");
@@ -1557,22 +1611,6 @@ std::error_code BitcodeReader::ParseMetadata() {
 
   SmallVector<uint64_t, 64> Record;
 
-  auto getMD =
-      [&](unsigned ID) -> Metadata *{ return MDValueList.getValueFwdRef(ID); };
-  auto getMDOrNull = [&](unsigned ID) -> Metadata *{
-    if (ID)
-      return getMD(ID - 1);
-    return nullptr;
-  };
-  auto getMDString = [&](unsigned ID) -> MDString *{
-    // This requires that the ID is not really a forward reference.  In
-    // particular, the MDString must already have been resolved.
-    return cast_or_null<MDString>(getMDOrNull(ID));
-  };
-
-#define GET_OR_DISTINCT(CLASS, DISTINCT, ARGS)                                 \
-  (DISTINCT ? CLASS::getDistinct ARGS : CLASS::get ARGS)
-
   // Read all the records.
   while (1) {
     BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
@@ -1582,8 +1620,8 @@ std::error_code BitcodeReader::ParseMetadata() {
     case BitstreamEntry::Error:
       return Error("Malformed block");
     case BitstreamEntry::EndBlock:
-      MDValueList.tryToResolveCycles();
-      return std::error_code();
+      // A function-level block may refer to indexed module-level nodes.
+      return loadPendingMetadata();
     case BitstreamEntry::Record:
       // The interesting case.
       break;
@@ -1592,399 +1630,479 @@ std::error_code BitcodeReader::ParseMetadata() {
     // Read a record.
     Record.clear();
     unsigned Code = Stream.readRecord(Entry.ID, Record);
-    bool IsDistinct = false;
-    switch (Code) {
-    default:  // Default behavior: ignore.
-      break;
-    case bitc::METADATA_NAME: {
-      // Read name of the named metadata.
-      SmallString<8> Name(Record.begin(), Record.end());
-      Record.clear();
-      Code = Stream.ReadCode();
+    std::error_code EC;
+    if (Code == bitc::METADATA_NAME)
+      EC = parseNamedMetadata(Stream, Record);
+    else
+      EC = parseMetadataRecord(Code, Record, NextMDValueNo);
+    if (EC)
+      return EC;
+  }
+}
 
-      // METADATA_NAME is always followed by METADATA_NAMED_NODE.
-      unsigned NextBitCode = Stream.readRecord(Code, Record);
-      assert(NextBitCode == bitc::METADATA_NAMED_NODE); (void)NextBitCode;
+/// Parse the METADATA_NAMED_NODE record that follows the METADATA_NAME record
+/// in Record.
+std::error_code
+BitcodeReader::parseNamedMetadata(BitstreamCursor &Cursor,
+                                  SmallVectorImpl<uint64_t> &Record) {
+  // Read name of the named metadata.
+  SmallString<8> Name(Record.begin(), Record.end());
+  Record.clear();
+  unsigned Code = Cursor.ReadCode();
+
+  // METADATA_NAME is always followed by METADATA_NAMED_NODE.
+  unsigned NextBitCode = Cursor.readRecord(Code, Record);
+  assert(NextBitCode == bitc::METADATA_NAMED_NODE); (void)NextBitCode;
+
+  // Read named metadata elements.
+  unsigned Size = Record.size();
+  for (unsigned i = 0; i != Size; ++i)
+    if (std::error_code EC = loadMetadata(Record[i]))
+      return EC;
+  NamedMDNode *NMD = TheModule->getOrInsertNamedMetadata(Name);
+  for (unsigned i = 0; i != Size; ++i) {
+    MDNode *MD = dyn_cast_or_null<MDNode>(MDValueList.getValueFwdRef(Record[i]));
+    if (!MD)
+      return Error("Invalid record");
+    NMD->addOperand(MD);
+  }
+  return std::error_code();
+}
 
-      // Read named metadata elements.
-      unsigned Size = Record.size();
-      NamedMDNode *NMD = TheModule->getOrInsertNamedMetadata(Name);
-      for (unsigned i = 0; i != Size; ++i) {
-        MDNode *MD = dyn_cast_or_null<MDNode>(MDValueList.getValueFwdRef(Record[i]));
-        if (!MD)
-          return Error("Invalid record");
-        NMD->addOperand(MD);
-      }
-      break;
+/// Parse a metadata record other than a named node, assigning the value it
+/// defines, if any, to NextMDValueNo.
+std::error_code
+BitcodeReader::parseMetadataRecord(unsigned Code,
+                                   SmallVectorImpl<uint64_t> &Record,
+                                   unsigned &NextMDValueNo) {
+  auto getMD =
+      [&](unsigned ID) -> Metadata *{ return getMetadataFwdRef(ID); };
+  auto getMDOrNull = [&](unsigned ID) -> Metadata *{
+    if (ID)
+      return getMD(ID - 1);
+    return nullptr;
+  };
+  auto getMDString = [&](unsigned ID) -> MDString *{
+    // This requires that the ID is not really a forward reference.  In
+    // particular, the MDString must already have been resolved, which is
+    // done here for an indexed string that has not been parsed yet.
+    if (ID && ID - 1 < MetadataOffsets.size() && !MetadataLoaded[ID - 1]) {
+      MetadataRequested.set(ID - 1);
+      if (parseIndexedMetadata(ID - 1))
+        return nullptr;
     }
-    case bitc::METADATA_OLD_FN_NODE: {
-      // FIXME: Remove in 4.0.
-      // This is a LocalAsMetadata record, the only type of function-local
-      // metadata.
-      if (Record.size() % 2 == 1)
-        return Error("Invalid record");
+    return cast_or_null<MDString>(getMDOrNull(ID));
+  };
 
-      // If this isn't a LocalAsMetadata record, we're dropping it.  This used
-      // to be legal, but there's no upgrade path.
-      auto dropRecord = [&] {
-        MDValueList.AssignValue(MDNode::get(Context, None), NextMDValueNo++);
-      };
-      if (Record.size() != 2) {
-        dropRecord();
-        break;
-      }
+#define GET_OR_DISTINCT(CLASS, DISTINCT, ARGS)                                 \
+  (DISTINCT ? CLASS::getDistinct ARGS : CLASS::get ARGS)
 
-      Type *Ty = getTypeByID(Record[0]);
-      if (Ty->isMetadataTy() || Ty->isVoidTy()) {
-        dropRecord();
-        break;
-      }
+  bool IsDistinct = false;
+  switch (Code) {
+  default:  // Default behavior: ignore.
+    break;
+  case bitc::METADATA_OLD_FN_NODE: {
+    // FIXME: Remove in 4.0.
+    // This is a LocalAsMetadata record, the only type of function-local
+    // metadata.
+    if (Record.size() % 2 == 1)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          LocalAsMetadata::get(ValueList.getValueFwdRef(Record[1], Ty)),
-          NextMDValueNo++);
+    // If this isn't a LocalAsMetadata record, we're dropping it.  This used
+    // to be legal, but there's no upgrade path.
+    auto dropRecord = [&] {
+      MDValueList.AssignValue(MDNode::get(Context, None), NextMDValueNo++);
+    };
+    if (Record.size() != 2) {
+      dropRecord();
       break;
     }
-    case bitc::METADATA_OLD_NODE: {
-      // FIXME: Remove in 4.0.
-      if (Record.size() % 2 == 1)
-        return Error("Invalid record");
 
-      unsigned Size = Record.size();
-      SmallVector<Metadata *, 8> Elts;
-      for (unsigned i = 0; i != Size; i += 2) {
-        Type *Ty = getTypeByID(Record[i]);
-        if (!Ty)
-          return Error("Invalid record");
-        if (Ty->isMetadataTy())
-          Elts.push_back(MDValueList.getValueFwdRef(Record[i+1]));
-        else if (!Ty->isVoidTy()) {
-          auto *MD =
-              ValueAsMetadata::get(ValueList.getValueFwdRef(Record[i + 1], Ty));
-          assert(isa<ConstantAsMetadata>(MD) &&
-                 "Expected non-function-local metadata");
-          Elts.push_back(MD);
-        } else
-          Elts.push_back(nullptr);
-      }
-      MDValueList.AssignValue(MDNode::get(Context, Elts), NextMDValueNo++);
+    Type *Ty = getTypeByID(Record[0]);
+    if (Ty->isMetadataTy() || Ty->isVoidTy()) {
+      dropRecord();
       break;
     }
-    case bitc::METADATA_VALUE: {
-      if (Record.size() != 2)
-        return Error("Invalid record");
 
-      Type *Ty = getTypeByID(Record[0]);
-      if (Ty->isMetadataTy() || Ty->isVoidTy())
-        return Error("Invalid record");
+    MDValueList.AssignValue(
+        LocalAsMetadata::get(ValueList.getValueFwdRef(Record[1], Ty)),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_OLD_NODE: {
+    // FIXME: Remove in 4.0.
+    if (Record.size() % 2 == 1)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          ValueAsMetadata::get(ValueList.getValueFwdRef(Record[1], Ty)),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_DISTINCT_NODE:
-      IsDistinct = true;
-      // fallthrough...
-    case bitc::METADATA_NODE: {
-      SmallVector<Metadata *, 8> Elts;
-      Elts.reserve(Record.size());
-      for (unsigned ID : Record)
-        Elts.push_back(ID ? MDValueList.getValueFwdRef(ID - 1) : nullptr);
-      MDValueList.AssignValue(IsDistinct ? MDNode::getDistinct(Context, Elts)
-                                         : MDNode::get(Context, Elts),
-                              NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_LOCATION: {
-      if (Record.size() != 5)
+    unsigned Size = Record.size();
+    SmallVector<Metadata *, 8> Elts;
+    for (unsigned i = 0; i != Size; i += 2) {
+      Type *Ty = getTypeByID(Record[i]);
+      if (!Ty)
         return Error("Invalid record");
-
-      unsigned Line = Record[1];
-      unsigned Column = Record[2];
-      MDNode *Scope = cast<MDNode>(MDValueList.getValueFwdRef(Record[3]));
-      Metadata *InlinedAt =
-          Record[4] ? MDValueList.getValueFwdRef(Record[4] - 1) : nullptr;
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDLocation, Record[0],
-                          (Context, Line, Column, Scope, InlinedAt)),
-          NextMDValueNo++);
-      break;
+      if (Ty->isMetadataTy())
+        Elts.push_back(getMD(Record[i+1]));
+      else if (!Ty->isVoidTy()) {
+        auto *MD =
+            ValueAsMetadata::get(ValueList.getValueFwdRef(Record[i + 1], Ty));
+        assert(isa<ConstantAsMetadata>(MD) &&
+               "Expected non-function-local metadata");
+        Elts.push_back(MD);
+      } else
+        Elts.push_back(nullptr);
     }
-    case bitc::METADATA_GENERIC_DEBUG: {
-      if (Record.size() < 4)
-        return Error("Invalid record");
+    MDValueList.AssignValue(MDNode::get(Context, Elts), NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_VALUE: {
+    if (Record.size() != 2)
+      return Error("Invalid record");
 
-      unsigned Tag = Record[1];
-      unsigned Version = Record[2];
+    Type *Ty = getTypeByID(Record[0]);
+    if (Ty->isMetadataTy() || Ty->isVoidTy())
+      return Error("Invalid record");
 
-      if (Tag >= 1u << 16 || Version != 0)
-        return Error("Invalid record");
+    MDValueList.AssignValue(
+        ValueAsMetadata::get(ValueList.getValueFwdRef(Record[1], Ty)),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_DISTINCT_NODE:
+    IsDistinct = true;
+    // fallthrough...
+  case bitc::METADATA_NODE: {
+    SmallVector<Metadata *, 8> Elts;
+    Elts.reserve(Record.size());
+    for (unsigned ID : Record)
+      Elts.push_back(getMDOrNull(ID));
+    MDValueList.AssignValue(IsDistinct ? MDNode::getDistinct(Context, Elts)
+                                       : MDNode::get(Context, Elts),
+                            NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_LOCATION: {
+    if (Record.size() != 5)
+      return Error("Invalid record");
 
-      auto *Header = getMDString(Record[3]);
-      SmallVector<Metadata *, 8> DwarfOps;
-      for (unsigned I = 4, E = Record.size(); I != E; ++I)
-        DwarfOps.push_back(Record[I] ? MDValueList.getValueFwdRef(Record[I] - 1)
-                                     : nullptr);
-      MDValueList.AssignValue(GET_OR_DISTINCT(GenericDebugNode, Record[0],
-                                              (Context, Tag, Header, DwarfOps)),
-                              NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_SUBRANGE: {
-      if (Record.size() != 3)
-        return Error("Invalid record");
+    unsigned Line = Record[1];
+    unsigned Column = Record[2];
+    MDNode *Scope = cast<MDNode>(getMD(Record[3]));
+    Metadata *InlinedAt = getMDOrNull(Record[4]);
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDLocation, Record[0],
+                        (Context, Line, Column, Scope, InlinedAt)),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_GENERIC_DEBUG: {
+    if (Record.size() < 4)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDSubrange, Record[0],
-                          (Context, Record[1], unrotateSign(Record[2]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_ENUMERATOR: {
-      if (Record.size() != 3)
-        return Error("Invalid record");
+    unsigned Tag = Record[1];
+    unsigned Version = Record[2];
 
-      MDValueList.AssignValue(GET_OR_DISTINCT(MDEnumerator, Record[0],
-                                              (Context, unrotateSign(Record[1]),
-                                               getMDString(Record[2]))),
-                              NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_BASIC_TYPE: {
-      if (Record.size() != 6)
-        return Error("Invalid record");
+    if (Tag >= 1u << 16 || Version != 0)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDBasicType, Record[0],
-                          (Context, Record[1], getMDString(Record[2]),
-                           Record[3], Record[4], Record[5])),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_DERIVED_TYPE: {
-      if (Record.size() != 12)
-        return Error("Invalid record");
+    auto *Header = getMDString(Record[3]);
+    SmallVector<Metadata *, 8> DwarfOps;
+    for (unsigned I = 4, E = Record.size(); I != E; ++I)
+      DwarfOps.push_back(getMDOrNull(Record[I]));
+    MDValueList.AssignValue(GET_OR_DISTINCT(GenericDebugNode, Record[0],
+                                            (Context, Tag, Header, DwarfOps)),
+                            NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_SUBRANGE: {
+    if (Record.size() != 3)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDDerivedType, Record[0],
-                          (Context, Record[1], getMDString(Record[2]),
-                           getMDOrNull(Record[3]), Record[4],
-                           getMDOrNull(Record[5]), getMDOrNull(Record[6]),
-                           Record[7], Record[8], Record[9], Record[10],
-                           getMDOrNull(Record[11]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_COMPOSITE_TYPE: {
-      if (Record.size() != 16)
-        return Error("Invalid record");
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDSubrange, Record[0],
+                        (Context, Record[1], unrotateSign(Record[2]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_ENUMERATOR: {
+    if (Record.size() != 3)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDCompositeType, Record[0],
-                          (Context, Record[1], getMDString(Record[2]),
-                           getMDOrNull(Record[3]), Record[4],
-                           getMDOrNull(Record[5]), getMDOrNull(Record[6]),
-                           Record[7], Record[8], Record[9], Record[10],
-                           getMDOrNull(Record[11]), Record[12],
-                           getMDOrNull(Record[13]), getMDOrNull(Record[14]),
-                           getMDString(Record[15]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_SUBROUTINE_TYPE: {
-      if (Record.size() != 3)
-        return Error("Invalid record");
+    MDValueList.AssignValue(GET_OR_DISTINCT(MDEnumerator, Record[0],
+                                            (Context, unrotateSign(Record[1]),
+                                             getMDString(Record[2]))),
+                            NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_BASIC_TYPE: {
+    if (Record.size() != 6)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDSubroutineType, Record[0],
-                          (Context, Record[1], getMDOrNull(Record[2]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_FILE: {
-      if (Record.size() != 3)
-        return Error("Invalid record");
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDBasicType, Record[0],
+                        (Context, Record[1], getMDString(Record[2]),
+                         Record[3], Record[4], Record[5])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_DERIVED_TYPE: {
+    if (Record.size() != 12)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDFile, Record[0], (Context, getMDString(Record[1]),
-                                              getMDString(Record[2]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_COMPILE_UNIT: {
-      if (Record.size() != 14)
-        return Error("Invalid record");
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDDerivedType, Record[0],
+                        (Context, Record[1], getMDString(Record[2]),
+                         getMDOrNull(Record[3]), Record[4],
+                         getMDOrNull(Record[5]), getMDOrNull(Record[6]),
+                         Record[7], Record[8], Record[9], Record[10],
+                         getMDOrNull(Record[11]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_COMPOSITE_TYPE: {
+    if (Record.size() != 16)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDCompileUnit, Record[0],
-                          (Context, Record[1], getMDOrNull(Record[2]),
-                           getMDString(Record[3]), Record[4],
-                           getMDString(Record[5]), Record[6],
-                           getMDString(Record[7]), Record[8],
-                           getMDOrNull(Record[9]), getMDOrNull(Record[10]),
-                           getMDOrNull(Record[11]), getMDOrNull(Record[12]),
-                           getMDOrNull(Record[13]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_SUBPROGRAM: {
-      if (Record.size() != 19)
-        return Error("Invalid record");
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDCompositeType, Record[0],
+                        (Context, Record[1], getMDString(Record[2]),
+                         getMDOrNull(Record[3]), Record[4],
+                         getMDOrNull(Record[5]), getMDOrNull(Record[6]),
+                         Record[7], Record[8], Record[9], Record[10],
+                         getMDOrNull(Record[11]), Record[12],
+                         getMDOrNull(Record[13]), getMDOrNull(Record[14]),
+                         getMDString(Record[15]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_SUBROUTINE_TYPE: {
+    if (Record.size() != 3)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(
-              MDSubprogram, Record[0],
-              (Context, getMDOrNull(Record[1]), getMDString(Record[2]),
-               getMDString(Record[3]), getMDOrNull(Record[4]), Record[5],
-               getMDOrNull(Record[6]), Record[7], Record[8], Record[9],
-               getMDOrNull(Record[10]), Record[11], Record[12], Record[13],
-               Record[14], getMDOrNull(Record[15]), getMDOrNull(Record[16]),
-               getMDOrNull(Record[17]), getMDOrNull(Record[18]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_LEXICAL_BLOCK: {
-      if (Record.size() != 5)
-        return Error("Invalid record");
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDSubroutineType, Record[0],
+                        (Context, Record[1], getMDOrNull(Record[2]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_FILE: {
+    if (Record.size() != 3)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDLexicalBlock, Record[0],
-                          (Context, getMDOrNull(Record[1]),
-                           getMDOrNull(Record[2]), Record[3], Record[4])),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_LEXICAL_BLOCK_FILE: {
-      if (Record.size() != 4)
-        return Error("Invalid record");
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDFile, Record[0], (Context, getMDString(Record[1]),
+                                            getMDString(Record[2]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_COMPILE_UNIT: {
+    if (Record.size() != 14)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDLexicalBlockFile, Record[0],
-                          (Context, getMDOrNull(Record[1]),
-                           getMDOrNull(Record[2]), Record[3])),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_NAMESPACE: {
-      if (Record.size() != 5)
-        return Error("Invalid record");
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDCompileUnit, Record[0],
+                        (Context, Record[1], getMDOrNull(Record[2]),
+                         getMDString(Record[3]), Record[4],
+                         getMDString(Record[5]), Record[6],
+                         getMDString(Record[7]), Record[8],
+                         getMDOrNull(Record[9]), getMDOrNull(Record[10]),
+                         getMDOrNull(Record[11]), getMDOrNull(Record[12]),
+                         getMDOrNull(Record[13]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_SUBPROGRAM: {
+    if (Record.size() != 19)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDNamespace, Record[0],
-                          (Context, getMDOrNull(Record[1]),
-                           getMDOrNull(Record[2]), getMDString(Record[3]),
-                           Record[4])),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_TEMPLATE_TYPE: {
-      if (Record.size() != 3)
-        return Error("Invalid record");
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(
+            MDSubprogram, Record[0],
+            (Context, getMDOrNull(Record[1]), getMDString(Record[2]),
+             getMDString(Record[3]), getMDOrNull(Record[4]), Record[5],
+             getMDOrNull(Record[6]), Record[7], Record[8], Record[9],
+             getMDOrNull(Record[10]), Record[11], Record[12], Record[13],
+             Record[14], getMDOrNull(Record[15]), getMDOrNull(Record[16]),
+             getMDOrNull(Record[17]), getMDOrNull(Record[18]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_LEXICAL_BLOCK: {
+    if (Record.size() != 5)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(GET_OR_DISTINCT(MDTemplateTypeParameter,
-                                              Record[0],
-                                              (Context, getMDString(Record[1]),
-                                               getMDOrNull(Record[2]))),
-                              NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_TEMPLATE_VALUE: {
-      if (Record.size() != 5)
-        return Error("Invalid record");
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDLexicalBlock, Record[0],
+                        (Context, getMDOrNull(Record[1]),
+                         getMDOrNull(Record[2]), Record[3], Record[4])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_LEXICAL_BLOCK_FILE: {
+    if (Record.size() != 4)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDTemplateValueParameter, Record[0],
-                          (Context, Record[1], getMDString(Record[2]),
-                           getMDOrNull(Record[3]), getMDOrNull(Record[4]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_GLOBAL_VAR: {
-      if (Record.size() != 11)
-        return Error("Invalid record");
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDLexicalBlockFile, Record[0],
+                        (Context, getMDOrNull(Record[1]),
+                         getMDOrNull(Record[2]), Record[3])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_NAMESPACE: {
+    if (Record.size() != 5)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDGlobalVariable, Record[0],
-                          (Context, getMDOrNull(Record[1]),
-                           getMDString(Record[2]), getMDString(Record[3]),
-                           getMDOrNull(Record[4]), Record[5],
-                           getMDOrNull(Record[6]), Record[7], Record[8],
-                           getMDOrNull(Record[9]), getMDOrNull(Record[10]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_LOCAL_VAR: {
-      // 10th field is for the obseleted 'inlinedAt:' field.
-      if (Record.size() != 9 && Record.size() != 10)
-        return Error("Invalid record");
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDNamespace, Record[0],
+                        (Context, getMDOrNull(Record[1]),
+                         getMDOrNull(Record[2]), getMDString(Record[3]),
+                         Record[4])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_TEMPLATE_TYPE: {
+    if (Record.size() != 3)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDLocalVariable, Record[0],
-                          (Context, Record[1], getMDOrNull(Record[2]),
-                           getMDString(Record[3]), getMDOrNull(Record[4]),
-                           Record[5], getMDOrNull(Record[6]), Record[7],
-                           Record[8])),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_EXPRESSION: {
-      if (Record.size() < 1)
-        return Error("Invalid record");
+    MDValueList.AssignValue(GET_OR_DISTINCT(MDTemplateTypeParameter,
+                                            Record[0],
+                                            (Context, getMDString(Record[1]),
+                                             getMDOrNull(Record[2]))),
+                            NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_TEMPLATE_VALUE: {
+    if (Record.size() != 5)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDExpression, Record[0],
-                          (Context, makeArrayRef(Record).slice(1))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_OBJC_PROPERTY: {
-      if (Record.size() != 8)
-        return Error("Invalid record");
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDTemplateValueParameter, Record[0],
+                        (Context, Record[1], getMDString(Record[2]),
+                         getMDOrNull(Record[3]), getMDOrNull(Record[4]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_GLOBAL_VAR: {
+    if (Record.size() != 11)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDObjCProperty, Record[0],
-                          (Context, getMDString(Record[1]),
-                           getMDOrNull(Record[2]), Record[3],
-                           getMDString(Record[4]), getMDString(Record[5]),
-                           Record[6], getMDOrNull(Record[7]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_IMPORTED_ENTITY: {
-      if (Record.size() != 6)
-        return Error("Invalid record");
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDGlobalVariable, Record[0],
+                        (Context, getMDOrNull(Record[1]),
+                         getMDString(Record[2]), getMDString(Record[3]),
+                         getMDOrNull(Record[4]), Record[5],
+                         getMDOrNull(Record[6]), Record[7], Record[8],
+                         getMDOrNull(Record[9]), getMDOrNull(Record[10]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_LOCAL_VAR: {
+    // 10th field is for the obseleted 'inlinedAt:' field.
+    if (Record.size() != 9 && Record.size() != 10)
+      return Error("Invalid record");
 
-      MDValueList.AssignValue(
-          GET_OR_DISTINCT(MDImportedEntity, Record[0],
-                          (Context, Record[1], getMDOrNull(Record[2]),
-                           getMDOrNull(Record[3]), Record[4],
-                           getMDString(Record[5]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_STRING: {
-      std::string String(Record.begin(), Record.end());
-      llvm::UpgradeMDStringConstant(String);
-      Metadata *MD = MDString::get(Context, String);
-      MDValueList.AssignValue(MD, NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_KIND: {
-      if (Record.size() < 2)
-        return Error("Invalid record");
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDLocalVariable, Record[0],
+                        (Context, Record[1], getMDOrNull(Record[2]),
+                         getMDString(Record[3]), getMDOrNull(Record[4]),
+                         Record[5], getMDOrNull(Record[6]), Record[7],
+                         Record[8])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_EXPRESSION: {
+    if (Record.size() < 1)
+      return Error("Invalid record");
+
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDExpression, Record[0],
+                        (Context, makeArrayRef(Record).slice(1))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_OBJC_PROPERTY: {
+    if (Record.size() != 8)
+      return Error("Invalid record");
+
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDObjCProperty, Record[0],
+                        (Context, getMDString(Record[1]),
+                         getMDOrNull(Record[2]), Record[3],
+                         getMDString(Record[4]), getMDString(Record[5]),
+                         Record[6], getMDOrNull(Record[7]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_IMPORTED_ENTITY: {
+    if (Record.size() != 6)
+      return Error("Invalid record");
+
+    MDValueList.AssignValue(
+        GET_OR_DISTINCT(MDImportedEntity, Record[0],
+                        (Context, Record[1], getMDOrNull(Record[2]),
+                         getMDOrNull(Record[3]), Record[4],
+                         getMDString(Record[5]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_STRING: {
+    std::string String(Record.begin(), Record.end());
+    llvm::UpgradeMDStringConstant(String);
+    Metadata *MD = MDString::get(Context, String);
+    MDValueList.AssignValue(MD, NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_KIND:
+    // Older writers put the kinds in a METADATA_BLOCK.
+    return parseMetadataKindRecord(Record);
+  }
+  return std::error_code();
+#undef GET_OR_DISTINCT
+}
+
+std::error_code
+BitcodeReader::parseMetadataKindRecord(SmallVectorImpl<uint64_t> &Record) {
+  if (Record.size() < 2)
+    return Error("Invalid record");
+
+  unsigned Kind = Record[0];
+  SmallString<8> Name(Record.begin()+1, Record.end());
 
-      unsigned Kind = Record[0];
-      SmallString<8> Name(Record.begin()+1, Record.end());
+  unsigned NewKind = TheModule->getMDKindID(Name.str());
+  if (!MDKindMap.insert(std::make_pair(Kind, NewKind)).second)
+    return Error("Conflicting METADATA_KIND records");
+  return std::error_code();
+}
+
+/// Parse the METADATA_KIND_BLOCK, which maps the metadata kinds of the bitcode
+/// to those of the context.
+std::error_code BitcodeReader::parseMetadataKinds() {
+  if (Stream.EnterSubBlock(bitc::METADATA_KIND_BLOCK_ID))
+    return Error("Invalid record");
 
-      unsigned NewKind = TheModule->getMDKindID(Name.str());
-      if (!MDKindMap.insert(std::make_pair(Kind, NewKind)).second)
-        return Error("Conflicting METADATA_KIND records");
+  SmallVector<uint64_t, 64> Record;
+
+  // Read all the records.
+  while (1) {
+    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return Error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      return std::error_code();
+    case BitstreamEntry::Record:
+      // The interesting case.
       break;
     }
-    }
+
+    // Read a record.
+    Record.clear();
+    if (Stream.readRecord(Entry.ID, Record) == bitc::METADATA_KIND)
+      if (std::error_code EC = parseMetadataKindRecord(Record))
+        return EC;
   }
-#undef GET_OR_DISTINCT
 }
 
 /// decodeSignRotatedValue - Decode a signed value stored with the sign bit in
@@ -2601,9 +2719,20 @@ std::error_code BitcodeReader::ParseUseLists() {
 /// When we see the block for metadata, remember where it is and then skip it.
 /// This lets us lazily deserialize the metadata.
 std::error_code BitcodeReader::rememberAndSkipMetadata() {
+  // Only the first block can be indexed, since the IDs in the index start at
+  // zero.
+  bool Indexed = false;
+  if (MDValueList.empty()) {
+    ErrorOr<bool> IndexedOrErr = parseMetadataIndex();
+    if (std::error_code EC = IndexedOrErr.getError())
+      return EC;
+    Indexed = *IndexedOrErr;
+  }
+
   // Save the current stream state.
   uint64_t CurBit = Stream.GetCurrentBitNo();
-  DeferredMetadataInfo.push_back(CurBit);
+  if (!Indexed)
+    DeferredMetadataInfo.push_back(CurBit);
 
   // Skip over the block for now.
   if (Stream.SkipBlock())
@@ -2611,7 +2740,97 @@ std::error_code BitcodeReader::rememberAndSkipMetadata() {
   return std::error_code();
 }
 
-std::error_code BitcodeReader::materializeMetadata() {
+/// If the metadata block at the current position starts with an index, read
+/// it so that the nodes of the block can be parsed one at a time, and return
+/// true. The stream is not moved.
+ErrorOr<bool> BitcodeReader::parseMetadataIndex() {
+  BitstreamCursor Cursor = Stream;
+  if (Cursor.EnterSubBlock(bitc::METADATA_BLOCK_ID))
+    return Error("Invalid record");
+
+  SmallVector<uint64_t, 64> Record;
+  BitstreamEntry Entry = Cursor.advanceSkippingSubblocks();
+  if (Entry.Kind != BitstreamEntry::Record)
+    return false;
+  if (Cursor.readRecord(Entry.ID, Record) != bitc::METADATA_INDEX_OFFSET)
+    return false;
+  if (Record.size() != 2)
+    return Error("Invalid record");
+
+  // The index and the records are relative to the end of the offset record.
+  uint64_t BaseBit = Cursor.GetCurrentBitNo();
+  MetadataCursor = Cursor;
+  Cursor.JumpToBit(BaseBit + (Record[0] | (Record[1] << 32)));
+  Entry = Cursor.advanceSkippingSubblocks();
+  if (Entry.Kind != BitstreamEntry::Record)
+    return Error("Malformed block");
+  Record.clear();
+  if (Cursor.readRecord(Entry.ID, Record) != bitc::METADATA_INDEX)
+    return Error("Invalid record");
+
+  uint64_t Bit = BaseBit;
+  MetadataOffsets.reserve(Record.size());
+  for (uint64_t Delta : Record) {
+    Bit += Delta;
+    MetadataOffsets.push_back(Bit);
+  }
+  MetadataRequested.resize(MetadataOffsets.size());
+  MetadataLoaded.resize(MetadataOffsets.size());
+  MDValueList.resize(MetadataOffsets.size());
+
+  // The named metadata follows the index.
+  DeferredNamedMetadataBit = Cursor.GetCurrentBitNo();
+  return true;
+}
+
+Metadata *BitcodeReader::getMetadataFwdRef(unsigned ID) {
+  if (ID < MetadataOffsets.size() && !MetadataRequested[ID]) {
+    MetadataRequested.set(ID);
+    PendingMetadata.push_back(ID);
+  }
+  return MDValueList.getValueFwdRef(ID);
+}
+
+std::error_code BitcodeReader::parseIndexedMetadata(unsigned ID) {
+  MetadataLoaded.set(ID);
+  MetadataCursor.JumpToBit(MetadataOffsets[ID]);
+  BitstreamEntry Entry = MetadataCursor.advanceSkippingSubblocks();
+  if (Entry.Kind != BitstreamEntry::Record)
+    return Error("Malformed block");
+
+  SmallVector<uint64_t, 64> Record;
+  unsigned Code = MetadataCursor.readRecord(Entry.ID, Record);
+  unsigned NextMDValueNo = ID;
+  if (std::error_code EC = parseMetadataRecord(Code, Record, NextMDValueNo))
+    return EC;
+  if (NextMDValueNo != ID + 1)
+    return Error("Invalid metadata index");
+  return std::error_code();
+}
+
+std::error_code BitcodeReader::loadPendingMetadata() {
+  // Parsing a node queues the nodes it refers to, so this visits everything
+  // that is reachable from the nodes that were queued initially.
+  while (!PendingMetadata.empty()) {
+    unsigned ID = PendingMetadata.pop_back_val();
+    if (MetadataLoaded[ID])
+      continue;
+    if (std::error_code EC = parseIndexedMetadata(ID))
+      return EC;
+  }
+  MDValueList.tryToResolveCycles();
+  return std::error_code();
+}
+
+std::error_code BitcodeReader::loadMetadata(unsigned ID) {
+  if (ID < MetadataOffsets.size() && !MetadataRequested[ID]) {
+    MetadataRequested.set(ID);
+    PendingMetadata.push_back(ID);
+  }
+  return loadPendingMetadata();
+}
+
+std::error_code BitcodeReader::parseDeferredMetadataBlocks() {
   for (uint64_t BitPos : DeferredMetadataInfo) {
     // Move the bit stream to the saved position.
     Stream.JumpToBit(BitPos);
@@ -2622,6 +2841,40 @@ std::error_code BitcodeReader::materializeMetadata() {
   return std::error_code();
 }
 
+std::error_code BitcodeReader::materializeMetadata() {
+  if (std::error_code EC = parseDeferredMetadataBlocks())
+    return EC;
+  if (!DeferredNamedMetadataBit)
+    return std::error_code();
+
+  // Parse the named metadata of the indexed block. The nodes that nothing
+  // refers to are never parsed. Use a copy of MetadataCursor: loading a node
+  // moves MetadataCursor, and reaching the end of the block leaves it.
+  BitstreamCursor Cursor = MetadataCursor;
+  Cursor.JumpToBit(DeferredNamedMetadataBit);
+  DeferredNamedMetadataBit = 0;
+  SmallVector<uint64_t, 64> Record;
+  while (1) {
+    BitstreamEntry Entry = Cursor.advanceSkippingSubblocks();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return Error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      return std::error_code();
+    case BitstreamEntry::Record:
+      // The interesting case.
+      break;
+    }
+
+    Record.clear();
+    if (Cursor.readRecord(Entry.ID, Record) == bitc::METADATA_NAME)
+      if (std::error_code EC = parseNamedMetadata(Cursor, Record))
+        return EC;
+  }
+}
+
 void BitcodeReader::setStripDebugInfo() { StripDebugInfo = true; }
 
 /// RememberAndSkipFunctionBody - When we see the block for a function body,
@@ -2738,6 +2991,11 @@ std::error_code BitcodeReader::ParseModule(bool Resume,
         if (std::error_code EC = ParseMetadata())
           return EC;
         break;
+      case bitc::METADATA_KIND_BLOCK_ID:
+        // Kinds are never deferred: attachments need them, and they are few.
+        if (std::error_code EC = parseMetadataKinds())
+          return EC;
+        break;
       case bitc::FUNCTION_BLOCK_ID:
         // If this is the first function body we've seen, reverse the
         // FunctionsWithBodies list.
@@ -3236,6 +3494,8 @@ std::error_code BitcodeReader::ParseMetadataAttachment() {
           MDKindMap.find(Kind);
         if (I == MDKindMap.end())
           return Error("Invalid ID");
+        if (std::error_code EC = loadMetadata(Record[i + 1]))
+          return EC;
         Metadata *Node = MDValueList.getValueFwdRef(Record[i + 1]);
         if (isa<LocalAsMetadata>(Node))
           // Drop the attachment.  This used to be legal, but there's no
@@ -3386,8 +3646,16 @@ std::error_code BitcodeReader::ParseFunctionBody(Function *F) {
       unsigned ScopeID = Record[2], IAID = Record[3];
 
       MDNode *Scope = nullptr, *IA = nullptr;
-      if (ScopeID) Scope = cast<MDNode>(MDValueList.getValueFwdRef(ScopeID-1));
-      if (IAID)    IA = cast<MDNode>(MDValueList.getValueFwdRef(IAID-1));
+      if (ScopeID) {
+        if (std::error_code EC = loadMetadata(ScopeID - 1))
+          return EC;
+        Scope = cast<MDNode>(MDValueList.getValueFwdRef(ScopeID - 1));
+      }
+      if (IAID) {
+        if (std::error_code EC = loadMetadata(IAID - 1))
+          return EC;
+        IA = cast<MDNode>(MDValueList.getValueFwdRef(IAID - 1));
+      }
       LastLoc = DebugLoc::get(Line, Col, Scope, IA);
       I->setDebugLoc(LastLoc);
       I = nullptr;
@@ -4301,7 +4569,9 @@ std::error_code BitcodeReader::FindFunctionInStream(
 void BitcodeReader::releaseBuffer() { Buffer.release(); }
 
 std::error_code BitcodeReader::materialize(GlobalValue *GV) {
-  if (std::error_code EC = materializeMetadata())
+  // Function bodies may refer to any node of a block without an index. The
+  // nodes of an indexed block are parsed as the body refers to them.
+  if (std::error_code EC = parseDeferredMetadataBlocks())
     return EC;
 
   Function *F = dyn_cast<Function>(GV);
@@ -4309,6 +4579,7 @@ std::error_code BitcodeReader::materialize(GlobalValue *GV) {
   if (!F || !F->isMaterializable())
     return std::error_code();
 
+  TimeTraceScope TraceScope("MaterializeFunction", F->getName());
   DenseMap<Function*, uint64_t>::iterator DFII = DeferredFunctionInfo.find(F);
   assert(DFII != DeferredFunctionInfo.end() && "Deferred function not found!");
   // If its position is recorded as 0, its body is somewhere in the stream
@@ -4502,6 +4773,167 @@ const std::error_category &llvm::BitcodeErrorCategory() {
   return *ErrorCategory;
 }
 
+//===----------------------------------------------------------------------===//
+// Function summary reader
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// Reads the function summary block of a bitcode file. The module block, if
+/// any, is skipped without being parsed, so no LLVMContext is needed.
+class FunctionSummaryReader {
+  MemoryBufferRef Buffer;
+  DiagnosticHandlerFunction DiagnosticHandler;
+  std::unique_ptr<BitstreamReader> StreamFile;
+  BitstreamCursor Stream;
+
+  std::error_code Error(const Twine &Message);
+
+public:
+  FunctionSummaryReader(MemoryBufferRef Buffer,
+                        DiagnosticHandlerFunction DiagnosticHandler)
+      : Buffer(Buffer), DiagnosticHandler(DiagnosticHandler) {}
+
+  /// Check the signature and advance to the function summary block. Returns
+  /// false if the file does not have one.
+  ErrorOr<bool> findSummaryBlock();
+
+  /// Parse the function summary block found by findSummaryBlock into Index.
+  std::error_code parseSummaryBlock(FunctionInfoIndex &Index);
+};
+}
+
+std::error_code FunctionSummaryReader::Error(const Twine &Message) {
+  std::error_code EC = make_error_code(BitcodeError::CorruptedBitcode);
+  if (DiagnosticHandler)
+    return ::Error(DiagnosticHandler, EC, Message);
+  return EC;
+}
+
+ErrorOr<bool> FunctionSummaryReader::findSummaryBlock() {
+  const unsigned char *BufPtr = (const unsigned char *)Buffer.getBufferStart();
+  const unsigned char *BufEnd = BufPtr + Buffer.getBufferSize();
+
+  if (Buffer.getBufferSize() & 3)
+    return Error("Invalid bitcode signature");
+
+  if (isBitcodeWrapper(BufPtr, BufEnd))
+    if (SkipBitcodeWrapperHeader(BufPtr, BufEnd, true))
+      return Error("Invalid bitcode wrapper header");
+
+  StreamFile.reset(new BitstreamReader(BufPtr, BufEnd));
+  Stream.init(&*StreamFile);
+
+  // Sniff for the signature.
+  if (Stream.Read(8) != 'B' ||
+      Stream.Read(8) != 'C' ||
+      Stream.Read(4) != 0x0 ||
+      Stream.Read(4) != 0xC ||
+      Stream.Read(4) != 0xE ||
+      Stream.Read(4) != 0xD)
+    return Error("Invalid bitcode signature");
+
+  while (1) {
+    if (Stream.AtEndOfStream())
+      return false;
+
+    BitstreamEntry Entry =
+        Stream.advance(BitstreamCursor::AF_DontAutoprocessAbbrevs);
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      return Error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      return false;
+
+    case BitstreamEntry::SubBlock:
+      if (Entry.ID == bitc::FUNCTION_SUMMARY_BLOCK_ID)
+        return true;
+
+      // Ignore other sub-blocks, in particular the module.
+      if (Stream.SkipBlock())
+        return Error("Malformed block");
+      continue;
+
+    case BitstreamEntry::Record:
+      Stream.skipRecord(Entry.ID);
+      continue;
+    }
+  }
+}
+
+std::error_code
+FunctionSummaryReader::parseSummaryBlock(FunctionInfoIndex &Index) {
+  if (Stream.EnterSubBlock(bitc::FUNCTION_SUMMARY_BLOCK_ID))
+    return Error("Invalid record");
+
+  // A per-module summary has no module path record; its entries all belong
+  // to the module stored in Buffer.
+  DenseMap<uint64_t, StringRef> ModulePaths;
+  std::vector<std::string> Names;
+  SmallVector<uint64_t, 64> Record;
+
+  while (1) {
+    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return Error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      return std::error_code();
+    case BitstreamEntry::Record:
+      // The interesting case.
+      break;
+    }
+
+    Record.clear();
+    switch (Stream.readRecord(Entry.ID, Record)) {
+    default: // Default behavior: ignore.
+      break;
+    case bitc::FS_CODE_MODULE_PATH: { // MODULE_PATH: [modid, strchr x N]
+      std::string Path;
+      if (Record.empty() || ConvertToString(Record, 1, Path))
+        return Error("Invalid record");
+      ModulePaths[Record[0]] = Index.addModulePath(Path);
+      break;
+    }
+    case bitc::FS_CODE_NAME: { // NAME: [strchr x N]
+      std::string Name;
+      if (ConvertToString(Record, 0, Name))
+        return Error("Invalid record");
+      Names.push_back(std::move(Name));
+      break;
+    }
+    case bitc::FS_CODE_ENTRY: {
+      // ENTRY: [nameid, modid, linkage, instcount, flags,
+      //         n x (calleenameid, numcallsites)]
+      if (Record.size() < 5 || Record.size() % 2 != 1 ||
+          Record[0] >= Names.size())
+        return Error("Invalid record");
+
+      StringRef ModPath;
+      if (ModulePaths.empty()) {
+        ModPath = Buffer.getBufferIdentifier();
+      } else {
+        auto I = ModulePaths.find(Record[1]);
+        if (I == ModulePaths.end())
+          return Error("Invalid record");
+        ModPath = I->second;
+      }
+
+      auto Summary = llvm::make_unique<FunctionSummary>(
+          getDecodedLinkage(Record[2]), Record[3], Record[4]);
+      for (unsigned I = 5, E = Record.size(); I != E; I += 2) {
+        if (Record[I] >= Names.size())
+          return Error("Invalid record");
+        Summary->addCall(Names[Record[I]], Record[I + 1]);
+      }
+      Index.addFunctionSummary(Names[Record[0]], ModPath, std::move(Summary));
+      break;
+    }
+    }
+  }
+}
+
 //===----------------------------------------------------------------------===//
 // External interface
 //===----------------------------------------------------------------------===//
@@ -4530,6 +4962,7 @@ getLazyBitcodeModuleImpl(std::unique_ptr<MemoryBuffer> &&Buffer,
     return EC;
   };
 
+  TimeTraceScope TraceScope("ParseBitcode", M->getModuleIdentifier());
   // Delay parsing Metadata if ShouldLazyLoadMetadata is true.
   if (std::error_code EC = R->ParseBitcodeInto(M, ShouldLazyLoadMetadata))
     return cleanupOnError(EC);
@@ -4596,3 +5029,30 @@ llvm::getBitcodeTargetTriple(MemoryBufferRef Buffer, LLVMContext &Context,
     return "";
   return Triple.get();
 }
+
+bool llvm::hasFunctionSummary(MemoryBufferRef Buffer,
+                              DiagnosticHandlerFunction DiagnosticHandler) {
+  FunctionSummaryReader R(Buffer, DiagnosticHandler);
+  ErrorOr<bool> Found = R.findSummaryBlock();
+  return Found && Found.get();
+}
+
+ErrorOr<std::unique_ptr<FunctionInfoIndex>>
+llvm::getFunctionInfoIndex(MemoryBufferRef Buffer,
+                           DiagnosticHandlerFunction DiagnosticHandler) {
+  FunctionSummaryReader R(Buffer, DiagnosticHandler);
+  auto Index = llvm::make_unique<FunctionInfoIndex>();
+
+  ErrorOr<bool> Found = R.findSummaryBlock();
+  if (std::error_code EC = Found.getError())
+    return EC;
+  if (Found.get())
+    if (std::error_code EC = R.parseSummaryBlock(*Index))
+      return EC;
+
+  // A module without summary block has an empty index, but it is still
+  // registered so that the module is known to the combined index.
+  if (Index->modulePaths().empty())
+    Index->addModulePath(Buffer.getBufferIdentifier());
+  return std::move(Index);
+}
@@ -19,6 +19,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/FunctionInfo.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
@@ -30,6 +31,7 @@
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cctype>
 #include <map>
 using namespace llvm;
@@ -479,8 +481,8 @@ static void WriteTypeTable(const ValueEnumerator &VE, BitstreamWriter &Stream) {
   Stream.ExitBlock();
 }
 
-static unsigned getEncodedLinkage(const GlobalValue &GV) {
-  switch (GV.getLinkage()) {
+static unsigned getEncodedLinkage(GlobalValue::LinkageTypes Linkage) {
+  switch (Linkage) {
   case GlobalValue::ExternalLinkage:
     return 0;
   case GlobalValue::WeakAnyLinkage:
@@ -507,6 +509,10 @@ static unsigned getEncodedLinkage(const GlobalValue &GV) {
   llvm_unreachable("Invalid linkage");
 }
 
+static unsigned getEncodedLinkage(const GlobalValue &GV) {
+  return getEncodedLinkage(GV.getLinkage());
+}
+
 static unsigned getEncodedVisibility(const GlobalValue &GV) {
   switch (GV.getVisibility()) {
   case GlobalValue::DefaultVisibility:   return 0;
@@ -1146,7 +1152,8 @@ static void WriteModuleMetadata(const Module *M,
   if (MDs.empty() && M->named_metadata_empty())
     return;
 
-  Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
+  // Up to six abbreviations are defined below, which needs 4-bit IDs.
+  Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 4);
 
   unsigned MDSAbbrev = 0;
   if (VE.hasMDString()) {
@@ -1203,8 +1210,40 @@ static void WriteModuleMetadata(const Module *M,
     NameAbbrev = Stream.EmitAbbrev(Abbv);
   }
 
+  // The index lets a reader that loads metadata lazily find the record of any
+  // node without parsing the records in front of it. It follows the records,
+  // so its offset is only known at the end and is backpatched then.
   SmallVector<uint64_t, 64> Record;
+  unsigned IndexAbbrev = 0;
+  uint64_t IndexOffsetBit = 0, IndexBaseBit = 0;
+  SmallVector<uint64_t, 64> IndexPos;
+  if (!MDs.empty()) {
+    // Abbrev for METADATA_INDEX_OFFSET.
+    BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_INDEX_OFFSET));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+    unsigned OffsetAbbrev = Stream.EmitAbbrev(Abbv);
+
+    // Abbrev for METADATA_INDEX.
+    Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_INDEX));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));
+    IndexAbbrev = Stream.EmitAbbrev(Abbv);
+
+    // Code: [offset lo, offset hi], relative to the end of this record.
+    Record.push_back(0);
+    Record.push_back(0);
+    Stream.EmitRecord(bitc::METADATA_INDEX_OFFSET, Record, OffsetAbbrev);
+    Record.clear();
+    IndexBaseBit = Stream.GetCurrentBitNo();
+    IndexOffsetBit = IndexBaseBit - 64;
+    IndexPos.reserve(MDs.size());
+  }
+
   for (const Metadata *MD : MDs) {
+    IndexPos.push_back(Stream.GetCurrentBitNo());
     if (const MDNode *N = dyn_cast<MDNode>(MD)) {
       assert(N->isResolved() && "Expected forward references to be resolved");
 
@@ -1231,6 +1270,19 @@ static void WriteModuleMetadata(const Module *M,
     Record.clear();
   }
 
+  uint64_t IndexBit = Stream.GetCurrentBitNo();
+  if (!MDs.empty()) {
+    // Code: [n x bitpos delta], where each record is relative to the previous
+    // one and the first to the end of METADATA_INDEX_OFFSET.
+    uint64_t PrevBit = IndexBaseBit;
+    for (uint64_t &Bit : IndexPos) {
+      uint64_t Delta = Bit - PrevBit;
+      PrevBit = Bit;
+      Bit = Delta;
+    }
+    Stream.EmitRecord(bitc::METADATA_INDEX, IndexPos, IndexAbbrev);
+  }
+
   // Write named metadata.
   for (const NamedMDNode &NMD : M->named_metadata()) {
     // Write name.
@@ -1247,6 +1299,12 @@ static void WriteModuleMetadata(const Module *M,
   }
 
   Stream.ExitBlock();
+
+  if (!MDs.empty()) {
+    uint64_t IndexOffset = IndexBit - IndexBaseBit;
+    Stream.BackpatchWordAtBit(IndexOffsetBit, uint32_t(IndexOffset));
+    Stream.BackpatchWordAtBit(IndexOffsetBit + 32, uint32_t(IndexOffset >> 32));
+  }
 }
 
 static void WriteFunctionLocalMetadata(const Function &F,
@@ -1312,7 +1370,7 @@ static void WriteModuleMetadataStore(const Module *M, BitstreamWriter &Stream) {
 
   if (Names.empty()) return;
 
-  Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
+  Stream.EnterSubblock(bitc::METADATA_KIND_BLOCK_ID, 3);
 
   for (unsigned MDKindID = 0, e = Names.size(); MDKindID != e; ++MDKindID) {
     Record.push_back(MDKindID);
@@ -2367,6 +2425,74 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream,
   Stream.ExitBlock();
 }
 
+/// Emit the function summary block describing the functions of Index. The
+/// module paths are only written for a combined index; a per-module summary
+/// implicitly describes the module it is stored in.
+static void WriteFunctionSummary(const FunctionInfoIndex &Index,
+                                 bool IsCombined, BitstreamWriter &Stream) {
+  Stream.EnterSubblock(bitc::FUNCTION_SUMMARY_BLOCK_ID, 3);
+
+  // Abbrev for FS_CODE_NAME.
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::FS_CODE_NAME));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 8));
+  unsigned NameAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<uint64_t, 64> Vals;
+  if (IsCombined) {
+    // Emit the module paths in the order of their IDs.
+    std::vector<StringRef> ModPaths(Index.modulePaths().size());
+    for (const auto &ModPath : Index.modulePaths())
+      ModPaths[ModPath.second] = ModPath.first();
+    for (unsigned I = 0, E = ModPaths.size(); I != E; ++I) {
+      Vals.push_back(I);
+      Vals.append(ModPaths[I].begin(), ModPaths[I].end());
+      Stream.EmitRecord(bitc::FS_CODE_MODULE_PATH, Vals);
+      Vals.clear();
+    }
+  }
+
+  // Names are emitted the first time an entry refers to them.
+  StringMap<unsigned> NameIDs;
+  auto GetNameID = [&](StringRef Name) {
+    auto Inserted = NameIDs.insert(std::make_pair(Name, NameIDs.size()));
+    if (Inserted.second) {
+      SmallVector<unsigned, 64> NameVals(Name.begin(), Name.end());
+      Stream.EmitRecord(bitc::FS_CODE_NAME, NameVals, NameAbbrev);
+    }
+    return Inserted.first->second;
+  };
+
+  // Sort the functions by name so that the output does not depend on the
+  // layout of the index.
+  std::vector<StringRef> FuncNames;
+  for (const auto &Entry : Index)
+    FuncNames.push_back(Entry.first());
+  std::sort(FuncNames.begin(), FuncNames.end());
+
+  for (StringRef FuncName : FuncNames) {
+    for (const auto &Summary : *Index.findFunctionSummaryList(FuncName)) {
+      // Looking up a name ID may emit its FS_CODE_NAME record, which thus
+      // precedes the entry that refers to it.
+      Vals.push_back(GetNameID(FuncName));
+      Vals.push_back(IsCombined ? Index.getModuleId(Summary->getModulePath())
+                                : 0);
+      Vals.push_back(getEncodedLinkage(Summary->getLinkage()));
+      Vals.push_back(Summary->getInstCount());
+      Vals.push_back(Summary->getFlags());
+      for (const CalleeInfo &Callee : Summary->calls()) {
+        Vals.push_back(GetNameID(Callee.Name));
+        Vals.push_back(Callee.NumCallSites);
+      }
+      Stream.EmitRecord(bitc::FS_CODE_ENTRY, Vals);
+      Vals.clear();
+    }
+  }
+
+  Stream.ExitBlock();
+}
+
 /// EmitDarwinBCHeader - If generating a bc file on darwin, we have to emit a
 /// header and trailer to make it compatible with the system archiver.  To do
 /// this we emit the following header, and then emit a trailer that pads the
@@ -2443,7 +2569,8 @@ static void EmitDarwinBCHeaderAndTrailer(SmallVectorImpl<char> &Buffer,
 /// WriteBitcodeToFile - Write the specified module to the specified output
 /// stream.
 void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
-                              bool ShouldPreserveUseListOrder) {
+                              bool ShouldPreserveUseListOrder,
+                              bool EmitFunctionSummary) {
   SmallVector<char, 0> Buffer;
   Buffer.reserve(256*1024);
 
@@ -2467,6 +2594,12 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
 
     // Emit the module.
     WriteModule(M, Stream, ShouldPreserveUseListOrder);
+
+    // The summary follows the module so that readers that only want the IR
+    // never have to look at it.
+    if (EmitFunctionSummary)
+      WriteFunctionSummary(*buildFunctionInfoIndex(*M), /*IsCombined=*/false,
+                           Stream);
   }
 
   if (TT.isOSDarwin())
@@ -2475,3 +2608,25 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
   // Write the generated bitstream to "Out".
   Out.write((char*)&Buffer.front(), Buffer.size());
 }
+
+void llvm::WriteFunctionSummaryToFile(const FunctionInfoIndex &Index,
+                                      raw_ostream &Out) {
+  SmallVector<char, 0> Buffer;
+  Buffer.reserve(256 * 1024);
+
+  {
+    BitstreamWriter Stream(Buffer);
+
+    // Emit the file header.
+    Stream.Emit((unsigned)'B', 8);
+    Stream.Emit((unsigned)'C', 8);
+    Stream.Emit(0x0, 4);
+    Stream.Emit(0xC, 4);
+    Stream.Emit(0xE, 4);
+    Stream.Emit(0xD, 4);
+
+    WriteFunctionSummary(Index, /*IsCombined=*/true, Stream);
+  }
+
+  Out.write((char *)&Buffer.front(), Buffer.size());
+}
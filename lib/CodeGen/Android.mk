@@ -74,6 +74,7 @@ codegen_SRC_FILES := \
   MachineVerifier.cpp \
   OcamlGC.cpp \
   OptimizePHIs.cpp \
+  ParallelCG.cpp \
   Passes.cpp \
   PeepholeOptimizer.cpp \
   PHIElimination.cpp \
@@ -91,6 +92,7 @@ codegen_SRC_FILES := \
   RegisterCoalescer.cpp \
   RegisterPressure.cpp \
   RegisterScavenging.cpp \
+  ScalarizeMaskedGatherScatter.cpp \
   ScheduleDAG.cpp \
   ScheduleDAGInstrs.cpp \
   ScheduleDAGPrinter.cpp \
@@ -0,0 +1,112 @@
+//===-- ParallelCG.cpp ----------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines functions that can be used for parallel code generation.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/ParallelCG.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+/// Forwards the diagnostics of the partition contexts to the handler of the
+/// original context, which need not be thread-safe.
+struct DiagnosticForwarder {
+  LLVMContext::DiagnosticHandlerTy Handler;
+  void *Context;
+  sys::Mutex Lock;
+};
+}
+
+static void forwardDiagnostic(const DiagnosticInfo &DI, void *Context) {
+  auto *Forwarder = static_cast<DiagnosticForwarder *>(Context);
+  sys::ScopedLock Guard(Forwarder->Lock);
+  Forwarder->Handler(DI, Forwarder->Context);
+}
+
+/// Run the code generator of TM on M. Returns true if TM cannot emit files of
+/// type FT.
+static bool codegen(Module &M, raw_pwrite_stream &OS, TargetMachine &TM,
+                    TargetMachine::CodeGenFileType FT) {
+  legacy::PassManager CodeGenPasses;
+  if (TM.addPassesToEmitFile(CodeGenPasses, OS, FT))
+    return true;
+  CodeGenPasses.run(M);
+  return false;
+}
+
+bool llvm::splitCodeGen(Module &M, ArrayRef<raw_pwrite_stream *> OSs,
+                        TargetMachine &TM,
+                        TargetMachine::CodeGenFileType FT) {
+  if (OSs.size() == 1)
+    return codegen(M, *OSs[0], TM, FT);
+
+  DiagnosticForwarder Forwarder;
+  Forwarder.Handler = M.getContext().getDiagnosticHandler();
+  Forwarder.Context = M.getContext().getDiagnosticContext();
+
+  std::vector<std::thread> Threads;
+  // std::vector<bool> is not safe to write from several threads.
+  std::vector<char> Failed(OSs.size(), false);
+  unsigned ThreadCount = 0;
+  SplitModule(M, OSs.size(), [&](std::unique_ptr<Module> MPart) {
+    // We want to clone the module in a new context to multi-thread the
+    // codegen. We do it by serializing partition modules to bitcode (while
+    // still on the main thread, in order to avoid data races) and spinning up
+    // new threads which deserialize the partitions into separate contexts.
+    SmallString<0> BC;
+    raw_svector_ostream BCOS(BC);
+    WriteBitcodeToFile(MPart.get(), BCOS);
+    BCOS.flush();
+
+    unsigned Index = ThreadCount++;
+    Threads.emplace_back([&TM, &Forwarder, &Failed, FT, Index, OSs](
+        const SmallString<0> &BC) {
+      LLVMContext Ctx;
+      if (Forwarder.Handler)
+        Ctx.setDiagnosticHandler(forwardDiagnostic, &Forwarder,
+                                 /* RespectFilters */ true);
+
+      ErrorOr<Module *> MOrErr =
+          parseBitcodeFile(MemoryBufferRef(BC.str(), "<split-module>"), Ctx);
+      if (!MOrErr)
+        report_fatal_error("Failed to read bitcode");
+      std::unique_ptr<Module> MPartInCtx(MOrErr.get());
+
+      std::unique_ptr<TargetMachine> ThreadTM(
+          TM.getTarget().createTargetMachine(
+              TM.getTargetTriple(), TM.getTargetCPU(),
+              TM.getTargetFeatureString(), TM.Options,
+              TM.getRelocationModel(), TM.getCodeModel(), TM.getOptLevel()));
+      Failed[Index] = codegen(*MPartInCtx, *OSs[Index], *ThreadTM, FT);
+    }, std::move(BC));
+  });
+
+  for (std::thread &T : Threads)
+    T.join();
+
+  for (char F : Failed)
+    if (F)
+      return true;
+  return false;
+}
@@ -393,6 +393,10 @@ void TargetPassConfig::addIRPasses() {
   // Make sure that no unreachable blocks are instruction selected.
   addPass(createUnreachableBlockEliminationPass());
 
+  // Expand the gathers and scatters the target cannot select. This is needed
+  // for correctness, so it runs at every optimization level.
+  addPass(createScalarizeMaskedGatherScatterPass());
+
   // Prepare expensive constants for SelectionDAG.
   if (getOptLevel() != CodeGenOpt::None && !DisableConstantHoisting)
     addPass(createConstantHoistingPass());
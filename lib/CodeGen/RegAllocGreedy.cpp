@@ -36,6 +36,7 @@
 #include "llvm/CodeGen/RegAllocRegistry.h"
 #include "llvm/CodeGen/RegisterClassInfo.h"
 #include "llvm/CodeGen/VirtRegMap.h"
+#include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/PassAnalysisSupport.h"
 #include "llvm/Support/BranchProbability.h"
@@ -54,6 +55,9 @@ using namespace llvm;
 STATISTIC(NumGlobalSplits, "Number of split global live ranges");
 STATISTIC(NumLocalSplits,  "Number of split local live ranges");
 STATISTIC(NumEvicted,      "Number of interferences evicted");
+STATISTIC(NumOverBudget,   "Number of functions that exceeded the work budget");
+STATISTIC(NumBudgetSpills,
+          "Number of live ranges spilled because of the work budget");
 
 static cl::opt<SplitEditor::ComplementSpillMode>
 SplitSpillMode("split-spill-mode", cl::Hidden,
@@ -92,6 +96,12 @@ CSRFirstTimeCost("regalloc-csr-first-time-cost",
               cl::desc("Cost for first time use of callee-saved register."),
               cl::init(0), cl::Hidden);
 
+static cl::opt<unsigned> WorkBudget(
+    "regalloc-work-budget", cl::Hidden,
+    cl::desc("Amount of eviction and splitting work allowed per function "
+             "before falling back to spilling (0 = unlimited)"),
+    cl::init(0));
+
 static RegisterRegAlloc greedyRegAlloc("greedy", "greedy register allocator",
                                        createGreedyRegisterAllocator);
 
@@ -299,6 +309,15 @@ class RAGreedy : public MachineFunctionPass,
   /// Set of broken hints that may be reconciled later because of eviction.
   SmallSetVector<LiveInterval *, 8> SetOfBrokenHints;
 
+  /// Eviction and splitting work done so far in the function, in units of
+  /// interference queries and blocks visited.
+  uint64_t WorkDone;
+
+  /// Set once WorkDone exceeds the work budget. From then on, live ranges
+  /// that can be spilled are spilled instead of evicting or being split, like
+  /// the basic allocator does.
+  bool OverBudget;
+
 public:
   RAGreedy();
 
@@ -400,6 +419,8 @@ private:
   typedef SmallVector<HintInfo, 4> HintsInfo;
   BlockFrequency getBrokenHintFreq(const HintsInfo &, unsigned);
   void collectHintInfo(unsigned, HintsInfo &);
+
+  void chargeWork(unsigned Units);
 };
 } // end anonymous namespace
 
@@ -720,7 +741,9 @@ bool RAGreedy::canEvictInterference(LiveInterval &VirtReg, unsigned PhysReg,
   for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
     LiveIntervalUnion::Query &Q = Matrix->query(VirtReg, *Units);
     // If there is 10 or more interferences, chances are one is heavier.
-    if (Q.collectInterferingVRegs(10) >= 10)
+    unsigned NumIntf = Q.collectInterferingVRegs(10);
+    chargeWork(NumIntf + 1);
+    if (NumIntf >= 10)
       return false;
 
     // Check if any interfering live range is heavier than MaxWeight.
@@ -1031,6 +1054,7 @@ void RAGreedy::growRegion(GlobalSplitCandidate &Cand) {
       }
     }
     // Any new blocks to add?
+    chargeWork(ActiveBlocks.size() - AddedTo + 1);
     if (ActiveBlocks.size() == AddedTo)
       break;
 
@@ -1186,6 +1210,7 @@ void RAGreedy::splitAroundRegion(LiveRangeEdit &LREdit,
 
   // First handle all the blocks with uses.
   ArrayRef<SplitAnalysis::BlockInfo> UseBlocks = SA->getUseBlocks();
+  chargeWork(UseBlocks.size() + SA->getNumThroughBlocks());
   for (unsigned i = 0; i != UseBlocks.size(); ++i) {
     const SplitAnalysis::BlockInfo &BI = UseBlocks[i];
     unsigned Number = BI.MBB->getNumber();
@@ -1374,6 +1399,7 @@ unsigned RAGreedy::calculateRegionSplitCost(LiveInterval &VirtReg,
       GlobalCand.resize(NumCands+1);
     GlobalSplitCandidate &Cand = GlobalCand[NumCands];
     Cand.reset(IntfCache, PhysReg);
+    chargeWork(SA->getUseBlocks().size());
 
     SpillPlacer->prepare(Cand.LiveBundles);
     BlockFrequency Cost;
@@ -1477,6 +1503,7 @@ unsigned RAGreedy::tryBlockSplit(LiveInterval &VirtReg, AllocationOrder &Order,
   LiveRangeEdit LREdit(&VirtReg, NewVRegs, *MF, *LIS, VRM, this);
   SE->reset(LREdit, SplitSpillMode);
   ArrayRef<SplitAnalysis::BlockInfo> UseBlocks = SA->getUseBlocks();
+  chargeWork(UseBlocks.size());
   for (unsigned i = 0; i != UseBlocks.size(); ++i) {
     const SplitAnalysis::BlockInfo &BI = UseBlocks[i];
     if (SA->shouldSplitSingleBlock(BI, SingleInstrs))
@@ -1767,6 +1794,8 @@ unsigned RAGreedy::tryLocalSplit(LiveInterval &VirtReg, AllocationOrder &Order,
 
   Order.rewind();
   while (unsigned PhysReg = Order.next()) {
+    chargeWork(NumGaps);
+
     // Keep track of the largest spill weight that would need to be evicted in
     // order to make use of PhysReg between UseSlots[i] and UseSlots[i+1].
     calcGapWeights(PhysReg, GapWeight);
@@ -2465,10 +2494,19 @@ unsigned RAGreedy::selectOrSplitImpl(LiveInterval &VirtReg,
   DEBUG(dbgs() << StageName[Stage]
                << " Cascade " << ExtraRegInfo[VirtReg.reg].Cascade << '\n');
 
+  // Once the work budget is spent, spill what can be spilled right away.
+  // Ranges that cannot be spilled still evict, or nothing could ever be
+  // allocated to them.
+  bool SpillNow = OverBudget && Stage < RS_Done && VirtReg.isSpillable();
+  if (SpillNow) {
+    DEBUG(dbgs() << "over the work budget, spilling\n");
+    ++NumBudgetSpills;
+  }
+
   // Try to evict a less worthy live range, but only for ranges from the primary
   // queue. The RS_Split ranges already failed to do this, and they should not
   // get a second chance until they have been split.
-  if (Stage != RS_Split)
+  if (Stage != RS_Split && !SpillNow)
     if (unsigned PhysReg =
             tryEvict(VirtReg, Order, NewVRegs, CostPerUseLimit)) {
       unsigned Hint = MRI->getSimpleHint(VirtReg.reg);
@@ -2487,7 +2525,7 @@ unsigned RAGreedy::selectOrSplitImpl(LiveInterval &VirtReg,
   // The first time we see a live range, don't try to split or spill.
   // Wait until the second time, when all smaller ranges have been allocated.
   // This gives a better picture of the interference to split around.
-  if (Stage < RS_Split) {
+  if (Stage < RS_Split && !SpillNow) {
     setStage(VirtReg, RS_Split);
     DEBUG(dbgs() << "wait for second round\n");
     NewVRegs.push_back(VirtReg.reg);
@@ -2501,9 +2539,11 @@ unsigned RAGreedy::selectOrSplitImpl(LiveInterval &VirtReg,
                                    Depth);
 
   // Try splitting VirtReg or interferences.
-  unsigned PhysReg = trySplit(VirtReg, Order, NewVRegs);
-  if (PhysReg || !NewVRegs.empty())
-    return PhysReg;
+  if (!SpillNow) {
+    unsigned PhysReg = trySplit(VirtReg, Order, NewVRegs);
+    if (PhysReg || !NewVRegs.empty())
+      return PhysReg;
+  }
 
   // Finally spill VirtReg itself.
   NamedRegionTimer T("Spiller", TimerGroupName, TimePassesIsEnabled);
@@ -2519,6 +2559,23 @@ unsigned RAGreedy::selectOrSplitImpl(LiveInterval &VirtReg,
   return 0;
 }
 
+/// Account for Units of eviction or splitting work, and switch to spilling
+/// when the work budget of the function is exceeded.
+void RAGreedy::chargeWork(unsigned Units) {
+  WorkDone += Units;
+  if (OverBudget || !WorkBudget || WorkDone <= WorkBudget)
+    return;
+
+  OverBudget = true;
+  ++NumOverBudget;
+  DEBUG(dbgs() << "Work budget of " << WorkBudget << " exceeded\n");
+  const Function &F = *MF->getFunction();
+  emitOptimizationRemarkMissed(
+      F.getContext(), DEBUG_TYPE, F, DebugLoc(),
+      "register allocation exceeded its work budget of " + Twine(WorkBudget) +
+          "; the remaining live ranges are spilled instead of being split");
+}
+
 bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   DEBUG(dbgs() << "********** GREEDY REGISTER ALLOCATION **********\n"
                << "********** Function: " << mf.getName() << '\n');
@@ -2561,6 +2618,8 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   IntfCache.init(MF, Matrix->getLiveUnions(), Indexes, LIS, TRI);
   GlobalCand.resize(32);  // This will grow as needed.
   SetOfBrokenHints.clear();
+  WorkDone = 0;
+  OverBudget = false;
 
   allocatePhysRegs();
   tryHintsRecoloring();
@@ -0,0 +1,313 @@
+//===- ScalarizeMaskedGatherScatter.cpp - Expand unsupported gathers ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass replaces the llvm.masked.gather and llvm.masked.scatter calls that
+// the target cannot lower with a sequence of scalar loads and stores. It runs
+// at every optimization level, so instruction selection only ever sees the
+// gathers and scatters that TargetTransformInfo reports as legal.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Pass.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "scalarize-masked-gather-scatter"
+
+STATISTIC(NumScalarizedGathers, "Number of masked gathers scalarized");
+STATISTIC(NumScalarizedScatters, "Number of masked scatters scalarized");
+
+namespace {
+  class ScalarizeMaskedGatherScatter : public FunctionPass {
+  public:
+    static char ID; // Pass identification, replacement for typeid
+    ScalarizeMaskedGatherScatter() : FunctionPass(ID) {
+      initializeScalarizeMaskedGatherScatterPass(
+          *PassRegistry::getPassRegistry());
+    }
+    bool runOnFunction(Function &F) override;
+
+    const char *getPassName() const override {
+      return "Scalarize Masked Gather/Scatter";
+    }
+
+    void getAnalysisUsage(AnalysisUsage &AU) const override {
+      AU.addRequired<TargetTransformInfoWrapperPass>();
+    }
+  };
+}
+
+char ScalarizeMaskedGatherScatter::ID = 0;
+INITIALIZE_PASS_BEGIN(ScalarizeMaskedGatherScatter,
+                      "scalarize-masked-gather-scatter",
+                      "Scalarize unsupported masked gathers and scatters",
+                      false, false)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
+INITIALIZE_PASS_END(ScalarizeMaskedGatherScatter,
+                    "scalarize-masked-gather-scatter",
+                    "Scalarize unsupported masked gathers and scatters",
+                    false, false)
+
+FunctionPass *llvm::createScalarizeMaskedGatherScatterPass() {
+  return new ScalarizeMaskedGatherScatter();
+}
+
+/// Return true if every lane of Mask is a known constant or undef, so that
+/// the lanes to access are known at compile time.
+static bool isConstantMask(Value *Mask, unsigned VectorWidth) {
+  Constant *MaskC = dyn_cast<Constant>(Mask);
+  if (!MaskC)
+    return false;
+  for (unsigned Idx = 0; Idx < VectorWidth; ++Idx) {
+    Constant *Elt = MaskC->getAggregateElement(Idx);
+    if (!Elt || (!isa<ConstantInt>(Elt) && !isa<UndefValue>(Elt)))
+      return false;
+  }
+  return true;
+}
+
+//  ScalarizeMaskedGather() translates masked gather intrinsic, like
+// <4 x i32> @llvm.masked.gather.v4i32(<4 x i32*> %ptrs, i32 align,
+//                                     <4 x i1> %mask, <4 x i32> %passthru)
+// to a chain of basic blocks, that loads element one-by-one if the
+// appropriate mask bit is set. Lanes of a constant mask need no branch: a set
+// bit loads the element unconditionally and a clear bit takes the pass-through
+// value.
+//
+//  %mask_0 = extractelement <4 x i1> %mask, i32 0
+//  br i1 %mask_0, label %cond.load, label %else
+//
+// cond.load:                                        ; preds = %0
+//  %ptr_0 = extractelement <4 x i32*> %ptrs, i32 0
+//  %load_0 = load i32, i32* %ptr_0
+//  %res_0 = insertelement <4 x i32> undef, i32 %load_0, i32 0
+//  br label %else
+//
+// else:                                             ; preds = %0, %cond.load
+//  %res.phi.else = phi <4 x i32> [ %res_0, %cond.load ], [ undef, %0 ]
+//  %mask_1 = extractelement <4 x i1> %mask, i32 1
+//  br i1 %mask_1, label %cond.load1, label %else2
+//  . . .
+//  %result = select <4 x i1> %mask, <4 x i32> %res.phi.select, <4 x i32> %src
+static void ScalarizeMaskedGather(CallInst *CI) {
+  Value *Ptrs = CI->getArgOperand(0);
+  unsigned Alignment = cast<ConstantInt>(CI->getArgOperand(1))->getZExtValue();
+  Value *Mask = CI->getArgOperand(2);
+  Value *Src0 = CI->getArgOperand(3);
+
+  VectorType *VecType = cast<VectorType>(CI->getType());
+
+  IRBuilder<> Builder(CI->getContext());
+  Instruction *InsertPt = CI;
+  BasicBlock *IfBlock = CI->getParent();
+  BasicBlock *CondBlock = nullptr;
+  BasicBlock *PrevIfBlock = CI->getParent();
+  Builder.SetInsertPoint(InsertPt);
+  Builder.SetCurrentDebugLocation(CI->getDebugLoc());
+
+  Value *UndefVal = UndefValue::get(VecType);
+  Value *VResult = UndefVal;
+  unsigned VectorWidth = VecType->getNumElements();
+
+  // A constant mask needs no control flow.
+  if (isConstantMask(Mask, VectorWidth)) {
+    Constant *MaskC = cast<Constant>(Mask);
+    for (unsigned Idx = 0; Idx < VectorWidth; ++Idx) {
+      if (!MaskC->getAggregateElement(Idx)->isAllOnesValue())
+        continue;
+      Value *Ptr = Builder.CreateExtractElement(Ptrs, Builder.getInt32(Idx),
+                                                "Ptr" + Twine(Idx));
+      LoadInst *Load = Builder.CreateAlignedLoad(Ptr, Alignment,
+                                                 "Load" + Twine(Idx));
+      VResult = Builder.CreateInsertElement(VResult, Load,
+                                            Builder.getInt32(Idx),
+                                            "Res" + Twine(Idx));
+    }
+    Value *NewI = Builder.CreateSelect(Mask, VResult, Src0);
+    CI->replaceAllUsesWith(NewI);
+    CI->eraseFromParent();
+    return;
+  }
+
+  PHINode *Phi = nullptr;
+  Value *PrevPhi = UndefVal;
+
+  for (unsigned Idx = 0; Idx < VectorWidth; ++Idx) {
+    // Fill the "else" block, created in the previous iteration
+    //
+    //  %Mask1 = extractelement <16 x i1> %Mask, i32 1
+    //  br i1 %Mask1, label %cond.load, label %else
+    //
+    if (Idx > 0) {
+      Phi = Builder.CreatePHI(VecType, 2, "res.phi.else");
+      Phi->addIncoming(VResult, CondBlock);
+      Phi->addIncoming(PrevPhi, PrevIfBlock);
+      PrevPhi = Phi;
+      VResult = Phi;
+    }
+
+    Value *Predicate = Builder.CreateExtractElement(Mask, Builder.getInt32(Idx),
+                                                    "Mask" + Twine(Idx));
+
+    // Create "cond" block
+    //
+    //  %EltAddr = extractelement <16 x i32*> %Ptrs, i32 1
+    //  %Elt = load i32* %EltAddr
+    //  VResult = insertelement <16 x i32> VResult, i32 %Elt, i32 Idx
+    //
+    CondBlock = IfBlock->splitBasicBlock(InsertPt, "cond.load");
+    Builder.SetInsertPoint(InsertPt);
+
+    Value *Ptr = Builder.CreateExtractElement(Ptrs, Builder.getInt32(Idx),
+                                              "Ptr" + Twine(Idx));
+    LoadInst *Load = Builder.CreateAlignedLoad(Ptr, Alignment,
+                                               "Load" + Twine(Idx));
+    VResult = Builder.CreateInsertElement(VResult, Load, Builder.getInt32(Idx),
+                                          "Res" + Twine(Idx));
+
+    // Create "else" block, fill it in the next iteration
+    BasicBlock *NewIfBlock = CondBlock->splitBasicBlock(InsertPt, "else");
+    Builder.SetInsertPoint(InsertPt);
+    Instruction *OldBr = IfBlock->getTerminator();
+    BranchInst::Create(CondBlock, NewIfBlock, Predicate, OldBr);
+    OldBr->eraseFromParent();
+    PrevIfBlock = IfBlock;
+    IfBlock = NewIfBlock;
+  }
+
+  Phi = Builder.CreatePHI(VecType, 2, "res.phi.select");
+  Phi->addIncoming(VResult, CondBlock);
+  Phi->addIncoming(PrevPhi, PrevIfBlock);
+  Value *NewI = Builder.CreateSelect(Mask, Phi, Src0);
+  CI->replaceAllUsesWith(NewI);
+  CI->eraseFromParent();
+}
+
+//  ScalarizeMaskedScatter() translates masked scatter intrinsic, like
+// void @llvm.masked.scatter.v4i32(<4 x i32> %src, <4 x i32*> %ptrs,
+//                                 i32 align, <4 x i1> %mask)
+// to a chain of basic blocks, that stores element one-by-one if the
+// appropriate mask bit is set. Lanes of a constant mask need no branch.
+//
+//  %mask_0 = extractelement <4 x i1> %mask, i32 0
+//  br i1 %mask_0, label %cond.store, label %else
+//
+// cond.store:                                       ; preds = %0
+//  %elt_0 = extractelement <4 x i32> %src, i32 0
+//  %ptr_0 = extractelement <4 x i32*> %ptrs, i32 0
+//  store i32 %elt_0, i32* %ptr_0
+//  br label %else
+//
+// else:                                             ; preds = %0, %cond.store
+//  %mask_1 = extractelement <4 x i1> %mask, i32 1
+//  br i1 %mask_1, label %cond.store1, label %else2
+//  . . .
+static void ScalarizeMaskedScatter(CallInst *CI) {
+  Value *Src = CI->getArgOperand(0);
+  Value *Ptrs = CI->getArgOperand(1);
+  unsigned Alignment = cast<ConstantInt>(CI->getArgOperand(2))->getZExtValue();
+  Value *Mask = CI->getArgOperand(3);
+
+  VectorType *VecType = cast<VectorType>(Src->getType());
+
+  IRBuilder<> Builder(CI->getContext());
+  Instruction *InsertPt = CI;
+  BasicBlock *IfBlock = CI->getParent();
+  Builder.SetInsertPoint(InsertPt);
+  Builder.SetCurrentDebugLocation(CI->getDebugLoc());
+
+  unsigned VectorWidth = VecType->getNumElements();
+
+  // A constant mask needs no control flow.
+  if (isConstantMask(Mask, VectorWidth)) {
+    Constant *MaskC = cast<Constant>(Mask);
+    for (unsigned Idx = 0; Idx < VectorWidth; ++Idx) {
+      if (!MaskC->getAggregateElement(Idx)->isAllOnesValue())
+        continue;
+      Value *OneElt = Builder.CreateExtractElement(Src, Builder.getInt32(Idx),
+                                                   "Elt" + Twine(Idx));
+      Value *Ptr = Builder.CreateExtractElement(Ptrs, Builder.getInt32(Idx),
+                                                "Ptr" + Twine(Idx));
+      Builder.CreateAlignedStore(OneElt, Ptr, Alignment);
+    }
+    CI->eraseFromParent();
+    return;
+  }
+
+  for (unsigned Idx = 0; Idx < VectorWidth; ++Idx) {
+    // Fill the "else" block, created in the previous iteration
+    //
+    //  %Mask1 = extractelement <16 x i1> %Mask, i32 Idx
+    //  br i1 %Mask1, label %cond.store, label %else
+    //
+    Value *Predicate = Builder.CreateExtractElement(Mask, Builder.getInt32(Idx),
+                                                    "Mask" + Twine(Idx));
+
+    // Create "cond" block
+    //
+    //  %Elt1 = extractelement <16 x i32> %Src, i32 1
+    //  %Ptr1 = extractelement <16 x i32*> %Ptrs, i32 1
+    //  store i32 %Elt1, i32* %Ptr1
+    //
+    BasicBlock *CondBlock = IfBlock->splitBasicBlock(InsertPt, "cond.store");
+    Builder.SetInsertPoint(InsertPt);
+
+    Value *OneElt = Builder.CreateExtractElement(Src, Builder.getInt32(Idx),
+                                                 "Elt" + Twine(Idx));
+    Value *Ptr = Builder.CreateExtractElement(Ptrs, Builder.getInt32(Idx),
+                                              "Ptr" + Twine(Idx));
+    Builder.CreateAlignedStore(OneElt, Ptr, Alignment);
+
+    // Create "else" block, fill it in the next iteration
+    BasicBlock *NewIfBlock = CondBlock->splitBasicBlock(InsertPt, "else");
+    Builder.SetInsertPoint(InsertPt);
+    Instruction *OldBr = IfBlock->getTerminator();
+    BranchInst::Create(CondBlock, NewIfBlock, Predicate, OldBr);
+    OldBr->eraseFromParent();
+    IfBlock = NewIfBlock;
+  }
+  CI->eraseFromParent();
+}
+
+bool ScalarizeMaskedGatherScatter::runOnFunction(Function &F) {
+  // This is a correctness transform: it is not skipped for optnone functions.
+  const TargetTransformInfo &TTI =
+      getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+
+  // Collect the calls first, as scalarizing them splits their blocks.
+  SmallVector<IntrinsicInst *, 8> Worklist;
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB)
+      if (IntrinsicInst *II = dyn_cast<IntrinsicInst>(&I)) {
+        if (II->getIntrinsicID() == Intrinsic::masked_gather &&
+            !TTI.isLegalMaskedGather(II->getType()))
+          Worklist.push_back(II);
+        else if (II->getIntrinsicID() == Intrinsic::masked_scatter &&
+                 !TTI.isLegalMaskedScatter(II->getArgOperand(0)->getType()))
+          Worklist.push_back(II);
+      }
+
+  for (IntrinsicInst *II : Worklist) {
+    if (II->getIntrinsicID() == Intrinsic::masked_gather) {
+      ScalarizeMaskedGather(II);
+      ++NumScalarizedGathers;
+    } else {
+      ScalarizeMaskedScatter(II);
+      ++NumScalarizedScatters;
+    }
+  }
+  return !Worklist.empty();
+}
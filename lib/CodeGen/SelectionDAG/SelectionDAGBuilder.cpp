@@ -3664,6 +3664,61 @@ void SelectionDAGBuilder::visitMaskedStore(const CallInst &I) {
   setValue(&I, StoreNode);
 }
 
+/// Return the mask of a gather or scatter with every lane sign-extended to
+/// the width of a pointer, so that it has the shape of the address vector.
+static SDValue getGatherScatterMask(SelectionDAG &DAG, SDLoc sdl,
+                                    SDValue Mask) {
+  const TargetLowering &TLI = DAG.getTargetLoweringInfo();
+  EVT MaskVT = EVT::getVectorVT(*DAG.getContext(), TLI.getPointerTy(),
+                                Mask.getValueType().getVectorNumElements());
+  return DAG.getNode(ISD::SIGN_EXTEND, sdl, MaskVT, Mask);
+}
+
+// Gathers and scatters have no node of their own: the
+// ScalarizeMaskedGatherScatter pass expands the ones the target cannot do, and the others are passed to the target as
+// the intrinsic call, with the mask widened by getGatherScatterMask.
+void SelectionDAGBuilder::visitMaskedGather(const CallInst &I) {
+  SDLoc sdl = getCurSDLoc();
+  const TargetLowering &TLI = DAG.getTargetLoweringInfo();
+
+  // @llvm.masked.gather.*(Ptrs, alignment, Mask, Src0)
+  SDValue Ptrs = getValue(I.getArgOperand(0));
+  SDValue Mask = getGatherScatterMask(DAG, sdl, getValue(I.getArgOperand(2)));
+  SDValue Src0 = getValue(I.getArgOperand(3));
+  unsigned Alignment = (cast<ConstantInt>(I.getArgOperand(1)))->getZExtValue();
+
+  SDValue Ops[] = { DAG.getRoot(),
+                    DAG.getTargetConstant(Intrinsic::masked_gather,
+                                          TLI.getPointerTy()),
+                    Ptrs, DAG.getTargetConstant(Alignment, MVT::i32), Mask,
+                    Src0 };
+  EVT VT = TLI.getValueType(I.getType());
+  SDValue Gather = DAG.getNode(ISD::INTRINSIC_W_CHAIN, sdl,
+                               DAG.getVTList(VT, MVT::Other), Ops);
+  PendingLoads.push_back(Gather.getValue(1));
+  setValue(&I, Gather);
+}
+
+void SelectionDAGBuilder::visitMaskedScatter(const CallInst &I) {
+  SDLoc sdl = getCurSDLoc();
+  const TargetLowering &TLI = DAG.getTargetLoweringInfo();
+
+  // llvm.masked.scatter.*(Src0, Ptrs, alignment, Mask)
+  SDValue Src0 = getValue(I.getArgOperand(0));
+  SDValue Ptrs = getValue(I.getArgOperand(1));
+  unsigned Alignment = (cast<ConstantInt>(I.getArgOperand(2)))->getZExtValue();
+  SDValue Mask = getGatherScatterMask(DAG, sdl, getValue(I.getArgOperand(3)));
+
+  SDValue Ops[] = { getRoot(),
+                    DAG.getTargetConstant(Intrinsic::masked_scatter,
+                                          TLI.getPointerTy()),
+                    Src0, Ptrs, DAG.getTargetConstant(Alignment, MVT::i32),
+                    Mask };
+  SDValue Scatter = DAG.getNode(ISD::INTRINSIC_VOID, sdl, MVT::Other, Ops);
+  DAG.setRoot(Scatter);
+  setValue(&I, Scatter);
+}
+
 void SelectionDAGBuilder::visitMaskedLoad(const CallInst &I) {
   SDLoc sdl = getCurSDLoc();
 
@@ -4864,6 +4919,12 @@ SelectionDAGBuilder::visitIntrinsicCall(const CallInst &I, unsigned Intrinsic) {
   case Intrinsic::masked_store:
     visitMaskedStore(I);
     return nullptr;
+  case Intrinsic::masked_gather:
+    visitMaskedGather(I);
+    return nullptr;
+  case Intrinsic::masked_scatter:
+    visitMaskedScatter(I);
+    return nullptr;
   case Intrinsic::x86_mmx_pslli_w:
   case Intrinsic::x86_mmx_pslli_d:
   case Intrinsic::x86_mmx_pslli_q:
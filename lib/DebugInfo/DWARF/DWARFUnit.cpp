@@ -12,6 +12,7 @@
 #include "llvm/DebugInfo/DWARF/DWARFFormValue.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/Path.h"
+#include <algorithm>
 #include <cstdio>
 
 using namespace llvm;
@@ -36,7 +37,8 @@ DWARFUnit::DWARFUnit(DWARFContext &DC, const DWARFSection &Section,
                      const DWARFUnitSectionBase &UnitSection)
     : Context(DC), InfoSection(Section), Abbrev(DA), RangeSection(RS),
       StringSection(SS), StringOffsetSection(SOS), AddrOffsetSection(AOS),
-      isLittleEndian(LE), UnitSection(UnitSection) {
+      isLittleEndian(LE), UnitSection(UnitSection),
+      SubroutineRangesBuilt(false) {
   clear();
 }
 
@@ -307,6 +309,9 @@ void DWARFUnit::clearDIEs(bool KeepCUDie) {
     if (KeepCUDie)
       DieArray.push_back(TmpArray.front());
   }
+  // The index refers to the DIEs by position.
+  SubroutineRanges.clear();
+  SubroutineRangesBuilt = false;
 }
 
 void DWARFUnit::collectAddressRanges(DWARFAddressRangesVector &CURanges) {
@@ -339,39 +344,106 @@ void DWARFUnit::collectAddressRanges(DWARFAddressRangesVector &CURanges) {
     clearDIEs(true);
 }
 
-const DWARFDebugInfoEntryMinimal *
-DWARFUnit::getSubprogramForAddress(uint64_t Address) {
+void DWARFUnit::collectSubroutineRanges(const DWARFDebugInfoEntryMinimal *DIE,
+                                        uint32_t SubtreeEnd) {
+  for (const DWARFDebugInfoEntryMinimal *Child = DIE->getFirstChild(); Child;
+       Child = Child->getSibling()) {
+    // A DIE without a sibling ends where its parent does.
+    const DWARFDebugInfoEntryMinimal *Sibling = Child->getSibling();
+    uint32_t ChildEnd = Sibling ? getDIEIndex(Sibling) : SubtreeEnd;
+    if (Child->isSubroutineDIE()) {
+      for (const auto &R : Child->getAddressRanges(this))
+        if (R.first < R.second)
+          SubroutineRanges.push_back(
+              {R.first, R.second, 0, getDIEIndex(Child), ChildEnd});
+    }
+    collectSubroutineRanges(Child, ChildEnd);
+  }
+}
+
+void DWARFUnit::buildSubroutineRanges() {
+  if (SubroutineRangesBuilt)
+    return;
   extractDIEsIfNeeded(false);
-  for (const DWARFDebugInfoEntryMinimal &DIE : DieArray) {
-    if (DIE.isSubprogramDIE() &&
-        DIE.addressRangeContainsAddress(this, Address)) {
-      return &DIE;
+  SubroutineRangesBuilt = true;
+  if (DieArray.empty())
+    return;
+  collectSubroutineRanges(&DieArray[0], DieArray.size());
+  std::sort(SubroutineRanges.begin(), SubroutineRanges.end(),
+            [](const SubroutineRange &LHS, const SubroutineRange &RHS) {
+              return LHS.LowPC < RHS.LowPC;
+            });
+  uint64_t MaxHighPC = 0;
+  for (SubroutineRange &R : SubroutineRanges) {
+    MaxHighPC = std::max(MaxHighPC, R.HighPC);
+    R.MaxHighPC = MaxHighPC;
+  }
+}
+
+SmallVector<uint32_t, 4>
+DWARFUnit::getSubroutineChainForAddress(uint64_t Address) {
+  buildSubroutineRanges();
+
+  // Collect the ranges that contain the address. Nested ranges start after
+  // the ranges that contain them, so walk back from the last range starting
+  // at or before the address until no earlier range reaches it.
+  SmallVector<const SubroutineRange *, 4> Candidates;
+  auto I = std::upper_bound(SubroutineRanges.begin(), SubroutineRanges.end(),
+                            Address,
+                            [](uint64_t Address, const SubroutineRange &R) {
+                              return Address < R.LowPC;
+                            });
+  while (I != SubroutineRanges.begin()) {
+    --I;
+    if (I->MaxHighPC <= Address)
+      break;
+    if (Address < I->HighPC)
+      Candidates.push_back(&*I);
+  }
+
+  // In DIE order, the root is the first subprogram, and each following DIE
+  // of the chain is the first one nested in the previous one, as a walk down
+  // the DIE tree would find them.
+  std::sort(Candidates.begin(), Candidates.end(),
+            [](const SubroutineRange *LHS, const SubroutineRange *RHS) {
+              return LHS->DIEIndex < RHS->DIEIndex;
+            });
+  SmallVector<uint32_t, 4> Chain;
+  uint32_t SubtreeEnd = 0;
+  for (const SubroutineRange *R : Candidates) {
+    if (Chain.empty()) {
+      if (!DieArray[R->DIEIndex].isSubprogramDIE())
+        continue;
+    } else if (R->DIEIndex == Chain.back() || R->DIEIndex >= SubtreeEnd) {
+      continue;
     }
+    Chain.push_back(R->DIEIndex);
+    SubtreeEnd = R->SubtreeEnd;
   }
-  return nullptr;
+  return Chain;
 }
 
 DWARFDebugInfoEntryInlinedChain
 DWARFUnit::getInlinedChainForAddress(uint64_t Address) {
   // First, find a subprogram that contains the given address (the root
   // of inlined chain).
-  const DWARFUnit *ChainCU = nullptr;
-  const DWARFDebugInfoEntryMinimal *SubprogramDIE =
-      getSubprogramForAddress(Address);
-  if (SubprogramDIE) {
-    ChainCU = this;
-  } else {
+  DWARFUnit *ChainCU = this;
+  SmallVector<uint32_t, 4> Chain = getSubroutineChainForAddress(Address);
+  if (Chain.empty()) {
     // Try to look for subprogram DIEs in the DWO file.
     parseDWO();
     if (DWO.get()) {
-      SubprogramDIE = DWO->getUnit()->getSubprogramForAddress(Address);
-      if (SubprogramDIE)
-        ChainCU = DWO->getUnit();
+      ChainCU = DWO->getUnit();
+      Chain = ChainCU->getSubroutineChainForAddress(Address);
     }
   }
 
-  // Get inlined chain rooted at this subprogram DIE.
-  if (!SubprogramDIE)
-    return DWARFDebugInfoEntryInlinedChain();
-  return SubprogramDIE->getInlinedChainForAddress(ChainCU, Address);
+  DWARFDebugInfoEntryInlinedChain InlinedChain;
+  if (Chain.empty())
+    return InlinedChain;
+  InlinedChain.U = ChainCU;
+  // Make the root of inlined chain last.
+  for (auto I = Chain.rbegin(), E = Chain.rend(); I != E; ++I)
+    InlinedChain.DIEs.push_back(*ChainCU->getDIEAtIndex(*I));
+  return InlinedChain;
 }
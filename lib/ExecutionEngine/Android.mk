@@ -7,8 +7,10 @@ include $(CLEAR_VARS)
 LOCAL_SRC_FILES := \
 	ExecutionEngineBindings.cpp \
 	ExecutionEngine.cpp \
+	FileObjectCache.cpp \
 	GDBRegistrationListener.cpp \
 	SectionMemoryManager.cpp \
+	SlabMemoryManager.cpp \
 	TargetSelect.cpp
 
 LOCAL_MODULE:= libLLVMExecutionEngine
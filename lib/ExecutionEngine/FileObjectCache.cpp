@@ -0,0 +1,104 @@
+//===- FileObjectCache.cpp - Persistent on-disk object cache --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements an ObjectCache that keeps compiled objects in a
+// directory, so that they survive the process.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/FileObjectCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+
+using namespace llvm;
+
+FileObjectCache::FileObjectCache(StringRef CacheDir, StringRef TargetKey,
+                                 uint64_t MaxSize)
+    : TargetKey(TargetKey), NumHits(0), NumMisses(0) {
+  Cache.setPath(CacheDir);
+  Cache.setMaxSize(MaxSize);
+}
+
+FileObjectCache::FileObjectCache(StringRef CacheDir, const TargetMachine &TM,
+                                 uint64_t MaxSize)
+    : FileObjectCache(CacheDir, getTargetKey(TM), MaxSize) {}
+
+FileObjectCache::~FileObjectCache() { prune(); }
+
+std::string FileObjectCache::getTargetKey(const TargetMachine &TM) {
+  FileCacheKeyBuilder Key;
+  TM.addToCacheKey(Key);
+  return Key.getKey();
+}
+
+std::string FileObjectCache::getCacheKey(const Module &M) const {
+  SmallVector<char, 0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS);
+  }
+
+  FileCacheKeyBuilder Key;
+  Key.add(TargetKey);
+  Key.add(StringRef(Bitcode.data(), Bitcode.size()));
+  return Key.getKey();
+}
+
+std::unique_ptr<MemoryBuffer> FileObjectCache::getObject(const Module *M) {
+  std::string Key = getCacheKey(*M);
+
+  // Entries are renamed into place once complete, so an entry that is not an
+  // object was damaged some other way. Compile it again, which replaces it.
+  std::unique_ptr<MemoryBuffer> Object = Cache.lookup(Key);
+  if (Object &&
+      sys::fs::identify_magic(Object->getBuffer()) !=
+          sys::fs::file_magic::unknown) {
+    std::lock_guard<std::mutex> Lock(CacheMutex);
+    ++NumHits;
+    return Object;
+  }
+
+  std::lock_guard<std::mutex> Lock(CacheMutex);
+  ++NumMisses;
+  PendingKeys[M] = std::move(Key);
+  return nullptr;
+}
+
+void FileObjectCache::notifyObjectCompiled(const Module *M,
+                                           MemoryBufferRef Obj) {
+  std::string Key;
+  {
+    std::lock_guard<std::mutex> Lock(CacheMutex);
+    auto I = PendingKeys.find(M);
+    if (I != PendingKeys.end()) {
+      Key = std::move(I->second);
+      PendingKeys.erase(I);
+    }
+  }
+  if (Key.empty())
+    Key = getCacheKey(*M);
+
+  Cache.store(Key, Obj.getBuffer());
+}
+
+bool FileObjectCache::prune() { return Cache.prune(); }
+
+unsigned FileObjectCache::getNumHits() const {
+  std::lock_guard<std::mutex> Lock(CacheMutex);
+  return NumHits;
+}
+
+unsigned FileObjectCache::getNumMisses() const {
+  std::lock_guard<std::mutex> Lock(CacheMutex);
+  return NumMisses;
+}
@@ -21,6 +21,7 @@
 #include "llvm/Object/COFF.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MutexGuard.h"
+#include <algorithm>
 
 using namespace llvm;
 using namespace llvm::object;
@@ -85,9 +86,11 @@ void RuntimeDyldImpl::resolveRelocations() {
   // First, resolve relocations associated with external symbols.
   resolveExternalSymbols();
 
-  // Just iterate over the sections we have and resolve all the relocations
-  // in them. Gross overkill, but it gets the job done.
-  for (int i = 0, e = Sections.size(); i != e; ++i) {
+  // Then iterate over the sections that relocations refer to and resolve
+  // them.
+  for (unsigned i = 0, e = Relocations.size(); i != e; ++i) {
+    if (Relocations[i].empty())
+      continue;
     // The Section here (Sections[i]) refers to the section in which the
     // symbol for the relocation is located.  The SectionID in the relocation
     // entry provides the section to which the relocation will be applied.
@@ -97,7 +100,7 @@ void RuntimeDyldImpl::resolveRelocations() {
     DEBUG(dumpSectionMemory(Sections[i], "before relocations"));
     resolveRelocationList(Relocations[i], Addr);
     DEBUG(dumpSectionMemory(Sections[i], "after relocations"));
-    Relocations.erase(i);
+    RelocationList().swap(Relocations[i]);
   }
 }
 
@@ -648,6 +651,8 @@ unsigned RuntimeDyldImpl::findOrEmitSection(const ObjectFile &Obj,
 
 void RuntimeDyldImpl::addRelocationForSection(const RelocationEntry &RE,
                                               unsigned SectionID) {
+  if (SectionID >= Relocations.size())
+    Relocations.resize(SectionID + 1);
   Relocations[SectionID].push_back(RE);
 }
 
@@ -664,7 +669,7 @@ void RuntimeDyldImpl::addRelocationForSymbol(const RelocationEntry &RE,
     RelocationEntry RECopy = RE;
     const auto &SymInfo = Loc->second;
     RECopy.Addend += SymInfo.getOffset();
-    Relocations[SymInfo.getSectionID()].push_back(RECopy);
+    addRelocationForSection(RECopy, SymInfo.getSectionID());
   }
 }
 
@@ -765,42 +770,60 @@ void RuntimeDyldImpl::reassignSectionAddress(unsigned SectionID,
   Sections[SectionID].LoadAddress = Addr;
 }
 
-void RuntimeDyldImpl::resolveRelocationList(const RelocationList &Relocs,
+static bool compareRelocationTargets(const RelocationEntry &A,
+                                     const RelocationEntry &B) {
+  if (A.SectionID != B.SectionID)
+    return A.SectionID < B.SectionID;
+  return A.Offset < B.Offset;
+}
+
+void RuntimeDyldImpl::resolveRelocationList(RelocationList &Relocs,
                                             uint64_t Value) {
-  for (unsigned i = 0, e = Relocs.size(); i != e; ++i) {
-    const RelocationEntry &RE = Relocs[i];
+  // Apply the relocations section by section, in address order, rather than
+  // jumping between the sections they write to. Relocations usually arrive
+  // sorted already. Those to the same location keep their order.
+  if (!std::is_sorted(Relocs.begin(), Relocs.end(), compareRelocationTargets))
+    std::stable_sort(Relocs.begin(), Relocs.end(), compareRelocationTargets);
+
+  for (auto I = Relocs.begin(), E = Relocs.end(); I != E;) {
+    unsigned SectionID = I->SectionID;
     // Ignore relocations for sections that were not loaded
-    if (Sections[RE.SectionID].Address == nullptr)
+    if (Sections[SectionID].Address == nullptr) {
+      while (I != E && I->SectionID == SectionID)
+        ++I;
       continue;
-    resolveRelocation(RE, Value);
+    }
+    for (; I != E && I->SectionID == SectionID; ++I)
+      resolveRelocation(*I, Value);
   }
 }
 
 void RuntimeDyldImpl::resolveExternalSymbols() {
   while (!ExternalSymbolRelocations.empty()) {
-    StringMap<RelocationList>::iterator i = ExternalSymbolRelocations.begin();
-
-    StringRef Name = i->first();
-    if (Name.size() == 0) {
-      // This is an absolute symbol, use an address of zero.
-      DEBUG(dbgs() << "Resolving absolute relocations."
-                   << "\n");
-      RelocationList &Relocs = i->second;
-      resolveRelocationList(Relocs, 0);
-    } else {
+    // Look up all the symbols that relocations currently refer to first, then
+    // apply their relocations. Each symbol is looked up once, however many
+    // relocations refer to it. Looking a symbol up in the resolver may load
+    // more objects, which may add relocations to symbols of this round, which
+    // are applied along with the others, and to new symbols, which are left
+    // to the next round.
+    SmallVector<std::pair<std::string, uint64_t>, 16> Symbols;
+    Symbols.reserve(ExternalSymbolRelocations.size());
+    for (const auto &Entry : ExternalSymbolRelocations)
+      Symbols.push_back(std::make_pair(Entry.first(), 0));
+
+    for (auto &Symbol : Symbols) {
+      StringRef Name = Symbol.first;
+      // An empty name stands for absolute relocations, which use an address
+      // of zero.
+      if (Name.empty())
+        continue;
+
       uint64_t Addr = 0;
       RTDyldSymbolTable::const_iterator Loc = GlobalSymbolTable.find(Name);
       if (Loc == GlobalSymbolTable.end()) {
         // This is an external symbol, try to get its address from the symbol
         // resolver.
-        Addr = Resolver.findSymbol(Name.data()).getAddress();
-        // The call to getSymbolAddress may have caused additional modules to
-        // be loaded, which may have added new entries to the
-        // ExternalSymbolRelocations map.  Consquently, we need to update our
-        // iterator.  This is also why retrieval of the relocation list
-        // associated with this symbol is deferred until below this point.
-        // New entries may have been added to the relocation list.
-        i = ExternalSymbolRelocations.find(Name);
+        Addr = Resolver.findSymbol(Symbol.first).getAddress();
       } else {
         // We found the symbol in our global table.  It was probably in a
         // Module that we loaded previously.
@@ -814,15 +837,22 @@ void RuntimeDyldImpl::resolveExternalSymbols() {
         report_fatal_error("Program used external function '" + Name +
                            "' which could not be resolved!");
 
-      DEBUG(dbgs() << "Resolving relocations Name: " << Name << "\t"
-                   << format("0x%lx", Addr) << "\n");
-      // This list may have been updated when we called getSymbolAddress, so
-      // don't change this code to get the list earlier.
-      RelocationList &Relocs = i->second;
-      resolveRelocationList(Relocs, Addr);
+      Symbol.second = Addr;
     }
 
-    ExternalSymbolRelocations.erase(i);
+    for (const auto &Symbol : Symbols) {
+      StringRef Name = Symbol.first;
+      if (Name.empty())
+        DEBUG(dbgs() << "Resolving absolute relocations.\n");
+      else
+        DEBUG(dbgs() << "Resolving relocations Name: " << Name << "\t"
+                     << format("0x%lx", Symbol.second) << "\n");
+      // Get the list only now: the lookups above may have added to it.
+      StringMap<RelocationList>::iterator i =
+          ExternalSymbolRelocations.find(Name);
+      resolveRelocationList(i->second, Symbol.second);
+      ExternalSymbolRelocations.erase(i);
+    }
   }
 }
 
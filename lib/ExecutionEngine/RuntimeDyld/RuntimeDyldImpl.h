@@ -31,6 +31,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include <map>
 #include <system_error>
+#include <vector>
 
 using namespace llvm;
 using namespace llvm::object;
@@ -220,11 +221,12 @@ protected:
   // the relocations get re-resolved.
   // The symbol (or section) the relocation is sourced from is the Key
   // in the relocation list where it's stored.
-  typedef SmallVector<RelocationEntry, 64> RelocationList;
+  typedef std::vector<RelocationEntry> RelocationList;
   // Relocations to sections already loaded. Indexed by SectionID which is the
   // source of the address. The target where the address will be written is
-  // SectionID/Offset in the relocation itself.
-  DenseMap<unsigned, RelocationList> Relocations;
+  // SectionID/Offset in the relocation itself. Sections that are not the
+  // source of any relocation have an empty list.
+  std::vector<RelocationList> Relocations;
 
   // Relocations to external symbols that are not yet resolved.  Symbols are
   // external when they aren't found in the global symbol table of all loaded
@@ -342,7 +344,8 @@ protected:
   uint8_t *createStubFunction(uint8_t *Addr, unsigned AbiVariant = 0);
 
   /// \brief Resolves relocations from Relocs list with address from Value.
-  void resolveRelocationList(const RelocationList &Relocs, uint64_t Value);
+  /// The list is sorted by the location that each relocation writes to.
+  void resolveRelocationList(RelocationList &Relocs, uint64_t Value);
 
   /// \brief A object file specific relocation resolver
   /// \param RE The relocation to be resolved
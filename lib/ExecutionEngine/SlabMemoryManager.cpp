@@ -0,0 +1,288 @@
+//===- SlabMemoryManager.cpp - Pooled memory manager for JITed code -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a memory manager that takes section memory from large
+// slabs shared by many memory managers.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/SlabMemoryManager.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
+
+namespace llvm {
+
+static size_t getPageSize() {
+  static const size_t PageSize = sys::Process::getPageSize();
+  return PageSize;
+}
+
+static uintptr_t getStart(const sys::MemoryBlock &MB) {
+  return reinterpret_cast<uintptr_t>(MB.base());
+}
+
+static uintptr_t getEnd(const sys::MemoryBlock &MB) {
+  return getStart(MB) + MB.size();
+}
+
+static sys::MemoryBlock getBlock(uintptr_t Start, uintptr_t End) {
+  return sys::MemoryBlock(reinterpret_cast<void*>(Start), End - Start);
+}
+
+const size_t SlabMemoryPool::DefaultSlabSize;
+
+SlabMemoryPool::SlabMemoryPool(size_t SlabSize, bool UseHugePages)
+    : SlabSize(RoundUpToAlignment(SlabSize, getPageSize())),
+      UseHugePages(UseHugePages), ReservedSize(0), AllocatedSize(0) {}
+
+SlabMemoryPool::~SlabMemoryPool() {
+  for (auto &S : Segments)
+    for (auto &Slab : S.Slabs)
+      sys::Memory::releaseMappedMemory(Slab);
+}
+
+sys::MemoryBlock SlabMemoryPool::allocate(SegmentKind Kind, size_t Size,
+                                          std::error_code &EC) {
+  EC = std::error_code();
+  Size = RoundUpToAlignment(Size, getPageSize());
+
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  Segment &S = Segments[Kind];
+
+  // Take the lowest free range that is large enough.
+  for (auto I = S.FreeRanges.begin(), E = S.FreeRanges.end(); I != E; ++I) {
+    if (I->second < Size)
+      continue;
+    uintptr_t Start = I->first;
+    size_t Rest = I->second - Size;
+    S.FreeRanges.erase(I);
+    if (Rest)
+      S.FreeRanges[Start + Size] = Rest;
+    AllocatedSize += Size;
+    return getBlock(Start, Start + Size);
+  }
+
+  // Nothing is free: reserve a new slab, next to the last one if possible.
+  unsigned Flags = sys::Memory::MF_READ | sys::Memory::MF_WRITE;
+  if (UseHugePages)
+    Flags |= sys::Memory::MF_HUGE_HINT;
+  sys::MemoryBlock Slab =
+    sys::Memory::allocateMappedMemory(std::max(Size, SlabSize),
+                                      S.Slabs.empty() ? nullptr
+                                                      : &S.Slabs.back(),
+                                      Flags, EC);
+  if (EC)
+    return sys::MemoryBlock();
+
+  S.Slabs.push_back(Slab);
+  ReservedSize += Slab.size();
+  uintptr_t Start = getStart(Slab);
+  if (Slab.size() > Size)
+    addFreeRange(S, Start + Size, Slab.size() - Size);
+  AllocatedSize += Size;
+  return getBlock(Start, Start + Size);
+}
+
+std::error_code SlabMemoryPool::release(SegmentKind Kind,
+                                        sys::MemoryBlock Range) {
+  // Make the range writable again before it can be handed out.
+  if (std::error_code EC =
+        sys::Memory::protectMappedMemory(Range, sys::Memory::MF_READ |
+                                                  sys::Memory::MF_WRITE))
+    return EC;
+
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  addFreeRange(Segments[Kind], getStart(Range), Range.size());
+  AllocatedSize -= Range.size();
+  return std::error_code();
+}
+
+size_t SlabMemoryPool::getReservedSize() const {
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  return ReservedSize;
+}
+
+size_t SlabMemoryPool::getAllocatedSize() const {
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  return AllocatedSize;
+}
+
+void SlabMemoryPool::addFreeRange(Segment &S, uintptr_t Start, size_t Size) {
+  auto Next = S.FreeRanges.lower_bound(Start);
+  if (Next != S.FreeRanges.begin()) {
+    auto Prev = std::prev(Next);
+    if (Prev->first + Prev->second == Start) {
+      Start = Prev->first;
+      Size += Prev->second;
+      S.FreeRanges.erase(Prev);
+    }
+  }
+  if (Next != S.FreeRanges.end() && Start + Size == Next->first) {
+    Size += Next->second;
+    S.FreeRanges.erase(Next);
+  }
+  S.FreeRanges[Start] = Size;
+}
+
+SlabMemoryManager::SlabMemoryManager(SlabMemoryPool &Pool, bool HotCode)
+    : Pool(Pool),
+      CodeMem(HotCode ? SlabMemoryPool::HotCode : SlabMemoryPool::Code),
+      RWDataMem(SlabMemoryPool::RWData), RODataMem(SlabMemoryPool::ROData) {}
+
+uint8_t *SlabMemoryManager::allocateDataSection(uintptr_t Size,
+                                                unsigned Alignment,
+                                                unsigned SectionID,
+                                                StringRef SectionName,
+                                                bool IsReadOnly) {
+  if (IsReadOnly)
+    return allocateSection(RODataMem, Size, Alignment);
+  return allocateSection(RWDataMem, Size, Alignment);
+}
+
+uint8_t *SlabMemoryManager::allocateCodeSection(uintptr_t Size,
+                                                unsigned Alignment,
+                                                unsigned SectionID,
+                                                StringRef SectionName) {
+  return allocateSection(CodeMem, Size, Alignment);
+}
+
+uint8_t *SlabMemoryManager::allocateSection(MemoryGroup &MemGroup,
+                                            uintptr_t Size,
+                                            unsigned Alignment) {
+  if (!Alignment)
+    Alignment = 16;
+
+  assert(!(Alignment & (Alignment - 1)) && "Alignment must be a power of two.");
+
+  uintptr_t Addr = RoundUpToAlignment(MemGroup.Cur, Alignment);
+  if (MemGroup.Cur && Addr + Size <= MemGroup.End) {
+    MemGroup.Cur = Addr + Size;
+    return reinterpret_cast<uint8_t*>(Addr);
+  }
+
+  // The section doesn't fit in the current range: take another one. If it
+  // follows the current range, just extend that, so that finalizeMemory can
+  // change the permissions of both at once.
+  std::error_code EC;
+  sys::MemoryBlock Range = Pool.allocate(MemGroup.Kind, Size + Alignment, EC);
+  if (EC) {
+    // FIXME: Add error propagation to the interface.
+    return nullptr;
+  }
+
+  if (MemGroup.Cur && getStart(Range) == MemGroup.End) {
+    sys::MemoryBlock &Last = MemGroup.Ranges.back();
+    Last = getBlock(getStart(Last), getEnd(Range));
+    MemGroup.End = getEnd(Range);
+  } else {
+    trimLastRange(MemGroup);
+    MemGroup.Ranges.push_back(Range);
+    MemGroup.Cur = getStart(Range);
+    MemGroup.End = getEnd(Range);
+  }
+
+  Addr = RoundUpToAlignment(MemGroup.Cur, Alignment);
+  MemGroup.Cur = Addr + Size;
+  return reinterpret_cast<uint8_t*>(Addr);
+}
+
+void SlabMemoryManager::trimLastRange(MemoryGroup &MemGroup) {
+  if (!MemGroup.Cur)
+    return;
+
+  sys::MemoryBlock &Last = MemGroup.Ranges.back();
+  uintptr_t UsedEnd = RoundUpToAlignment(MemGroup.Cur, getPageSize());
+  if (UsedEnd < getEnd(Last)) {
+    Pool.release(MemGroup.Kind, getBlock(UsedEnd, getEnd(Last)));
+    Last = getBlock(getStart(Last), UsedEnd);
+  }
+  MemGroup.Cur = MemGroup.End = 0;
+}
+
+bool SlabMemoryManager::finalizeMemory(std::string *ErrMsg) {
+  // FIXME: Should in-progress permissions be reverted if an error occurs?
+  std::error_code ec;
+
+  // Don't allow the pages that are about to become executable or read-only to
+  // be used for new sections. Their unused pages go back to the pool.
+  trimLastRange(CodeMem);
+  trimLastRange(RODataMem);
+
+  // Make code memory executable.
+  ec = applyMemoryGroupPermissions(CodeMem,
+                                   sys::Memory::MF_READ | sys::Memory::MF_EXEC);
+  if (ec) {
+    if (ErrMsg) {
+      *ErrMsg = ec.message();
+    }
+    return true;
+  }
+
+  // Make read-only data memory read-only.
+  ec = applyMemoryGroupPermissions(RODataMem, sys::Memory::MF_READ);
+  if (ec) {
+    if (ErrMsg) {
+      *ErrMsg = ec.message();
+    }
+    return true;
+  }
+
+  // Read-write data memory already has the correct permissions
+
+  // Some platforms with separate data cache and instruction cache require
+  // explicit cache flush, otherwise JIT code manipulations (like resolved
+  // relocations) will get to the data cache but not to the instruction cache.
+  invalidateInstructionCache();
+
+  CodeMem.FirstPending = CodeMem.Ranges.size();
+  RODataMem.FirstPending = RODataMem.Ranges.size();
+  return false;
+}
+
+std::error_code
+SlabMemoryManager::applyMemoryGroupPermissions(MemoryGroup &MemGroup,
+                                               unsigned Permissions) {
+  auto &Ranges = MemGroup.Ranges;
+  for (unsigned I = MemGroup.FirstPending, E = Ranges.size(); I != E;) {
+    // Change the permissions of each run of adjacent ranges at once.
+    uintptr_t Start = getStart(Ranges[I]);
+    uintptr_t End = getEnd(Ranges[I]);
+    for (++I; I != E && getStart(Ranges[I]) == End; ++I)
+      End = getEnd(Ranges[I]);
+
+    if (std::error_code ec =
+          sys::Memory::protectMappedMemory(getBlock(Start, End), Permissions))
+      return ec;
+  }
+
+  return std::error_code();
+}
+
+void SlabMemoryManager::invalidateInstructionCache() {
+  for (unsigned i = CodeMem.FirstPending, e = CodeMem.Ranges.size(); i != e;
+       ++i)
+    sys::Memory::InvalidateInstructionCache(CodeMem.Ranges[i].base(),
+                                            CodeMem.Ranges[i].size());
+}
+
+SlabMemoryManager::~SlabMemoryManager() {
+  for (MemoryGroup *MemGroup : { &CodeMem, &RWDataMem, &RODataMem }) {
+    auto &Ranges = MemGroup->Ranges;
+    for (unsigned I = 0, E = Ranges.size(); I != E;) {
+      uintptr_t Start = getStart(Ranges[I]);
+      uintptr_t End = getEnd(Ranges[I]);
+      for (++I; I != E && getStart(Ranges[I]) == End; ++I)
+        End = getEnd(Ranges[I]);
+      Pool.release(MemGroup->Kind, getBlock(Start, End));
+    }
+  }
+}
+
+} // namespace llvm
@@ -0,0 +1,142 @@
+//===-- FunctionInfo.cpp - Function summary index -------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the function summary index used by summary-based link
+// time optimization.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/FunctionInfo.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+using namespace llvm;
+
+/// Return false if a copy of a function referring to C cannot be compiled
+/// outside of the module that defines the function: C refers to a global that
+/// may be discarded or renamed, or to a basic block of the function.
+static bool
+canReferenceFromOtherModule(const Constant *C,
+                            SmallPtrSetImpl<const Constant *> &Visited) {
+  if (!Visited.insert(C).second)
+    return true;
+
+  if (const auto *GV = dyn_cast<GlobalValue>(C))
+    return !GV->isDiscardableIfUnused();
+
+  if (isa<BlockAddress>(C))
+    return false;
+
+  for (const Use &Op : C->operands())
+    if (!canReferenceFromOtherModule(cast<Constant>(Op), Visited))
+      return false;
+  return true;
+}
+
+std::unique_ptr<FunctionSummary> FunctionSummary::create(const Function &F) {
+  assert(!F.isDeclaration() && "Cannot summarize a declaration");
+
+  // Only definitions that the defining module is guaranteed to emit can be
+  // replaced by an available_externally copy elsewhere, and there is no point
+  // in importing a function that will not be inlined.
+  bool Importable =
+      (F.hasExternalLinkage() || F.hasWeakODRLinkage()) &&
+      !F.hasFnAttribute(Attribute::NoInline) &&
+      !F.hasFnAttribute(Attribute::OptimizeNone) &&
+      !F.hasFnAttribute(Attribute::Naked);
+
+  unsigned InstCount = 0;
+  MapVector<const Function *, unsigned> Callees;
+  SmallPtrSet<const Constant *, 32> Visited;
+  for (const BasicBlock &BB : F)
+    for (const Instruction &I : BB) {
+      if (isa<DbgInfoIntrinsic>(I))
+        continue;
+      ++InstCount;
+
+      for (const Use &Op : I.operands())
+        if (const auto *C = dyn_cast<Constant>(Op))
+          if (Importable && !canReferenceFromOtherModule(C, Visited))
+            Importable = false;
+
+      ImmutableCallSite CS(&I);
+      if (!CS)
+        continue;
+      const auto *Callee =
+          dyn_cast<Function>(CS.getCalledValue()->stripPointerCasts());
+      if (Callee && !Callee->isIntrinsic() && !Callee->hasLocalLinkage())
+        ++Callees[Callee];
+    }
+
+  unsigned Flags = 0;
+  if (Importable)
+    Flags |= FF_Importable;
+  if (F.hasFnAttribute(Attribute::Cold))
+    Flags |= FF_Cold;
+
+  auto Summary =
+      llvm::make_unique<FunctionSummary>(F.getLinkage(), InstCount, Flags);
+  for (const auto &Callee : Callees)
+    Summary->addCall(Callee.first->getName(), Callee.second);
+  return Summary;
+}
+
+StringRef FunctionInfoIndex::addModulePath(StringRef ModPath) {
+  auto Entry = ModulePathStringTable.insert(
+      std::make_pair(ModPath, ModulePathStringTable.size()));
+  return Entry.first->first();
+}
+
+void FunctionInfoIndex::addFunctionSummary(
+    StringRef FuncName, StringRef ModPath,
+    std::unique_ptr<FunctionSummary> Summary) {
+  Summary->setModulePath(addModulePath(ModPath));
+  FunctionMap[FuncName].push_back(std::move(Summary));
+}
+
+const FunctionSummaryList *
+FunctionInfoIndex::findFunctionSummaryList(StringRef FuncName) const {
+  auto I = FunctionMap.find(FuncName);
+  if (I == FunctionMap.end())
+    return nullptr;
+  return &I->second;
+}
+
+void FunctionInfoIndex::mergeFrom(std::unique_ptr<FunctionInfoIndex> Other) {
+  // Register the module paths first, in the order of their IDs in Other, so
+  // that modules without any summary are kept and IDs stay deterministic.
+  std::vector<StringRef> ModPaths(Other->ModulePathStringTable.size());
+  for (const auto &ModPath : Other->ModulePathStringTable)
+    ModPaths[ModPath.second] = ModPath.first();
+  for (StringRef ModPath : ModPaths)
+    addModulePath(ModPath);
+
+  for (auto &Entry : Other->FunctionMap)
+    for (std::unique_ptr<FunctionSummary> &Summary : Entry.second) {
+      StringRef ModPath = Summary->getModulePath();
+      addFunctionSummary(Entry.first(), ModPath, std::move(Summary));
+    }
+}
+
+std::unique_ptr<FunctionInfoIndex>
+llvm::buildFunctionInfoIndex(const Module &M) {
+  auto Index = llvm::make_unique<FunctionInfoIndex>();
+  StringRef ModPath = Index->addModulePath(M.getModuleIdentifier());
+  for (const Function &F : M) {
+    if (F.isDeclaration() || F.hasLocalLinkage())
+      continue;
+    Index->addFunctionSummary(F.getName(), ModPath, FunctionSummary::create(F));
+  }
+  return Index;
+}
@@ -219,6 +219,44 @@ CallInst *IRBuilderBase::CreateMaskedStore(Value *Val, Value *Ptr,
   return CreateMaskedIntrinsic(Intrinsic::masked_store, Ops, Val->getType());
 }
 
+/// Create a call to a Masked Gather intrinsic.
+/// Ptrs     - a vector of pointers to the elements to be loaded
+/// Align    - alignment of each element
+/// Mask     - a vector of booleans which indicates what vector lanes should
+///            be loaded; all of them if it is null
+/// PassThru - the value of the lanes that are not loaded
+CallInst *IRBuilderBase::CreateMaskedGather(Value *Ptrs, unsigned Align,
+                                            Value *Mask, Value *PassThru,
+                                            const Twine &Name) {
+  VectorType *PtrsTy = cast<VectorType>(Ptrs->getType());
+  unsigned NumElts = PtrsTy->getVectorNumElements();
+  Type *DataTy = VectorType::get(
+      cast<PointerType>(PtrsTy->getElementType())->getElementType(), NumElts);
+  if (!Mask)
+    Mask = Constant::getAllOnesValue(
+        VectorType::get(Type::getInt1Ty(Context), NumElts));
+  if (!PassThru)
+    PassThru = UndefValue::get(DataTy);
+  Value *Ops[] = { Ptrs, getInt32(Align), Mask, PassThru };
+  return CreateMaskedIntrinsic(Intrinsic::masked_gather, Ops, DataTy, Name);
+}
+
+/// Create a call to a Masked Scatter intrinsic.
+/// Val   - the data to be stored
+/// Ptrs  - a vector of pointers to the destinations of the elements
+/// Align - alignment of each element
+/// Mask  - a vector of booleans which indicates what vector lanes should
+///         be stored; all of them if it is null
+CallInst *IRBuilderBase::CreateMaskedScatter(Value *Val, Value *Ptrs,
+                                             unsigned Align, Value *Mask) {
+  unsigned NumElts = Val->getType()->getVectorNumElements();
+  if (!Mask)
+    Mask = Constant::getAllOnesValue(
+        VectorType::get(Type::getInt1Ty(Context), NumElts));
+  Value *Ops[] = { Val, Ptrs, getInt32(Align), Mask };
+  return CreateMaskedIntrinsic(Intrinsic::masked_scatter, Ops, Val->getType());
+}
+
 /// Create a call to a Masked intrinsic, with given intrinsic Id,
 /// an array of operands - Ops, and one overloaded type - DataTy
 CallInst *IRBuilderBase::CreateMaskedIntrinsic(unsigned Id,
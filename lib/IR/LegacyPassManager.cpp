@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 
+#include "llvm/ADT/Optional.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LegacyPassManager.h"
@@ -23,6 +24,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/TimeValue.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
@@ -1313,6 +1315,9 @@ bool BBPassManager::runOnFunction(Function &F) {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, *I);
         TimeRegion PassTimer(getPassTimer(BP));
+        Optional<TimeTraceScope> TraceScope;
+        if (timeTraceProfilerEnabled())
+          TraceScope.emplace(BP->getPassName(), F.getName());
 
         LocalChanged |= BP->runOnBasicBlock(*I);
       }
@@ -1518,6 +1523,9 @@ bool FPPassManager::runOnFunction(Function &F) {
     return false;
 
   bool Changed = false;
+  Optional<TimeTraceScope> FunctionScope;
+  if (timeTraceProfilerEnabled())
+    FunctionScope.emplace("RunFunctionPasses", F.getName());
 
   // Collect inherited analysis from Module level pass manager.
   populateInheritedAnalysis(TPM->activeStack);
@@ -1534,6 +1542,11 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      // Only name the event if it is recorded; this runs for every pass on
+      // every function.
+      Optional<TimeTraceScope> TraceScope;
+      if (timeTraceProfilerEnabled())
+        TraceScope.emplace(FP->getPassName(), F.getName());
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1612,6 +1625,9 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      Optional<TimeTraceScope> TraceScope;
+      if (timeTraceProfilerEnabled())
+        TraceScope.emplace(MP->getPassName(), M.getModuleIdentifier());
 
       LocalChanged |= MP->runOnModule(M);
     }
@@ -3,6 +3,7 @@ LOCAL_PATH:= $(call my-dir)
 lto_SRC_FILES := \
   LTOModule.cpp \
   LTOCodeGenerator.cpp \
+  ThinLTOCodeGenerator.cpp \
 
 # For the host
 # =====================================================
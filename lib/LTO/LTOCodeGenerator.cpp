@@ -13,11 +13,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/LTO/LTOCodeGenerator.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/CodeGen/RuntimeLibcalls.h"
 #include "llvm/Config/config.h"
 #include "llvm/IR/Constants.h"
@@ -82,6 +84,10 @@ void LTOCodeGenerator::initialize() {
   DiagHandler = nullptr;
   DiagContext = nullptr;
   OwnedModule = nullptr;
+  Parallelism = 1;
+  DeferredDisableInline = false;
+  DeferredDisableGVNLoadPRE = false;
+  DeferredDisableVectorization = false;
 
   initializeLTOPasses();
 }
@@ -244,7 +250,8 @@ bool LTOCodeGenerator::compileOptimizedToFile(const char **name,
   // generate object file
   tool_output_file objFile(Filename.c_str(), FD);
 
-  bool genResult = compileOptimized(objFile.os(), errMsg);
+  raw_pwrite_stream *OS = &objFile.os();
+  bool genResult = compileOptimized(OS, errMsg);
   objFile.os().close();
   if (objFile.os().has_error()) {
     objFile.os().clear_error();
@@ -263,6 +270,45 @@ bool LTOCodeGenerator::compileOptimizedToFile(const char **name,
   return true;
 }
 
+bool LTOCodeGenerator::compileOptimizedToFiles(std::string &errMsg) {
+  NativeObjectPaths.clear();
+
+  // make one unique temp .o file per partition to put generated code in
+  std::vector<std::unique_ptr<tool_output_file>> objFiles;
+  std::vector<raw_pwrite_stream *> OSs;
+  std::vector<std::string> Paths;
+  for (unsigned I = 0; I != Parallelism; ++I) {
+    SmallString<128> Filename;
+    int FD;
+    std::error_code EC =
+        sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
+    if (EC) {
+      errMsg = EC.message();
+      return false;
+    }
+    objFiles.push_back(make_unique<tool_output_file>(Filename.c_str(), FD));
+    OSs.push_back(&objFiles.back()->os());
+    Paths.push_back(Filename.c_str());
+  }
+
+  // generate object files; the files are removed unless they are kept
+  bool genResult = compileOptimized(OSs, errMsg);
+  for (auto &objFile : objFiles) {
+    objFile->os().close();
+    if (objFile->os().has_error()) {
+      objFile->os().clear_error();
+      genResult = false;
+    }
+  }
+  if (!genResult)
+    return false;
+
+  for (auto &objFile : objFiles)
+    objFile->keep();
+  NativeObjectPaths = std::move(Paths);
+  return true;
+}
+
 const void *LTOCodeGenerator::compileOptimized(size_t *length,
                                                std::string &errMsg) {
   const char *name;
@@ -524,6 +570,34 @@ void LTOCodeGenerator::applyScopeRestrictions() {
   ScopeRestrictionsDone = true;
 }
 
+/// Compute the key of the object files generated for the merged module with
+/// the current options, once the scope restrictions have been applied.
+std::string LTOCodeGenerator::computeCacheKey(bool DisableInline,
+                                              bool DisableGVNLoadPRE,
+                                              bool DisableVectorization) {
+  FileCacheKeyBuilder Key;
+  SmallString<0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(IRLinker.getModule(), OS,
+                       /* ShouldPreserveUseListOrder */ true);
+    OS.flush();
+  }
+  Key.add(Bitcode);
+
+  Key.add(DisableInline);
+  Key.add(DisableGVNLoadPRE);
+  Key.add(DisableVectorization);
+  Key.add(OptLevel);
+  Key.add(CodeModel);
+  Key.add(EmitDwarfDebugInfo);
+  TargetMach->addToCacheKey(Key);
+  for (const char *Option : CodegenOptions)
+    Key.add(Option);
+  Key.add(Parallelism);
+  return Key.getKey();
+}
+
 /// Optimize merged modules using various IPO passes
 bool LTOCodeGenerator::optimize(bool DisableInline,
                                 bool DisableGVNLoadPRE,
@@ -537,12 +611,46 @@ bool LTOCodeGenerator::optimize(bool DisableInline,
   // Mark which symbols can not be internalized
   this->applyScopeRestrictions();
 
-  // Instantiate the pass manager to organize the passes.
-  legacy::PassManager passes;
-
   // Add an appropriate DataLayout instance for this module...
   mergedModule->setDataLayout(*TargetMach->getDataLayout());
 
+  // If a previous link generated the object files for the same module with
+  // the same options, there is nothing left to do.
+  CachedObjects.clear();
+  CacheKey.clear();
+  if (Cache.isEnabled()) {
+    CacheKey =
+        computeCacheKey(DisableInline, DisableGVNLoadPRE, DisableVectorization);
+    for (unsigned I = 0; I != Parallelism; ++I) {
+      std::unique_ptr<MemoryBuffer> Object =
+          Cache.lookup(CacheKey + "-" + utostr(I));
+      if (!Object) {
+        CachedObjects.clear();
+        break;
+      }
+      CachedObjects.push_back(std::move(Object));
+    }
+    if (!CachedObjects.empty()) {
+      DeferredDisableInline = DisableInline;
+      DeferredDisableGVNLoadPRE = DisableGVNLoadPRE;
+      DeferredDisableVectorization = DisableVectorization;
+      return true;
+    }
+  }
+
+  runOptimizationPasses(DisableInline, DisableGVNLoadPRE,
+                        DisableVectorization);
+  return true;
+}
+
+void LTOCodeGenerator::runOptimizationPasses(bool DisableInline,
+                                             bool DisableGVNLoadPRE,
+                                             bool DisableVectorization) {
+  Module *mergedModule = IRLinker.getModule();
+
+  // Instantiate the pass manager to organize the passes.
+  legacy::PassManager passes;
+
   passes.add(
       createTargetTransformInfoWrapperPass(TargetMach->getTargetIRAnalysis()));
 
@@ -562,32 +670,71 @@ bool LTOCodeGenerator::optimize(bool DisableInline,
 
   // Run our queue of passes all at once now, efficiently.
   passes.run(*mergedModule);
-
-  return true;
 }
 
-bool LTOCodeGenerator::compileOptimized(raw_pwrite_stream &out,
+bool LTOCodeGenerator::compileOptimized(ArrayRef<raw_pwrite_stream *> out,
                                         std::string &errMsg) {
   if (!this->determineTarget(errMsg))
     return false;
 
   Module *mergedModule = IRLinker.getModule();
 
-  legacy::PassManager codeGenPasses;
+  if (!CachedObjects.empty()) {
+    if (CachedObjects.size() == out.size()) {
+      for (unsigned I = 0, E = out.size(); I != E; ++I)
+        *out[I] << CachedObjects[I]->getBuffer();
+      return true;
+    }
+
+    // The cached objects are partitioned differently, so the module has to
+    // be optimized and compiled after all.
+    CachedObjects.clear();
+    runOptimizationPasses(DeferredDisableInline, DeferredDisableGVNLoadPRE,
+                          DeferredDisableVectorization);
+  }
 
   // If the bitcode files contain ARC code and were compiled with optimization,
-  // the ObjCARCContractPass must be run, so do it unconditionally here.
-  codeGenPasses.add(createObjCARCContractPass());
-
-  if (TargetMach->addPassesToEmitFile(codeGenPasses, out,
-                                      TargetMachine::CGFT_ObjectFile)) {
-    errMsg = "target file type not supported";
-    return false;
+  // the ObjCARCContractPass must be run, so do it unconditionally here. It is
+  // run on the merged module so that every partition sees its result.
+  legacy::PassManager preCodeGenPasses;
+  preCodeGenPasses.add(createObjCARCContractPass());
+  preCodeGenPasses.run(*mergedModule);
+
+  // The cache key assumes one object per partition.
+  std::string Key;
+  std::swap(Key, CacheKey);
+  if (Key.empty() || out.size() != Parallelism) {
+    // Run the code generator, and write the object files
+    if (splitCodeGen(*mergedModule, out, *TargetMach,
+                     TargetMachine::CGFT_ObjectFile)) {
+      errMsg = "target file type not supported";
+      return false;
+    }
+    return true;
   }
 
-  // Run the code generator, and write assembly file
-  codeGenPasses.run(*mergedModule);
+  // Generate the object files in memory, so that they can be added to the
+  // cache as well.
+  std::vector<SmallString<0>> Objects(out.size());
+  {
+    std::vector<std::unique_ptr<raw_svector_ostream>> OSs;
+    std::vector<raw_pwrite_stream *> OSPtrs;
+    for (SmallString<0> &Object : Objects) {
+      OSs.push_back(make_unique<raw_svector_ostream>(Object));
+      OSPtrs.push_back(OSs.back().get());
+    }
+    if (splitCodeGen(*mergedModule, OSPtrs, *TargetMach,
+                     TargetMachine::CGFT_ObjectFile)) {
+      errMsg = "target file type not supported";
+      return false;
+    }
+  }
 
+  for (unsigned I = 0, E = out.size(); I != E; ++I) {
+    Cache.store(Key + "-" + utostr(I), Objects[I]);
+    *out[I] << Objects[I];
+  }
+  Cache.prune();
   return true;
 }
 
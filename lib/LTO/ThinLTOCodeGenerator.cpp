@@ -0,0 +1,233 @@
+//===-ThinLTOCodeGenerator.cpp - LLVM Link Time Optimizer -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the Thin Link Time Optimization library. This library is
+// intended to be used by linker to optimize code at link time.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/LTO/ThinLTOCodeGenerator.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/FunctionInfo.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/FunctionImport.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include <atomic>
+#include <thread>
+using namespace llvm;
+
+ThinLTOCodeGenerator::ThinLTOCodeGenerator()
+    : RelocModel(Reloc::Default), OptLevel(2), Parallelism(1) {}
+
+ThinLTOCodeGenerator::~ThinLTOCodeGenerator() {}
+
+void ThinLTOCodeGenerator::addModule(StringRef Identifier, StringRef Data) {
+  Modules.push_back({Identifier, Data});
+}
+
+std::unique_ptr<FunctionInfoIndex>
+ThinLTOCodeGenerator::linkCombinedIndex(std::string &ErrMsg) {
+  auto CombinedIndex = llvm::make_unique<FunctionInfoIndex>();
+  for (const InputModule &Input : Modules) {
+    ErrorOr<std::unique_ptr<FunctionInfoIndex>> IndexOrErr =
+        getFunctionInfoIndex(MemoryBufferRef(Input.Data, Input.Identifier));
+    if (std::error_code EC = IndexOrErr.getError()) {
+      ErrMsg = "error reading function summary of '" + Input.Identifier +
+               "': " + EC.message();
+      return nullptr;
+    }
+    CombinedIndex->mergeFrom(std::move(IndexOrErr.get()));
+  }
+  return CombinedIndex;
+}
+
+static CodeGenOpt::Level getCGOptLevel(unsigned OptLevel) {
+  switch (OptLevel) {
+  case 0:
+    return CodeGenOpt::None;
+  case 1:
+    return CodeGenOpt::Less;
+  case 2:
+    return CodeGenOpt::Default;
+  }
+  return CodeGenOpt::Aggressive;
+}
+
+bool ThinLTOCodeGenerator::processModule(unsigned ModuleIndex,
+                                         const FunctionInfoIndex &Index,
+                                         std::string &ErrMsg) {
+  const InputModule &Input = Modules[ModuleIndex];
+  LLVMContext Context;
+
+  ErrorOr<Module *> MOrErr =
+      parseBitcodeFile(MemoryBufferRef(Input.Data, Input.Identifier), Context);
+  if (std::error_code EC = MOrErr.getError()) {
+    ErrMsg = "could not read '" + Input.Identifier + "': " + EC.message();
+    return false;
+  }
+  std::unique_ptr<Module> M(MOrErr.get());
+
+  // Bring in the bodies of the functions the index selects. The other modules
+  // are loaded lazily, so only the imported bodies and the metadata they refer
+  // to are parsed.
+  auto ModuleLoader = [&](StringRef Identifier) -> std::unique_ptr<Module> {
+    for (const InputModule &Other : Modules) {
+      if (Other.Identifier != Identifier)
+        continue;
+      ErrorOr<Module *> SrcOrErr = getLazyBitcodeModule(
+          MemoryBuffer::getMemBuffer(Other.Data, Other.Identifier, false),
+          Context, nullptr, /* ShouldLazyLoadMetadata */ true);
+      if (!SrcOrErr)
+        return nullptr;
+      return std::unique_ptr<Module>(SrcOrErr.get());
+    }
+    return nullptr;
+  };
+  FunctionImporter Importer(
+      Index, [&Context](const DiagnosticInfo &DI) { Context.diagnose(DI); },
+      ModuleLoader);
+  Importer.importFunctions(*M);
+
+  std::string TripleStr = M->getTargetTriple();
+  if (TripleStr.empty())
+    TripleStr = sys::getDefaultTargetTriple();
+  Triple TheTriple(TripleStr);
+  const Target *TheTarget = TargetRegistry::lookupTarget(TripleStr, ErrMsg);
+  if (!TheTarget)
+    return false;
+
+  SubtargetFeatures Features(MAttr);
+  Features.getDefaultSubtargetFeatures(TheTriple);
+  std::unique_ptr<TargetMachine> TM(TheTarget->createTargetMachine(
+      TripleStr, MCpu, Features.getString(), Options, RelocModel,
+      CodeModel::Default, getCGOptLevel(OptLevel)));
+  M->setDataLayout(*TM->getDataLayout());
+
+  // The object file only depends on the module with its imports and on the
+  // options, so that is what the cache entry is keyed by.
+  std::string CacheKey;
+  if (Cache.isEnabled()) {
+    FileCacheKeyBuilder Key;
+    SmallString<0> Bitcode;
+    {
+      raw_svector_ostream OS(Bitcode);
+      WriteBitcodeToFile(M.get(), OS, /* ShouldPreserveUseListOrder */ true);
+      OS.flush();
+    }
+    Key.add(Bitcode);
+    Key.add(OptLevel);
+    TM->addToCacheKey(Key);
+    CacheKey = Key.getKey();
+    if (std::unique_ptr<MemoryBuffer> Object = Cache.lookup(CacheKey)) {
+      ProducedBinaries[ModuleIndex] =
+          MemoryBuffer::getMemBufferCopy(Object->getBuffer(), Input.Identifier);
+      return true;
+    }
+  }
+
+  // Optimize the module with the imported functions. The pipeline is the
+  // regular per-module one: the imported bodies are inlined and then dropped,
+  // since available_externally definitions are never emitted.
+  {
+    legacy::PassManager PM;
+    PM.add(createTargetTransformInfoWrapperPass(TM->getTargetIRAnalysis()));
+    PassManagerBuilder PMB;
+    PMB.OptLevel = OptLevel;
+    PMB.LibraryInfo = new TargetLibraryInfoImpl(TheTriple);
+    PMB.Inliner = createFunctionInliningPass();
+    PMB.LoopVectorize = true;
+    PMB.SLPVectorize = true;
+    PMB.VerifyInput = true;
+    PMB.VerifyOutput = true;
+    PMB.populateModulePassManager(PM);
+    PM.run(*M);
+  }
+
+  SmallString<0> Object;
+  {
+    raw_svector_ostream OS(Object);
+    legacy::PassManager CodeGenPasses;
+    if (TM->addPassesToEmitFile(CodeGenPasses, OS,
+                                TargetMachine::CGFT_ObjectFile)) {
+      ErrMsg = "target file type not supported";
+      return false;
+    }
+    CodeGenPasses.run(*M);
+    OS.flush();
+  }
+
+  if (!CacheKey.empty())
+    Cache.store(CacheKey, Object);
+  ProducedBinaries[ModuleIndex] =
+      MemoryBuffer::getMemBufferCopy(Object, Input.Identifier);
+  return true;
+}
+
+bool ThinLTOCodeGenerator::run(std::string &ErrMsg) {
+  std::unique_ptr<FunctionInfoIndex> Index = linkCombinedIndex(ErrMsg);
+  if (!Index)
+    return false;
+
+  ProducedBinaries.clear();
+  ProducedBinaries.resize(Modules.size());
+
+  // Every worker repeatedly takes the next module that has not been compiled
+  // yet. The first error wins; the remaining modules are not compiled.
+  std::atomic<unsigned> NextModule(0);
+  std::atomic<bool> Failed(false);
+  std::vector<std::string> Errors(Modules.size());
+  auto Worker = [&]() {
+    while (!Failed) {
+      unsigned I = NextModule++;
+      if (I >= Modules.size())
+        return;
+      if (!processModule(I, *Index, Errors[I]))
+        Failed = true;
+    }
+  };
+
+  unsigned NumThreads =
+      std::min<unsigned>(Parallelism, std::max<size_t>(Modules.size(), 1));
+  if (NumThreads == 1) {
+    Worker();
+  } else {
+    std::vector<std::thread> Threads;
+    for (unsigned I = 0; I != NumThreads; ++I)
+      Threads.emplace_back(Worker);
+    for (std::thread &T : Threads)
+      T.join();
+  }
+
+  if (!Failed) {
+    Cache.prune();
+    return true;
+  }
+  for (const std::string &Error : Errors)
+    if (!Error.empty()) {
+      ErrMsg = Error;
+      break;
+    }
+  ProducedBinaries.clear();
+  return false;
+}
@@ -29,17 +29,24 @@
 #include "llvm/MC/MCSectionELF.h"
 #include "llvm/MC/MCValue.h"
 #include "llvm/MC/StringTableBuilder.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ELF.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Parallel.h"
 #include <vector>
 using namespace llvm;
 
 #undef  DEBUG_TYPE
 #define DEBUG_TYPE "reloc-info"
 
+static cl::opt<unsigned> MinParallelWriteSize(
+    "elf-parallel-write-min-size", cl::Hidden, cl::init(1 << 20),
+    cl::desc("Write the sections of ELF objects with at least this many "
+             "bytes of section contents concurrently"));
+
 namespace {
 class FragmentWriter {
   bool IsLittleEndian;
@@ -79,6 +86,30 @@ public:
                    uint8_t other, uint32_t shndx, bool Reserved);
 };
 
+/// An object writer that only receives the contents of one section, so that
+/// sections can be written concurrently, each into its own buffer.
+class SectionContentsWriter : public MCObjectWriter {
+public:
+  SectionContentsWriter(raw_pwrite_stream &OS, bool IsLittleEndian)
+      : MCObjectWriter(OS, IsLittleEndian) {}
+
+  void ExecutePostLayoutBinding(MCAssembler &Asm,
+                                const MCAsmLayout &Layout) override {
+    llvm_unreachable("Not a complete object writer!");
+  }
+
+  void RecordRelocation(MCAssembler &Asm, const MCAsmLayout &Layout,
+                        const MCFragment *Fragment, const MCFixup &Fixup,
+                        MCValue Target, bool &IsPCRel,
+                        uint64_t &FixedValue) override {
+    llvm_unreachable("Not a complete object writer!");
+  }
+
+  void WriteObject(MCAssembler &Asm, const MCAsmLayout &Layout) override {
+    llvm_unreachable("Not a complete object writer!");
+  }
+};
+
 class ELFObjectWriter : public MCObjectWriter {
   FragmentWriter FWriter;
 
@@ -94,9 +125,11 @@ class ELFObjectWriter : public MCObjectWriter {
     static uint64_t DataSectionSize(const MCSectionData &SD);
     static uint64_t GetSectionAddressSize(const MCAsmLayout &Layout,
                                           const MCSectionData &SD);
+    static uint64_t GetSectionFileSize(const MCAsmLayout &Layout,
+                                       const MCSectionData &SD);
 
     void writeDataSectionData(MCAssembler &Asm, const MCAsmLayout &Layout,
-                              const MCSectionData &SD);
+                              const MCSectionData &SD, MCObjectWriter *OW);
 
     /// Helper struct for containing some precomputed information on symbols.
     struct ELFSymbolData {
@@ -1532,18 +1565,26 @@ uint64_t ELFObjectWriter::GetSectionAddressSize(const MCAsmLayout &Layout,
   return Layout.getSectionAddressSize(&SD);
 }
 
+uint64_t ELFObjectWriter::GetSectionFileSize(const MCAsmLayout &Layout,
+                                             const MCSectionData &SD) {
+  if (SD.getSection().isVirtualSection())
+    return 0;
+  return GetSectionAddressSize(Layout, SD);
+}
+
 void ELFObjectWriter::writeDataSectionData(MCAssembler &Asm,
                                            const MCAsmLayout &Layout,
-                                           const MCSectionData &SD) {
+                                           const MCSectionData &SD,
+                                           MCObjectWriter *OW) {
   if (IsELFMetaDataSection(SD)) {
     for (MCSectionData::const_iterator i = SD.begin(), e = SD.end(); i != e;
          ++i) {
       const MCFragment &F = *i;
       assert(F.getKind() == MCFragment::FT_Data);
-      WriteBytes(cast<MCDataFragment>(F).getContents());
+      OW->WriteBytes(cast<MCDataFragment>(F).getContents());
     }
   } else {
-    Asm.writeSectionData(&SD, Layout);
+    Asm.writeSectionData(&SD, Layout, OW);
   }
 }
 
@@ -1611,16 +1652,49 @@ void ELFObjectWriter::WriteObject(MCAssembler &Asm,
   WriteHeader(Asm, NumSections + 1);
 
   // ... then the sections ...
+  // Layout is final, so the offset of every section in the file is known
+  // before any of them is written.
+  std::vector<const MCSectionData *> SectionData(NumSections);
+  uint64_t Offset = OS.tell();
   for (unsigned i = 0; i < NumSections; ++i) {
     const MCSectionELF &Section = *Sections[i];
     const MCSectionData &SD = Asm.getOrCreateSectionData(Section);
-    uint64_t Padding = OffsetToAlignment(OS.tell(), SD.getAlignment());
-    WriteZeros(Padding);
+    SectionData[i] = &SD;
+    Offset = RoundUpToAlignment(Offset, SD.getAlignment());
+    SectionOffsetMap[&Section] = Offset;
+    Offset += GetSectionFileSize(Layout, SD);
+  }
 
-    // Remember the offset into the file for this section.
-    SectionOffsetMap[&Section] = OS.tell();
+  // When there is enough data, write the sections concurrently into buffers
+  // of their own, and then copy the buffers out in order. With a single
+  // thread the buffers are filled in turn, which gives the same bytes.
+  std::vector<SmallVector<char, 0>> SectionContents;
+#if LLVM_ENABLE_THREADS
+  if (NumSections > 1 && Offset - OS.tell() >= MinParallelWriteSize) {
+    SectionContents.resize(NumSections);
+    parallel_for_each_n(0u, NumSections, [&](unsigned i) {
+      const MCSectionData &SD = *SectionData[i];
+      SmallVector<char, 0> &Contents = SectionContents[i];
+      Contents.reserve(GetSectionFileSize(Layout, SD));
+      raw_svector_ostream VOS(Contents);
+      SectionContentsWriter Writer(VOS, IsLittleEndian);
+      writeDataSectionData(Asm, Layout, SD, &Writer);
+    });
+  }
+#endif
 
-    writeDataSectionData(Asm, Layout, SD);
+  for (unsigned i = 0; i < NumSections; ++i) {
+    const MCSectionELF &Section = *Sections[i];
+    const MCSectionData &SD = *SectionData[i];
+    WriteZeros(SectionOffsetMap[&Section] - OS.tell());
+
+    if (SectionContents.empty())
+      writeDataSectionData(Asm, Layout, SD, this);
+    else
+      WriteBytes(SectionContents[i]);
+    assert(OS.tell() == SectionOffsetMap[&Section] +
+                            GetSectionFileSize(Layout, SD) &&
+           "Section size does not match its layout!");
   }
 
   uint64_t NaturalAlignment = is64Bit() ? 8 : 4;
@@ -28,6 +28,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/raw_ostream.h"
 #include <tuple>
 using namespace llvm;
@@ -54,6 +55,8 @@ STATISTIC(FragmentLayouts, "Number of fragment layouts");
 STATISTIC(ObjectBytes, "Number of emitted object file bytes");
 STATISTIC(RelaxationSteps, "Number of assembler layout and relaxation steps");
 STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
+STATISTIC(ReusedFixupValues,
+          "Number of fixup values reused during relaxation");
 }
 }
 
@@ -695,11 +698,9 @@ void MCAssembler::writeFragmentPadding(const MCFragment &F, uint64_t FSize,
   }
 }
 
-/// \brief Write the fragment \p F to the output file.
+/// \brief Write the fragment \p F to the given object writer.
 static void writeFragment(const MCAssembler &Asm, const MCAsmLayout &Layout,
-                          const MCFragment &F) {
-  MCObjectWriter *OW = &Asm.getWriter();
-
+                          const MCFragment &F, MCObjectWriter *OW) {
   // FIXME: Embed in fragments instead?
   uint64_t FragmentSize = Asm.computeFragmentSize(Layout, F);
 
@@ -820,6 +821,12 @@ static void writeFragment(const MCAssembler &Asm, const MCAsmLayout &Layout,
 
 void MCAssembler::writeSectionData(const MCSectionData *SD,
                                    const MCAsmLayout &Layout) const {
+  writeSectionData(SD, Layout, &getWriter());
+}
+
+void MCAssembler::writeSectionData(const MCSectionData *SD,
+                                   const MCAsmLayout &Layout,
+                                   MCObjectWriter *OW) const {
   // Ignore virtual sections.
   if (SD->getSection().isVirtualSection()) {
     assert(Layout.getSectionFileSize(SD) == 0 && "Invalid size for section!");
@@ -864,14 +871,14 @@ void MCAssembler::writeSectionData(const MCSectionData *SD,
     return;
   }
 
-  uint64_t Start = getWriter().getStream().tell();
+  uint64_t Start = OW->getStream().tell();
   (void)Start;
 
   for (MCSectionData::const_iterator it = SD->begin(), ie = SD->end();
        it != ie; ++it)
-    writeFragment(*this, Layout, *it);
+    writeFragment(*this, Layout, *it, OW);
 
-  assert(getWriter().getStream().tell() - Start ==
+  assert(OW->getStream().tell() - Start ==
          Layout.getSectionAddressSize(SD));
 }
 
@@ -894,6 +901,7 @@ std::pair<uint64_t, bool> MCAssembler::handleFixup(const MCAsmLayout &Layout,
 }
 
 void MCAssembler::Finish() {
+  TimeTraceScope TraceScope("AssembleObject");
   DEBUG_WITH_TYPE("mc-dump", {
       llvm::errs() << "assembler backend - pre-layout\n--\n";
       dump(); });
@@ -924,8 +932,11 @@ void MCAssembler::Finish() {
   }
 
   // Layout until everything fits.
-  while (layoutOnce(Layout))
-    continue;
+  {
+    TimeTraceScope LayoutScope("RelaxAndLayout");
+    while (layoutOnce(Layout))
+      continue;
+  }
 
   DEBUG_WITH_TYPE("mc-dump", {
       llvm::errs() << "assembler backend - post-relaxation\n--\n";
@@ -965,18 +976,88 @@ void MCAssembler::Finish() {
   }
 
   // Write the object file.
-  getWriter().WriteObject(*this, Layout);
+  {
+    TimeTraceScope WriteScope("WriteObject");
+    getWriter().WriteObject(*this, Layout);
+  }
 
   stats::ObjectBytes += OS.tell() - StartOffset;
 }
 
+/// If the value of \p Fixup only depends on the layout through the distance
+/// between \p DF and another fragment of the same section, return that
+/// fragment. This is the case of a PC-relative fixup to a label plus a
+/// constant.
+static const MCFragment *getFixupTargetFragment(const MCAssembler &Asm,
+                                                const MCFixup &Fixup,
+                                                const MCFragment *DF) {
+  const MCFixupKindInfo &Info =
+      Asm.getBackend().getFixupKindInfo(Fixup.getKind());
+  if (!(Info.Flags & MCFixupKindInfo::FKF_IsPCRel) ||
+      (Info.Flags & MCFixupKindInfo::FKF_IsAlignedDownTo32Bits))
+    return nullptr;
+
+  const MCExpr *Expr = Fixup.getValue();
+  if (const MCBinaryExpr *BE = dyn_cast<MCBinaryExpr>(Expr)) {
+    if ((BE->getOpcode() != MCBinaryExpr::Add &&
+         BE->getOpcode() != MCBinaryExpr::Sub) ||
+        !isa<MCConstantExpr>(BE->getRHS()))
+      return nullptr;
+    Expr = BE->getLHS();
+  }
+
+  const MCSymbolRefExpr *Ref = dyn_cast<MCSymbolRefExpr>(Expr);
+  if (!Ref || Ref->getKind() != MCSymbolRefExpr::VK_None)
+    return nullptr;
+  const MCSymbol &Sym = Ref->getSymbol();
+  if (Sym.isVariable() || !Sym.isDefined() || !Asm.hasSymbolData(Sym))
+    return nullptr;
+
+  const MCFragment *F = Asm.getSymbolData(Sym).getFragment();
+  if (!F || F->getParent() != DF->getParent())
+    return nullptr;
+  return F;
+}
+
+bool MCAssembler::evaluateRelaxableFixup(const MCAsmLayout &Layout,
+                                         const MCFixup &Fixup,
+                                         const MCRelaxableFragment *DF,
+                                         uint64_t &Value) const {
+  MCValue Target;
+  if (DF->getFixups().size() != 1)
+    return evaluateFixup(Layout, Fixup, DF, Target, Value);
+
+  MCRelaxableFragment::FixupValueCache &Cache = DF->getFixupValueCache();
+  if (!Cache.Analyzed) {
+    Cache.TargetFragment = getFixupTargetFragment(*this, Fixup, DF);
+    Cache.Analyzed = true;
+  }
+  if (!Cache.TargetFragment)
+    return evaluateFixup(Layout, Fixup, DF, Target, Value);
+
+  // Only the fragments between DF and the target can change the value, and
+  // they can only do so by changing the distance between the two.
+  int64_t Distance = Layout.getFragmentOffset(Cache.TargetFragment) -
+                     Layout.getFragmentOffset(DF);
+  if (Cache.HasValue && Cache.Distance == Distance) {
+    ++stats::ReusedFixupValues;
+    Value = Cache.Value;
+    return Cache.IsResolved;
+  }
+
+  Cache.IsResolved = evaluateFixup(Layout, Fixup, DF, Target, Value);
+  Cache.HasValue = true;
+  Cache.Distance = Distance;
+  Cache.Value = Value;
+  return Cache.IsResolved;
+}
+
 bool MCAssembler::fixupNeedsRelaxation(const MCFixup &Fixup,
                                        const MCRelaxableFragment *DF,
                                        const MCAsmLayout &Layout) const {
   // If we cannot resolve the fixup value, it requires relaxation.
-  MCValue Target;
   uint64_t Value;
-  if (!evaluateFixup(Layout, Fixup, DF, Target, Value))
+  if (!evaluateRelaxableFixup(Layout, Fixup, DF, Value))
     return true;
 
   return getBackend().fixupNeedsRelaxation(Fixup, Value, DF, Layout);
@@ -1027,6 +1108,7 @@ bool MCAssembler::relaxInstruction(MCAsmLayout &Layout,
   F.setInst(Relaxed);
   F.getContents() = Code;
   F.getFixups() = Fixups;
+  F.getFixupValueCache().reset();
 
   return true;
 }
@@ -1117,6 +1199,10 @@ bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD) {
     if (RelaxedFrag && !FirstRelaxedFragment)
       FirstRelaxedFragment = I;
   }
+  // The offsets of all the fragments after the first relaxed one are computed
+  // again in the next iteration, so each iteration still walks the section.
+  // The fixup value cache of the relaxable fragments only saves evaluating
+  // the fixups whose distance did not change.
   if (FirstRelaxedFragment) {
     Layout.invalidateFragmentsFrom(FirstRelaxedFragment);
     return true;
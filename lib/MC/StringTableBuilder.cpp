@@ -8,33 +8,94 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/MC/StringTableBuilder.h"
-#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/Support/COFF.h"
 #include "llvm/Support/Endian.h"
+#include "llvm/Support/Parallel.h"
+#include <vector>
 
 using namespace llvm;
 
-static bool compareBySuffix(StringRef a, StringRef b) {
-  size_t sizeA = a.size();
-  size_t sizeB = b.size();
-  size_t len = std::min(sizeA, sizeB);
-  for (size_t i = 0; i < len; ++i) {
-    char ca = a[sizeA - i - 1];
-    char cb = b[sizeB - i - 1];
-    if (ca != cb)
-      return ca > cb;
+typedef StringMapEntry<size_t> StringEntry;
+
+/// Strings tables with at least this many strings are sorted in parallel, and
+/// so are the buckets of at least this many strings within them.
+static const size_t MinParallelSortSize = 1 << 14;
+
+// Returns the character at Pos from the end of a string, or -1 past its
+// beginning.
+static int charTailAt(StringRef S, size_t Pos) {
+  if (Pos >= S.size())
+    return -1;
+  return (unsigned char)S[S.size() - Pos - 1];
+}
+
+static void multikeySort(MutableArrayRef<StringEntry *> Vec, size_t Pos,
+                         TaskGroup *TG);
+
+static void sortBucket(MutableArrayRef<StringEntry *> Vec, size_t Pos,
+                       TaskGroup *TG) {
+  if (TG && Vec.size() >= MinParallelSortSize)
+    TG->spawn([=] { multikeySort(Vec, Pos, TG); });
+  else
+    multikeySort(Vec, Pos, TG);
+}
+
+// Three-way radix quicksort of the strings by their reversed characters, in
+// decreasing order. A string therefore comes right before the strings that
+// are its suffixes, which is what tail merging needs. Unlike a comparison
+// sort, each character is looked at about once per level of the recursion.
+// The buckets are disjoint, so with a task group the large ones are sorted
+// concurrently.
+static void multikeySort(MutableArrayRef<StringEntry *> Vec, size_t Pos,
+                         TaskGroup *TG) {
+  while (Vec.size() > 1) {
+    // Partition the strings so that those in [0, I) are greater than the
+    // pivot at Pos, those in [I, J) are equal to it and those in
+    // [J, Vec.size()) are less than it.
+    int Pivot = charTailAt(Vec[0]->getKey(), Pos);
+    size_t I = 0;
+    size_t J = Vec.size();
+    for (size_t K = 1; K < J;) {
+      int C = charTailAt(Vec[K]->getKey(), Pos);
+      if (C > Pivot)
+        std::swap(Vec[I++], Vec[K++]);
+      else if (C < Pivot)
+        std::swap(Vec[--J], Vec[K]);
+      else
+        K++;
+    }
+
+    sortBucket(Vec.slice(0, I), Pos, TG);
+    sortBucket(Vec.slice(J), Pos, TG);
+
+    // The strings equal to the pivot all end at Pos, and are all different.
+    if (Pivot == -1)
+      return;
+    Vec = Vec.slice(I, J - I);
+    ++Pos;
   }
-  return sizeA > sizeB;
 }
 
 void StringTableBuilder::finalize(Kind kind) {
-  SmallVector<StringRef, 8> Strings;
+  std::vector<StringEntry *> Strings;
   Strings.reserve(StringIndexMap.size());
+  size_t Size = 0;
+  for (StringEntry &E : StringIndexMap) {
+    Strings.push_back(&E);
+    Size += E.getKeyLength() + 1;
+  }
 
-  for (auto i = StringIndexMap.begin(), e = StringIndexMap.end(); i != e; ++i)
-    Strings.push_back(i->getKey());
+  if (Strings.size() >= MinParallelSortSize) {
+    TaskGroup TG(getDefaultThreadPool());
+    multikeySort(Strings, 0, &TG);
+    TG.wait();
+  } else {
+    multikeySort(Strings, 0, nullptr);
+  }
 
-  std::sort(Strings.begin(), Strings.end(), compareBySuffix);
+  // Reserve room for the table without tail merging, plus header and padding.
+  StringTable.reserve(Size + 8);
 
   switch (kind) {
   case ELF:
@@ -49,16 +110,17 @@ void StringTableBuilder::finalize(Kind kind) {
   }
 
   StringRef Previous;
-  for (StringRef s : Strings) {
+  for (StringEntry *E : Strings) {
+    StringRef s = E->getKey();
     if (kind == WinCOFF)
       assert(s.size() > COFF::NameSize && "Short string in COFF string table!");
 
     if (Previous.endswith(s)) {
-      StringIndexMap[s] = StringTable.size() - 1 - s.size();
+      E->second = StringTable.size() - 1 - s.size();
       continue;
     }
 
-    StringIndexMap[s] = StringTable.size();
+    E->second = StringTable.size();
     StringTable += s;
     StringTable += '\x00';
     Previous = s;
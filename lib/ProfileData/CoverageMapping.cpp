@@ -171,6 +171,16 @@ ErrorOr<int64_t> CounterMappingContext::evaluate(const Counter &C) const {
 }
 
 void FunctionRecordIterator::skipOtherFiles() {
+  if (Candidate) {
+    while (Candidate != CandidatesEnd &&
+           Filename != Records[*Candidate].Filenames[0])
+      ++Candidate;
+    if (Candidate == CandidatesEnd)
+      *this = FunctionRecordIterator();
+    else
+      Current = Records.begin() + *Candidate;
+    return;
+  }
   while (Current != Records.end() && !Filename.empty() &&
          Filename != Current->Filenames[0])
     ++Current;
@@ -178,6 +188,25 @@ void FunctionRecordIterator::skipOtherFiles() {
     *this = FunctionRecordIterator();
 }
 
+void CoverageMapping::buildFileIndex() {
+  for (unsigned I = 0, E = Functions.size(); I != E; ++I)
+    for (const auto &Filename : Functions[I].Filenames) {
+      // A file may be listed several times, for instance when it is included
+      // twice.
+      std::vector<unsigned> &Indices = FileFunctions[Filename];
+      if (Indices.empty() || Indices.back() != I)
+        Indices.push_back(I);
+    }
+}
+
+ArrayRef<unsigned>
+CoverageMapping::getFileFunctions(StringRef Filename) const {
+  auto I = FileFunctions.find(Filename);
+  if (I == FileFunctions.end())
+    return None;
+  return I->getValue();
+}
+
 ErrorOr<std::unique_ptr<CoverageMapping>>
 CoverageMapping::load(CoverageMappingReader &CoverageReader,
                       IndexedInstrProfReader &ProfileReader) {
@@ -214,6 +243,7 @@ CoverageMapping::load(CoverageMappingReader &CoverageReader,
     Coverage->Functions.push_back(std::move(Function));
   }
 
+  Coverage->buildFileIndex();
   return std::move(Coverage);
 }
 
@@ -337,12 +367,10 @@ public:
 
 std::vector<StringRef> CoverageMapping::getUniqueSourceFiles() const {
   std::vector<StringRef> Filenames;
-  for (const auto &Function : getCoveredFunctions())
-    Filenames.insert(Filenames.end(), Function.Filenames.begin(),
-                     Function.Filenames.end());
+  Filenames.reserve(FileFunctions.size());
+  for (const auto &File : FileFunctions)
+    Filenames.push_back(File.getKey());
   std::sort(Filenames.begin(), Filenames.end());
-  auto Last = std::unique(Filenames.begin(), Filenames.end());
-  Filenames.erase(Last, Filenames.end());
   return Filenames;
 }
 
@@ -396,11 +424,12 @@ static bool isExpansion(const CountedRegion &R, unsigned FileID) {
   return R.Kind == CounterMappingRegion::ExpansionRegion && R.FileID == FileID;
 }
 
-CoverageData CoverageMapping::getCoverageForFile(StringRef Filename) {
+CoverageData CoverageMapping::getCoverageForFile(StringRef Filename) const {
   CoverageData FileCoverage(Filename);
   std::vector<coverage::CountedRegion> Regions;
 
-  for (const auto &Function : Functions) {
+  for (unsigned Index : getFileFunctions(Filename)) {
+    const FunctionRecord &Function = Functions[Index];
     auto MainFileID = findMainViewFileID(Filename, Function);
     if (!MainFileID)
       continue;
@@ -421,9 +450,10 @@ CoverageData CoverageMapping::getCoverageForFile(StringRef Filename) {
 }
 
 std::vector<const FunctionRecord *>
-CoverageMapping::getInstantiations(StringRef Filename) {
+CoverageMapping::getInstantiations(StringRef Filename) const {
   FunctionInstantiationSetCollector InstantiationSetCollector;
-  for (const auto &Function : Functions) {
+  for (unsigned Index : getFileFunctions(Filename)) {
+    const FunctionRecord &Function = Functions[Index];
     auto MainFileID = findMainViewFileID(Filename, Function);
     if (!MainFileID)
       continue;
@@ -441,7 +471,7 @@ CoverageMapping::getInstantiations(StringRef Filename) {
 }
 
 CoverageData
-CoverageMapping::getCoverageForFunction(const FunctionRecord &Function) {
+CoverageMapping::getCoverageForFunction(const FunctionRecord &Function) const {
   auto MainFileID = findMainViewFileID(Function);
   if (!MainFileID)
     return CoverageData();
@@ -463,7 +493,8 @@ CoverageMapping::getCoverageForFunction(const FunctionRecord &Function) {
 }
 
 CoverageData
-CoverageMapping::getCoverageForExpansion(const ExpansionRecord &Expansion) {
+CoverageMapping::getCoverageForExpansion(
+    const ExpansionRecord &Expansion) const {
   CoverageData ExpansionCoverage(
       Expansion.Function.Filenames[Expansion.FileID]);
   std::vector<coverage::CountedRegion> Regions;
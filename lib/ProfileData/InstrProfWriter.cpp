@@ -75,12 +75,15 @@ std::error_code
 InstrProfWriter::addFunctionCounts(StringRef FunctionName,
                                    uint64_t FunctionHash,
                                    ArrayRef<uint64_t> Counters) {
-  auto &CounterData = FunctionData[FunctionName];
+  auto Entry = FunctionData.insert(std::make_pair(FunctionName, CounterData()));
+  auto &CounterData = Entry.first->getValue();
 
   auto Where = CounterData.find(FunctionHash);
   if (Where == CounterData.end()) {
     // We've never seen a function with this name and hash, add it.
     CounterData[FunctionHash] = Counters;
+    FunctionOrder.push_back(
+        std::make_pair(Entry.first->getKey(), FunctionHash));
     // We keep track of the max function count as we go for simplicity.
     if (Counters[0] > MaxFunctionCount)
       MaxFunctionCount = Counters[0];
@@ -106,6 +109,19 @@ InstrProfWriter::addFunctionCounts(StringRef FunctionName,
   return instrprof_error::success;
 }
 
+std::error_code InstrProfWriter::mergeRecordsFromWriter(InstrProfWriter &&IPW) {
+  std::error_code Result = instrprof_error::success;
+  for (const auto &Function : IPW.FunctionOrder) {
+    const auto &Counters =
+        IPW.FunctionData.find(Function.first)->getValue().find(Function.second);
+    std::error_code EC =
+        addFunctionCounts(Function.first, Function.second, Counters->second);
+    if (EC && !Result)
+      Result = EC;
+  }
+  return Result;
+}
+
 std::pair<uint64_t, uint64_t> InstrProfWriter::writeImpl(raw_ostream &OS) {
   OnDiskChainedHashTableGenerator<InstrProfRecordTrait> Generator;
 
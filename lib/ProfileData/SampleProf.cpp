@@ -38,6 +38,8 @@ class SampleProfErrorCategoryType : public std::error_category {
       return "Malformed profile data";
     case sampleprof_error::unrecognized_format:
       return "Unrecognized profile encoding format";
+    case sampleprof_error::zlib_unavailable:
+      return "Compressed profile data requires zlib";
     }
     llvm_unreachable("A value of sampleprof_error has no message.");
   }
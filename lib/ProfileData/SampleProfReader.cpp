@@ -92,9 +92,42 @@
 //    instruction that calls one of ``foo()``, ``bar()`` and ``baz()``,
 //    with ``baz()`` being the relatively more frequently called target.
 //
+// Indexed binary format
+// ---------------------
+//
+// All numbers are ULEB128 encoded and all strings are NUL terminated. The
+// file starts with a header
+//
+//     magic version flags
+//
+// If the SPIF_Compressed flag is set, the header is followed by the
+// uncompressed size and the compressed size of the rest of the file, and by
+// the zlib compressed data. The whole of it is inflated when the header is
+// read, so a compressed profile trades the memory of the uncompressed data
+// for its smaller size; only the decoding of the unused function profiles is
+// skipped. Once uncompressed, the rest of the file is
+//
+//     num_names name1 name2 ... nameN
+//     num_functions name_index1 offset1 ... name_indexN offsetN
+//     function_profile1 function_profile2 ... function_profileN
+//
+// Every function name, including the names of call targets, is stored once
+// in the name table and referred to by its index. The function index gives
+// the offset of each function profile from the first one, so a reader only
+// decodes the profiles it needs. Each function profile is
+//
+//     total_samples head_samples num_records record1 ... recordN
+//
+// where each record is
+//
+//     line_offset discriminator num_samples num_calls
+//     name_index1 num_samples1 ... name_indexN num_samplesN
+//
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ProfileData/SampleProfReader.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/LEB128.h"
@@ -353,6 +386,194 @@ bool SampleProfileReaderBinary::hasFormat(const MemoryBuffer &Buffer) {
   return Magic == SPMagic();
 }
 
+std::error_code SampleProfileReaderIndexed::readHeader() {
+  Data = reinterpret_cast<const uint8_t *>(Buffer->getBufferStart());
+  End = Data + Buffer->getBufferSize();
+
+  auto Magic = readNumber<uint64_t>();
+  if (std::error_code EC = Magic.getError())
+    return EC;
+  else if (*Magic != SPIndexedMagic())
+    return sampleprof_error::bad_magic;
+
+  auto Version = readNumber<uint64_t>();
+  if (std::error_code EC = Version.getError())
+    return EC;
+  else if (*Version != SPIndexedVersion())
+    return sampleprof_error::unsupported_version;
+
+  auto Flags = readNumber<uint64_t>();
+  if (std::error_code EC = Flags.getError())
+    return EC;
+  if (*Flags & ~uint64_t(SPIF_Compressed))
+    return sampleprof_error::malformed;
+
+  if (*Flags & SPIF_Compressed) {
+    if (!zlib::isAvailable())
+      return sampleprof_error::zlib_unavailable;
+    auto UncompressedSize = readNumber<size_t>();
+    if (std::error_code EC = UncompressedSize.getError())
+      return EC;
+    auto CompressedSize = readNumber<size_t>();
+    if (std::error_code EC = CompressedSize.getError())
+      return EC;
+    if (*CompressedSize > size_t(End - Data))
+      return sampleprof_error::truncated;
+    // zlib never expands data by more than a factor of 1032, so a larger
+    // size can only come from a corrupt file.
+    if (*UncompressedSize / 1032 > *CompressedSize)
+      return sampleprof_error::malformed;
+    StringRef Compressed(reinterpret_cast<const char *>(Data),
+                         *CompressedSize);
+    if (zlib::uncompress(Compressed, Uncompressed, *UncompressedSize) !=
+        zlib::StatusOK)
+      return sampleprof_error::malformed;
+    // Strings are read up to their terminating NUL, make sure there is one
+    // past the end of the data.
+    Uncompressed.push_back(0);
+    Data = reinterpret_cast<const uint8_t *>(Uncompressed.data());
+    End = Data + *UncompressedSize;
+  }
+
+  // Read the name table.
+  auto NumNames = readNumber<uint32_t>();
+  if (std::error_code EC = NumNames.getError())
+    return EC;
+  // Every name takes at least its terminating NUL, so do not trust a count
+  // that the rest of the data cannot hold.
+  if (*NumNames > uint64_t(End - Data))
+    return sampleprof_error::truncated;
+  NameTable.reserve(*NumNames);
+  for (uint32_t I = 0; I < *NumNames; ++I) {
+    auto Name = readString();
+    if (std::error_code EC = Name.getError())
+      return EC;
+    NameTable.push_back(*Name);
+  }
+
+  // Read the function index.
+  auto NumFunctions = readNumber<uint32_t>();
+  if (std::error_code EC = NumFunctions.getError())
+    return EC;
+  // Every entry takes at least two bytes.
+  if (*NumFunctions > uint64_t(End - Data) / 2)
+    return sampleprof_error::truncated;
+  FunctionIndex.reserve(*NumFunctions);
+  for (uint32_t I = 0; I < *NumFunctions; ++I) {
+    auto NameIdx = readNumber<uint32_t>();
+    if (std::error_code EC = NameIdx.getError())
+      return EC;
+    auto Offset = readNumber<uint64_t>();
+    if (std::error_code EC = Offset.getError())
+      return EC;
+    if (*NameIdx >= NameTable.size()) {
+      reportParseError(0, "Function name index out of range");
+      return sampleprof_error::malformed;
+    }
+    FunctionIndex.push_back(std::make_pair(*NameIdx, *Offset));
+  }
+
+  BodiesStart = Data;
+  return sampleprof_error::success;
+}
+
+ErrorOr<StringRef> SampleProfileReaderIndexed::readNameRef() {
+  auto Idx = readNumber<uint32_t>();
+  if (std::error_code EC = Idx.getError())
+    return EC;
+  if (*Idx >= NameTable.size()) {
+    reportParseError(0, "Function name index out of range");
+    return sampleprof_error::malformed;
+  }
+  return NameTable[*Idx];
+}
+
+std::error_code
+SampleProfileReaderIndexed::readFunctionProfile(FunctionSamples &FProfile) {
+  auto Val = readNumber<unsigned>();
+  if (std::error_code EC = Val.getError())
+    return EC;
+  FProfile.addTotalSamples(*Val);
+
+  Val = readNumber<unsigned>();
+  if (std::error_code EC = Val.getError())
+    return EC;
+  FProfile.addHeadSamples(*Val);
+
+  auto NumRecords = readNumber<unsigned>();
+  if (std::error_code EC = NumRecords.getError())
+    return EC;
+  for (unsigned I = 0; I < *NumRecords; ++I) {
+    auto LineOffset = readNumber<uint64_t>();
+    if (std::error_code EC = LineOffset.getError())
+      return EC;
+
+    auto Discriminator = readNumber<uint64_t>();
+    if (std::error_code EC = Discriminator.getError())
+      return EC;
+
+    auto NumSamples = readNumber<uint64_t>();
+    if (std::error_code EC = NumSamples.getError())
+      return EC;
+
+    auto NumCalls = readNumber<unsigned>();
+    if (std::error_code EC = NumCalls.getError())
+      return EC;
+
+    for (unsigned J = 0; J < *NumCalls; ++J) {
+      auto CalledFunction = readNameRef();
+      if (std::error_code EC = CalledFunction.getError())
+        return EC;
+
+      auto CalledFunctionSamples = readNumber<uint64_t>();
+      if (std::error_code EC = CalledFunctionSamples.getError())
+        return EC;
+
+      FProfile.addCalledTargetSamples(*LineOffset, *Discriminator,
+                                      *CalledFunction, *CalledFunctionSamples);
+    }
+
+    FProfile.addBodySamples(*LineOffset, *Discriminator, *NumSamples);
+  }
+
+  return sampleprof_error::success;
+}
+
+std::error_code SampleProfileReaderIndexed::read() {
+  for (const auto &Entry : FunctionIndex) {
+    StringRef FName = NameTable[Entry.first];
+    if (!UseAllFunctions && !FuncsToUse.count(FName))
+      continue;
+
+    if (Entry.second >= uint64_t(End - BodiesStart)) {
+      reportParseError(0, "Function profile offset out of range");
+      return sampleprof_error::malformed;
+    }
+    Data = BodiesStart + Entry.second;
+
+    Profiles[FName] = FunctionSamples();
+    if (std::error_code EC = readFunctionProfile(Profiles[FName]))
+      return EC;
+  }
+
+  return sampleprof_error::success;
+}
+
+void SampleProfileReaderIndexed::collectFuncsToUse(const Module &M) {
+  UseAllFunctions = false;
+  FuncsToUse.clear();
+  for (const auto &F : M)
+    if (!F.isDeclaration())
+      FuncsToUse.insert(F.getName());
+}
+
+bool SampleProfileReaderIndexed::hasFormat(const MemoryBuffer &Buffer) {
+  const uint8_t *Data =
+      reinterpret_cast<const uint8_t *>(Buffer.getBufferStart());
+  uint64_t Magic = decodeULEB128(Data);
+  return Magic == SPIndexedMagic();
+}
+
 /// \brief Prepare a memory buffer for the contents of \p Filename.
 ///
 /// \returns an error code indicating the status of the buffer.
@@ -387,7 +608,9 @@ SampleProfileReader::create(StringRef Filename, LLVMContext &C) {
 
   auto Buffer = std::move(BufferOrError.get());
   std::unique_ptr<SampleProfileReader> Reader;
-  if (SampleProfileReaderBinary::hasFormat(*Buffer))
+  if (SampleProfileReaderIndexed::hasFormat(*Buffer))
+    Reader.reset(new SampleProfileReaderIndexed(std::move(Buffer), C));
+  else if (SampleProfileReaderBinary::hasFormat(*Buffer))
     Reader.reset(new SampleProfileReaderBinary(std::move(Buffer), C));
   else
     Reader.reset(new SampleProfileReaderText(std::move(Buffer), C));
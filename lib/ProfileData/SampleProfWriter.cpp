@@ -8,10 +8,11 @@
 //===----------------------------------------------------------------------===//
 //
 // This file implements the class that writes LLVM sample profiles. It
-// supports two file formats: text and binary. The textual representation
-// is useful for debugging and testing purposes. The binary representation
-// is more compact, resulting in smaller file sizes. However, they can
-// both be used interchangeably.
+// supports three file formats: text, binary and indexed binary. The textual
+// representation is useful for debugging and testing purposes. The binary
+// representations are more compact, resulting in smaller file sizes, and the
+// indexed one can be loaded one function at a time. However, they can all be
+// used interchangeably.
 //
 // See lib/ProfileData/SampleProfReader.cpp for documentation on each of the
 // supported formats.
@@ -19,6 +20,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ProfileData/SampleProfWriter.h"
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/LEB128.h"
@@ -98,6 +100,85 @@ bool SampleProfileWriterBinary::write(StringRef FName,
   return true;
 }
 
+SampleProfileWriterIndexed::SampleProfileWriterIndexed(StringRef F,
+                                                       std::error_code &EC,
+                                                       bool Compress)
+    : SampleProfileWriter(F, EC, sys::fs::F_None), Compress(Compress) {}
+
+uint32_t SampleProfileWriterIndexed::getNameIndex(StringRef Name) {
+  auto Entry = NameIndex.insert(std::make_pair(Name, NameTable.size()));
+  if (Entry.second)
+    NameTable.push_back(Entry.first->getKey());
+  return Entry.first->getValue();
+}
+
+/// \brief Encode the samples of a function into the buffered profiles.
+///
+/// \returns true if the samples were encoded successfully, false otherwise.
+bool SampleProfileWriterIndexed::write(StringRef FName,
+                                       const FunctionSamples &S) {
+  if (S.empty())
+    return true;
+
+  FunctionIndex.push_back(std::make_pair(getNameIndex(FName), Bodies.size()));
+  raw_string_ostream BodiesOS(Bodies);
+  encodeULEB128(S.getTotalSamples(), BodiesOS);
+  encodeULEB128(S.getHeadSamples(), BodiesOS);
+  encodeULEB128(S.getBodySamples().size(), BodiesOS);
+  for (const auto &I : S.getBodySamples()) {
+    LineLocation Loc = I.first;
+    const SampleRecord &Sample = I.second;
+    encodeULEB128(Loc.LineOffset, BodiesOS);
+    encodeULEB128(Loc.Discriminator, BodiesOS);
+    encodeULEB128(Sample.getSamples(), BodiesOS);
+    encodeULEB128(Sample.getCallTargets().size(), BodiesOS);
+    for (const auto &J : Sample.getCallTargets()) {
+      encodeULEB128(getNameIndex(J.first()), BodiesOS);
+      encodeULEB128(J.second, BodiesOS);
+    }
+  }
+
+  return true;
+}
+
+/// \brief Write the header, the name table, the function index and the
+/// buffered profiles to the file.
+///
+/// \returns true if the file was written successfully, false otherwise.
+bool SampleProfileWriterIndexed::finalize() {
+  std::string Contents;
+  raw_string_ostream ContentsOS(Contents);
+  encodeULEB128(NameTable.size(), ContentsOS);
+  for (StringRef Name : NameTable) {
+    ContentsOS << Name;
+    encodeULEB128(0, ContentsOS);
+  }
+  encodeULEB128(FunctionIndex.size(), ContentsOS);
+  for (const auto &Entry : FunctionIndex) {
+    encodeULEB128(Entry.first, ContentsOS);
+    encodeULEB128(Entry.second, ContentsOS);
+  }
+  ContentsOS << Bodies;
+  ContentsOS.flush();
+
+  encodeULEB128(SPIndexedMagic(), OS);
+  encodeULEB128(SPIndexedVersion(), OS);
+  if (!Compress) {
+    encodeULEB128(0, OS);
+    OS << Contents;
+    return true;
+  }
+
+  SmallVector<char, 0> Compressed;
+  if (zlib::compress(Contents, Compressed) != zlib::StatusOK)
+    return false;
+  encodeULEB128(SPIF_Compressed, OS);
+  encodeULEB128(Contents.size(), OS);
+  encodeULEB128(Compressed.size(), OS);
+  OS.write(Compressed.data(), Compressed.size());
+  return true;
+}
+
 /// \brief Create a sample profile writer based on the specified format.
 ///
 /// \param Filename The file to create.
@@ -106,13 +187,21 @@ bool SampleProfileWriterBinary::write(StringRef FName,
 ///
 /// \param Format Encoding format for the profile file.
 ///
+/// \param Compress Whether to compress the profile file. Only the indexed
+/// format supports compression.
+///
 /// \returns an error code indicating the status of the created writer.
 ErrorOr<std::unique_ptr<SampleProfileWriter>>
-SampleProfileWriter::create(StringRef Filename, SampleProfileFormat Format) {
+SampleProfileWriter::create(StringRef Filename, SampleProfileFormat Format,
+                            bool Compress) {
   std::error_code EC;
   std::unique_ptr<SampleProfileWriter> Writer;
 
-  if (Format == SPF_Binary)
+  if (Compress && Format == SPF_Indexed && !zlib::isAvailable())
+    EC = sampleprof_error::zlib_unavailable;
+  else if (Format == SPF_Indexed)
+    Writer.reset(new SampleProfileWriterIndexed(Filename, EC, Compress));
+  else if (Format == SPF_Binary)
     Writer.reset(new SampleProfileWriterBinary(Filename, EC));
   else if (Format == SPF_Text)
     Writer.reset(new SampleProfileWriterText(Filename, EC));
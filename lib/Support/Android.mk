@@ -26,6 +26,7 @@ support_SRC_FILES := \
   DynamicLibrary.cpp \
   Errno.cpp \
   ErrorHandling.cpp \
+  FileCache.cpp \
   FileUtilities.cpp \
   FoldingSet.cpp \
   FormattedStream.cpp \
@@ -47,6 +48,7 @@ support_SRC_FILES := \
   MemoryObject.cpp \
   Mutex.cpp \
   Options.cpp \
+  Parallel.cpp \
   Path.cpp \
   PluginLoader.cpp \
   PrettyStackTrace.cpp \
@@ -72,6 +74,8 @@ support_SRC_FILES := \
   TargetRegistry.cpp \
   Threading.cpp \
   ThreadLocal.cpp \
+  ThreadPool.cpp \
+  TimeProfiler.cpp \
   Timer.cpp \
   TimeValue.cpp \
   ToolOutputFile.cpp \
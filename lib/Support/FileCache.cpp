@@ -0,0 +1,189 @@
+//===- FileCache.cpp - Content-addressed on-disk file cache ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the content-addressed on-disk file cache.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/FileCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <tuple>
+#include <vector>
+using namespace llvm;
+
+/// Entries are named "llvmcache-<key>". Other files in the directory, such as
+/// the pruning timestamp and lock, start with "llvmcache." and are never
+/// pruned.
+static const char EntryPrefix[] = "llvmcache-";
+
+FileCacheKeyBuilder::FileCacheKeyBuilder() {
+  // A different compiler generates different code.
+#ifdef LLVM_VERSION_INFO
+  add(PACKAGE_NAME " version " PACKAGE_VERSION ", " LLVM_VERSION_INFO);
+#else
+  add(PACKAGE_NAME " version " PACKAGE_VERSION);
+#endif
+}
+
+void FileCacheKeyBuilder::add(StringRef Data) {
+  // Prefix the data with its size, so that consecutive strings cannot be
+  // confused with a different split of the same characters.
+  add(uint64_t(Data.size()));
+  Hasher.update(Data);
+}
+
+void FileCacheKeyBuilder::add(uint64_t Value) {
+  uint8_t Data[8];
+  support::endian::write64le(Data, Value);
+  Hasher.update(Data);
+}
+
+std::string FileCacheKeyBuilder::getKey() {
+  MD5::MD5Result Result;
+  Hasher.final(Result);
+  SmallString<32> Key;
+  MD5::stringifyResult(Result, Key);
+  return Key.str();
+}
+
+FileCache::FileCache()
+    : PruningInterval(20 * 60), Expiration(7 * 24 * 60 * 60), MaxSize(0) {}
+
+std::string FileCache::getEntryPath(StringRef Key) const {
+  SmallString<128> EntryPath(Path);
+  sys::path::append(EntryPath, EntryPrefix + Key);
+  return EntryPath.str();
+}
+
+std::unique_ptr<MemoryBuffer> FileCache::lookup(StringRef Key) const {
+  if (!isEnabled())
+    return nullptr;
+
+  std::string EntryPath = getEntryPath(Key);
+  int FD;
+  if (sys::fs::openFileForRead(EntryPath, FD))
+    return nullptr;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+      MemoryBuffer::getOpenFile(FD, EntryPath, -1,
+                                /*RequiresNullTerminator=*/false);
+
+  // The modification time of an entry is the time it was last used, which
+  // pruning relies on.
+  if (BufferOrErr)
+    sys::fs::setLastModificationAndAccessTime(FD, sys::TimeValue::now());
+  sys::Process::SafelyCloseFileDescriptor(FD);
+  if (!BufferOrErr)
+    return nullptr;
+  return std::move(*BufferOrErr);
+}
+
+void FileCache::store(StringRef Key, StringRef Data) const {
+  if (!isEnabled() || sys::fs::create_directories(Path))
+    return;
+
+  // Write to a temporary file first and rename it: the rename is atomic, so
+  // concurrent lookups see either no entry or a complete one.
+  SmallString<128> TempPath(Path);
+  sys::path::append(TempPath, "llvmcache.tmp-%%%%%%%%");
+  int FD;
+  if (sys::fs::createUniqueFile(TempPath, FD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Data;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath);
+      return;
+    }
+  }
+  if (sys::fs::rename(TempPath, getEntryPath(Key)))
+    sys::fs::remove(TempPath);
+}
+
+bool FileCache::prune() const {
+  if (!isEnabled() || PruningInterval < 0 || (!Expiration && !MaxSize))
+    return false;
+
+  // Skip pruning if it was done recently. The timestamp file records when.
+  SmallString<128> TimestampPath(Path);
+  sys::path::append(TimestampPath, "llvmcache.timestamp");
+  sys::TimeValue Now = sys::TimeValue::now();
+  sys::fs::file_status TimestampStatus;
+  if (!sys::fs::status(TimestampPath, TimestampStatus) &&
+      Now.seconds() - TimestampStatus.getLastModificationTime().seconds() <
+          PruningInterval)
+    return false;
+
+  // Only one process prunes at a time; the others carry on without waiting.
+  LockFileManager Lock(TimestampPath);
+  if (Lock.getState() != LockFileManager::LFS_Owned)
+    return false;
+
+  {
+    int FD;
+    if (sys::fs::openFileForWrite(TimestampPath, FD, sys::fs::F_None))
+      return false;
+    sys::fs::setLastModificationAndAccessTime(FD, Now);
+    sys::Process::SafelyCloseFileDescriptor(FD);
+  }
+
+  // Remove the expired entries and collect the others, along with their
+  // last use and size.
+  std::vector<std::tuple<sys::TimeValue::SecondsType, uint64_t, std::string>>
+      Entries;
+  uint64_t TotalSize = 0;
+  std::error_code EC;
+  for (sys::fs::directory_iterator File(Path, EC), FileEnd;
+       File != FileEnd && !EC; File.increment(EC)) {
+    StringRef Filename = sys::path::filename(File->path());
+    bool IsEntry = Filename.startswith(EntryPrefix);
+    // Temporary files left behind by a crashed process are removed once they
+    // are older than the expiration time.
+    if (!IsEntry && !Filename.startswith("llvmcache.tmp-"))
+      continue;
+
+    sys::fs::file_status Status;
+    if (File->status(Status))
+      continue;
+    sys::TimeValue::SecondsType LastUse =
+        Status.getLastModificationTime().seconds();
+    if (Expiration && Now.seconds() - LastUse > Expiration) {
+      sys::fs::remove(File->path());
+      continue;
+    }
+    if (!IsEntry)
+      continue;
+    TotalSize += Status.getSize();
+    Entries.push_back(std::make_tuple(LastUse, Status.getSize(),
+                                      File->path()));
+  }
+
+  // Remove the least recently used entries until the rest fits.
+  if (MaxSize && TotalSize > MaxSize) {
+    std::sort(Entries.begin(), Entries.end());
+    for (const auto &Entry : Entries) {
+      if (TotalSize <= MaxSize)
+        break;
+      if (!sys::fs::remove(std::get<2>(Entry)))
+        TotalSize -= std::get<1>(Entry);
+    }
+  }
+  return true;
+}
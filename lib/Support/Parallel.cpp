@@ -0,0 +1,21 @@
+//===-- llvm/Support/Parallel.cpp - Parallel algorithms -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the thread pool shared by the parallel algorithms.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/ManagedStatic.h"
+
+using namespace llvm;
+
+static ManagedStatic<ThreadPool> DefaultThreadPool;
+
+ThreadPool &llvm::getDefaultThreadPool() { return *DefaultThreadPool; }
@@ -0,0 +1,229 @@
+//===-- llvm/Support/ThreadPool.cpp - A pool of worker threads ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ThreadPool and TaskGroup classes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Compiler.h"
+#include <algorithm>
+#include <cassert>
+#include <deque>
+
+using namespace llvm;
+
+static unsigned getDefaultThreadCount() {
+  // hardware_concurrency() returns 0 when the number is unknown.
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+ThreadPool::ThreadPool() : ThreadPool(getDefaultThreadCount()) {}
+
+#if LLVM_ENABLE_THREADS
+
+struct ThreadPool::WorkerQueue {
+  WorkerQueue(ThreadPool &Pool, unsigned Index) : Pool(Pool), Index(Index) {}
+
+  ThreadPool &Pool;
+  unsigned Index;
+  std::mutex Lock;
+  std::deque<TaskTy> Tasks;
+};
+
+/// The queue of the worker running on this thread, if any.
+static LLVM_THREAD_LOCAL void *CurrentQueue = nullptr;
+
+ThreadPool::ThreadPool(unsigned ThreadCount)
+    : NextQueue(0), QueuedTasks(0), PendingTasks(0), Stopping(false),
+      ThreadCount(std::max(1u, ThreadCount)) {
+  for (unsigned I = 0; I != this->ThreadCount; ++I)
+    Queues.push_back(llvm::make_unique<WorkerQueue>(*this, I));
+  // Only start the workers once all the queues exist, since they steal from
+  // each other.
+  Threads.reserve(this->ThreadCount);
+  for (unsigned I = 0; I != this->ThreadCount; ++I)
+    Threads.emplace_back([this, I] { runWorker(I); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> LockGuard(SleepLock);
+    Stopping = true;
+  }
+  SleepCondition.notify_all();
+  for (std::thread &Worker : Threads)
+    Worker.join();
+}
+
+std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
+  // std::function must be copyable, but a std::packaged_task is not.
+  auto PackagedTask =
+      std::make_shared<std::packaged_task<void()>>(std::move(Task));
+  std::shared_future<void> Future = PackagedTask->get_future().share();
+  enqueue([PackagedTask] { (*PackagedTask)(); });
+  return Future;
+}
+
+void ThreadPool::enqueue(TaskTy Task) {
+  WorkerQueue *Queue = static_cast<WorkerQueue *>(CurrentQueue);
+  if (!Queue || &Queue->Pool != this)
+    Queue = Queues[NextQueue++ % Queues.size()].get();
+
+  ++PendingTasks;
+  {
+    std::lock_guard<std::mutex> QueueGuard(Queue->Lock);
+    Queue->Tasks.push_back(std::move(Task));
+    // Count the task before it can be taken, so that the count never drops
+    // below zero.
+    std::lock_guard<std::mutex> SleepGuard(SleepLock);
+    ++QueuedTasks;
+  }
+  SleepCondition.notify_one();
+}
+
+bool ThreadPool::takeTask(WorkerQueue *Own, TaskTy &Task) {
+  if (Own) {
+    std::lock_guard<std::mutex> LockGuard(Own->Lock);
+    if (!Own->Tasks.empty()) {
+      Task = std::move(Own->Tasks.back());
+      Own->Tasks.pop_back();
+      --QueuedTasks;
+      return true;
+    }
+  }
+
+  // Start with the next worker, so that thieves spread over the queues.
+  unsigned Start = Own ? Own->Index + 1 : 0;
+  for (unsigned I = 0, E = Queues.size(); I != E; ++I) {
+    WorkerQueue &Victim = *Queues[(Start + I) % E];
+    if (&Victim == Own)
+      continue;
+    std::lock_guard<std::mutex> LockGuard(Victim.Lock);
+    if (!Victim.Tasks.empty()) {
+      Task = std::move(Victim.Tasks.front());
+      Victim.Tasks.pop_front();
+      --QueuedTasks;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::runTask(TaskTy &Task) {
+  Task();
+  if (--PendingTasks == 0) {
+    // Taking the lock makes sure that wait() is either before its check of
+    // the count or already asleep.
+    std::lock_guard<std::mutex> LockGuard(CompletionLock);
+    CompletionCondition.notify_all();
+  }
+}
+
+bool ThreadPool::runPendingTask() {
+  WorkerQueue *Own = static_cast<WorkerQueue *>(CurrentQueue);
+  if (Own && &Own->Pool != this)
+    Own = nullptr;
+  TaskTy Task;
+  if (!takeTask(Own, Task))
+    return false;
+  runTask(Task);
+  return true;
+}
+
+void ThreadPool::runWorker(unsigned Index) {
+  WorkerQueue *Own = Queues[Index].get();
+  CurrentQueue = Own;
+  while (true) {
+    TaskTy Task;
+    if (takeTask(Own, Task)) {
+      runTask(Task);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> LockGuard(SleepLock);
+    SleepCondition.wait(LockGuard,
+                        [&] { return Stopping || QueuedTasks != 0; });
+    if (Stopping && QueuedTasks == 0)
+      return;
+  }
+}
+
+void ThreadPool::wait() {
+  assert((!CurrentQueue ||
+          &static_cast<WorkerQueue *>(CurrentQueue)->Pool != this) &&
+         "a task cannot wait for the pool it runs on");
+  std::unique_lock<std::mutex> LockGuard(CompletionLock);
+  CompletionCondition.wait(LockGuard, [&] { return PendingTasks == 0; });
+}
+
+void TaskGroup::spawn(ThreadPool::TaskTy Task) {
+  ++PendingTasks;
+  Pool.enqueue([this, Task] {
+    Task();
+    if (--PendingTasks == 0) {
+      // Waiters sleep with the workers until there is a task to run or the
+      // group is done. Taking the lock makes sure that a waiter is either
+      // before its check of the count or already asleep.
+      std::lock_guard<std::mutex> LockGuard(Pool.SleepLock);
+      Pool.SleepCondition.notify_all();
+    }
+  });
+}
+
+void TaskGroup::wait() {
+  // The tasks of the group may be waiting in a queue behind other tasks, or
+  // may spawn more tasks, so help the workers while there is work to take.
+  // Otherwise sleep until the group is done or a task is queued.
+  while (PendingTasks != 0) {
+    if (Pool.runPendingTask())
+      continue;
+    std::unique_lock<std::mutex> LockGuard(Pool.SleepLock);
+    Pool.SleepCondition.wait(LockGuard, [&] {
+      return PendingTasks == 0 || Pool.QueuedTasks != 0;
+    });
+  }
+}
+
+#else // !LLVM_ENABLE_THREADS
+
+ThreadPool::ThreadPool(unsigned ThreadCount) : ThreadCount(1) {}
+
+ThreadPool::~ThreadPool() { wait(); }
+
+std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
+  std::shared_future<void> Future =
+      std::async(std::launch::deferred, std::move(Task)).share();
+  DeferredTasks.push_back(Future);
+  return Future;
+}
+
+void ThreadPool::enqueue(TaskTy Task) { asyncImpl(std::move(Task)); }
+
+bool ThreadPool::runPendingTask() {
+  if (DeferredTasks.empty())
+    return false;
+  std::shared_future<void> Future = DeferredTasks.front();
+  DeferredTasks.erase(DeferredTasks.begin());
+  Future.get();
+  return true;
+}
+
+void ThreadPool::wait() {
+  // A task may queue more tasks, so take them one at a time.
+  while (runPendingTask())
+    ;
+}
+
+void TaskGroup::spawn(ThreadPool::TaskTy Task) { Task(); }
+
+void TaskGroup::wait() {}
+
+#endif
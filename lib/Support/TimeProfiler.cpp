@@ -0,0 +1,258 @@
+//===- TimeProfiler.cpp - Hierarchical time trace -------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the time trace profiler.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+typedef std::chrono::steady_clock ClockType;
+typedef std::chrono::time_point<ClockType> TimePointType;
+typedef std::chrono::microseconds DurationType;
+
+struct Entry {
+  TimePointType Start;
+  DurationType Duration;
+  std::string Name;
+  std::string Detail;
+
+  Entry(TimePointType Start, StringRef Name, std::string Detail)
+      : Start(Start), Duration(0), Name(Name), Detail(std::move(Detail)) {}
+};
+
+/// The events of one thread. Only that thread touches them until the trace
+/// is written.
+struct ThreadEvents {
+  explicit ThreadEvents(unsigned Tid) : Tid(Tid) {}
+
+  unsigned Tid;
+  std::vector<Entry> Stack;
+  std::vector<Entry> Entries;
+  /// The number of events and their total duration, by name. Events nested
+  /// in an event of the same name are not counted again.
+  StringMap<std::pair<size_t, DurationType>> CountAndTotalPerName;
+};
+} // End anonymous namespace
+
+struct llvm::TimeTraceProfiler {
+  TimeTraceProfiler(unsigned Granularity, StringRef ProcName)
+      : StartTime(ClockType::now()),
+        BeginningOfTime(std::chrono::system_clock::now()),
+        Granularity(Granularity), ProcName(ProcName) {}
+
+  ThreadEvents &getThreadEvents();
+  void begin(StringRef Name, std::string Detail);
+  void end();
+  void write(raw_ostream &OS);
+
+  const TimePointType StartTime;
+  const std::chrono::time_point<std::chrono::system_clock> BeginningOfTime;
+  const DurationType Granularity;
+  const std::string ProcName;
+
+  std::mutex Lock;
+  std::vector<std::unique_ptr<ThreadEvents>> Threads;
+};
+
+TimeTraceProfiler *llvm::TimeTraceProfilerInstance = nullptr;
+
+/// Each profiler gets a new generation, so that a thread never uses the events
+/// of a profiler that has been cleaned up.
+static std::atomic<unsigned> ProfilerGeneration(0);
+static LLVM_THREAD_LOCAL ThreadEvents *CurrentThreadEvents = nullptr;
+static LLVM_THREAD_LOCAL unsigned CurrentThreadGeneration = 0;
+
+ThreadEvents &TimeTraceProfiler::getThreadEvents() {
+  unsigned Generation = ProfilerGeneration;
+  if (CurrentThreadEvents && CurrentThreadGeneration == Generation)
+    return *CurrentThreadEvents;
+
+  std::lock_guard<std::mutex> LockGuard(Lock);
+  Threads.push_back(llvm::make_unique<ThreadEvents>(Threads.size() + 1));
+  CurrentThreadEvents = Threads.back().get();
+  CurrentThreadGeneration = Generation;
+  return *CurrentThreadEvents;
+}
+
+void TimeTraceProfiler::begin(StringRef Name, std::string Detail) {
+  getThreadEvents().Stack.emplace_back(ClockType::now(), Name,
+                                       std::move(Detail));
+}
+
+void TimeTraceProfiler::end() {
+  ThreadEvents &Events = getThreadEvents();
+  // The event may have begun before the profiler was initialized.
+  if (Events.Stack.empty())
+    return;
+  Entry &E = Events.Stack.back();
+  E.Duration = std::chrono::duration_cast<DurationType>(ClockType::now() -
+                                                        E.Start);
+
+  // Only count the outermost event of each name, so that recursion does not
+  // inflate the total.
+  if (std::find_if(Events.Stack.begin(), Events.Stack.end() - 1,
+                   [&](const Entry &Outer) { return Outer.Name == E.Name; }) ==
+      Events.Stack.end() - 1) {
+    std::pair<size_t, DurationType> &CountAndTotal =
+        Events.CountAndTotalPerName[E.Name];
+    ++CountAndTotal.first;
+    CountAndTotal.second += E.Duration;
+  }
+
+  if (E.Duration >= Granularity)
+    Events.Entries.push_back(std::move(E));
+  Events.Stack.pop_back();
+}
+
+static void writeJSONString(raw_ostream &OS, StringRef Str) {
+  OS << '"';
+  for (unsigned char C : Str) {
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << format("\\u%04x", C);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+static void writeEvent(raw_ostream &OS, unsigned Tid, int64_t Start,
+                       int64_t Duration, StringRef Name, StringRef Detail) {
+  OS << "{\"pid\":1,\"tid\":" << Tid << ",\"ph\":\"X\",\"ts\":" << Start
+     << ",\"dur\":" << Duration << ",\"name\":";
+  writeJSONString(OS, Name);
+  if (!Detail.empty()) {
+    OS << ",\"args\":{\"detail\":";
+    writeJSONString(OS, Detail);
+    OS << '}';
+  }
+  OS << "},\n";
+}
+
+static void writeMetadataEvent(raw_ostream &OS, unsigned Tid, StringRef Kind,
+                               StringRef Name) {
+  OS << "{\"pid\":1,\"tid\":" << Tid << ",\"ph\":\"M\",\"ts\":0,\"name\":\""
+     << Kind << "\",\"args\":{\"name\":";
+  writeJSONString(OS, Name);
+  OS << "}},\n";
+}
+
+void TimeTraceProfiler::write(raw_ostream &OS) {
+  OS << "{\"traceEvents\":[\n";
+
+  StringMap<std::pair<size_t, DurationType>> AllCountAndTotalPerName;
+  for (const std::unique_ptr<ThreadEvents> &Events : Threads) {
+    assert(Events->Stack.empty() && "cannot write a trace with open events");
+    for (const Entry &E : Events->Entries)
+      writeEvent(OS, Events->Tid,
+                 std::chrono::duration_cast<DurationType>(E.Start - StartTime)
+                     .count(),
+                 E.Duration.count(), E.Name, E.Detail);
+    for (const auto &Total : Events->CountAndTotalPerName) {
+      std::pair<size_t, DurationType> &AllTotal =
+          AllCountAndTotalPerName[Total.getKey()];
+      AllTotal.first += Total.getValue().first;
+      AllTotal.second += Total.getValue().second;
+    }
+  }
+
+  // Show the totals on a thread of their own, longest first and all starting
+  // at zero, so that they read like a bar chart.
+  typedef std::pair<std::string, std::pair<size_t, DurationType>> NameAndTotal;
+  std::vector<NameAndTotal> Totals;
+  for (const auto &Total : AllCountAndTotalPerName)
+    Totals.emplace_back(Total.getKey(), Total.getValue());
+  std::sort(Totals.begin(), Totals.end(),
+            [](const NameAndTotal &A, const NameAndTotal &B) {
+              if (A.second.second != B.second.second)
+                return A.second.second > B.second.second;
+              return A.first < B.first;
+            });
+  unsigned TotalsTid = Threads.size() + 1;
+  for (const auto &Total : Totals) {
+    std::string Detail;
+    raw_string_ostream(Detail) << Total.second.first << " events";
+    writeEvent(OS, TotalsTid, 0, Total.second.second.count(),
+               "Total " + Total.first, Detail);
+  }
+
+  writeMetadataEvent(OS, 0, "process_name", ProcName);
+  for (const std::unique_ptr<ThreadEvents> &Events : Threads)
+    writeMetadataEvent(OS, Events->Tid, "thread_name",
+                       "Thread " + utostr(Events->Tid));
+  writeMetadataEvent(OS, TotalsTid, "thread_name", "Totals");
+
+  // The trace format allows neither a trailing comma nor an empty element, so
+  // end the list with the instant at which the profiler started.
+  OS << "{\"pid\":1,\"tid\":0,\"ph\":\"i\",\"s\":\"g\",\"ts\":0,"
+        "\"name\":\"Start\"}\n";
+  OS << "],\n\"beginningOfTime\":"
+     << std::chrono::duration_cast<DurationType>(
+            BeginningOfTime.time_since_epoch()).count()
+     << "}\n";
+}
+
+void llvm::timeTraceProfilerInitialize(unsigned Granularity,
+                                       StringRef ProcName) {
+  assert(!TimeTraceProfilerInstance && "profiler is already initialized");
+  ++ProfilerGeneration;
+  TimeTraceProfilerInstance = new TimeTraceProfiler(Granularity, ProcName);
+}
+
+void llvm::timeTraceProfilerCleanup() {
+  delete TimeTraceProfilerInstance;
+  TimeTraceProfilerInstance = nullptr;
+}
+
+void llvm::timeTraceProfilerWrite(raw_ostream &OS) {
+  assert(TimeTraceProfilerInstance && "profiler is not initialized");
+  TimeTraceProfilerInstance->write(OS);
+}
+
+std::error_code llvm::timeTraceProfilerWrite(StringRef Path) {
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::F_Text);
+  if (EC)
+    return EC;
+  timeTraceProfilerWrite(OS);
+  return std::error_code();
+}
+
+void llvm::timeTraceProfilerBegin(StringRef Name, StringRef Detail) {
+  if (TimeTraceProfilerInstance)
+    TimeTraceProfilerInstance->begin(Name, Detail);
+}
+
+void llvm::timeTraceProfilerBegin(StringRef Name,
+                                  function_ref<std::string()> Detail) {
+  if (TimeTraceProfilerInstance)
+    TimeTraceProfilerInstance->begin(Name, Detail());
+}
+
+void llvm::timeTraceProfilerEnd() {
+  if (TimeTraceProfilerInstance)
+    TimeTraceProfilerInstance->end();
+}
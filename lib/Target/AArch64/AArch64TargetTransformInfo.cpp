@@ -407,6 +407,32 @@ unsigned AArch64TTIImpl::getMemoryOpCost(unsigned Opcode, Type *Src,
   return LT.first;
 }
 
+unsigned AArch64TTIImpl::getInterleavedMemoryOpCost(
+    unsigned Opcode, Type *VecTy, unsigned Factor, ArrayRef<unsigned> Indices,
+    unsigned Alignment, unsigned AddressSpace) {
+  assert(Factor >= 2 && "Invalid interleave factor");
+  assert(isa<VectorType>(VecTy) && "Expect a vector type");
+
+  // A group of factor 2 is a wide access plus one uzp1/uzp2 (or zip1/zip2)
+  // per register of each member, as long as the members are legal vectors.
+  if (Factor == 2) {
+    unsigned NumElts = VecTy->getVectorNumElements();
+    Type *SubVecTy = VectorType::get(VecTy->getScalarType(), NumElts / Factor);
+    std::pair<unsigned, MVT> SubLT = TLI->getTypeLegalizationCost(SubVecTy);
+    if (SubLT.second.isVector() &&
+        SubLT.second.getScalarSizeInBits() == VecTy->getScalarSizeInBits() &&
+        (SubLT.second.is64BitVector() || SubLT.second.is128BitVector())) {
+      unsigned NumMembers =
+          Opcode == Instruction::Load ? Indices.size() : Factor;
+      return getMemoryOpCost(Opcode, VecTy, Alignment, AddressSpace) +
+             NumMembers * SubLT.first;
+    }
+  }
+
+  return BaseT::getInterleavedMemoryOpCost(Opcode, VecTy, Factor, Indices,
+                                           Alignment, AddressSpace);
+}
+
 unsigned AArch64TTIImpl::getCostOfKeepingLiveOverCall(ArrayRef<Type *> Tys) {
   unsigned Cost = 0;
   for (auto *I : Tys) {
@@ -28,6 +28,7 @@
 #include "llvm/MC/SectionKind.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileCache.h"
 #include "llvm/Target/TargetLowering.h"
 #include "llvm/Target/TargetLoweringObjectFile.h"
 #include "llvm/Target/TargetSubtargetInfo.h"
@@ -144,6 +145,64 @@ CodeGenOpt::Level TargetMachine::getOptLevel() const {
   return CodeGenInfo->getOptLevel();
 }
 
+void TargetMachine::addToCacheKey(FileCacheKeyBuilder &Key) const {
+  Key.add(TargetTriple);
+  Key.add(TargetCPU);
+  Key.add(TargetFS);
+  Key.add(uint64_t(getRelocationModel()));
+  Key.add(uint64_t(getCodeModel()));
+  Key.add(uint64_t(getOptLevel()));
+
+  // Every field of the target options that operator== compares, in the same
+  // order.
+  Key.add(Options.UnsafeFPMath);
+  Key.add(Options.NoInfsFPMath);
+  Key.add(Options.NoNaNsFPMath);
+  Key.add(Options.HonorSignDependentRoundingFPMathOption);
+  Key.add(Options.UseSoftFloat);
+  Key.add(Options.NoZerosInBSS);
+  Key.add(Options.JITEmitDebugInfo);
+  Key.add(Options.JITEmitDebugInfoToDisk);
+  Key.add(Options.GuaranteedTailCallOpt);
+  Key.add(Options.DisableTailCalls);
+  Key.add(Options.StackAlignmentOverride);
+  Key.add(Options.EnableFastISel);
+  Key.add(Options.PositionIndependentExecutable);
+  Key.add(Options.UseInitArray);
+  Key.add(Options.TrapUnreachable);
+  Key.add(Options.TrapFuncName);
+  Key.add(Options.FloatABIType);
+  Key.add(Options.AllowFPOpFusion);
+  Key.add(Options.JTType);
+  Key.add(Options.FCFI);
+  Key.add(Options.ThreadModel);
+  Key.add(uint64_t(Options.CFIType));
+  Key.add(Options.CFIEnforcing);
+  Key.add(Options.CFIFuncName);
+
+  // These are not compared, but they still change the object file.
+  Key.add(Options.NoFramePointerElim);
+  Key.add(Options.LessPreciseFPMADOption);
+  Key.add(Options.DisableIntegratedAS);
+  Key.add(Options.CompressDebugSections);
+  Key.add(Options.FunctionSections);
+  Key.add(Options.DataSections);
+  Key.add(Options.UniqueSectionNames);
+
+  const MCTargetOptions &MCOptions = Options.MCOptions;
+  Key.add(MCOptions.SanitizeAddress);
+  Key.add(MCOptions.MCRelaxAll);
+  Key.add(MCOptions.MCNoExecStack);
+  Key.add(MCOptions.MCFatalWarnings);
+  Key.add(MCOptions.MCSaveTempLabels);
+  Key.add(MCOptions.MCUseDwarfDirectory);
+  Key.add(MCOptions.ShowMCEncoding);
+  Key.add(MCOptions.ShowMCInst);
+  Key.add(MCOptions.AsmVerbose);
+  Key.add(uint64_t(MCOptions.DwarfVersion));
+  Key.add(MCOptions.ABIName);
+}
+
 void TargetMachine::setOptLevel(CodeGenOpt::Level Level) const {
   if (CodeGenInfo)
     CodeGenInfo->setOptLevel(Level);
@@ -15247,10 +15247,78 @@ static SDValue LowerREADCYCLECOUNTER(SDValue Op, const X86Subtarget *Subtarget,
 }
 
 
+/// Lower a call to llvm.masked.gather or llvm.masked.scatter, whose mask was
+/// sign-extended to 64-bit lanes by the SelectionDAG builder. Only the types
+/// accepted by X86TTIImpl::isLegalMaskedGather and isLegalMaskedScatter get
+/// here: CodeGenPrepare scalarizes the others.
+static SDValue LowerMaskedGatherScatter(SDValue Op,
+                                        const X86Subtarget *Subtarget,
+                                        SelectionDAG &DAG) {
+  SDLoc dl(Op);
+  bool IsGather = Op.getOpcode() == ISD::INTRINSIC_W_CHAIN;
+  SDValue Chain = Op.getOperand(0);
+  SDValue Src   = Op.getOperand(IsGather ? 5 : 2);
+  SDValue Index = Op.getOperand(IsGather ? 2 : 3);
+  SDValue Mask  = Op.getOperand(IsGather ? 4 : 5);
+  MVT VT = Src.getSimpleValueType();
+  MVT EltVT = VT.getVectorElementType();
+  bool Is64BitElt = EltVT.getSizeInBits() == 64;
+
+  // The addresses are the index, with no base and a scale of one.
+  SDValue Base = DAG.getRegister(0, MVT::i64);
+  SDValue Scale = DAG.getConstant(1, MVT::i8);
+
+  if (VT.getVectorNumElements() == 8) {
+    assert(Subtarget->hasAVX512() && "Unexpected gather or scatter type");
+    Mask = DAG.getNode(ISD::TRUNCATE, dl, MVT::v8i1, Mask);
+    if (!IsGather) {
+      unsigned Opc = Is64BitElt
+                         ? (EltVT.isFloatingPoint() ? X86::VSCATTERQPDZmr
+                                                    : X86::VPSCATTERQQZmr)
+                         : (EltVT.isFloatingPoint() ? X86::VSCATTERQPSZmr
+                                                    : X86::VPSCATTERQDZmr);
+      return getScatterNode(Opc, Op, DAG, Src, Mask, Base, Index, Scale,
+                            Chain);
+    }
+    unsigned Opc = Is64BitElt
+                       ? (EltVT.isFloatingPoint() ? X86::VGATHERQPDZrm
+                                                  : X86::VPGATHERQQZrm)
+                       : (EltVT.isFloatingPoint() ? X86::VGATHERQPSZrm
+                                                  : X86::VPGATHERQDZrm);
+    return getGatherNode(Opc, Op, DAG, Src, Mask, Base, Index, Scale, Chain,
+                         Subtarget);
+  }
+
+  // Rewrite the gather as the AVX2 intrinsic with 64-bit indices, which takes
+  // the mask in the sign bit of each element of a vector of the data type.
+  assert(IsGather && Subtarget->hasAVX2() && "Unexpected gather or scatter");
+  Intrinsic::ID IID;
+  if (!Is64BitElt)
+    IID = EltVT.isFloatingPoint() ? Intrinsic::x86_avx2_gather_q_ps_256
+                                  : Intrinsic::x86_avx2_gather_q_d_256;
+  else if (VT.getVectorNumElements() == 4)
+    IID = EltVT.isFloatingPoint() ? Intrinsic::x86_avx2_gather_q_pd_256
+                                  : Intrinsic::x86_avx2_gather_q_q_256;
+  else
+    IID = EltVT.isFloatingPoint() ? Intrinsic::x86_avx2_gather_q_pd
+                                  : Intrinsic::x86_avx2_gather_q_q;
+  if (!Is64BitElt)
+    Mask = DAG.getNode(ISD::TRUNCATE, dl, MVT::v4i32, Mask);
+  Mask = DAG.getNode(ISD::BITCAST, dl, VT, Mask);
+  if (Src.getOpcode() == ISD::UNDEF)
+    Src = getZeroVector(VT, Subtarget, DAG, dl);
+  SDValue Ops[] = { Chain, DAG.getTargetConstant(IID, MVT::i64), Src, Base,
+                    Index, Mask, Scale };
+  return DAG.getNode(ISD::INTRINSIC_W_CHAIN, dl, Op->getVTList(), Ops);
+}
+
 static SDValue LowerINTRINSIC_W_CHAIN(SDValue Op, const X86Subtarget *Subtarget,
                                       SelectionDAG &DAG) {
   unsigned IntNo = cast<ConstantSDNode>(Op.getOperand(1))->getZExtValue();
 
+  if (IntNo == Intrinsic::masked_gather || IntNo == Intrinsic::masked_scatter)
+    return LowerMaskedGatherScatter(Op, Subtarget, DAG);
+
   const IntrinsicData* IntrData = getIntrinsicWithChain(IntNo);
   if (!IntrData)
     return SDValue();
@@ -513,6 +513,8 @@ unsigned X86TTIImpl::getCastInstrCost(unsigned Opcode, Type *Dst, Type *Src) {
     { ISD::ZERO_EXTEND, MVT::v16i32, MVT::v16i8,  1 },
     { ISD::SIGN_EXTEND, MVT::v16i32, MVT::v16i16, 1 },
     { ISD::ZERO_EXTEND, MVT::v16i32, MVT::v16i16, 1 },
+    { ISD::SIGN_EXTEND, MVT::v8i64,  MVT::v8i32,  1 },
+    { ISD::ZERO_EXTEND, MVT::v8i64,  MVT::v8i32,  1 },
     { ISD::SIGN_EXTEND, MVT::v8i64,  MVT::v16i32, 3 },
     { ISD::ZERO_EXTEND, MVT::v8i64,  MVT::v16i32, 3 },
 
@@ -812,6 +814,37 @@ unsigned X86TTIImpl::getMemoryOpCost(unsigned Opcode, Type *Src,
   return Cost;
 }
 
+unsigned X86TTIImpl::getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                                unsigned Factor,
+                                                ArrayRef<unsigned> Indices,
+                                                unsigned Alignment,
+                                                unsigned AddressSpace) {
+  assert(Factor >= 2 && "Invalid interleave factor");
+  assert(isa<VectorType>(VecTy) && "Expect a vector type");
+
+  // Pairs of 32 and 64 bit elements are split (or merged) with one shufps or
+  // unpck per 128 bit register of each member. 256 bit registers also need a
+  // permute across the lanes.
+  unsigned EltSize = VecTy->getScalarSizeInBits();
+  if (Factor == 2 && (EltSize == 32 || EltSize == 64)) {
+    unsigned NumElts = VecTy->getVectorNumElements();
+    Type *SubVecTy = VectorType::get(VecTy->getScalarType(), NumElts / Factor);
+    std::pair<unsigned, MVT> SubLT = TLI->getTypeLegalizationCost(SubVecTy);
+    if (SubLT.second.isVector() &&
+        SubLT.second.getScalarSizeInBits() == EltSize &&
+        SubLT.second.getSizeInBits() <= 256) {
+      unsigned ShufflesPerReg = SubLT.second.getSizeInBits() == 256 ? 2 : 1;
+      unsigned NumMembers =
+          Opcode == Instruction::Load ? Indices.size() : Factor;
+      return getMemoryOpCost(Opcode, VecTy, Alignment, AddressSpace) +
+             NumMembers * SubLT.first * ShufflesPerReg;
+    }
+  }
+
+  return BaseT::getInterleavedMemoryOpCost(Opcode, VecTy, Factor, Indices,
+                                           Alignment, AddressSpace);
+}
+
 unsigned X86TTIImpl::getMaskedMemoryOpCost(unsigned Opcode, Type *SrcTy,
                                            unsigned Alignment,
                                            unsigned AddressSpace) {
@@ -865,6 +898,23 @@ unsigned X86TTIImpl::getMaskedMemoryOpCost(unsigned Opcode, Type *SrcTy,
   return Cost+LT.first;
 }
 
+unsigned X86TTIImpl::getGatherScatterOpCost(unsigned Opcode, Type *DataTy,
+                                            Value *Ptr, bool VariableMask,
+                                            unsigned Alignment) {
+  bool Legal = Opcode == Instruction::Load ? isLegalMaskedGather(DataTy)
+                                           : isLegalMaskedScatter(DataTy);
+  if (!Legal || !DataTy->isVectorTy())
+    return BaseT::getGatherScatterOpCost(Opcode, DataTy, Ptr, VariableMask,
+                                         Alignment);
+
+  // The hardware accesses the elements one at a time, but without the
+  // extracts and branches of the scalarized form.
+  unsigned NumElem = DataTy->getVectorNumElements();
+  if (!ST->hasAVX512())
+    return NumElem + 4; // The AVX2 gathers also have to rebuild the mask.
+  return NumElem + 1;
+}
+
 unsigned X86TTIImpl::getAddressComputationCost(Type *Ty, bool IsComplex) {
   // Address computations in vectorized code with non-consecutive addresses will
   // likely result in more instructions compared to scalar code where the
@@ -1124,3 +1174,41 @@ bool X86TTIImpl::isLegalMaskedStore(Type *DataType, int Consecutive) {
   return isLegalMaskedLoad(DataType, Consecutive);
 }
 
+/// Return true if a gather or scatter of DataTy can be lowered to one of the
+/// instructions of the subtarget. A scalar DataTy asks whether some vector of
+/// that element type can be.
+static bool isLegalGatherScatterType(Type *DataTy, bool Scatter,
+                                     const X86Subtarget *ST) {
+  // The instructions take 64-bit addresses in a vector register.
+  if (!ST->is64Bit())
+    return false;
+  Type *ScalarTy = DataTy->getScalarType();
+  unsigned ScalarWidth = ScalarTy->getPrimitiveSizeInBits();
+  if (!ScalarTy->isIntegerTy() && !ScalarTy->isFloatingPointTy())
+    return false;
+  if (ScalarWidth != 32 && ScalarWidth != 64)
+    return false;
+
+  bool HasAVX2Gather = ST->hasAVX2() && !Scatter;
+  if (!DataTy->isVectorTy())
+    return ST->hasAVX512() || HasAVX2Gather;
+
+  unsigned NumElem = DataTy->getVectorNumElements();
+  // AVX-512 accesses eight elements with eight 64-bit addresses.
+  if (ST->hasAVX512() && NumElem == 8)
+    return true;
+  // The AVX2 gathers with 64-bit indices fill a 128-bit register with 32-bit
+  // elements, or a 128 or 256-bit register with 64-bit elements.
+  if (HasAVX2Gather)
+    return NumElem == 4 || (NumElem == 2 && ScalarWidth == 64);
+  return false;
+}
+
+bool X86TTIImpl::isLegalMaskedGather(Type *DataTy) {
+  return isLegalGatherScatterType(DataTy, /*Scatter=*/false, ST);
+}
+
+bool X86TTIImpl::isLegalMaskedScatter(Type *DataTy) {
+  return isLegalGatherScatterType(DataTy, /*Scatter=*/true, ST);
+}
+
@@ -7,6 +7,7 @@ transforms_ipo_SRC_FILES := \
   DeadArgumentElimination.cpp \
   ExtractGV.cpp \
   FunctionAttrs.cpp \
+  FunctionImport.cpp \
   GlobalDCE.cpp \
   GlobalOpt.cpp \
   IPConstantPropagation.cpp \
@@ -0,0 +1,288 @@
+//===- FunctionImport.cpp - ThinLTO Summary-based Function Import ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements Function import based on summaries.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/FunctionImport.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/FunctionInfo.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <map>
+using namespace llvm;
+
+#define DEBUG_TYPE "function-import"
+
+/// Limit on instruction count of imported functions.
+static cl::opt<unsigned> ImportInstrLimit(
+    "import-instr-limit", cl::init(100), cl::Hidden, cl::value_desc("N"),
+    cl::desc("Only import functions with less than N instructions"));
+
+static cl::opt<float> ImportInstrFactor(
+    "import-instr-evolution-factor", cl::init(0.7), cl::Hidden,
+    cl::value_desc("x"),
+    cl::desc("As we import functions, multiply the "
+             "`import-instr-limit` threshold by this factor "
+             "before processing newly imported functions"));
+
+/// Return the summary of a definition of FuncName that can be imported into
+/// a module named DestModulePath with the given threshold, or nullptr.
+static const FunctionSummary *
+selectCallee(const FunctionInfoIndex &Index, StringRef FuncName,
+             StringRef DestModulePath, unsigned Threshold) {
+  const FunctionSummaryList *Summaries =
+      Index.findFunctionSummaryList(FuncName);
+  if (!Summaries)
+    return nullptr;
+
+  for (const auto &Summary : *Summaries) {
+    // A definition in the destination module will be there anyway.
+    if (Summary->getModulePath() == DestModulePath)
+      return nullptr;
+    if (!Summary->isImportable() || Summary->isCold())
+      continue;
+    if (Summary->getInstCount() >= Threshold)
+      continue;
+    return Summary.get();
+  }
+  return nullptr;
+}
+
+bool FunctionImporter::importFunctions(Module &DestModule) {
+  StringRef DestModulePath = DestModule.getModuleIdentifier();
+
+  // The functions to import, grouped by source module. A std::map keeps the
+  // order in which modules are visited deterministic.
+  std::map<StringRef, StringSet<>> ImportsByModule;
+  StringSet<> Visited;
+
+  // Start with everything the module declares but does not define. Every
+  // name is only considered once, with the highest threshold it is reached
+  // with, since callees of imported functions come after the declarations.
+  SmallVector<std::pair<std::string, unsigned>, 64> Worklist;
+  for (const Function &F : DestModule)
+    if (F.isDeclaration() && !F.isIntrinsic() && !F.hasLocalLinkage())
+      Worklist.push_back(
+          std::make_pair(F.getName().str(), unsigned(ImportInstrLimit)));
+
+  for (unsigned I = 0; I != Worklist.size(); ++I) {
+    StringRef Name = Worklist[I].first;
+    unsigned Threshold = Worklist[I].second;
+    if (!Visited.insert(Name).second)
+      continue;
+
+    const FunctionSummary *Summary =
+        selectCallee(Index, Name, DestModulePath, Threshold);
+    if (!Summary) {
+      DEBUG(dbgs() << "Not importing " << Name << "\n");
+      continue;
+    }
+
+    DEBUG(dbgs() << "Importing " << Name << " from "
+                 << Summary->getModulePath() << "\n");
+    ImportsByModule[Summary->getModulePath()].insert(Name);
+
+    // The callees of an imported function will only be worth importing if
+    // it is inlined, so be more conservative with them.
+    unsigned CalleeThreshold = Threshold * ImportInstrFactor;
+    for (const CalleeInfo &Callee : Summary->calls()) {
+      const Function *F = DestModule.getFunction(Callee.Name);
+      if (F && !F->isDeclaration())
+        continue;
+      Worklist.push_back(std::make_pair(Callee.Name, CalleeThreshold));
+    }
+  }
+
+  unsigned ImportedCount = 0;
+  for (auto &Imports : ImportsByModule) {
+    StringRef SrcModulePath = Imports.first;
+    StringSet<> &Names = Imports.second;
+
+    std::unique_ptr<Module> SrcModule = ModuleLoader(SrcModulePath);
+    if (!SrcModule)
+      continue;
+    assert(&SrcModule->getContext() == &DestModule.getContext() &&
+           "Module loaded in the wrong context");
+
+    // Materialize the bodies to import. Anything that does not match the
+    // summary (the module may have changed since the index was built) is
+    // silently skipped.
+    SmallPtrSet<const GlobalValue *, 16> ToImport;
+    for (const auto &Name : Names) {
+      Function *F = SrcModule->getFunction(Name.getKey());
+      if (!F || F->isDeclaration() || F->materialize())
+        continue;
+      ToImport.insert(F);
+    }
+    if (ToImport.empty())
+      continue;
+
+    // Copy the selected definitions, along with declarations of whatever
+    // they refer to, into a new module that is linked into the destination.
+    ValueToValueMapTy VMap;
+    std::unique_ptr<Module> Imported(
+        CloneModule(SrcModule.get(), VMap, [&](const GlobalValue *GV) {
+          return ToImport.count(GV);
+        }));
+    SrcModule.reset();
+
+    // Drop the declarations the imported bodies do not need, including the
+    // appending globals of the source module.
+    SmallVector<GlobalValue *, 64> Unused;
+    for (GlobalValue &GV : Imported->globals())
+      if (GV.use_empty())
+        Unused.push_back(&GV);
+    for (Function &F : *Imported)
+      if (F.isDeclaration() && F.use_empty())
+        Unused.push_back(&F);
+    for (GlobalValue *GV : Unused)
+      if (GV->use_empty())
+        GV->eraseFromParent();
+
+    // The definitions are linked with their original linkage, so that they
+    // replace the declarations of the destination module, and then turned
+    // into available_externally definitions, which are never emitted.
+    for (Function &F : *Imported)
+      if (!F.isDeclaration())
+        F.setComdat(nullptr);
+    std::vector<std::string> ImportedNames;
+    for (Function &F : *Imported)
+      if (!F.isDeclaration())
+        ImportedNames.push_back(F.getName());
+
+    if (Linker::LinkModules(&DestModule, Imported.get(), DiagnosticHandler))
+      report_fatal_error("Function Import: link error");
+
+    for (const std::string &Name : ImportedNames)
+      if (Function *F = DestModule.getFunction(Name)) {
+        F->setLinkage(GlobalValue::AvailableExternallyLinkage);
+        ++ImportedCount;
+      }
+  }
+
+  DEBUG(dbgs() << "Imported " << ImportedCount << " functions for Module "
+               << DestModulePath << "\n");
+  return ImportedCount != 0;
+}
+
+/// Summary file to use for function importing when using -function-import from
+/// the command line.
+static cl::opt<std::string>
+    SummaryFile("summary-file",
+                cl::desc("The summary file to use for function importing."));
+
+static void diagnosticHandler(const DiagnosticInfo &DI) {
+  raw_ostream &OS = errs();
+  DiagnosticPrinterRawOStream DP(OS);
+  DI.print(DP);
+  OS << '\n';
+}
+
+/// Parse the function index out of an IR file and return the function
+/// index object if found, or nullptr if not.
+static std::unique_ptr<FunctionInfoIndex>
+getFunctionIndexForFile(StringRef Path, std::string &Error,
+                        DiagnosticHandlerFunction DiagnosticHandler) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr =
+      MemoryBuffer::getFileOrSTDIN(Path);
+  if (std::error_code EC = FileOrErr.getError()) {
+    Error = EC.message();
+    return nullptr;
+  }
+
+  ErrorOr<std::unique_ptr<FunctionInfoIndex>> IndexOrErr =
+      getFunctionInfoIndex((*FileOrErr)->getMemBufferRef(), DiagnosticHandler);
+  if (std::error_code EC = IndexOrErr.getError()) {
+    Error = EC.message();
+    return nullptr;
+  }
+  return std::move(IndexOrErr.get());
+}
+
+namespace {
+/// Pass that performs cross-module function import provided a summary file.
+class FunctionImportPass : public ModulePass {
+  /// Optional function summary index to use for importing, otherwise
+  /// the summary-file option must be specified.
+  const FunctionInfoIndex *Index;
+
+public:
+  /// Pass identification, replacement for typeid
+  static char ID;
+
+  /// Specify pass name for debug output
+  const char *getPassName() const override {
+    return "Function Importing";
+  }
+
+  explicit FunctionImportPass(const FunctionInfoIndex *Index = nullptr)
+      : ModulePass(ID), Index(Index) {
+    initializeFunctionImportPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override {
+    std::unique_ptr<FunctionInfoIndex> IndexPtr;
+    if (!Index) {
+      if (SummaryFile.empty())
+        report_fatal_error("error: -function-import requires -summary-file\n");
+      std::string Error;
+      IndexPtr = getFunctionIndexForFile(SummaryFile, Error, diagnosticHandler);
+      if (!IndexPtr) {
+        errs() << "Error loading file '" << SummaryFile << "': " << Error
+               << "\n";
+        return false;
+      }
+      Index = IndexPtr.get();
+    }
+
+    // Source modules are loaded lazily, so that only the bodies that are
+    // imported, and the metadata they refer to, are read.
+    auto ModuleLoader = [&M](StringRef Path) {
+      SMDiagnostic Err;
+      std::unique_ptr<Module> Result = getLazyIRFileModule(
+          Path, Err, M.getContext(), /* ShouldLazyLoadMetadata */ true);
+      if (!Result)
+        Err.print("function-import", errs());
+      return Result;
+    };
+
+    FunctionImporter Importer(*Index, diagnosticHandler, ModuleLoader);
+    bool Changed = Importer.importFunctions(M);
+
+    // The index only lives as long as this run when it was read here.
+    if (IndexPtr)
+      Index = nullptr;
+    return Changed;
+  }
+};
+} // anonymous namespace
+
+char FunctionImportPass::ID = 0;
+INITIALIZE_PASS_BEGIN(FunctionImportPass, "function-import",
+                      "Summary Based Function Import", false, false)
+INITIALIZE_PASS_END(FunctionImportPass, "function-import",
+                    "Summary Based Function Import", false, false)
+
+ModulePass *llvm::createFunctionImportPass(const FunctionInfoIndex *Index) {
+  return new FunctionImportPass(Index);
+}
@@ -19,6 +19,7 @@ transforms_scalar_SRC_FILES := \
   LICM.cpp \
   LoadCombine.cpp \
   LoopDeletion.cpp \
+  LoopDistribute.cpp \
   LoopIdiomRecognize.cpp \
   LoopInstSimplify.cpp \
   LoopInterchange.cpp \
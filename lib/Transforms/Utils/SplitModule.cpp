@@ -0,0 +1,275 @@
+//===- SplitModule.cpp - Split a module into partitions -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the function llvm::SplitModule, which splits a module
+// into multiple linkable partitions. It can be used to implement parallel code
+// generation for link-time optimization.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <algorithm>
+
+using namespace llvm;
+
+typedef EquivalenceClasses<const GlobalValue *> ClusterMapType;
+typedef DenseMap<const GlobalValue *, unsigned> PartitionMapType;
+
+/// Appending-linkage globals (llvm.used, llvm.global_ctors, ...) that nobody
+/// refers to are not assigned to a partition. Instead, every partition gets
+/// the entries that belong to the definitions it contains.
+static bool isDistributed(const GlobalValue &GV) {
+  const auto *GVar = dyn_cast<GlobalVariable>(&GV);
+  return GVar && GVar->hasAppendingLinkage() && GVar->hasInitializer() &&
+         GVar->use_empty();
+}
+
+/// Find every global value that C refers to, looking through constant
+/// expressions and aggregates. Functions whose blocks have their address taken
+/// are added to Colocated, since a block address can only be formed in the
+/// module that defines the function.
+static void findGlobalRefs(const Constant *C,
+                           SmallPtrSetImpl<const Constant *> &Visited,
+                           SmallVectorImpl<const GlobalValue *> &Refs,
+                           SmallVectorImpl<const GlobalValue *> &Colocated) {
+  if (!Visited.insert(C).second)
+    return;
+
+  if (const auto *GV = dyn_cast<GlobalValue>(C)) {
+    Refs.push_back(GV);
+    return;
+  }
+
+  if (const auto *BA = dyn_cast<BlockAddress>(C)) {
+    Colocated.push_back(BA->getFunction());
+    return;
+  }
+
+  for (const Use &Op : C->operands())
+    findGlobalRefs(cast<Constant>(Op), Visited, Refs, Colocated);
+}
+
+/// Put GV in the same cluster as every definition that has to be emitted in
+/// the same partition as GV.
+static void
+addToClusters(const GlobalValue &GV, ClusterMapType &Clusters,
+              DenseMap<const Comdat *, const GlobalValue *> &Comdats) {
+  Clusters.insert(&GV);
+
+  // All members of a comdat are emitted together.
+  if (const Comdat *C = GV.getComdat()) {
+    const GlobalValue *&Member = Comdats[C];
+    if (Member)
+      Clusters.unionSets(Member, &GV);
+    else
+      Member = &GV;
+  }
+
+  // An alias must be defined next to its aliasee.
+  if (const auto *GA = dyn_cast<GlobalAlias>(&GV))
+    if (const GlobalObject *Base = GA->getBaseObject())
+      Clusters.unionSets(&GV, Base);
+
+  SmallPtrSet<const Constant *, 16> Visited;
+  SmallVector<const GlobalValue *, 16> Refs;
+  SmallVector<const GlobalValue *, 4> Colocated;
+  if (const auto *F = dyn_cast<Function>(&GV)) {
+    for (const BasicBlock &BB : *F)
+      for (const Instruction &I : BB)
+        for (const Use &Op : I.operands())
+          if (const auto *C = dyn_cast<Constant>(Op))
+            findGlobalRefs(C, Visited, Refs, Colocated);
+  } else if (const auto *GVar = dyn_cast<GlobalVariable>(&GV)) {
+    findGlobalRefs(GVar->getInitializer(), Visited, Refs, Colocated);
+  } else if (const Constant *Aliasee = cast<GlobalAlias>(GV).getAliasee()) {
+    findGlobalRefs(Aliasee, Visited, Refs, Colocated);
+  }
+
+  // Local symbols are not visible outside of the partition that defines them,
+  // so they have to be emitted next to all of their users.
+  for (const GlobalValue *Ref : Refs)
+    if (Ref->hasLocalLinkage())
+      Clusters.unionSets(&GV, Ref);
+  for (const GlobalValue *Ref : Colocated)
+    Clusters.unionSets(&GV, Ref);
+}
+
+/// Rough estimate of the amount of code generation work GV represents.
+static unsigned getCost(const GlobalValue &GV) {
+  unsigned Cost = 1;
+  if (const auto *F = dyn_cast<Function>(&GV))
+    for (const BasicBlock &BB : *F)
+      Cost += BB.size();
+  return Cost;
+}
+
+/// Assign every definition in M that is not distributed to one of N
+/// partitions, keeping clusters intact and balancing the partition costs.
+static void partitionModule(const Module &M, unsigned N,
+                            PartitionMapType &PartitionOf) {
+  ClusterMapType Clusters;
+  DenseMap<const Comdat *, const GlobalValue *> Comdats;
+  SmallVector<const GlobalValue *, 64> Definitions;
+
+  auto AddDefinition = [&](const GlobalValue &GV) {
+    if (GV.isDeclaration() || isDistributed(GV))
+      return;
+    Definitions.push_back(&GV);
+    addToClusters(GV, Clusters, Comdats);
+  };
+  for (const Function &F : M)
+    AddDefinition(F);
+  for (const GlobalVariable &GV : M.globals())
+    AddDefinition(GV);
+  for (const GlobalAlias &GA : M.aliases())
+    AddDefinition(GA);
+
+  // Number the clusters in module order so that the partitioning does not
+  // depend on the addresses of the leaders, and accumulate their costs.
+  DenseMap<const GlobalValue *, unsigned> ClusterIDs;
+  SmallVector<unsigned, 64> ClusterOf;
+  SmallVector<uint64_t, 64> ClusterCosts;
+  for (const GlobalValue *GV : Definitions) {
+    const GlobalValue *Leader = Clusters.getLeaderValue(GV);
+    auto Inserted =
+        ClusterIDs.insert(std::make_pair(Leader, ClusterCosts.size()));
+    if (Inserted.second)
+      ClusterCosts.push_back(0);
+    ClusterOf.push_back(Inserted.first->second);
+    ClusterCosts[Inserted.first->second] += getCost(*GV);
+  }
+
+  // Greedily hand the most expensive remaining cluster to the least loaded
+  // partition.
+  SmallVector<unsigned, 64> Order;
+  for (unsigned I = 0, E = ClusterCosts.size(); I != E; ++I)
+    Order.push_back(I);
+  std::stable_sort(Order.begin(), Order.end(), [&](unsigned L, unsigned R) {
+    return ClusterCosts[L] > ClusterCosts[R];
+  });
+
+  SmallVector<uint64_t, 16> PartitionCosts(N, 0);
+  SmallVector<unsigned, 64> ClusterPartition(ClusterCosts.size(), 0);
+  for (unsigned ClusterID : Order) {
+    unsigned Cheapest = 0;
+    for (unsigned I = 1; I != N; ++I)
+      if (PartitionCosts[I] < PartitionCosts[Cheapest])
+        Cheapest = I;
+    ClusterPartition[ClusterID] = Cheapest;
+    PartitionCosts[Cheapest] += ClusterCosts[ClusterID];
+  }
+
+  for (unsigned I = 0, E = Definitions.size(); I != E; ++I)
+    PartitionOf[Definitions[I]] = ClusterPartition[ClusterOf[I]];
+}
+
+/// Return the partition that should emit the given entry of a distributed
+/// global. Entries naming a global defined in M go with that global; anything
+/// else goes to the first partition.
+static unsigned getEntryPartition(const Constant *Entry,
+                                  const PartitionMapType &PartitionOf) {
+  // llvm.global_ctors and llvm.global_dtors entries are { priority, function,
+  // data } structs; key them on the function.
+  if (const auto *CS = dyn_cast<ConstantStruct>(Entry))
+    if (CS->getNumOperands() > 1)
+      Entry = CS->getOperand(1);
+
+  const auto *GV = dyn_cast<GlobalValue>(Entry->stripPointerCasts());
+  if (!GV)
+    return 0;
+  auto I = PartitionOf.find(GV);
+  return I == PartitionOf.end() ? 0 : I->second;
+}
+
+/// Drop the entries of the copy NewGV of the distributed global GV that are
+/// emitted by another partition than Partition.
+static void distributeEntries(const GlobalVariable &GV, GlobalVariable &NewGV,
+                              unsigned Partition,
+                              const PartitionMapType &PartitionOf) {
+  const auto *Init = dyn_cast<ConstantArray>(GV.getInitializer());
+  if (!Init) {
+    // Nothing to distribute; keep the global in the first partition.
+    if (Partition != 0)
+      NewGV.eraseFromParent();
+    return;
+  }
+
+  auto *NewInit = cast<ConstantArray>(NewGV.getInitializer());
+  SmallVector<Constant *, 16> Entries;
+  for (unsigned I = 0, E = Init->getNumOperands(); I != E; ++I)
+    if (getEntryPartition(Init->getOperand(I), PartitionOf) == Partition)
+      Entries.push_back(NewInit->getOperand(I));
+
+  if (Entries.size() == Init->getNumOperands())
+    return;
+  if (Entries.empty()) {
+    NewGV.eraseFromParent();
+    return;
+  }
+
+  ArrayType *ATy =
+      ArrayType::get(Init->getType()->getElementType(), Entries.size());
+  auto *Replacement = new GlobalVariable(
+      *NewGV.getParent(), ATy, NewGV.isConstant(), NewGV.getLinkage(),
+      ConstantArray::get(ATy, Entries), "", &NewGV, NewGV.getThreadLocalMode(),
+      NewGV.getType()->getAddressSpace());
+  Replacement->copyAttributesFrom(&NewGV);
+  Replacement->takeName(&NewGV);
+  NewGV.eraseFromParent();
+}
+
+void llvm::SplitModule(
+    const Module &M, unsigned N,
+    std::function<void(std::unique_ptr<Module> MPart)> ModuleCallback) {
+  assert(N > 0 && "Cannot split a module into zero partitions");
+
+  PartitionMapType PartitionOf;
+  partitionModule(M, N, PartitionOf);
+
+  for (unsigned I = 0; I != N; ++I) {
+    ValueToValueMapTy VMap;
+    std::unique_ptr<Module> MPart(
+        CloneModule(&M, VMap, [&](const GlobalValue *GV) {
+          if (GV->isDeclaration() || isDistributed(*GV))
+            return true;
+          return PartitionOf.lookup(GV) == I;
+        }));
+
+    // Module-level inline asm may define symbols, so only emit it once.
+    if (I != 0)
+      MPart->setModuleInlineAsm("");
+
+    for (const GlobalVariable &GV : M.globals())
+      if (isDistributed(GV))
+        distributeEntries(GV, *cast<GlobalVariable>(VMap[&GV]), I,
+                          PartitionOf);
+
+    // Remove the external references that CloneModule created for
+    // definitions in other partitions when nothing here refers to them.
+    for (const auto &Entry : PartitionOf) {
+      if (Entry.second == I)
+        continue;
+      auto *Stub = cast<GlobalValue>(VMap[Entry.first]);
+      if (Stub->use_empty())
+        Stub->eraseFromParent();
+    }
+
+    ModuleCallback(std::move(MPart));
+  }
+}
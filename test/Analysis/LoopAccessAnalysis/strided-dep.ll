@@ -0,0 +1,118 @@
+; RUN: opt -loop-accesses -analyze < %s | FileCheck %s
+
+; Accesses with the same stride never touch the same element if their distance
+; is not a multiple of the stride. Otherwise the distance must still leave room
+; for two strided iterations.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@A = common global [1024 x i32] zeroinitializer, align 4
+
+; for (i = 0; i < 1024; i += 2)
+;   A[i+1] = A[i] + 1;
+
+; CHECK-LABEL: function 'independent':
+; CHECK: Memory dependences are safe{{$}}
+
+define void @independent() {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds [1024 x i32], [1024 x i32]* @A, i64 0, i64 %iv
+  %0 = load i32, i32* %arrayidx, align 4
+  %add = add nsw i32 %0, 1
+  %iv.1 = add nuw nsw i64 %iv, 1
+  %arrayidx.1 = getelementptr inbounds [1024 x i32], [1024 x i32]* @A, i64 0, i64 %iv.1
+  store i32 %add, i32* %arrayidx.1, align 4
+  %iv.next = add nuw nsw i64 %iv, 2
+  %cmp = icmp slt i64 %iv.next, 1022
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:
+  ret void
+}
+
+; for (i = 0; i < 1024; i += 2)
+;   A[i+8] = A[i] + 1;
+
+; CHECK-LABEL: function 'backward_vectorizable':
+; CHECK: Memory dependences are safe{{$}}
+; CHECK: BackwardVectorizable
+
+define void @backward_vectorizable() {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds [1024 x i32], [1024 x i32]* @A, i64 0, i64 %iv
+  %0 = load i32, i32* %arrayidx, align 4
+  %add = add nsw i32 %0, 1
+  %iv.8 = add nuw nsw i64 %iv, 8
+  %arrayidx.8 = getelementptr inbounds [1024 x i32], [1024 x i32]* @A, i64 0, i64 %iv.8
+  store i32 %add, i32* %arrayidx.8, align 4
+  %iv.next = add nuw nsw i64 %iv, 2
+  %cmp = icmp slt i64 %iv.next, 1016
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:
+  ret void
+}
+
+; for (i = 0; i < 1024; i += 2)
+;   A[i+2] = A[i] + 1;
+
+; CHECK-LABEL: function 'backward':
+; CHECK: Report: unsafe dependent memory operations in loop
+; CHECK-NOT: Memory dependences are safe
+
+define void @backward() {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds [1024 x i32], [1024 x i32]* @A, i64 0, i64 %iv
+  %0 = load i32, i32* %arrayidx, align 4
+  %add = add nsw i32 %0, 1
+  %iv.2 = add nuw nsw i64 %iv, 2
+  %arrayidx.2 = getelementptr inbounds [1024 x i32], [1024 x i32]* @A, i64 0, i64 %iv.2
+  store i32 %add, i32* %arrayidx.2, align 4
+  %iv.next = add nuw nsw i64 %iv, 2
+  %cmp = icmp slt i64 %iv.next, 1022
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:
+  ret void
+}
+
+; for (i = 0; i < 1024; i += 2)
+;   A[i+1] = A[i] + 1;
+; where the computation of i+1 may wrap, so the address of A[i+1] may wrap too.
+
+; CHECK-LABEL: function 'wrapping_index':
+; CHECK: Report: unsafe dependent memory operations in loop
+; CHECK-NOT: Memory dependences are safe
+
+define void @wrapping_index() {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds [1024 x i32], [1024 x i32]* @A, i64 0, i64 %iv
+  %0 = load i32, i32* %arrayidx, align 4
+  %add = add nsw i32 %0, 1
+  %iv.1 = add i64 %iv, 1
+  %arrayidx.1 = getelementptr inbounds [1024 x i32], [1024 x i32]* @A, i64 0, i64 %iv.1
+  store i32 %add, i32* %arrayidx.1, align 4
+  %iv.next = add nuw nsw i64 %iv, 2
+  %cmp = icmp slt i64 %iv.next, 1022
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:
+  ret void
+}
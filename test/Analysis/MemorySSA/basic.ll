@@ -0,0 +1,44 @@
+; RUN: opt -basicaa -memoryssa -analyze -verify-memoryssa < %s 2>&1 | FileCheck %s
+;
+; Every memory access is linked to the nearest dominating definition; the
+; builder does not disambiguate.
+
+define i32 @main() {
+entry:
+; CHECK: 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: %call = call noalias i8* @_Znwm(i64 4)
+  %call = call noalias i8* @_Znwm(i64 4)
+  %0 = bitcast i8* %call to i32*
+; CHECK: 2 = MemoryDef(1)
+; CHECK-NEXT: %call1 = call noalias i8* @_Znwm(i64 4)
+  %call1 = call noalias i8* @_Znwm(i64 4)
+  %1 = bitcast i8* %call1 to i32*
+; CHECK: 3 = MemoryDef(2)
+; CHECK-NEXT: store i32 5, i32* %0, align 4
+  store i32 5, i32* %0, align 4
+; CHECK: 4 = MemoryDef(3)
+; CHECK-NEXT: store i32 7, i32* %1, align 4
+  store i32 7, i32* %1, align 4
+; CHECK: MemoryUse(4)
+; CHECK-NEXT: %2 = load i32, i32* %0, align 4
+  %2 = load i32, i32* %0, align 4
+; CHECK: MemoryUse(4)
+; CHECK-NEXT: %3 = load i32, i32* %1, align 4
+  %3 = load i32, i32* %1, align 4
+  %add = add nsw i32 %2, %3
+  ret i32 %add
+}
+
+declare noalias i8* @_Znwm(i64)
+
+; Instructions that do not touch memory get no access.
+define i32 @readnone(i32 %a) {
+entry:
+; CHECK-LABEL: @readnone
+; CHECK-NOT: Memory
+; CHECK: ret i32
+  %b = call i32 @f_readnone(i32 %a)
+  ret i32 %b
+}
+
+declare i32 @f_readnone(i32) readnone
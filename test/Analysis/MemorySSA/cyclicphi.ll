@@ -0,0 +1,56 @@
+; RUN: opt -basicaa -memoryssa -analyze -verify-memoryssa < %s 2>&1 | FileCheck %s
+;
+; MemoryPhis are placed where definitions from different paths meet, including
+; loop headers.
+
+define i32 @diamond(i1 %c, i32* %p) {
+entry:
+  br i1 %c, label %if.then, label %if.else
+
+if.then:
+; CHECK: 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 1, i32* %p
+  store i32 1, i32* %p
+  br label %if.end
+
+if.else:
+; CHECK: 2 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 2, i32* %p
+  store i32 2, i32* %p
+  br label %if.end
+
+if.end:
+; CHECK: 3 = MemoryPhi({if.then,1},{if.else,2})
+; CHECK: MemoryUse(3)
+; CHECK-NEXT: %v = load i32, i32* %p
+  %v = load i32, i32* %p
+  ret i32 %v
+}
+
+define void @loop(i32* %p, i32* noalias %q) {
+entry:
+; CHECK-LABEL: @loop
+; CHECK: 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 0, i32* %p
+  store i32 0, i32* %p
+  br label %for.body
+
+for.body:
+; CHECK: 3 = MemoryPhi({entry,1},{for.body,2})
+; CHECK: MemoryUse(3)
+; CHECK-NEXT: %v = load i32, i32* %q
+; CHECK: 2 = MemoryDef(3)
+; CHECK-NEXT: store i32 %v, i32* %p
+  %i = phi i32 [ 0, %entry ], [ %i.next, %for.body ]
+  %v = load i32, i32* %q
+  store i32 %v, i32* %p
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, 100
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:
+; CHECK: for.end:
+; CHECK-NOT: MemoryPhi
+; CHECK: ret void
+  ret void
+}
@@ -0,0 +1,45 @@
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=BC
+; RUN: llvm-as < %s -o %t.bc
+; RUN: llvm-dis < %t.bc | FileCheck %s
+; RUN: llvm-link %t.bc -S | FileCheck %s
+
+; The module-level metadata block starts with the offset of an index of its
+; records, which follows them and precedes the named metadata. The kinds are
+; in a block of their own.
+; BC: <METADATA_BLOCK
+; BC: <METADATA_INDEX_OFFSET
+; BC: <METADATA_INDEX
+; BC-NEXT: <METADATA_NAME
+; BC: </METADATA_BLOCK>
+; BC: <METADATA_KIND_BLOCK
+; BC: <METADATA_KIND op0=
+
+; llvm-link loads the nodes lazily through the index. They must be the same
+; as when the whole block is parsed, including the nodes that are loaded
+; between and after the named metadata.
+; CHECK: define void @f()
+; CHECK-NEXT: ret void, !attach [[F:![0-9]+]]
+; CHECK: define void @g()
+; CHECK-NEXT: ret void, !attach [[G:![0-9]+]]
+; CHECK: !named = !{[[N:![0-9]+]]}
+; CHECK: !named2 = !{[[G]], [[F]]}
+; CHECK-DAG: [[F]] = !{!"f", [[D:![0-9]+]]}
+; CHECK-DAG: [[G]] = !{!"g"}
+; CHECK-DAG: [[N]] = !{!"named", [[F]]}
+; CHECK-DAG: [[D]] = distinct !{[[D]]}
+
+define void @f() {
+  ret void, !attach !0
+}
+
+define void @g() {
+  ret void, !attach !1
+}
+
+!named = !{!2}
+!named2 = !{!1, !0}
+
+!0 = !{!"f", !3}
+!1 = !{!"g"}
+!2 = !{!"named", !0}
+!3 = distinct !{!3}
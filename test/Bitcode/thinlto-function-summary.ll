@@ -0,0 +1,30 @@
+; RUN: llvm-as -function-summary < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=BC
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=NOSUMMARY
+
+; The summary of a single module does not list the module path. Functions are
+; summarized in name order ("bar", then "foo") and local functions are not
+; summarized.
+; BC: <FUNCTION_SUMMARY_BLOCK
+; BC-NOT: <MODULE_PATH
+; BC: <NAME{{.*}} op0=98 op1=97 op2=114/>
+; BC: <ENTRY
+; BC: <NAME{{.*}} op0=102 op1=111 op2=111/>
+; BC: <ENTRY
+; BC: </FUNCTION_SUMMARY_BLOCK>
+
+; NOSUMMARY-NOT: FUNCTION_SUMMARY_BLOCK
+
+define i32 @foo() {
+entry:
+  %call = call i32 @bar()
+  ret i32 %call
+}
+
+define i32 @bar() {
+entry:
+  ret i32 1
+}
+
+define internal void @local() {
+  ret void
+}
@@ -0,0 +1,104 @@
+; RUN: llc -mtriple=x86_64-apple-darwin -mcpu=knl < %s | FileCheck %s -check-prefix=AVX512
+; RUN: llc -mtriple=x86_64-apple-darwin -mcpu=core-avx2 < %s | FileCheck %s -check-prefix=AVX2
+; RUN: opt -mtriple=x86_64-apple-darwin -scalarize-masked-gather-scatter -mcpu=corei7-avx -S < %s | FileCheck %s -check-prefix=SCALAR
+
+; AVX512-LABEL: test1
+; AVX512: kxnorw %k1, %k1, %k1
+; AVX512: vgatherqps (,%zmm0), %ymm1 {%k1}
+
+; AVX2-LABEL: test1
+; AVX2-NOT: vgather
+
+; SCALAR-LABEL: test1
+; SCALAR-NOT: llvm.masked.gather
+; SCALAR: extractelement <8 x float*> %ptrs, i32 0
+; SCALAR: load float, float* %Ptr0, align 4
+; SCALAR: extractelement <8 x float*> %ptrs, i32 7
+; SCALAR-NOT: br
+; SCALAR: ret <8 x float>
+define <8 x float> @test1(<8 x float*> %ptrs) {
+  %res = call <8 x float> @llvm.masked.gather.v8f32(<8 x float*> %ptrs, i32 4, <8 x i1> <i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true>, <8 x float> undef)
+  ret <8 x float> %res
+}
+
+; AVX512-LABEL: test2
+; AVX512: vpgatherqq (,%zmm0), %zmm{{[0-9]+}} {%k1}
+
+; AVX2-LABEL: test2
+; AVX2-NOT: vpgather
+
+; SCALAR-LABEL: test2
+; SCALAR-NOT: llvm.masked.gather
+; SCALAR: cond.load:
+; SCALAR: load i64, i64* %Ptr0, align 8
+; SCALAR: else:
+; SCALAR: select <8 x i1> %{{[^,]+}}, <8 x i64> %res.phi.select, <8 x i64> %passthru
+define <8 x i64> @test2(<8 x i64*> %ptrs, <8 x i64> %trigger, <8 x i64> %passthru) {
+  %mask = icmp ne <8 x i64> %trigger, zeroinitializer
+  %res = call <8 x i64> @llvm.masked.gather.v8i64(<8 x i64*> %ptrs, i32 8, <8 x i1> %mask, <8 x i64> %passthru)
+  ret <8 x i64> %res
+}
+
+; AVX512-LABEL: test3
+; AVX512: vgatherqpd
+
+; AVX2-LABEL: test3
+; AVX2: vgatherqpd %ymm{{[0-9]+}}, (,%ymm0), %ymm{{[0-9]+}}
+
+; SCALAR-LABEL: test3
+; SCALAR-NOT: llvm.masked.gather
+define <4 x double> @test3(<4 x double*> %ptrs, <4 x i64> %trigger) {
+  %mask = icmp sgt <4 x i64> %trigger, zeroinitializer
+  %res = call <4 x double> @llvm.masked.gather.v4f64(<4 x double*> %ptrs, i32 8, <4 x i1> %mask, <4 x double> undef)
+  ret <4 x double> %res
+}
+
+; AVX2-LABEL: test4
+; AVX2: vpgatherqd %xmm{{[0-9]+}}, (,%ymm0), %xmm{{[0-9]+}}
+define <4 x i32> @test4(<4 x i32*> %ptrs, <4 x i32> %trigger, <4 x i32> %passthru) {
+  %mask = icmp sgt <4 x i32> %trigger, zeroinitializer
+  %res = call <4 x i32> @llvm.masked.gather.v4i32(<4 x i32*> %ptrs, i32 4, <4 x i1> %mask, <4 x i32> %passthru)
+  ret <4 x i32> %res
+}
+
+; AVX512-LABEL: test5
+; AVX512: vpscatterqd %ymm{{[0-9]+}}, (,%zmm{{[0-9]+}}) {%k1}
+
+; AVX2-LABEL: test5
+; AVX2-NOT: vpscatter
+; AVX2: vpextrd
+; AVX2: retq
+
+; SCALAR-LABEL: test5
+; SCALAR-NOT: llvm.masked.scatter
+; SCALAR: cond.store:
+; SCALAR: extractelement <8 x i32> %val, i32 0
+; SCALAR: store i32 %Elt0, i32* %Ptr0, align 4
+define void @test5(<8 x i32> %val, <8 x i32*> %ptrs, <8 x i32> %trigger) {
+  %mask = icmp ne <8 x i32> %trigger, zeroinitializer
+  call void @llvm.masked.scatter.v8i32(<8 x i32> %val, <8 x i32*> %ptrs, i32 4, <8 x i1> %mask)
+  ret void
+}
+
+; AVX512-LABEL: test6
+; AVX512: movw $253, %ax
+; AVX512: kmovw %eax, %k1
+; AVX512: vscatterqpd %zmm{{[0-9]+}}, (,%zmm1) {%k1}
+
+; SCALAR-LABEL: test6
+; SCALAR-NOT: llvm.masked.scatter
+; SCALAR-NOT: cond.store
+; SCALAR: store double %Elt0, double* %Ptr0, align 8
+; SCALAR-NOT: %Elt1
+; SCALAR: store double %Elt2, double* %Ptr2, align 8
+define void @test6(<8 x double> %val, <8 x double*> %ptrs) {
+  call void @llvm.masked.scatter.v8f64(<8 x double> %val, <8 x double*> %ptrs, i32 8, <8 x i1> <i1 true, i1 false, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true>)
+  ret void
+}
+
+declare <8 x float> @llvm.masked.gather.v8f32(<8 x float*>, i32, <8 x i1>, <8 x float>)
+declare <8 x i64> @llvm.masked.gather.v8i64(<8 x i64*>, i32, <8 x i1>, <8 x i64>)
+declare <4 x double> @llvm.masked.gather.v4f64(<4 x double*>, i32, <4 x i1>, <4 x double>)
+declare <4 x i32> @llvm.masked.gather.v4i32(<4 x i32*>, i32, <4 x i1>, <4 x i32>)
+declare void @llvm.masked.scatter.v8i32(<8 x i32>, <8 x i32*>, i32, <8 x i1>)
+declare void @llvm.masked.scatter.v8f64(<8 x double>, <8 x double*>, i32, <8 x i1>)
@@ -0,0 +1,34 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -mcpu=corei7 -O0 < %s | FileCheck %s
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -mcpu=corei7 -disable-cgp < %s | FileCheck %s
+
+; Without AVX2 the target has no gathers or scatters. They are expanded into
+; scalar loads and stores even when CodeGenPrepare does not run.
+
+; CHECK-LABEL: gather:
+; CHECK-NOT: vpgather
+; CHECK: # %cond.load{{$}}
+; CHECK: # %cond.load1{{$}}
+; CHECK: # %cond.load4{{$}}
+; CHECK: # %cond.load7{{$}}
+; CHECK: retq
+define <4 x i32> @gather(<4 x i32*> %ptrs, <4 x i32> %trigger, <4 x i32> %passthru) {
+  %mask = icmp sgt <4 x i32> %trigger, zeroinitializer
+  %res = call <4 x i32> @llvm.masked.gather.v4i32(<4 x i32*> %ptrs, i32 4, <4 x i1> %mask, <4 x i32> %passthru)
+  ret <4 x i32> %res
+}
+
+; CHECK-LABEL: scatter:
+; CHECK-NOT: vpscatter
+; CHECK: # %cond.store{{$}}
+; CHECK: # %cond.store1{{$}}
+; CHECK: # %cond.store3{{$}}
+; CHECK: # %cond.store5{{$}}
+; CHECK: retq
+define void @scatter(<4 x i32> %val, <4 x i32*> %ptrs, <4 x i32> %trigger) {
+  %mask = icmp sgt <4 x i32> %trigger, zeroinitializer
+  call void @llvm.masked.scatter.v4i32(<4 x i32> %val, <4 x i32*> %ptrs, i32 4, <4 x i1> %mask)
+  ret void
+}
+
+declare <4 x i32> @llvm.masked.gather.v4i32(<4 x i32*>, i32, <4 x i1>, <4 x i32>)
+declare void @llvm.masked.scatter.v4i32(<4 x i32>, <4 x i32*>, i32, <4 x i1>)
@@ -0,0 +1,88 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -regalloc-work-budget=1 \
+; RUN:   -pass-remarks-missed=regalloc 2>&1 | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu \
+; RUN:   -pass-remarks-missed=regalloc 2>&1 | FileCheck %s -check-prefix=NOBUDGET
+
+; Twenty values live across a call need more registers than there are
+; callee-saved ones. With a tiny work budget the allocator gives up on
+; eviction and splitting early, says so, and still allocates everything.
+
+; CHECK: remark: <unknown>:0:0: register allocation exceeded its work budget of 1; the remaining live ranges are spilled instead of being split
+; CHECK-LABEL: pressure:
+; CHECK: callq f
+; CHECK: retq
+
+; NOBUDGET-NOT: remark
+; NOBUDGET-LABEL: pressure:
+; NOBUDGET: retq
+; NOBUDGET-NOT: remark
+
+@g = global [20 x i64] zeroinitializer
+
+declare void @f()
+
+define void @pressure() {
+entry:
+  %p0 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 0
+  %v0 = load volatile i64, i64* %p0
+  %p1 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 1
+  %v1 = load volatile i64, i64* %p1
+  %p2 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 2
+  %v2 = load volatile i64, i64* %p2
+  %p3 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 3
+  %v3 = load volatile i64, i64* %p3
+  %p4 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 4
+  %v4 = load volatile i64, i64* %p4
+  %p5 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 5
+  %v5 = load volatile i64, i64* %p5
+  %p6 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 6
+  %v6 = load volatile i64, i64* %p6
+  %p7 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 7
+  %v7 = load volatile i64, i64* %p7
+  %p8 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 8
+  %v8 = load volatile i64, i64* %p8
+  %p9 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 9
+  %v9 = load volatile i64, i64* %p9
+  %p10 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 10
+  %v10 = load volatile i64, i64* %p10
+  %p11 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 11
+  %v11 = load volatile i64, i64* %p11
+  %p12 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 12
+  %v12 = load volatile i64, i64* %p12
+  %p13 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 13
+  %v13 = load volatile i64, i64* %p13
+  %p14 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 14
+  %v14 = load volatile i64, i64* %p14
+  %p15 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 15
+  %v15 = load volatile i64, i64* %p15
+  %p16 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 16
+  %v16 = load volatile i64, i64* %p16
+  %p17 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 17
+  %v17 = load volatile i64, i64* %p17
+  %p18 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 18
+  %v18 = load volatile i64, i64* %p18
+  %p19 = getelementptr [20 x i64], [20 x i64]* @g, i64 0, i64 19
+  %v19 = load volatile i64, i64* %p19
+  call void @f()
+  store volatile i64 %v19, i64* %p19
+  store volatile i64 %v18, i64* %p18
+  store volatile i64 %v17, i64* %p17
+  store volatile i64 %v16, i64* %p16
+  store volatile i64 %v15, i64* %p15
+  store volatile i64 %v14, i64* %p14
+  store volatile i64 %v13, i64* %p13
+  store volatile i64 %v12, i64* %p12
+  store volatile i64 %v11, i64* %p11
+  store volatile i64 %v10, i64* %p10
+  store volatile i64 %v9, i64* %p9
+  store volatile i64 %v8, i64* %p8
+  store volatile i64 %v7, i64* %p7
+  store volatile i64 %v6, i64* %p6
+  store volatile i64 %v5, i64* %p5
+  store volatile i64 %v4, i64* %p4
+  store volatile i64 %v3, i64* %p3
+  store volatile i64 %v2, i64* %p2
+  store volatile i64 %v1, i64* %p1
+  store volatile i64 %v0, i64* %p0
+  ret void
+}
@@ -0,0 +1,22 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -filetype=obj -time-trace \
+; RUN:   -time-trace-granularity=0 -time-trace-file=%t.json -o %t.o %s
+; RUN: FileCheck %s --input-file=%t.json
+
+; Instruction selection phases, register allocation and object emission show
+; up in the trace along with the passes.
+; CHECK: "traceEvents":[
+; CHECK-DAG: "name":"CompileModule"
+; CHECK-DAG: "name":"X86 DAG->DAG Instruction Selection","args":{"detail":"f"}
+; CHECK-DAG: "name":"Instruction Selection"
+; CHECK-DAG: "name":"DAG Legalization"
+; CHECK-DAG: "name":"Greedy Register Allocator","args":{"detail":"f"}
+; CHECK-DAG: "name":"AssembleObject"
+; CHECK-DAG: "name":"RelaxAndLayout"
+; CHECK-DAG: "name":"WriteObject"
+; CHECK: "beginningOfTime":
+
+define i32 @f(i32 %a, i32 %b) {
+  %c = mul i32 %a, %b
+  %d = add i32 %c, %a
+  ret i32 %d
+}
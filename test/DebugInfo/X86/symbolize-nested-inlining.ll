@@ -0,0 +1,102 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -O0 -filetype=obj < %s -o %t.o
+; RUN: echo 0x3 > %t.input
+; RUN: echo 0xd >> %t.input
+; RUN: echo 0x17 >> %t.input
+; RUN: echo 0x21 >> %t.input
+; RUN: echo 0x2b >> %t.input
+; RUN: llvm-symbolizer -obj=%t.o -inlining -functions=linkage < %t.input | FileCheck %s
+
+; Check the inlined chains of the addresses in two nested inlined subroutines
+; and in a sibling inlined subroutine, which are found through the address
+; index of the subroutine DIEs.
+
+; Generated from:
+; void g(int);
+; static inline void inner2(int x) {
+;   g(x);
+; }
+; static inline void inner1(int x) {
+;   g(x);
+;   inner2(x + 1);
+;   g(x + 2);
+; }
+; int main() {
+;   g(0);
+;   inner1(1);
+;   inner2(4);
+;   return 0;
+; }
+; with inner1 and inner2 always inlined and the arguments folded.
+
+; g(0) in main.
+; CHECK: {{^}}main
+; CHECK-NEXT: nested-inlining.c:11:3
+; CHECK-NOT: {{.}}
+
+; g(1) in inner1, inlined into main.
+; CHECK: {{^}}inner1
+; CHECK-NEXT: nested-inlining.c:6:3
+; CHECK-NEXT: main
+; CHECK-NEXT: nested-inlining.c:12:0
+; CHECK-NOT: {{.}}
+
+; g(2) in inner2, inlined into inner1, inlined into main.
+; CHECK: {{^}}inner2
+; CHECK-NEXT: nested-inlining.c:3:3
+; CHECK-NEXT: inner1
+; CHECK-NEXT: nested-inlining.c:7:0
+; CHECK-NEXT: main
+; CHECK-NEXT: nested-inlining.c:12:0
+; CHECK-NOT: {{.}}
+
+; g(3) in inner1 after the nested inlined subroutine.
+; CHECK: {{^}}inner1
+; CHECK-NEXT: nested-inlining.c:8:3
+; CHECK-NEXT: main
+; CHECK-NEXT: nested-inlining.c:12:0
+; CHECK-NOT: {{.}}
+
+; g(4) in the inner2 inlined directly into main.
+; CHECK: {{^}}inner2
+; CHECK-NEXT: nested-inlining.c:3:3
+; CHECK-NEXT: main
+; CHECK-NEXT: nested-inlining.c:13:0
+; CHECK-NOT: {{.}}
+
+define i32 @main() {
+entry:
+  call void @g(i32 0), !dbg !13
+  call void @g(i32 1), !dbg !14
+  call void @g(i32 2), !dbg !16
+  call void @g(i32 3), !dbg !18
+  call void @g(i32 4), !dbg !19
+  ret i32 0, !dbg !21
+}
+
+declare void @g(i32)
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!11, !12}
+
+!0 = !MDCompileUnit(language: DW_LANG_C99, producer: "clang", isOptimized: true, emissionKind: 1, file: !1, enums: !2, retainedTypes: !2, subprograms: !3, globals: !2, imports: !2)
+!1 = !MDFile(filename: "nested-inlining.c", directory: "/tmp")
+!2 = !{}
+!3 = !{!4, !8, !10}
+!4 = !MDSubprogram(name: "main", line: 10, isLocal: false, isDefinition: true, isOptimized: true, scopeLine: 10, file: !1, scope: !1, type: !5, function: i32 ()* @main, variables: !2)
+!5 = !MDSubroutineType(types: !6)
+!6 = !{!7}
+!7 = !MDBasicType(name: "int", size: 32, align: 32, encoding: DW_ATE_signed)
+!8 = !MDSubprogram(name: "inner1", line: 5, isLocal: true, isDefinition: true, flags: DIFlagPrototyped, isOptimized: true, scopeLine: 5, file: !1, scope: !1, type: !9, variables: !2)
+!9 = !MDSubroutineType(types: !{null, !7})
+!10 = !MDSubprogram(name: "inner2", line: 2, isLocal: true, isDefinition: true, flags: DIFlagPrototyped, isOptimized: true, scopeLine: 2, file: !1, scope: !1, type: !9, variables: !2)
+!11 = !{i32 2, !"Dwarf Version", i32 4}
+!12 = !{i32 2, !"Debug Info Version", i32 3}
+!13 = !MDLocation(line: 11, column: 3, scope: !4)
+!14 = !MDLocation(line: 6, column: 3, scope: !8, inlinedAt: !15)
+!15 = distinct !MDLocation(line: 12, column: 3, scope: !4)
+!16 = !MDLocation(line: 3, column: 3, scope: !10, inlinedAt: !17)
+!17 = distinct !MDLocation(line: 7, column: 3, scope: !8, inlinedAt: !15)
+!18 = !MDLocation(line: 8, column: 3, scope: !8, inlinedAt: !15)
+!19 = !MDLocation(line: 3, column: 3, scope: !10, inlinedAt: !20)
+!20 = distinct !MDLocation(line: 13, column: 3, scope: !4)
+!21 = !MDLocation(line: 14, column: 3, scope: !4)
@@ -0,0 +1,21 @@
+; RUN: rm -rf %t.cachedir
+; RUN: %lli -extra-module=%p/Inputs/multi-module-b.ll -extra-module=%p/Inputs/multi-module-c.ll -persistent-object-cache=%t.cachedir -print-startup-time %s 2>&1 | FileCheck %s -check-prefix=COLD
+
+; The second run loads every module from the cache.
+; RUN: %lli -extra-module=%p/Inputs/multi-module-b.ll -extra-module=%p/Inputs/multi-module-c.ll -persistent-object-cache=%t.cachedir -print-startup-time %s 2>&1 | FileCheck %s -check-prefix=WARM
+
+; Objects compiled at another optimization level are not reused.
+; RUN: %lli -O0 -extra-module=%p/Inputs/multi-module-b.ll -extra-module=%p/Inputs/multi-module-c.ll -persistent-object-cache=%t.cachedir -print-startup-time %s 2>&1 | FileCheck %s -check-prefix=COLD
+
+; COLD: startup time:
+; COLD: object cache hits: 0, misses: 3
+
+; WARM: startup time:
+; WARM: object cache hits: 3, misses: 0
+
+declare i32 @FB()
+
+define i32 @main() {
+  %r = call i32 @FB( )   ; <i32> [#uses=1]
+  ret i32 %r
+}
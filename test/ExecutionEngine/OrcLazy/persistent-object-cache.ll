@@ -0,0 +1,28 @@
+; RUN: rm -rf %t.cachedir
+; RUN: lli -jit-kind=orc-lazy -persistent-object-cache=%t.cachedir %s | FileCheck %s
+; RUN: ls %t.cachedir > %t.cold
+;
+; The second run finds every cacheable object, so it adds none.
+; RUN: lli -jit-kind=orc-lazy -persistent-object-cache=%t.cachedir %s | FileCheck %s
+; RUN: ls %t.cachedir > %t.warm
+; RUN: diff %t.cold %t.warm
+;
+; CHECK: 49
+
+@str = private unnamed_addr constant [4 x i8] c"%d\0A\00"
+
+declare i32 @printf(i8*, ...)
+
+define i32 @square(i32 %x) {
+entry:
+  %r = mul i32 %x, %x
+  ret i32 %r
+}
+
+define i32 @main(i32 %argc, i8** %argv) {
+entry:
+  %v = call i32 @square(i32 7)
+  %p = getelementptr inbounds [4 x i8], [4 x i8]* @str, i64 0, i64 0
+  %call = call i32 (i8*, ...) @printf(i8* %p, i32 %v)
+  ret i32 0
+}
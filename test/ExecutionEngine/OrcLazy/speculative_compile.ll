@@ -0,0 +1,40 @@
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-speculative-compile %s | FileCheck %s
+;
+; Check that the callees of main, which are compiled speculatively on the
+; compile thread, and the functions that only they call are run correctly.
+;
+; CHECK: Hello
+; CHECK-NEXT: World
+; CHECK-NEXT: Goodbye
+
+@.str.hello = private unnamed_addr constant [6 x i8] c"Hello\00"
+@.str.world = private unnamed_addr constant [6 x i8] c"World\00"
+@.str.goodbye = private unnamed_addr constant [8 x i8] c"Goodbye\00"
+
+declare i32 @puts(i8*)
+
+define internal void @world() {
+entry:
+  %0 = tail call i32 @puts(i8* getelementptr inbounds ([6 x i8], [6 x i8]* @.str.world, i64 0, i64 0))
+  ret void
+}
+
+define void @hello() {
+entry:
+  %0 = tail call i32 @puts(i8* getelementptr inbounds ([6 x i8], [6 x i8]* @.str.hello, i64 0, i64 0))
+  tail call void @world()
+  ret void
+}
+
+define void @goodbye() {
+entry:
+  %0 = tail call i32 @puts(i8* getelementptr inbounds ([8 x i8], [8 x i8]* @.str.goodbye, i64 0, i64 0))
+  ret void
+}
+
+define i32 @main(i32 %argc, i8** nocapture readnone %argv) {
+entry:
+  tail call void @hello()
+  tail call void @goodbye()
+  ret i32 0
+}
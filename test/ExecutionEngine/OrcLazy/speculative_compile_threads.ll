@@ -0,0 +1,51 @@
+; REQUIRES: asserts
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-speculative-compile -debug-only=orc-cod %s 2> %t.debug | FileCheck %s
+; RUN: FileCheck %s --check-prefix=DEBUG < %t.debug
+;
+; Check that the program runs the same with speculative compiles, and that
+; each function is compiled exactly once. Whether a callee is compiled
+; speculatively or on demand depends on the timing of the threads, so both
+; are accepted.
+;
+; CHECK: Hello
+; CHECK-NEXT: World
+; CHECK-NEXT: Goodbye
+;
+; DEBUG: Compiled main on demand
+; DEBUG-NOT: Compiled main
+; DEBUG-DAG: Compiled hello {{speculatively|on demand}}
+; DEBUG-DAG: Compiled goodbye {{speculatively|on demand}}
+; DEBUG-DAG: Compiled world {{speculatively|on demand}}
+; DEBUG-NOT: Compiled
+
+@.str.hello = private unnamed_addr constant [6 x i8] c"Hello\00"
+@.str.world = private unnamed_addr constant [6 x i8] c"World\00"
+@.str.goodbye = private unnamed_addr constant [8 x i8] c"Goodbye\00"
+
+declare i32 @puts(i8*)
+
+define internal void @world() {
+entry:
+  %0 = tail call i32 @puts(i8* getelementptr inbounds ([6 x i8], [6 x i8]* @.str.world, i64 0, i64 0))
+  ret void
+}
+
+define void @hello() {
+entry:
+  %0 = tail call i32 @puts(i8* getelementptr inbounds ([6 x i8], [6 x i8]* @.str.hello, i64 0, i64 0))
+  tail call void @world()
+  ret void
+}
+
+define void @goodbye() {
+entry:
+  %0 = tail call i32 @puts(i8* getelementptr inbounds ([8 x i8], [8 x i8]* @.str.goodbye, i64 0, i64 0))
+  ret void
+}
+
+define i32 @main(i32 %argc, i8** nocapture readnone %argv) {
+entry:
+  tail call void @hello()
+  tail call void @goodbye()
+  ret i32 0
+}
@@ -0,0 +1,39 @@
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-tier-up-threshold=10 -orc-lazy-print-tier-ups %s 2> %t.err | FileCheck %s
+; RUN: FileCheck --check-prefix=TIER %s < %t.err
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-huge-pages -orc-lazy-tier-up-threshold=10 -orc-lazy-print-tier-ups %s 2> %t.slab.err | FileCheck %s
+; RUN: FileCheck --check-prefix=TIER %s < %t.slab.err
+;
+; Check that a function that is called often enough is recompiled, that a
+; function that is called once is not, and that the program still computes
+; the same result once its calls go to the recompiled function.
+;
+; CHECK: sum = 4950
+; TIER: [tier-up] accumulate -> tier 1
+; TIER-NOT: [tier-up] main
+
+@.str = private unnamed_addr constant [10 x i8] c"sum = %d\0A\00"
+
+declare i32 @printf(i8*, ...)
+
+define internal i32 @accumulate(i32 %acc, i32 %x) {
+entry:
+  %sum = add i32 %acc, %x
+  ret i32 %sum
+}
+
+define i32 @main(i32 %argc, i8** nocapture readnone %argv) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %acc.next = call i32 @accumulate(i32 %acc, i32 %i)
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, 100
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %0 = call i32 (i8*, ...) @printf(i8* getelementptr inbounds ([10 x i8], [10 x i8]* @.str, i64 0, i64 0), i32 %acc.next)
+  ret i32 0
+}
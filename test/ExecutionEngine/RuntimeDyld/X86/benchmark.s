@@ -0,0 +1,28 @@
+# RUN: llvm-mc -triple=x86_64-pc-linux -relocation-model=pic -filetype=obj -o %t %s
+# RUN: llvm-rtdyld -benchmark -benchmark-iterations=3 %t | FileCheck %s
+
+# Check that -benchmark links the inputs the requested number of times and
+# reports the time spent in RuntimeDyld.
+
+# CHECK: objects: 1
+# CHECK-NEXT: relocations: 3
+# CHECK-NEXT: iterations: 3
+# CHECK-NEXT: load time: {{[0-9.]+}}s
+# CHECK-NEXT: resolve time: {{[0-9.]+}}s
+# CHECK-NEXT: relocations/sec: {{[0-9]+}}
+
+	.text
+	.globl	foo
+	.align	16, 0x90
+	.type	foo,@function
+foo:
+	movq	x@GOTPCREL(%rip), %rax
+	leaq	x(%rip), %rcx
+	retq
+.Ltmp0:
+	.size	foo, .Ltmp0-foo
+
+	.data
+	.align	8
+x:
+	.quad	foo
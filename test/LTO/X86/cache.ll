@@ -0,0 +1,35 @@
+; RUN: rm -rf %t.cache
+; RUN: llvm-as -o %t.bc %s
+
+; The first link populates the cache, the second one is served from it.
+; RUN: llvm-lto -exported-symbol=foo -cache-dir=%t.cache -o %t.o %t.bc
+; RUN: ls %t.cache | FileCheck %s --check-prefix=ENTRY
+; RUN: llvm-lto -exported-symbol=foo -cache-dir=%t.cache -o %t2.o %t.bc
+; RUN: cmp %t.o %t2.o
+; RUN: llvm-nm %t2.o | FileCheck %s
+
+; A different option misses the cache and adds a second entry.
+; RUN: llvm-lto -exported-symbol=foo -disable-inlining -cache-dir=%t.cache \
+; RUN:     -o %t3.o %t.bc
+; RUN: ls %t.cache | FileCheck %s --check-prefix=TWO
+; RUN: llvm-nm %t3.o | FileCheck %s
+
+; Pruning with a one-byte size limit removes every entry.
+; RUN: llvm-lto -exported-symbol=foo -disable-gvn-loadpre -cache-dir=%t.cache \
+; RUN:     -cache-pruning-interval=0 -cache-max-size=1 -o %t4.o %t.bc
+; RUN: ls %t.cache | FileCheck %s --check-prefix=PRUNED
+
+; ENTRY: llvmcache-{{[0-9a-f]+}}-0
+
+; TWO: llvmcache-{{[0-9a-f]+}}-0
+; TWO: llvmcache-{{[0-9a-f]+}}-0
+
+; PRUNED-NOT: llvmcache-
+
+; CHECK: T foo
+
+target triple = "x86_64-unknown-linux-gnu"
+
+define void @foo() {
+  ret void
+}
@@ -0,0 +1,40 @@
+; RUN: llvm-as -function-summary -o %t.bc %s
+; RUN: llvm-as -function-summary -o %t2.bc %p/Inputs/thinlto.ll
+
+; The combined index lists both modules.
+; RUN: llvm-lto -thinlto-action=thinlink -o %t3 %t.bc %t2.bc
+; RUN: llvm-bcanalyzer -dump %t3.thinlto.bc | FileCheck %s --check-prefix=COMBINED
+; COMBINED: <FUNCTION_SUMMARY_BLOCK
+; COMBINED: <MODULE_PATH{{.*}} op0=0 op1=
+; COMBINED: <MODULE_PATH{{.*}} op0=1 op1=
+; COMBINED: </FUNCTION_SUMMARY_BLOCK>
+
+; Each module is compiled to its own object file. @helper is imported into the
+; first module and inlined, so that module no longer refers to it.
+; RUN: llvm-lto -thinlto-action=run -j2 -o %t.o %t.bc %t2.bc
+; RUN: llvm-nm %t.o | FileCheck %s --check-prefix=CHECK0
+; RUN: llvm-nm %t.o.1 | FileCheck %s --check-prefix=CHECK1
+; CHECK0-NOT: helper
+; CHECK0: T main
+; CHECK0-NOT: helper
+; CHECK1: T helper
+
+; With a cache, each module has its own entry and a second link reuses them.
+; RUN: rm -rf %t.cache
+; RUN: llvm-lto -thinlto-action=run -cache-dir=%t.cache -o %t4.o %t.bc %t2.bc
+; RUN: ls %t.cache | FileCheck %s --check-prefix=CACHE
+; RUN: llvm-lto -thinlto-action=run -cache-dir=%t.cache -o %t5.o %t.bc %t2.bc
+; RUN: cmp %t4.o %t5.o
+; RUN: cmp %t4.o.1 %t5.o.1
+; CACHE: llvmcache-
+; CACHE: llvmcache-
+
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @main() {
+entry:
+  %call = call i32 @helper()
+  ret i32 %call
+}
+
+declare i32 @helper()
@@ -0,0 +1,43 @@
+// Writing the sections concurrently must produce the same object as writing
+// them one after the other.
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o %t.serial
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu -elf-parallel-write-min-size=0 %s -o %t.parallel
+// RUN: cmp %t.serial %t.parallel
+// RUN: llvm-mc -filetype=obj -triple i386-pc-linux-gnu %s -o %t.serial32
+// RUN: llvm-mc -filetype=obj -triple i386-pc-linux-gnu -elf-parallel-write-min-size=0 %s -o %t.parallel32
+// RUN: cmp %t.serial32 %t.parallel32
+
+        .text
+        .globl  foo
+        .type   foo,@function
+foo:
+        call    bar
+        jmp     .Lend
+        .fill   300, 1, 0x90
+.Lend:
+        ret
+
+        .section .text.other,"ax",@progbits
+        .p2align 6
+bar:
+        movl    data, %eax
+        ret
+
+        .data
+        .p2align 4
+data:
+        .long   foo
+        .long   bar
+        .zero   37
+        .byte   1
+
+        .section .rodata.str1.1,"aMS",@progbits,1
+        .asciz  "hello"
+        .asciz  "world"
+
+        .bss
+        .p2align 5
+        .zero   128
+
+        .section .debug_str,"MS",@progbits,1
+        .asciz  "producer"
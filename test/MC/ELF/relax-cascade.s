@@ -0,0 +1,20 @@
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o - | llvm-nm - | FileCheck %s
+
+// The first jump is in range until the second one is relaxed. Nothing else
+// changes between the first jump and its target, so it is only relaxed if the
+// assembler notices that the distance to the target moved.
+
+// CHECK: 0000000000000085 t target1
+// CHECK: 000000000000014d t target2
+// CHECK: 00000000000001b3 t target3
+
+        jmp target1
+        .fill 123, 1, 0x90
+        jmp target2
+target1:
+        .fill 200, 1, 0x90
+target2:
+        jmp target3
+        .fill 100, 1, 0x90
+target3:
+        ret
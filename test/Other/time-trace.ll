@@ -0,0 +1,34 @@
+; RUN: opt -time-trace -time-trace-granularity=0 -time-trace-file=%t.json \
+; RUN:   -instcombine -loop-rotate -inline -disable-output %s
+; RUN: FileCheck %s --input-file=%t.json
+
+; Every pass invocation is an event that names what it ran on, and the totals
+; follow on a thread of their own.
+; CHECK: "traceEvents":[
+; CHECK-DAG: "name":"Parse IR"
+; CHECK-DAG: "name":"Combine redundant instructions","args":{"detail":"loop"}
+; CHECK-DAG: "name":"Rotate Loops","args":{"detail":"loop:header"}
+; CHECK-DAG: "name":"Function Integration/Inlining","args":{"detail":"caller"}
+; CHECK-DAG: "name":"RunFunctionPasses","args":{"detail":"caller"}
+; CHECK-DAG: "name":"Total RunFunctionPasses","args":{"detail":"{{[0-9]+}} events"}
+; CHECK-DAG: "ph":"M","ts":0,"name":"process_name"
+; CHECK: "beginningOfTime":
+
+define void @loop(i32 %n) {
+entry:
+  br label %header
+
+header:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %header ]
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %header, label %exit
+
+exit:
+  ret void
+}
+
+define void @caller() {
+  call void @loop(i32 10)
+  ret void
+}
@@ -0,0 +1,65 @@
+; RUN: opt < %s -S -early-cse | FileCheck %s --check-prefix=CHECK-NOMEMSSA
+; RUN: opt < %s -S -basicaa -early-cse-memssa -verify-memoryssa | FileCheck %s
+
+@G1 = global i32 zeroinitializer
+@G2 = global i32 zeroinitializer
+
+;; Simple load value numbering across non-clobbering store.
+; CHECK-LABEL: @test1(
+; CHECK-NOMEMSSA-LABEL: @test1(
+define i32 @test1() {
+  %V1 = load i32, i32* @G1
+  store i32 0, i32* @G2
+  %V2 = load i32, i32* @G1
+  ; CHECK-NOMEMSSA: sub i32 %V1, %V2
+  %Diff = sub i32 %V1, %V2
+  ret i32 %Diff
+  ; CHECK: ret i32 0
+}
+
+;; Load value numbering across a join point whose incoming stores do not
+;; clobber the load.
+; CHECK-LABEL: @test2(
+; CHECK-NOMEMSSA-LABEL: @test2(
+define i32 @test2(i1 %c) {
+entry:
+  %V1 = load i32, i32* @G1
+  br i1 %c, label %then, label %end
+
+then:
+  store i32 0, i32* @G2
+  br label %end
+
+end:
+  %V2 = load i32, i32* @G1
+  ; CHECK-NOMEMSSA: sub i32 %V1, %V2
+  %Diff = sub i32 %V1, %V2
+  ret i32 %Diff
+  ; CHECK: ret i32 0
+}
+
+;; A store that may alias the load blocks value numbering.
+; CHECK-LABEL: @test3(
+define i32 @test3(i32* %p) {
+  %V1 = load i32, i32* @G1
+  store i32 0, i32* %p
+  %V2 = load i32, i32* @G1
+  ; CHECK: sub i32 %V1, %V2
+  %Diff = sub i32 %V1, %V2
+  ret i32 %Diff
+}
+
+;; Forward a store to a load across a non-clobbering store, and remove a dead
+;; store while keeping Memory SSA up to date.
+; CHECK-LABEL: @test4(
+define i32 @test4() {
+  ; CHECK-NOT: store i32 1, i32* @G1
+  store i32 1, i32* @G1
+  ; CHECK: store i32 2, i32* @G1
+  store i32 2, i32* @G1
+  ; CHECK: store i32 3, i32* @G2
+  store i32 3, i32* @G2
+  %V = load i32, i32* @G1
+  ; CHECK: ret i32 2
+  ret i32 %V
+}
@@ -0,0 +1,28 @@
+define i32 @importable() {
+entry:
+  %call = call i32 @callee()
+  ret i32 %call
+}
+
+define i32 @callee() {
+entry:
+  ret i32 42
+}
+
+define i32 @noinline() noinline {
+entry:
+  ret i32 1
+}
+
+define i32 @cold() cold {
+entry:
+  ret i32 2
+}
+
+@local_var = internal global i32 3
+
+define i32 @references_local() {
+entry:
+  %v = load i32, i32* @local_var
+  ret i32 %v
+}
@@ -0,0 +1,35 @@
+; RUN: llvm-as -function-summary %s -o %t.bc
+; RUN: llvm-as -function-summary %p/Inputs/funcimport.ll -o %t2.bc
+; RUN: llvm-lto -thinlto-action=thinlink -o %t3 %t.bc %t2.bc
+; RUN: opt -function-import -summary-file %t3.thinlto.bc %t.bc -S | FileCheck %s
+; RUN: opt -function-import -summary-file %t3.thinlto.bc -import-instr-limit=2 %t.bc -S | FileCheck %s --check-prefix=LIMIT
+
+; The callee of an imported function is imported as well.
+; CHECK-DAG: define available_externally i32 @importable()
+; CHECK-DAG: define available_externally i32 @callee()
+
+; Functions that are noinline, cold, or refer to a local of their module are
+; not imported.
+; CHECK-DAG: declare i32 @noinline()
+; CHECK-DAG: declare i32 @cold()
+; CHECK-DAG: declare i32 @references_local()
+
+; Only functions with less than import-instr-limit instructions are imported.
+; LIMIT: declare i32 @importable()
+
+define i32 @main() {
+entry:
+  %a = call i32 @importable()
+  %b = call i32 @noinline()
+  %c = call i32 @cold()
+  %d = call i32 @references_local()
+  %s1 = add i32 %a, %b
+  %s2 = add i32 %s1, %c
+  %s3 = add i32 %s2, %d
+  ret i32 %s3
+}
+
+declare i32 @importable()
+declare i32 @noinline()
+declare i32 @cold()
+declare i32 @references_local()
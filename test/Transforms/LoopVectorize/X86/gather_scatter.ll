@@ -0,0 +1,93 @@
+; RUN: opt < %s -basicaa -loop-vectorize -mtriple=x86_64-unknown-linux -mcpu=knl -force-vector-interleave=1 -S | FileCheck %s -check-prefix=AVX512
+; RUN: opt < %s -basicaa -loop-vectorize -mtriple=x86_64-unknown-linux -mcpu=core-avx2 -force-vector-interleave=1 -S | FileCheck %s -check-prefix=AVX2
+; RUN: opt < %s -basicaa -loop-vectorize -mtriple=x86_64-unknown-linux -mcpu=corei7-avx -force-vector-interleave=1 -S | FileCheck %s -check-prefix=AVX1
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The source code:
+;
+;void foo1(float * __restrict__ in, float * __restrict__ out, int * __restrict__ trigger, int * __restrict__ index) {
+;
+;  for (int i=0; i < 4096; i++) {
+;    if (trigger[i] > 0) {
+;      out[i] = in[index[i]] + (float) 0.5;
+;    }
+;  }
+;}
+
+; AVX512-LABEL: @foo1
+; AVX512: getelementptr inbounds float, <8 x float*> %{{.*}}, <8 x i64>
+; AVX512: call <8 x float> @llvm.masked.gather.v8f32(<8 x float*> {{.*}}, i32 4, <8 x i1> {{.*}}, <8 x float> undef)
+; AVX512: call void @llvm.masked.store.v8f32
+
+; AVX1-LABEL: @foo1
+; AVX1-NOT: llvm.masked
+
+define void @foo1(float* noalias %in, float* noalias %out, i32* noalias %trigger, i32* noalias %index) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.inc ]
+  %arrayidx = getelementptr inbounds i32, i32* %trigger, i64 %indvars.iv
+  %0 = load i32, i32* %arrayidx, align 4
+  %cmp1 = icmp sgt i32 %0, 0
+  br i1 %cmp1, label %if.then, label %for.inc
+
+if.then:
+  %arrayidx3 = getelementptr inbounds i32, i32* %index, i64 %indvars.iv
+  %1 = load i32, i32* %arrayidx3, align 4
+  %idxprom4 = sext i32 %1 to i64
+  %arrayidx5 = getelementptr inbounds float, float* %in, i64 %idxprom4
+  %2 = load float, float* %arrayidx5, align 4
+  %add = fadd float %2, 5.000000e-01
+  %arrayidx7 = getelementptr inbounds float, float* %out, i64 %indvars.iv
+  store float %add, float* %arrayidx7, align 4
+  br label %for.inc
+
+for.inc:
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, 4096
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; The source code:
+;
+;void foo2(double * __restrict__ in, double * __restrict__ out, int * __restrict__ index) {
+;
+;  for (int i=0; i < 4096; i++) {
+;    out[index[i]] = in[i] * 2.0;
+;  }
+;}
+
+; AVX512-LABEL: @foo2
+; AVX512: getelementptr inbounds double, <8 x double*> %{{.*}}, <8 x i64>
+; AVX512: call void @llvm.masked.scatter.v8f64(<8 x double> {{.*}}, <8 x double*> {{.*}}, i32 8, <8 x i1> <i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true, i1 true>)
+
+; AVX2-LABEL: @foo2
+; AVX2-NOT: llvm.masked.scatter
+
+define void @foo2(double* noalias %in, double* noalias %out, i32* noalias %index) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds double, double* %in, i64 %indvars.iv
+  %0 = load double, double* %arrayidx, align 8
+  %mul = fmul double %0, 2.000000e+00
+  %arrayidx2 = getelementptr inbounds i32, i32* %index, i64 %indvars.iv
+  %1 = load i32, i32* %arrayidx2, align 4
+  %idxprom = sext i32 %1 to i64
+  %arrayidx4 = getelementptr inbounds double, double* %out, i64 %idxprom
+  store double %mul, double* %arrayidx4, align 8
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, 4096
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
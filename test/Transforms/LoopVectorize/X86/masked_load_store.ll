@@ -276,11 +276,13 @@ for.end:                                          ; preds = %for.cond
 ;}
 
 ;AVX2-LABEL: @foo4
-;AVX2-NOT: llvm.masked
+;AVX2-NOT: llvm.masked.load
+;AVX2: llvm.masked.gather
 ;AVX2: ret void
 
 ;AVX512-LABEL: @foo4
-;AVX512-NOT: llvm.masked
+;AVX512-NOT: llvm.masked.load
+;AVX512: llvm.masked.gather
 ;AVX512: ret void
 
 ; Function Attrs: nounwind uwtable
@@ -0,0 +1,177 @@
+; RUN: opt -S -loop-vectorize -force-vector-width=4 -force-vector-interleave=1 -enable-interleaved-mem-accesses=true -runtime-memory-check-threshold=24 < %s | FileCheck %s
+; RUN: opt -S -loop-vectorize -force-vector-width=4 -force-vector-interleave=1 -enable-interleaved-mem-accesses=false -runtime-memory-check-threshold=24 < %s | FileCheck %s --check-prefix=DISABLED
+
+target datalayout = "e-m:e-i64:64-i128:128-n32:64-S128"
+
+; Check vectorization on an interleaved load group of factor 2 and an
+; interleaved store group of factor 2.
+
+; int AB[1024];
+; int CD[1024];
+;  void test_array_load2_store2(int C, int D) {
+;   for (int i = 0; i < 1024; i+=2) {
+;     int A = AB[i];
+;     int B = AB[i+1];
+;     CD[i] = A + C;
+;     CD[i+1] = B * D;
+;   }
+; }
+
+; CHECK-LABEL: @test_array_load2_store2(
+; CHECK: %wide.vec = load <8 x i32>, <8 x i32>* %{{.*}}, align 4
+; CHECK: shufflevector <8 x i32> %wide.vec, <8 x i32> undef, <4 x i32> <i32 0, i32 2, i32 4, i32 6>
+; CHECK: shufflevector <8 x i32> %wide.vec, <8 x i32> undef, <4 x i32> <i32 1, i32 3, i32 5, i32 7>
+; CHECK: add nsw <4 x i32>
+; CHECK: mul nsw <4 x i32>
+; CHECK: %interleaved.vec = shufflevector <8 x i32> {{.*}}, <8 x i32> <i32 0, i32 4, i32 1, i32 5, i32 2, i32 6, i32 3, i32 7>
+; CHECK: store <8 x i32> %interleaved.vec, <8 x i32>* %{{.*}}, align 4
+
+; DISABLED-LABEL: @test_array_load2_store2(
+; DISABLED-NOT: load <8 x i32>
+; DISABLED-NOT: store <8 x i32>
+; DISABLED: ret void
+
+@AB = common global [1024 x i32] zeroinitializer, align 4
+@CD = common global [1024 x i32] zeroinitializer, align 4
+
+define void @test_array_load2_store2(i32 %C, i32 %D) {
+entry:
+  br label %for.body
+
+for.body:                                         ; preds = %for.body, %entry
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx0 = getelementptr inbounds [1024 x i32], [1024 x i32]* @AB, i64 0, i64 %indvars.iv
+  %tmp = load i32, i32* %arrayidx0, align 4
+  %tmp1 = add nuw nsw i64 %indvars.iv, 1
+  %arrayidx1 = getelementptr inbounds [1024 x i32], [1024 x i32]* @AB, i64 0, i64 %tmp1
+  %tmp2 = load i32, i32* %arrayidx1, align 4
+  %add = add nsw i32 %tmp, %C
+  %mul = mul nsw i32 %tmp2, %D
+  %arrayidx2 = getelementptr inbounds [1024 x i32], [1024 x i32]* @CD, i64 0, i64 %indvars.iv
+  store i32 %add, i32* %arrayidx2, align 4
+  %arrayidx3 = getelementptr inbounds [1024 x i32], [1024 x i32]* @CD, i64 0, i64 %tmp1
+  store i32 %mul, i32* %arrayidx3, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 2
+  %cmp = icmp slt i64 %indvars.iv.next, 1024
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:                                          ; preds = %for.body
+  ret void
+}
+
+; Check vectorization on an interleaved load group of factor 3 whose members
+; appear out of order, feeding a consecutive store.
+
+; int A[3072];
+; int S[1024];
+; void test_struct_load3(void) {
+;   for (int i = 0; i < 1024; i++)
+;     S[i] = A[3*i+2] + A[3*i] + A[3*i+1];
+; }
+
+; CHECK-LABEL: @test_struct_load3(
+; CHECK: %wide.vec = load <12 x i32>, <12 x i32>* %{{.*}}, align 4
+; CHECK-DAG: shufflevector <12 x i32> %wide.vec, <12 x i32> undef, <4 x i32> <i32 0, i32 3, i32 6, i32 9>
+; CHECK-DAG: shufflevector <12 x i32> %wide.vec, <12 x i32> undef, <4 x i32> <i32 1, i32 4, i32 7, i32 10>
+; CHECK-DAG: shufflevector <12 x i32> %wide.vec, <12 x i32> undef, <4 x i32> <i32 2, i32 5, i32 8, i32 11>
+; CHECK: store <4 x i32>
+
+@A = common global [3072 x i32] zeroinitializer, align 4
+@S = common global [1024 x i32] zeroinitializer, align 4
+
+define void @test_struct_load3() {
+entry:
+  br label %for.body
+
+for.body:                                         ; preds = %for.body, %entry
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %mul = mul nuw nsw i64 %indvars.iv, 3
+  %idx2 = add nuw nsw i64 %mul, 2
+  %arrayidx2 = getelementptr inbounds [3072 x i32], [3072 x i32]* @A, i64 0, i64 %idx2
+  %tmp2 = load i32, i32* %arrayidx2, align 4
+  %arrayidx0 = getelementptr inbounds [3072 x i32], [3072 x i32]* @A, i64 0, i64 %mul
+  %tmp0 = load i32, i32* %arrayidx0, align 4
+  %idx1 = add nuw nsw i64 %mul, 1
+  %arrayidx1 = getelementptr inbounds [3072 x i32], [3072 x i32]* @A, i64 0, i64 %idx1
+  %tmp1 = load i32, i32* %arrayidx1, align 4
+  %add0 = add nsw i32 %tmp2, %tmp0
+  %add1 = add nsw i32 %add0, %tmp1
+  %arrayidx = getelementptr inbounds [1024 x i32], [1024 x i32]* @S, i64 0, i64 %indvars.iv
+  store i32 %add1, i32* %arrayidx, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:                                          ; preds = %for.body
+  ret void
+}
+
+; A load group without its last member would read past the last element that
+; the loop accesses, so the loads are not grouped.
+
+; void test_load_gap_at_end(int *B) {
+;   for (int i = 0; i < 1024; i++)
+;     B[i] = A[3*i] + A[3*i+1];
+; }
+
+; CHECK-LABEL: @test_load_gap_at_end(
+; CHECK-NOT: %wide.vec
+; CHECK: ret void
+
+define void @test_load_gap_at_end(i32* noalias %B) {
+entry:
+  br label %for.body
+
+for.body:                                         ; preds = %for.body, %entry
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %mul = mul nuw nsw i64 %indvars.iv, 3
+  %arrayidx0 = getelementptr inbounds [3072 x i32], [3072 x i32]* @A, i64 0, i64 %mul
+  %tmp0 = load i32, i32* %arrayidx0, align 4
+  %idx1 = add nuw nsw i64 %mul, 1
+  %arrayidx1 = getelementptr inbounds [3072 x i32], [3072 x i32]* @A, i64 0, i64 %idx1
+  %tmp1 = load i32, i32* %arrayidx1, align 4
+  %add = add nsw i32 %tmp0, %tmp1
+  %arrayidx = getelementptr inbounds i32, i32* %B, i64 %indvars.iv
+  store i32 %add, i32* %arrayidx, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:                                          ; preds = %for.body
+  ret void
+}
+
+; A store group would sink the first store below the load in between, which
+; may read the stored value, so the stores are not grouped.
+
+; void test_store_over_load(int *B) {
+;   for (int i = 0; i < 1024; i+=2) {
+;     CD[i] = 1;
+;     CD[i+1] = B[i];
+;   }
+; }
+
+; CHECK-LABEL: @test_store_over_load(
+; CHECK-NOT: %interleaved.vec
+; CHECK: ret void
+
+define void @test_store_over_load(i32* %B) {
+entry:
+  br label %for.body
+
+for.body:                                         ; preds = %for.body, %entry
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx0 = getelementptr inbounds [1024 x i32], [1024 x i32]* @CD, i64 0, i64 %indvars.iv
+  store i32 1, i32* %arrayidx0, align 4
+  %arrayidxB = getelementptr inbounds i32, i32* %B, i64 %indvars.iv
+  %tmp = load i32, i32* %arrayidxB, align 4
+  %tmp1 = add nuw nsw i64 %indvars.iv, 1
+  %arrayidx1 = getelementptr inbounds [1024 x i32], [1024 x i32]* @CD, i64 0, i64 %tmp1
+  store i32 %tmp, i32* %arrayidx1, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 2
+  %cmp = icmp slt i64 %indvars.iv.next, 1024
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:                                          ; preds = %for.body
+  ret void
+}
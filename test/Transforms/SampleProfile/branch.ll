@@ -1,4 +1,11 @@
 ; RUN: opt < %s -sample-profile -sample-profile-file=%S/Inputs/branch.prof | opt -analyze -branch-prob | FileCheck %s
+;
+; The indexed profile also has a malformed profile for @unused, which is not
+; defined in this module. The reader only decodes the profiles of the functions
+; the module defines, so it never reaches that one.
+; RUN: opt < %s -sample-profile -sample-profile-file=%S/Inputs/branch-unused-malformed.idxprof | opt -analyze -branch-prob | FileCheck %s
+; RUN: not llvm-profdata show --sample %S/Inputs/branch-unused-malformed.idxprof 2>&1 | FileCheck %s --check-prefix=SHOW
+; SHOW: Truncated profile data
 
 ; Original C++ code for this test case:
 ;
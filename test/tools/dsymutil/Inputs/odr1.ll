@@ -0,0 +1,56 @@
+; odr1.macho.x86_64.o is built from this file with:
+;   llc -filetype=obj odr1.ll -o odr1.macho.x86_64.o
+; The IR corresponds to -O0 code for:
+;
+; odr.h:
+;   struct S {
+;     int x;
+;   };
+;
+; odr1.cpp:
+;   #include "odr.h"
+;   int foo(S *s) { return s->x; }
+
+target datalayout = "e-m:o-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.10.0"
+
+%struct.S = type { i32 }
+
+define i32 @_Z3fooP1S(%struct.S* %s) #0 {
+entry:
+  %s.addr = alloca %struct.S*, align 8
+  store %struct.S* %s, %struct.S** %s.addr, align 8
+  call void @llvm.dbg.declare(metadata %struct.S** %s.addr, metadata !14, metadata !MDExpression()), !dbg !15
+  %0 = load %struct.S*, %struct.S** %s.addr, align 8, !dbg !16
+  %x = getelementptr inbounds %struct.S, %struct.S* %0, i32 0, i32 0, !dbg !16
+  %1 = load i32, i32* %x, align 4, !dbg !16
+  ret i32 %1, !dbg !16
+}
+
+declare void @llvm.dbg.declare(metadata, metadata, metadata) #1
+
+attributes #0 = { nounwind ssp uwtable }
+attributes #1 = { nounwind readnone }
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!17, !18}
+
+!0 = !MDCompileUnit(language: DW_LANG_C_plus_plus, producer: "clang", isOptimized: false, emissionKind: 1, file: !1, enums: !2, retainedTypes: !3, subprograms: !8, globals: !2, imports: !2)
+!1 = !MDFile(filename: "odr1.cpp", directory: "/odr")
+!2 = !{}
+!3 = !{!4}
+!4 = !MDCompositeType(tag: DW_TAG_structure_type, name: "S", file: !5, line: 1, size: 32, align: 32, elements: !6, identifier: "_ZTS1S")
+!5 = !MDFile(filename: "./odr.h", directory: "/odr")
+!6 = !{!7}
+!7 = !MDDerivedType(tag: DW_TAG_member, name: "x", scope: !"_ZTS1S", file: !5, line: 2, baseType: !12, size: 32, align: 32)
+!8 = !{!9}
+!9 = !MDSubprogram(name: "foo", linkageName: "_Z3fooP1S", scope: !1, file: !1, line: 2, type: !10, isLocal: false, isDefinition: true, scopeLine: 2, flags: DIFlagPrototyped, isOptimized: false, function: i32 (%struct.S*)* @_Z3fooP1S, variables: !2)
+!10 = !MDSubroutineType(types: !11)
+!11 = !{!12, !13}
+!12 = !MDBasicType(name: "int", size: 32, align: 32, encoding: DW_ATE_signed)
+!13 = !MDDerivedType(tag: DW_TAG_pointer_type, baseType: !"_ZTS1S", size: 64, align: 64)
+!14 = !MDLocalVariable(tag: DW_TAG_arg_variable, name: "s", arg: 1, scope: !9, file: !1, line: 2, type: !13)
+!15 = !MDLocation(line: 2, column: 12, scope: !9)
+!16 = !MDLocation(line: 2, column: 17, scope: !9)
+!17 = !{i32 2, !"Dwarf Version", i32 2}
+!18 = !{i32 2, !"Debug Info Version", i32 3}
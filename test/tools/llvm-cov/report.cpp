@@ -1,5 +1,11 @@
 // RUN: llvm-cov report %S/Inputs/report.covmapping -instr-profile %S/Inputs/report.profdata -filename-equivalence 2>&1 | FileCheck %s
 // RUN: llvm-cov report %S/Inputs/report.covmapping -instr-profile %S/Inputs/report.profdata -filename-equivalence report.cpp 2>&1 | FileCheck -check-prefix=FILT-NEXT %s
+// RUN: llvm-cov report %S/Inputs/report.covmapping -instr-profile %S/Inputs/report.profdata -filename-equivalence -j 2 2>&1 | FileCheck %s
+
+// Files shown on several threads are printed in the order they were given.
+// RUN: llvm-cov show %S/Inputs/report.covmapping -instr-profile %S/Inputs/report.profdata -filename-equivalence %s %S/showExpansions.cpp > %t.serial
+// RUN: llvm-cov show %S/Inputs/report.covmapping -instr-profile %S/Inputs/report.profdata -filename-equivalence -j 2 %s %S/showExpansions.cpp > %t.parallel
+// RUN: diff %t.serial %t.parallel
 
 // CHECK:      Filename   Regions  Miss   Cover  Functions  Executed
 // CHECK-NEXT: ---
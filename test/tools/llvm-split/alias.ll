@@ -0,0 +1,27 @@
+; RUN: llvm-split -o %t %s
+; RUN: llvm-dis -o - %t0 | FileCheck --check-prefix=CHECK0 %s
+; RUN: llvm-dis -o - %t1 | FileCheck --check-prefix=CHECK1 %s
+
+; An alias is emitted by the partition that defines its aliasee. Elsewhere it
+; is referred to through a declaration.
+
+; CHECK0-NOT: = alias
+; CHECK0: define void @g()
+; CHECK0: declare void @a()
+
+; CHECK1: @a = alias void ()* @f
+; CHECK1: define void @f()
+; CHECK1-NOT: define
+
+@a = alias void ()* @f
+
+define void @f() {
+  ret void
+}
+
+define void @g() {
+  call void @a()
+  call void @a()
+  call void @a()
+  ret void
+}
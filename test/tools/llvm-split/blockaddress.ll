@@ -0,0 +1,31 @@
+; RUN: llvm-split -o %t %s
+; RUN: llvm-dis -o - %t0 | FileCheck --check-prefix=CHECK0 %s
+; RUN: llvm-dis -o - %t1 | FileCheck --check-prefix=CHECK1 %s
+
+; A block address can only be formed in the module that defines the function,
+; so its user is emitted next to the function even though both are external.
+
+; CHECK0-NOT: @addr
+; CHECK0-NOT: @f
+; CHECK0: define void @g()
+
+; CHECK1: @addr = global i8* blockaddress(@f, %bb)
+; CHECK1: define void @f()
+; CHECK1-NOT: define
+
+@addr = global i8* blockaddress(@f, %bb)
+
+define void @f() {
+  br label %bb
+bb:
+  ret void
+}
+
+define void @g() {
+  call void @h()
+  call void @h()
+  call void @h()
+  ret void
+}
+
+declare void @h()
@@ -0,0 +1,31 @@
+; RUN: llvm-split -o %t %s
+; RUN: llvm-dis -o - %t0 | FileCheck --check-prefix=CHECK0 %s
+; RUN: llvm-dis -o - %t1 | FileCheck --check-prefix=CHECK1 %s
+
+; All members of a comdat are emitted by the same partition.
+
+$f = comdat any
+
+; CHECK0: $f = comdat any
+; CHECK0: @v = linkonce_odr global i32 0, comdat($f)
+; CHECK0: define linkonce_odr void @f() comdat
+; CHECK0-NOT: define
+
+; CHECK1-NOT: = comdat
+; CHECK1-NOT: comdat(
+; CHECK1: @v = external global i32
+; CHECK1: declare void @f()
+; CHECK1: define void @g()
+
+@v = linkonce_odr global i32 0, comdat($f)
+
+define linkonce_odr void @f() comdat($f) {
+  store i32 1, i32* @v
+  ret void
+}
+
+define void @g() {
+  call void @f()
+  %x = load i32, i32* @v
+  ret void
+}
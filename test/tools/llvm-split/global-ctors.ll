@@ -0,0 +1,29 @@
+; RUN: llvm-split -o %t %s
+; RUN: llvm-dis -o - %t0 | FileCheck --check-prefix=CHECK0 %s
+; RUN: llvm-dis -o - %t1 | FileCheck --check-prefix=CHECK1 %s
+
+; Each partition registers the constructors it defines, and only those.
+
+; CHECK0: @llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @ctor0, i8* null }]
+; CHECK0: @llvm.used = appending global [1 x i8*] [i8* bitcast (void ()* @ctor0 to i8*)]
+; CHECK0: define internal void @ctor0()
+; CHECK0-NOT: define
+
+; CHECK1: @llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @ctor1, i8* null }]
+; CHECK1-NOT: llvm.used
+; CHECK1: define internal void @ctor1()
+; CHECK1-NOT: define
+
+@llvm.global_ctors = appending global [2 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @ctor0, i8* null }, { i32, void ()*, i8* } { i32 65535, void ()* @ctor1, i8* null }]
+@llvm.used = appending global [1 x i8*] [i8* bitcast (void ()* @ctor0 to i8*)], section "llvm.metadata"
+
+define internal void @ctor0() {
+  call void @ext()
+  ret void
+}
+
+define internal void @ctor1() {
+  ret void
+}
+
+declare void @ext()
@@ -0,0 +1,26 @@
+; RUN: llvm-split -o %t %s
+; RUN: llvm-dis -o - %t0 | FileCheck --check-prefix=CHECK0 %s
+; RUN: llvm-dis -o - %t1 | FileCheck --check-prefix=CHECK1 %s
+
+; An internal function is emitted next to its users, so it keeps its linkage.
+
+; CHECK0: define void @a()
+; CHECK0: define internal void @b()
+; CHECK0-NOT: @c
+
+; CHECK1-NOT: @a
+; CHECK1-NOT: @b
+; CHECK1: define void @c()
+
+define void @a() {
+  call void @b()
+  ret void
+}
+
+define internal void @b() {
+  ret void
+}
+
+define void @c() {
+  ret void
+}
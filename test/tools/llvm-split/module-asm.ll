@@ -0,0 +1,16 @@
+; RUN: llvm-split -j3 -o %t %s
+; RUN: llvm-dis -o - %t0 | FileCheck --check-prefix=CHECK0 %s
+; RUN: llvm-dis -o - %t1 | FileCheck --check-prefix=CHECKN %s
+; RUN: llvm-dis -o - %t2 | FileCheck --check-prefix=CHECKN %s
+
+; Module-level inline asm may define symbols, so it is only emitted once.
+
+; CHECK0: module asm ".globl sym"
+; CHECKN-NOT: module asm
+
+module asm ".globl sym"
+module asm "sym:"
+
+define void @f() {
+  ret void
+}
@@ -11,6 +11,9 @@
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/YAMLTraits.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 
@@ -90,3 +93,84 @@ void DebugMap::dump() const { print(errs()); }
 #endif
 }
 }
+
+namespace {
+/// The YAML form of a debug map. It lets tests describe a link without
+/// needing a linker that emits STABS debug maps.
+struct YAMLSymbolMapping {
+  std::string Name;
+  llvm::yaml::Hex64 ObjectAddress;
+  llvm::yaml::Hex64 BinaryAddress;
+  llvm::yaml::Hex32 Size;
+};
+
+struct YAMLDebugMapObject {
+  std::string Filename;
+  std::vector<YAMLSymbolMapping> Symbols;
+};
+
+struct YAMLDebugMap {
+  std::string Triple;
+  std::vector<YAMLDebugMapObject> Objects;
+};
+}
+
+LLVM_YAML_IS_SEQUENCE_VECTOR(YAMLSymbolMapping)
+LLVM_YAML_IS_SEQUENCE_VECTOR(YAMLDebugMapObject)
+
+namespace llvm {
+namespace yaml {
+
+template <> struct MappingTraits<YAMLSymbolMapping> {
+  static void mapping(IO &io, YAMLSymbolMapping &Sym) {
+    io.mapRequired("sym", Sym.Name);
+    io.mapRequired("objAddr", Sym.ObjectAddress);
+    io.mapRequired("binAddr", Sym.BinaryAddress);
+    io.mapOptional("size", Sym.Size, Hex32(0));
+  }
+};
+
+template <> struct MappingTraits<YAMLDebugMapObject> {
+  static void mapping(IO &io, YAMLDebugMapObject &Obj) {
+    io.mapRequired("filename", Obj.Filename);
+    io.mapOptional("symbols", Obj.Symbols);
+  }
+};
+
+template <> struct MappingTraits<YAMLDebugMap> {
+  static void mapping(IO &io, YAMLDebugMap &DM) {
+    io.mapRequired("triple", DM.Triple);
+    io.mapOptional("objects", DM.Objects);
+  }
+};
+}
+
+namespace dsymutil {
+
+ErrorOr<std::unique_ptr<DebugMap>>
+DebugMap::parseYAMLDebugMap(StringRef InputFile, StringRef PrependPath) {
+  auto BufOrErr = MemoryBuffer::getFileOrSTDIN(InputFile);
+  if (auto Err = BufOrErr.getError())
+    return Err;
+
+  YAMLDebugMap YAMLMap;
+  yaml::Input YIn((*BufOrErr)->getBuffer());
+  YIn >> YAMLMap;
+  if (auto Err = YIn.error())
+    return Err;
+
+  auto Result = make_unique<DebugMap>(Triple(YAMLMap.Triple));
+  for (const auto &Obj : YAMLMap.Objects) {
+    SmallString<80> Path(PrependPath);
+    sys::path::append(Path, Obj.Filename);
+    DebugMapObject &DMO = Result->addDebugMapObject(Path);
+    for (const auto &Sym : Obj.Symbols)
+      if (!DMO.addSymbol(Sym.Name, Sym.ObjectAddress, Sym.BinaryAddress,
+                         Sym.Size))
+        errs() << "warning: failed to insert symbol '" << Sym.Name
+               << "' in the debug map.\n";
+  }
+  return std::move(Result);
+}
+}
+}
@@ -85,6 +85,11 @@ public:
 
   const Triple &getTriple() const { return BinaryTriple; }
 
+  /// \brief Read a debug map written in YAML from \p InputFile. The
+  /// object file paths it lists are prefixed with \p PrependPath.
+  static ErrorOr<std::unique_ptr<DebugMap>>
+  parseYAMLDebugMap(StringRef InputFile, StringRef PrependPath);
+
   void print(raw_ostream &OS) const;
 
 #ifndef NDEBUG
@@ -10,7 +10,10 @@
 #include "BinaryHolder.h"
 #include "DebugMap.h"
 #include "dsymutil.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/IntervalMap.h"
+#include "llvm/ADT/PointerIntPair.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/CodeGen/AsmPrinter.h"
@@ -31,8 +34,10 @@
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
+#include <algorithm>
 #include <string>
 #include <tuple>
 
@@ -59,6 +64,87 @@ using HalfOpenIntervalMap =
 
 typedef HalfOpenIntervalMap<uint64_t, int64_t> FunctionIntervals;
 
+class CompileUnit;
+struct DeclContextMapInfo;
+
+/// \brief A DeclContext is a named program scope that is used for ODR
+/// uniquing of types.
+///
+/// The set of DeclContexts for the ODR-subject parts of a program form
+/// a tree whose root is the global scope. Each node is identified by
+/// its tag, its name and the identity of its parent. A C++ type
+/// defined in several compile units maps to the same context in every
+/// one of them: the first time the linker emits a DIE for a context,
+/// its offset becomes the canonical offset of the context, and the
+/// references to the type in later units point at that DIE instead of
+/// a new copy.
+class DeclContext {
+  unsigned QualifiedNameHash;
+  uint32_t Line;
+  uint32_t ByteSize;
+  uint16_t Tag;
+  StringRef Name;
+  StringRef File;
+  const DeclContext &Parent;
+  const DWARFDebugInfoEntryMinimal *LastSeenDIE;
+  uint32_t LastSeenCompileUnitID;
+  uint32_t CanonicalDIEOffset;
+
+  friend struct DeclContextMapInfo;
+
+public:
+  typedef DenseSet<DeclContext *, DeclContextMapInfo> Map;
+
+  DeclContext()
+      : QualifiedNameHash(0), Line(0), ByteSize(0),
+        Tag(dwarf::DW_TAG_compile_unit), Name(), File(), Parent(*this),
+        LastSeenDIE(nullptr), LastSeenCompileUnitID(0), CanonicalDIEOffset(0) {
+  }
+
+  DeclContext(unsigned Hash, uint32_t Line, uint32_t ByteSize, uint16_t Tag,
+              StringRef Name, StringRef File, const DeclContext &Parent,
+              const DWARFDebugInfoEntryMinimal *LastSeenDIE = nullptr,
+              unsigned CUId = 0)
+      : QualifiedNameHash(Hash), Line(Line), ByteSize(ByteSize), Tag(Tag),
+        Name(Name), File(File), Parent(Parent), LastSeenDIE(LastSeenDIE),
+        LastSeenCompileUnitID(CUId), CanonicalDIEOffset(0) {}
+
+  uint32_t getQualifiedNameHash() const { return QualifiedNameHash; }
+
+  /// \brief Record that \p Die of unit \p U maps to this context.
+  /// \returns false if another DIE of that same unit already did, in
+  /// which case the context is ambiguous and must not be uniqued.
+  bool setLastSeenDIE(CompileUnit &U, const DWARFDebugInfoEntryMinimal *Die);
+
+  uint32_t getCanonicalDIEOffset() const { return CanonicalDIEOffset; }
+  void setCanonicalDIEOffset(uint32_t Offset) { CanonicalDIEOffset = Offset; }
+
+  uint16_t getTag() const { return Tag; }
+  StringRef getName() const { return Name; }
+};
+
+/// \brief Info type for the DenseSet storing DeclContext pointers.
+struct DeclContextMapInfo : private DenseMapInfo<DeclContext *> {
+  using DenseMapInfo<DeclContext *>::getEmptyKey;
+  using DenseMapInfo<DeclContext *>::getTombstoneKey;
+
+  static unsigned getHashValue(const DeclContext *Ctxt) {
+    return Ctxt->QualifiedNameHash;
+  }
+
+  static bool isEqual(const DeclContext *LHS, const DeclContext *RHS) {
+    if (RHS == getEmptyKey() || RHS == getTombstoneKey())
+      return RHS == LHS;
+    // The names and files are interned, comparing their addresses is
+    // enough.
+    return LHS->QualifiedNameHash == RHS->QualifiedNameHash &&
+           LHS->Line == RHS->Line && LHS->ByteSize == RHS->ByteSize &&
+           LHS->Name.data() == RHS->Name.data() &&
+           LHS->File.data() == RHS->File.data() &&
+           LHS->Parent.QualifiedNameHash == RHS->Parent.QualifiedNameHash;
+  }
+};
+
 /// \brief Stores all information relating to a compile unit, be it in
 /// its original instance in the object file to its brand new cloned
 /// and linked DIE tree.
@@ -68,15 +154,27 @@ public:
   struct DIEInfo {
     int64_t AddrAdjust; ///< Address offset to apply to the described entity.
     DIE *Clone;         ///< Cloned version of that DIE.
+    DeclContext *Ctxt;  ///< ODR Declaration context.
     uint32_t ParentIdx; ///< The index of this DIE's parent.
     bool Keep;          ///< Is the DIE part of the linked output?
     bool InDebugMap;    ///< Was this DIE's entity found in the map?
   };
 
-  CompileUnit(DWARFUnit &OrigUnit, unsigned ID)
+  CompileUnit(DWARFUnit &OrigUnit, unsigned ID, bool CanUseODR)
       : OrigUnit(OrigUnit), ID(ID), LowPc(UINT64_MAX), HighPc(0), RangeAlloc(),
         Ranges(RangeAlloc), UnitRangeAttribute(nullptr) {
     Info.resize(OrigUnit.getNumDIEs());
+
+    // The ODR only holds for C++.
+    uint64_t Lang = 0;
+    if (const auto *CUDie = OrigUnit.getCompileUnitDIE())
+      Lang = CUDie->getAttributeValueAsUnsignedConstant(
+          &OrigUnit, dwarf::DW_AT_language, 0);
+    HasODR = CanUseODR && (Lang == dwarf::DW_LANG_C_plus_plus ||
+                           Lang == dwarf::DW_LANG_C_plus_plus_03 ||
+                           Lang == dwarf::DW_LANG_C_plus_plus_11 ||
+                           Lang == dwarf::DW_LANG_C_plus_plus_14 ||
+                           Lang == dwarf::DW_LANG_ObjC_plus_plus);
   }
 
   CompileUnit(CompileUnit &&RHS)
@@ -92,6 +190,9 @@ public:
 
   unsigned getUniqueID() const { return ID; }
 
+  /// \brief Can the types of this unit be uniqued with the ODR?
+  bool hasODR() const { return HasODR; }
+
   DIE *getOutputUnitDIE() const { return CUDie.get(); }
   void setOutputUnitDIE(DIE *Die) { CUDie.reset(Die); }
 
@@ -124,9 +225,10 @@ public:
 
   /// \brief Keep track of a forward reference to DIE \p Die in \p
   /// RefUnit by \p Attr. The attribute should be fixed up later to
-  /// point to the absolute offset of \p Die in the debug_info section.
+  /// point to the absolute offset of \p Die in the debug_info section
+  /// or to the canonical offset of \p Ctxt if it is non-null.
   void noteForwardReference(DIE *Die, const CompileUnit *RefUnit,
-                            DIEInteger *Attr);
+                            DeclContext *Ctxt, DIEInteger *Attr);
 
   /// \brief Apply all fixups recored by noteForwardReference().
   void fixupForwardReferences();
@@ -152,6 +254,21 @@ public:
   /// which is stored in the string table at \p Offset.
   void addTypeAccelerator(const DIE *Die, const char *Name, uint32_t Offset);
 
+  /// \brief Get the resolved name of file \p FileNum of the line
+  /// table, if it has been cached.
+  StringRef getResolvedPath(unsigned FileNum) const {
+    return FileNum < ResolvedPaths.size() ? ResolvedPaths[FileNum]
+                                          : StringRef();
+  }
+
+  /// \brief Cache the resolved name of file \p FileNum of the line
+  /// table.
+  void setResolvedPath(unsigned FileNum, StringRef Path) {
+    if (ResolvedPaths.size() <= FileNum)
+      ResolvedPaths.resize(FileNum + 1);
+    ResolvedPaths[FileNum] = Path;
+  }
+
   struct AccelInfo {
     StringRef Name; ///< Name of the entry.
     const DIE *Die; ///< DIE this entry describes.
@@ -185,8 +302,8 @@ private:
   /// The offsets for the attributes in this array couldn't be set while
   /// cloning because for cross-cu forward refences the target DIE's
   /// offset isn't known you emit the reference attribute.
-  std::vector<std::tuple<DIE *, const CompileUnit *, DIEInteger *>>
-      ForwardDIEReferences;
+  std::vector<std::tuple<DIE *, const CompileUnit *, DeclContext *,
+                         DIEInteger *>> ForwardDIEReferences;
 
   FunctionIntervals::Allocator RangeAlloc;
   /// \brief The ranges in that interval map are the PC ranges for
@@ -213,6 +330,13 @@ private:
   std::vector<AccelInfo> Pubnames;
   std::vector<AccelInfo> Pubtypes;
   /// @}
+
+  /// \brief The interned names of the files of the line table, by
+  /// index. Computing them is costly, and every type DIE needs one.
+  std::vector<StringRef> ResolvedPaths;
+
+  /// \brief Is this unit subject to the ODR?
+  bool HasODR;
 };
 
 uint64_t CompileUnit::computeNextUnitOffset() {
@@ -228,8 +352,8 @@ uint64_t CompileUnit::computeNextUnitOffset() {
 /// \brief Keep track of a forward cross-cu reference from this unit
 /// to \p Die that lives in \p RefUnit.
 void CompileUnit::noteForwardReference(DIE *Die, const CompileUnit *RefUnit,
-                                       DIEInteger *Attr) {
-  ForwardDIEReferences.emplace_back(Die, RefUnit, Attr);
+                                       DeclContext *Ctxt, DIEInteger *Attr) {
+  ForwardDIEReferences.emplace_back(Die, RefUnit, Ctxt, Attr);
 }
 
 /// \brief Apply all fixups recorded by noteForwardReference().
@@ -237,9 +361,13 @@ void CompileUnit::fixupForwardReferences() {
   for (const auto &Ref : ForwardDIEReferences) {
     DIE *RefDie;
     const CompileUnit *RefUnit;
+    DeclContext *Ctxt;
     DIEInteger *Attr;
-    std::tie(RefDie, RefUnit, Attr) = Ref;
-    Attr->setValue(RefDie->getOffset() + RefUnit->getStartOffset());
+    std::tie(RefDie, RefUnit, Ctxt, Attr) = Ref;
+    if (Ctxt && Ctxt->getCanonicalDIEOffset())
+      Attr->setValue(Ctxt->getCanonicalDIEOffset());
+    else
+      Attr->setValue(RefDie->getOffset() + RefUnit->getStartOffset());
   }
 }
 
@@ -360,6 +488,205 @@ StringRef NonRelocatableStringpool::internString(StringRef S) {
   return InsertResult.first->getKey();
 }
 
+/// \brief This class gives a tree-like API to the DenseMap that stores
+/// the DeclContext objects. It also holds the BumpPtrAllocator where
+/// these objects will be allocated.
+class DeclContextTree {
+  BumpPtrAllocator Allocator;
+  DeclContext Root;
+  DeclContext::Map Contexts;
+
+public:
+  /// \brief Get the child of \a Context described by \a DIE in \a
+  /// Unit. The required strings will be interned in \a StringPool.
+  /// \returns The child DeclContext along with one bit that is set if
+  /// this context is invalid.
+  ///
+  /// An invalid context means it shouldn't be considered for
+  /// uniquing, but its not returning null, because some children of
+  /// that context might be uniquing candidates.
+  PointerIntPair<DeclContext *, 1>
+  getChildDeclContext(DeclContext &Context,
+                      const DWARFDebugInfoEntryMinimal *DIE, CompileUnit &Unit,
+                      NonRelocatableStringpool &StringPool);
+
+  DeclContext &getRoot() { return Root; }
+};
+
+/// \brief Set the last DIE/CU a context was seen in and, possibly
+/// invalidate the context if it is ambiguous.
+///
+/// In the current implementation, we don't handle overloaded
+/// functions well, because the argument types are not taken into
+/// account when computing the DeclContext tree.
+///
+/// Some of this is mitigated byt using mangled names that do contain
+/// the arguments types, but sometimes (eg. with function templates)
+/// we don't have that. In that case, just do not unique anything that
+/// refers to the contexts we are not able to distinguish.
+///
+/// If a context that is not a namespace appears twice in the same CU,
+/// we know it is ambiguous. Make it invalid.
+bool DeclContext::setLastSeenDIE(CompileUnit &U,
+                                 const DWARFDebugInfoEntryMinimal *Die) {
+  if (LastSeenCompileUnitID == U.getUniqueID()) {
+    DWARFUnit &OrigUnit = U.getOrigUnit();
+    uint32_t FirstIdx = OrigUnit.getDIEIndex(LastSeenDIE);
+    U.getInfo(FirstIdx).Ctxt = nullptr;
+    return false;
+  }
+
+  LastSeenCompileUnitID = U.getUniqueID();
+  LastSeenDIE = Die;
+  return true;
+}
+
+PointerIntPair<DeclContext *, 1> DeclContextTree::getChildDeclContext(
+    DeclContext &Context, const DWARFDebugInfoEntryMinimal *DIE,
+    CompileUnit &U, NonRelocatableStringpool &StringPool) {
+  unsigned Tag = DIE->getTag();
+
+  // FIXME: We should bail out here if we have a specification or an
+  // abstract_origin. We will get the parent context wrong here.
+
+  switch (Tag) {
+  default:
+    // By default stop gathering child contexts.
+    return PointerIntPair<DeclContext *, 1>(nullptr);
+  case dwarf::DW_TAG_compile_unit:
+    // FIXME: Add support for DW_TAG_module.
+    return PointerIntPair<DeclContext *, 1>(&Context);
+  case dwarf::DW_TAG_subprogram:
+    // Do not unique anything inside CU local functions.
+    if ((Context.getTag() == dwarf::DW_TAG_namespace ||
+         Context.getTag() == dwarf::DW_TAG_compile_unit) &&
+        !DIE->getAttributeValueAsUnsignedConstant(&U.getOrigUnit(),
+                                                  dwarf::DW_AT_external, 0))
+      return PointerIntPair<DeclContext *, 1>(nullptr);
+  // Fallthrough
+  case dwarf::DW_TAG_member:
+  case dwarf::DW_TAG_namespace:
+  case dwarf::DW_TAG_structure_type:
+  case dwarf::DW_TAG_class_type:
+  case dwarf::DW_TAG_union_type:
+  case dwarf::DW_TAG_enumeration_type:
+  case dwarf::DW_TAG_typedef:
+    // Artificial things might be ambiguous, because they might be
+    // created on demand. For example implicitely defined constructors
+    // are ambiguous because of the way we identify contexts, and they
+    // won't be generated everytime everywhere.
+    if (DIE->getAttributeValueAsUnsignedConstant(&U.getOrigUnit(),
+                                                 dwarf::DW_AT_artificial, 0))
+      return PointerIntPair<DeclContext *, 1>(nullptr);
+    break;
+  }
+
+  const char *Name = DIE->getName(&U.getOrigUnit(), DINameKind::LinkageName);
+  StringRef NameRef;
+  StringRef FileRef;
+
+  if (Name)
+    NameRef = StringPool.internString(Name);
+  else if (Tag == dwarf::DW_TAG_namespace)
+    // FIXME: For dsymutil-classic compatibility. I think uniquing
+    // within anonymous namespaces is wrong. There is no ODR guarantee
+    // there.
+    NameRef = StringPool.internString("(anonymous namespace)");
+
+  if (Tag != dwarf::DW_TAG_class_type && Tag != dwarf::DW_TAG_structure_type &&
+      Tag != dwarf::DW_TAG_union_type &&
+      Tag != dwarf::DW_TAG_enumeration_type && NameRef.empty())
+    return PointerIntPair<DeclContext *, 1>(nullptr);
+
+  std::string File;
+  unsigned Line = 0;
+  unsigned ByteSize = 0;
+
+  // Gather some discriminating data about the DeclContext we will be
+  // creating: File, line number and byte size. This shouldn't be
+  // necessary, because the ODR is just about names, but given that we
+  // do some approximations with overloaded functions and anonymous
+  // namespaces, use these additional data points to make the process
+  // safer.
+  ByteSize = DIE->getAttributeValueAsUnsignedConstant(
+      &U.getOrigUnit(), dwarf::DW_AT_byte_size, UINT32_MAX);
+  if (Tag != dwarf::DW_TAG_namespace || !Name) {
+    if (unsigned FileNum = DIE->getAttributeValueAsUnsignedConstant(
+            &U.getOrigUnit(), dwarf::DW_AT_decl_file, 0)) {
+      if (const auto *LT = U.getOrigUnit().getContext().getLineTableForUnit(
+              &U.getOrigUnit())) {
+        // FIXME: dsymutil-classic compatibility. I'd rather not
+        // unique anything in anonymous namespaces, but if we do, then
+        // verify that the file and line correspond.
+        if (!Name && Tag == dwarf::DW_TAG_namespace)
+          FileNum = 1;
+
+        // Cache the resolved paths, because building them for every
+        // type DIE would be expensive.
+        FileRef = U.getResolvedPath(FileNum);
+        if (FileRef.empty() &&
+            LT->getFileNameByIndex(
+                FileNum, U.getOrigUnit().getCompilationDir(),
+                DILineInfoSpecifier::FileLineInfoKind::AbsoluteFilePath,
+                File)) {
+          FileRef = StringPool.internString(File);
+          U.setResolvedPath(FileNum, FileRef);
+        }
+        if (!FileRef.empty())
+          Line = DIE->getAttributeValueAsUnsignedConstant(
+              &U.getOrigUnit(), dwarf::DW_AT_decl_line, 0);
+      }
+    }
+  }
+
+  if (!Line && NameRef.empty())
+    return PointerIntPair<DeclContext *, 1>(nullptr);
+
+  // We hash NameRef, which is the mangled name, in order to get most
+  // overloaded functions resolve correctly.
+  //
+  // FIXME: dsymutil-classic won't unique the same type presented once
+  // as a struct and once as a class. Using the Tag in the fully
+  // qualified name hash to get the same effect.
+  unsigned Hash = hash_combine(Context.getQualifiedNameHash(), Tag, NameRef);
+
+  // FIXME: dsymutil-classic compatibility: when we don't have a name,
+  // use the filename.
+  if (Tag == dwarf::DW_TAG_namespace && NameRef == "(anonymous namespace)")
+    Hash = hash_combine(Hash, FileRef);
+
+  // Now look if this context already exists.
+  DeclContext Key(Hash, Line, ByteSize, Tag, NameRef, FileRef, Context);
+  auto ContextIter = Contexts.find(&Key);
+
+  if (ContextIter == Contexts.end()) {
+    // The context wasn't found.
+    bool Inserted;
+    DeclContext *NewContext =
+        new (Allocator) DeclContext(Hash, Line, ByteSize, Tag, NameRef, FileRef,
+                                    Context, DIE, U.getUniqueID());
+    std::tie(ContextIter, Inserted) = Contexts.insert(NewContext);
+    assert(Inserted && "Failed to insert DeclContext");
+    (void)Inserted;
+  } else if (Tag != dwarf::DW_TAG_namespace &&
+             !(*ContextIter)->setLastSeenDIE(U, DIE)) {
+    // The context was found, but it is ambiguous with another context
+    // in the same file. Mark it invalid.
+    return PointerIntPair<DeclContext *, 1>(*ContextIter, /* Invalid= */ 1);
+  }
+
+  assert(ContextIter != Contexts.end());
+  // FIXME: dsymutil-classic compatibility. Union types aren't
+  // uniques, but their children might be.
+  if ((Tag == dwarf::DW_TAG_subprogram &&
+       Context.getTag() != dwarf::DW_TAG_structure_type &&
+       Context.getTag() != dwarf::DW_TAG_class_type) ||
+      (Tag == dwarf::DW_TAG_union_type))
+    return PointerIntPair<DeclContext *, 1>(*ContextIter, /* Invalid= */ 1);
+
+  return PointerIntPair<DeclContext *, 1>(*ContextIter);
+}
+
 /// \brief The Dwarf streaming logic
 ///
 /// All interactions with the MC layer that is used to build the debug
@@ -974,11 +1301,19 @@ void DwarfStreamer::emitPubTypesForUnit(const CompileUnit &Unit) {
 /// a function, the location for a variable). These relocations are
 /// called ValidRelocs in the DwarfLinker and are gathered as a very
 /// first step when we start processing a DebugMapObject.
+///
+/// Mapping an object file, finding its ValidRelocs and parsing its
+/// DIEs does not depend on the other objects. With more than one
+/// thread, this is done for the next objects of the debug map while
+/// the current one is linked. Everything else, which shares the
+/// output string pool, abbreviations, ODR contexts and streamer,
+/// happens on the linking thread in debug map order, so the output
+/// does not depend on the number of threads.
 class DwarfLinker {
 public:
   DwarfLinker(StringRef OutputFilename, const LinkOptions &Options)
       : OutputFilename(OutputFilename), Options(Options),
-        BinHolder(Options.Verbose) {}
+        CurrentDebugObject(nullptr) {}
 
   ~DwarfLinker() {
     for (auto *Abbrev : Abbreviations)
@@ -989,8 +1324,17 @@ public:
   bool link(const DebugMap &);
 
 private:
+  struct LinkContext;
+
+  /// \brief Map the object file of \p DMO with \p BinHolder, find its
+  /// valid relocations and parse its DIEs. This may run on another
+  /// thread than the link, thus it only touches the returned context.
+  std::unique_ptr<LinkContext> loadDebugObject(DebugMapObject &DMO,
+                                               BinaryHolder &BinHolder);
+
   /// \brief Called at the start of a debug object link.
-  void startDebugObject(DWARFContext &, DebugMapObject &);
+  /// \returns false if there is nothing to link in the object.
+  bool startDebugObject(LinkContext &);
 
   /// \brief Called at the end of a debug object link.
   void endDebugObject();
@@ -1012,6 +1356,26 @@ private:
     bool operator<(const ValidReloc &RHS) const { return Offset < RHS.Offset; }
   };
 
+  /// \brief The state of a DebugMapObject that has been loaded but
+  /// not linked yet.
+  struct LinkContext {
+    DebugMapObject &DMO;
+    /// \brief The debug information of the object file, or null if
+    /// there is nothing to link in it.
+    std::unique_ptr<DWARFContextInMemory> DwarfContext;
+    /// \brief The valid relocations, sorted by offset.
+    std::vector<ValidReloc> ValidRelocs;
+    /// \brief The warnings issued while loading. They are reported
+    /// when the object is linked, so that they are not mixed up with
+    /// the ones of the object being linked.
+    std::vector<std::string> Warnings;
+    /// \brief Was the object file found?
+    bool ObjectLoaded;
+
+    explicit LinkContext(DebugMapObject &DMO)
+        : DMO(DMO), ObjectLoaded(false) {}
+  };
+
   /// \brief The valid relocations for the current DebugMapObject.
   /// This vector is sorted by relocation offset.
   std::vector<ValidReloc> ValidRelocs;
@@ -1024,15 +1388,14 @@ private:
   unsigned NextValidReloc;
 
   bool findValidRelocsInDebugInfo(const object::ObjectFile &Obj,
-                                  const DebugMapObject &DMO);
+                                  LinkContext &Context);
 
   bool findValidRelocs(const object::SectionRef &Section,
-                       const object::ObjectFile &Obj,
-                       const DebugMapObject &DMO);
+                       const object::ObjectFile &Obj, LinkContext &Context);
 
   void findValidRelocsMachO(const object::SectionRef &Section,
                             const object::MachOObjectFile &Obj,
-                            const DebugMapObject &DMO);
+                            LinkContext &Context);
   /// @}
 
   /// \defgroup FindRootDIEs Find DIEs corresponding to debug map entries.
@@ -1050,6 +1413,7 @@ private:
     TF_InFunctionScope = 1 << 1, ///< Current scope is a fucntion scope.
     TF_DependencyWalk = 1 << 2,  ///< Walking the dependencies of a kept DIE.
     TF_ParentWalk = 1 << 3,      ///< Walking up the parents of a kept DIE.
+    TF_ODR = 1 << 4,             ///< Use the ODR while keeping dependants.
   };
 
   /// \brief Mark the passed DIE as well as all the ones it depends on
@@ -1057,7 +1421,7 @@ private:
   void keepDIEAndDenpendencies(const DWARFDebugInfoEntryMinimal &DIE,
                                CompileUnit::DIEInfo &MyInfo,
                                const DebugMapObject &DMO, CompileUnit &CU,
-                               unsigned Flags);
+                               bool UseODR);
 
   unsigned shouldKeepDIE(const DWARFDebugInfoEntryMinimal &DIE,
                          CompileUnit &Unit, CompileUnit::DIEInfo &MyInfo,
@@ -1206,7 +1570,6 @@ private:
 private:
   std::string OutputFilename;
   LinkOptions Options;
-  BinaryHolder BinHolder;
   std::unique_ptr<DwarfStreamer> Streamer;
 
   /// The units of the current debug map object.
@@ -1218,6 +1581,13 @@ private:
   /// \brief The Dwarf string pool
   NonRelocatableStringpool StringPool;
 
+  /// \brief The ODR contexts of every object linked so far.
+  DeclContextTree ODRContexts;
+
+  /// \brief The names of the ODR contexts. They are not part of the
+  /// output.
+  NonRelocatableStringpool UniquingStringPool;
+
   /// \brief This map is keyed by the entry PC of functions in that
   /// debug object and the associated value is a pair storing the
   /// corresponding end PC and the offset to apply to get the linked
@@ -1312,6 +1682,31 @@ static void gatherDIEParents(const DWARFDebugInfoEntryMinimal *DIE,
       gatherDIEParents(Child, MyIdx, CU);
 }
 
+/// \brief Recursive helper to build the DeclContext of every DIE of
+/// \p CU. The DIEs that cannot be uniqued get a null context.
+static void analyzeContextInfo(const DWARFDebugInfoEntryMinimal *DIE,
+                               CompileUnit &CU,
+                               DeclContext *CurrentDeclContext,
+                               NonRelocatableStringpool &StringPool,
+                               DeclContextTree &Contexts) {
+  unsigned MyIdx = CU.getOrigUnit().getDIEIndex(DIE);
+  CompileUnit::DIEInfo &Info = CU.getInfo(MyIdx);
+
+  if (CurrentDeclContext) {
+    auto PtrInvalidPair = Contexts.getChildDeclContext(*CurrentDeclContext,
+                                                       DIE, CU, StringPool);
+    CurrentDeclContext = PtrInvalidPair.getPointer();
+    Info.Ctxt =
+        PtrInvalidPair.getInt() ? nullptr : PtrInvalidPair.getPointer();
+  } else
+    Info.Ctxt = CurrentDeclContext = nullptr;
+
+  if (DIE->hasChildren())
+    for (auto *Child = DIE->getFirstChild(); Child && !Child->isNULL();
+         Child = Child->getSibling())
+      analyzeContextInfo(Child, CU, CurrentDeclContext, StringPool, Contexts);
+}
+
 static bool dieNeedsChildrenToBeMeaningful(uint32_t Tag) {
   switch (Tag) {
   default:
@@ -1327,8 +1722,43 @@ static bool dieNeedsChildrenToBeMeaningful(uint32_t Tag) {
   llvm_unreachable("Invalid Tag");
 }
 
-void DwarfLinker::startDebugObject(DWARFContext &Dwarf, DebugMapObject &Obj) {
-  Units.reserve(Dwarf.getNumCompileUnits());
+std::unique_ptr<DwarfLinker::LinkContext>
+DwarfLinker::loadDebugObject(DebugMapObject &DMO, BinaryHolder &BinHolder) {
+  auto Context = llvm::make_unique<LinkContext>(DMO);
+  auto ErrOrObj = BinHolder.GetObjectFile(DMO.getObjectFilename());
+  if (std::error_code EC = ErrOrObj.getError()) {
+    Context->Warnings.push_back(
+        (Twine(DMO.getObjectFilename()) + ": " + EC.message()).str());
+    return Context;
+  }
+
+  // Look for relocations that correspond to debug map entries.
+  Context->ObjectLoaded = true;
+  if (!findValidRelocsInDebugInfo(*ErrOrObj, *Context))
+    return Context;
+
+  // Setup access to the debug info, and parse every DIE now rather
+  // than when the DIE tree is first walked.
+  Context->DwarfContext = llvm::make_unique<DWARFContextInMemory>(*ErrOrObj);
+  for (const auto &CU : Context->DwarfContext->compile_units())
+    CU->getCompileUnitDIE(false);
+  return Context;
+}
+
+bool DwarfLinker::startDebugObject(LinkContext &Context) {
+  DebugMapObject &Obj = Context.DMO;
+  CurrentDebugObject = &Obj;
+
+  for (const std::string &Warning : Context.Warnings)
+    reportWarning(Warning);
+  if (!Context.DwarfContext) {
+    if (Options.Verbose && Context.ObjectLoaded)
+      outs() << "No valid relocations found. Skipping.\n";
+    return false;
+  }
+
+  ValidRelocs.swap(Context.ValidRelocs);
+  Units.reserve(Context.DwarfContext->getNumCompileUnits());
   NextValidReloc = 0;
   // Iterate over the debug map entries and put all the ones that are
   // functions (because they have a size) into the Ranges map. This
@@ -1351,6 +1781,7 @@ void DwarfLinker::startDebugObject(DWARFContext &Dwarf, DebugMapObject &Obj) {
           Mapping.ObjectAddress + Mapping.Size,
           int64_t(Mapping.BinaryAddress) - Mapping.ObjectAddress);
   }
+  return true;
 }
 
 void DwarfLinker::endDebugObject() {
@@ -1373,7 +1804,9 @@ void DwarfLinker::endDebugObject() {
 /// ValidRelocs array.
 void DwarfLinker::findValidRelocsMachO(const object::SectionRef &Section,
                                        const object::MachOObjectFile &Obj,
-                                       const DebugMapObject &DMO) {
+                                       LinkContext &Context) {
+  const DebugMapObject &DMO = Context.DMO;
+  std::vector<ValidReloc> &ValidRelocs = Context.ValidRelocs;
   StringRef Contents;
   Section.getContents(Contents);
   DataExtractor Data(Contents, Obj.isLittleEndian(), 0);
@@ -1384,7 +1817,8 @@ void DwarfLinker::findValidRelocsMachO(const object::SectionRef &Section,
     unsigned RelocSize = 1 << Obj.getAnyRelocationLength(MachOReloc);
     uint64_t Offset64;
     if ((RelocSize != 4 && RelocSize != 8) || Reloc.getOffset(Offset64)) {
-      reportWarning(" unsupported relocation in debug_info section.");
+      Context.Warnings.push_back(
+          " unsupported relocation in debug_info section.");
       continue;
     }
     uint32_t Offset = Offset64;
@@ -1395,7 +1829,7 @@ void DwarfLinker::findValidRelocsMachO(const object::SectionRef &Section,
     if (Sym != Obj.symbol_end()) {
       StringRef SymbolName;
       if (Sym->getName(SymbolName)) {
-        reportWarning("error getting relocation symbol name.");
+        Context.Warnings.push_back("error getting relocation symbol name.");
         continue;
       }
       if (const auto *Mapping = DMO.lookupSymbol(SymbolName))
@@ -1413,13 +1847,15 @@ void DwarfLinker::findValidRelocsMachO(const object::SectionRef &Section,
 /// appropriate handler depending on the object file format.
 bool DwarfLinker::findValidRelocs(const object::SectionRef &Section,
                                   const object::ObjectFile &Obj,
-                                  const DebugMapObject &DMO) {
+                                  LinkContext &Context) {
   // Dispatch to the right handler depending on the file type.
   if (auto *MachOObj = dyn_cast<object::MachOObjectFile>(&Obj))
-    findValidRelocsMachO(Section, *MachOObj, DMO);
+    findValidRelocsMachO(Section, *MachOObj, Context);
   else
-    reportWarning(Twine("unsupported object file type: ") + Obj.getFileName());
+    Context.Warnings.push_back(
+        (Twine("unsupported object file type: ") + Obj.getFileName()).str());
 
+  std::vector<ValidReloc> &ValidRelocs = Context.ValidRelocs;
   if (ValidRelocs.empty())
     return false;
 
@@ -1437,7 +1873,7 @@ bool DwarfLinker::findValidRelocs(const object::SectionRef &Section,
 /// linked binary.
 /// \returns wether there are any valid relocations in the debug info.
 bool DwarfLinker::findValidRelocsInDebugInfo(const object::ObjectFile &Obj,
-                                             const DebugMapObject &DMO) {
+                                             LinkContext &Context) {
   // Find the debug_info section.
   for (const object::SectionRef &Section : Obj.sections()) {
     StringRef SectionName;
@@ -1445,7 +1881,7 @@ bool DwarfLinker::findValidRelocsInDebugInfo(const object::ObjectFile &Obj,
     SectionName = SectionName.substr(SectionName.find_first_not_of("._"));
     if (SectionName != "debug_info")
       continue;
-    return findValidRelocs(Section, Obj, DMO);
+    return findValidRelocs(Section, Obj, Context);
   }
   return false;
 }
@@ -1622,6 +2058,22 @@ unsigned DwarfLinker::shouldKeepDIE(const DWARFDebugInfoEntryMinimal &DIE,
   return Flags;
 }
 
+/// \brief Is \p Attr a reference that can point at the canonical DIE
+/// of an ODR context rather than at a DIE of the same unit?
+static bool isODRAttribute(uint16_t Attr) {
+  switch (Attr) {
+  default:
+    return false;
+  case dwarf::DW_AT_type:
+  case dwarf::DW_AT_containing_type:
+  case dwarf::DW_AT_specification:
+  case dwarf::DW_AT_abstract_origin:
+  case dwarf::DW_AT_import:
+    return true;
+  }
+  llvm_unreachable("Improper attribute.");
+}
+
 /// \brief Mark the passed DIE as well as all the ones it depends on
 /// as kept.
 ///
@@ -1633,15 +2085,16 @@ unsigned DwarfLinker::shouldKeepDIE(const DWARFDebugInfoEntryMinimal &DIE,
 void DwarfLinker::keepDIEAndDenpendencies(const DWARFDebugInfoEntryMinimal &DIE,
                                           CompileUnit::DIEInfo &MyInfo,
                                           const DebugMapObject &DMO,
-                                          CompileUnit &CU, unsigned Flags) {
+                                          CompileUnit &CU, bool UseODR) {
   const DWARFUnit &Unit = CU.getOrigUnit();
   MyInfo.Keep = true;
 
   // First mark all the parent chain as kept.
   unsigned AncestorIdx = MyInfo.ParentIdx;
   while (!CU.getInfo(AncestorIdx).Keep) {
+    unsigned ODRFlag = UseODR ? TF_ODR : 0;
     lookForDIEsToKeep(*Unit.getDIEAtIndex(AncestorIdx), DMO, CU,
-                      TF_ParentWalk | TF_Keep | TF_DependencyWalk);
+                      TF_ParentWalk | TF_Keep | TF_DependencyWalk | ODRFlag);
     AncestorIdx = CU.getInfo(AncestorIdx).ParentIdx;
   }
 
@@ -1662,9 +2115,24 @@ void DwarfLinker::keepDIEAndDenpendencies(const DWARFDebugInfoEntryMinimal &DIE,
 
     Val.extractValue(Data, &Offset, &Unit);
     CompileUnit *ReferencedCU;
-    if (const auto *RefDIE = resolveDIEReference(Val, Unit, DIE, ReferencedCU))
+    if (const auto *RefDIE =
+            resolveDIEReference(Val, Unit, DIE, ReferencedCU)) {
+      uint32_t RefIdx = ReferencedCU->getOrigUnit().getDIEIndex(RefDIE);
+      CompileUnit::DIEInfo &Info = ReferencedCU->getInfo(RefIdx);
+      // If the referenced DIE has a DeclContext that has already been
+      // emitted, then do not keep the one in this CU. We'll link to
+      // the canonical DIE in cloneDieReferenceAttribute.
+      // FIXME: compatibility with dsymutil-classic. There is no
+      // reason not to unique ref_addr references.
+      if (AttrSpec.Form != dwarf::DW_FORM_ref_addr && UseODR && Info.Ctxt &&
+          Info.Ctxt != ReferencedCU->getInfo(Info.ParentIdx).Ctxt &&
+          Info.Ctxt->getCanonicalDIEOffset() && isODRAttribute(AttrSpec.Attr))
+        continue;
+
+      unsigned ODRFlag = UseODR ? TF_ODR : 0;
       lookForDIEsToKeep(*RefDIE, DMO, *ReferencedCU,
-                        TF_Keep | TF_DependencyWalk);
+                        TF_Keep | TF_DependencyWalk | ODRFlag);
+    }
   }
 }
 
@@ -1699,8 +2167,10 @@ void DwarfLinker::lookForDIEsToKeep(const DWARFDebugInfoEntryMinimal &DIE,
     Flags = shouldKeepDIE(DIE, CU, MyInfo, Flags);
 
   // If it is a newly kept DIE mark it as well as all its dependencies as kept.
-  if (!AlreadyKept && (Flags & TF_Keep))
-    keepDIEAndDenpendencies(DIE, MyInfo, DMO, CU, Flags);
+  if (!AlreadyKept && (Flags & TF_Keep)) {
+    bool UseODR = (Flags & TF_DependencyWalk) ? (Flags & TF_ODR) : CU.hasODR();
+    keepDIEAndDenpendencies(DIE, MyInfo, DMO, CU, UseODR);
+  }
 
   // The TF_ParentWalk flag tells us that we are currently walking up
   // the parent chain of a required DIE, and we don't want to mark all
@@ -1763,6 +2233,13 @@ unsigned DwarfLinker::cloneStringAttribute(DIE &Die, AttributeSpec AttrSpec,
   return 4;
 }
 
+/// \brief Get the size of a DW_FORM_ref_addr attribute in \p Unit.
+static unsigned getRefAddrSize(const DWARFUnit &Unit) {
+  // DWARF 2 ref_addr attributes are the size of an address, later
+  // versions use the size of a section offset.
+  return Unit.getVersion() == 2 ? Unit.getAddressByteSize() : 4;
+}
+
 /// \brief Clone an attribute referencing another DIE and add
 /// it to \p Die.
 /// \returns the size of the new attribute.
@@ -1788,6 +2265,19 @@ unsigned DwarfLinker::cloneDieReferenceAttribute(
 
   unsigned Idx = RefUnit->getOrigUnit().getDIEIndex(RefDie);
   CompileUnit::DIEInfo &RefInfo = RefUnit->getInfo(Idx);
+
+  // If we already have emitted an equivalent DeclContext, just point
+  // at it.
+  DeclContext *Ctxt = nullptr;
+  if (Unit.hasODR() && isODRAttribute(AttrSpec.Attr)) {
+    Ctxt = RefInfo.Ctxt;
+    if (Ctxt && Ctxt->getCanonicalDIEOffset()) {
+      Die.addValue(dwarf::Attribute(AttrSpec.Attr), dwarf::DW_FORM_ref_addr,
+                   new (DIEAlloc) DIEInteger(Ctxt->getCanonicalDIEOffset()));
+      return getRefAddrSize(Unit.getOrigUnit());
+    }
+  }
+
   if (!RefInfo.Clone) {
     assert(Ref > InputDIE.getOffset());
     // We haven't cloned this DIE yet. Just create an empty one and
@@ -1811,7 +2301,7 @@ unsigned DwarfLinker::cloneDieReferenceAttribute(
     } else {
       // A forward reference. Note and fixup later.
       Attr = new (DIEAlloc) DIEInteger(0xBADDEF);
-      Unit.noteForwardReference(NewRefDie, RefUnit, Attr);
+      Unit.noteForwardReference(NewRefDie, RefUnit, Ctxt, Attr);
     }
     Die.addValue(dwarf::Attribute(AttrSpec.Attr), dwarf::DW_FORM_ref_addr,
                  Attr);
@@ -2090,6 +2580,14 @@ DIE *DwarfLinker::cloneDIE(const DWARFDebugInfoEntryMinimal &InputDIE,
     Die = Info.Clone = new DIE(dwarf::Tag(InputDIE.getTag()));
   assert(Die->getTag() == InputDIE.getTag());
   Die->setOffset(OutOffset);
+  if (Unit.hasODR() && Die->getTag() != dwarf::DW_TAG_namespace && Info.Ctxt &&
+      Info.Ctxt != Unit.getInfo(Info.ParentIdx).Ctxt &&
+      !Info.Ctxt->getCanonicalDIEOffset()) {
+    // We are about to emit a DIE that is the root of its own valid
+    // DeclContext tree. Make the current offset the canonical offset
+    // for this context.
+    Info.Ctxt->setCanonicalDIEOffset(OutOffset + Unit.getStartOffset());
+  }
 
   // Extract and clone every attribute.
   DataExtractor Data = U.getDebugInfoExtractor();
@@ -2431,31 +2929,57 @@ bool DwarfLinker::link(const DebugMap &Map) {
   if (!createStreamer(Map.getTriple(), OutputFilename))
     return false;
 
+  std::vector<DebugMapObject *> Objects;
+  for (const auto &Obj : Map.objects())
+    Objects.push_back(Obj.get());
+
+  // While an object is linked, up to NumThreads - 1 of the next ones
+  // are loaded. The verbose output describes the objects in link
+  // order, so it disables this.
+  unsigned NumThreads = Options.Verbose ? 1 : std::max(1u, Options.NumThreads);
+  // A BinaryHolder only keeps one object file mapped, so every object
+  // that is loaded or linked at a given time needs its own.
+  std::vector<std::unique_ptr<BinaryHolder>> BinHolders;
+  for (unsigned I = 0; I != NumThreads; ++I)
+    BinHolders.push_back(llvm::make_unique<BinaryHolder>(Options.Verbose));
+
+  std::vector<std::unique_ptr<LinkContext>> Contexts(Objects.size());
+  auto LoadObject = [&](size_t I) {
+    Contexts[I] = loadDebugObject(*Objects[I], *BinHolders[I % NumThreads]);
+  };
+
+  std::unique_ptr<ThreadPool> Pool;
+  std::vector<std::shared_future<void>> Loads(Objects.size());
+  size_t NextLoad = 0;
+  if (NumThreads > 1)
+    Pool = llvm::make_unique<ThreadPool>(NumThreads - 1);
+
   // Size of the DIEs (and headers) generated for the linked output.
   uint64_t OutputDebugInfoSize = 0;
   // A unique ID that identifies each compile unit.
   unsigned UnitID = 0;
-  for (const auto &Obj : Map.objects()) {
-    CurrentDebugObject = Obj.get();
-
+  for (size_t ObjIdx = 0, NumObjects = Objects.size(); ObjIdx != NumObjects;
+       ++ObjIdx) {
+    const DebugMapObject *Obj = Objects[ObjIdx];
     if (Options.Verbose)
       outs() << "DEBUG MAP OBJECT: " << Obj->getObjectFilename() << "\n";
-    auto ErrOrObj = BinHolder.GetObjectFile(Obj->getObjectFilename());
-    if (std::error_code EC = ErrOrObj.getError()) {
-      reportWarning(Twine(Obj->getObjectFilename()) + ": " + EC.message());
-      continue;
+
+    if (Pool) {
+      // The holder of the object linked last is free again.
+      for (; NextLoad != NumObjects && NextLoad < ObjIdx + NumThreads;
+           ++NextLoad)
+        Loads[NextLoad] = Pool->async(LoadObject, NextLoad);
+      Loads[ObjIdx].wait();
+    } else {
+      LoadObject(ObjIdx);
     }
 
-    // Look for relocations that correspond to debug map entries.
-    if (!findValidRelocsInDebugInfo(*ErrOrObj, *Obj)) {
-      if (Options.Verbose)
-        outs() << "No valid relocations found. Skipping.\n";
+    std::unique_ptr<LinkContext> Context = std::move(Contexts[ObjIdx]);
+    if (!startDebugObject(*Context)) {
+      endDebugObject();
       continue;
     }
-
-    // Setup access to the debug info.
-    DWARFContextInMemory DwarfContext(*ErrOrObj);
-    startDebugObject(DwarfContext, *Obj);
+    DWARFContext &DwarfContext = *Context->DwarfContext;
 
     // In a first phase, just read in the debug info and store the DIE
     // parent links that we will use during the next phase.
@@ -2465,8 +2989,11 @@ bool DwarfLinker::link(const DebugMap &Map) {
         outs() << "Input compilation unit:";
         CUDie->dump(outs(), CU.get(), 0);
       }
-      Units.emplace_back(*CU, UnitID++);
+      Units.emplace_back(*CU, UnitID++, Options.ODR);
       gatherDIEParents(CUDie, 0, Units.back());
+      if (Units.back().hasODR())
+        analyzeContextInfo(CUDie, Units.back(), &ODRContexts.getRoot(),
+                           UniquingStringPool, ODRContexts);
     }
 
     // Then mark all the DIEs that need to be present in the linked
@@ -2518,7 +3045,8 @@ bool DwarfLinker::link(const DebugMap &Map) {
         Streamer->emitDIE(*CurrentUnit.getOutputUnitDIE());
       }
 
-    // Clean-up before starting working on the next object.
+    // Clean-up before starting working on the next object. The debug
+    // information of the object goes away with its context.
     endDebugObject();
   }
 
@@ -245,7 +245,11 @@ void MachODebugMapParser::loadMainBinarySymbols() {
 namespace llvm {
 namespace dsymutil {
 llvm::ErrorOr<std::unique_ptr<DebugMap>>
-parseDebugMap(StringRef InputFile, StringRef PrependPath, bool Verbose) {
+parseDebugMap(StringRef InputFile, StringRef PrependPath, bool Verbose,
+              bool InputIsYAML) {
+  if (InputIsYAML)
+    return DebugMap::parseYAMLDebugMap(InputFile, PrependPath);
+
   MachODebugMapParser Parser(InputFile, PrependPath, Verbose);
   return Parser.parse();
 }
@@ -20,7 +20,9 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetSelect.h"
+#include <algorithm>
 #include <string>
+#include <thread>
 
 using namespace llvm::dsymutil;
 
@@ -45,6 +47,27 @@ static opt<bool> NoOutput("no-output", desc("Do the link in memory, but do "
                                             "not emit the result file."),
                           init(false));
 
+static opt<bool>
+    ODR("odr",
+        desc("Use the One Definition Rule to unique C++ types across "
+             "compile units (experimental)."),
+        init(false));
+
+static opt<unsigned> NumThreads(
+    "num-threads",
+    desc("Number of threads to use. With more than one, the next object "
+         "files are loaded while the current one is linked. The default is "
+         "the number of hardware threads; -v implies 1."),
+    value_desc("n"), init(0));
+static alias NumThreadsA("j", desc("Alias for -num-threads"),
+                         aliasopt(NumThreads));
+
+static opt<bool>
+    InputIsYAMLDebugMap("y",
+                        desc("Treat the input file as a YAML debug map "
+                             "rather than a binary."),
+                        init(false));
+
 static opt<bool>
     ParseOnly("parse-only",
               desc("Only parse the debug map, do not actaully link "
@@ -59,10 +82,16 @@ int main(int argc, char **argv) {
   LinkOptions Options;
 
   llvm::cl::ParseCommandLineOptions(argc, argv, "llvm dsymutil\n");
-  auto DebugMapPtrOrErr = parseDebugMap(InputFile, OsoPrependPath, Verbose);
+  auto DebugMapPtrOrErr = parseDebugMap(InputFile, OsoPrependPath, Verbose,
+                                        InputIsYAMLDebugMap);
 
   Options.Verbose = Verbose;
   Options.NoOutput = NoOutput;
+  Options.ODR = ODR;
+  if (NumThreads)
+    Options.NumThreads = NumThreads;
+  else
+    Options.NumThreads = std::max(1u, std::thread::hardware_concurrency());
 
   llvm::InitializeAllTargetInfos();
   llvm::InitializeAllTargetMCs();
@@ -25,17 +25,21 @@ namespace llvm {
 namespace dsymutil {
 
 struct LinkOptions {
-  bool Verbose;  ///< Verbosity
-  bool NoOutput; ///< Skip emitting output
+  bool Verbose;        ///< Verbosity
+  bool NoOutput;       ///< Skip emitting output
+  bool ODR;            ///< Unique C++ types across compile units
+  unsigned NumThreads; ///< Threads used to load object files ahead of time
 
-  LinkOptions() : Verbose(false), NoOutput(false) {}
+  LinkOptions()
+      : Verbose(false), NoOutput(false), ODR(false), NumThreads(1) {}
 };
 
 /// \brief Extract the DebugMap from the given file.
-/// The file has to be a MachO object file.
+/// The file has to be a MachO object file, or a YAML debug map when
+/// \p InputIsYAML is set.
 llvm::ErrorOr<std::unique_ptr<DebugMap>>
 parseDebugMap(StringRef InputFile, StringRef PrependPath = "",
-              bool Verbose = false);
+              bool Verbose = false, bool InputIsYAML = false);
 
 /// \brief Link the Dwarf debuginfo as directed by the passed DebugMap
 /// \p DM into a DwarfFile named \p OutputFilename.
@@ -14,12 +14,15 @@
 
 #include "llvm/Config/config.h" // plugin-api.h requires HAVE_STDINT_H
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/Analysis.h"
 #include "llvm/CodeGen/CommandFlags.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/IR/AutoUpgrade.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DiagnosticInfo.h"
@@ -28,10 +31,12 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/LTO/ThinLTOCodeGenerator.h"
 #include "llvm/Linker/Linker.h"
 #include "llvm/MC/SubtargetFeature.h"
 #include "llvm/Object/IRObjectFile.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/FileCache.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -92,6 +97,17 @@ namespace options {
   static bool generate_api_file = false;
   static OutputType TheOutputType = OT_NORMAL;
   static unsigned OptLevel = 2;
+  // Number of partitions the merged module is split into for code generation.
+  static unsigned Parallelism = 1;
+  // Use summary-based (thin) LTO: every module is optimized and compiled on
+  // its own after importing functions from the other modules.
+  static bool thinlto = false;
+  // Directory in which the object files are cached, and the pruning policy
+  // of the cache.
+  static std::string cache_dir;
+  static int cache_pruning_interval = 20 * 60;
+  static unsigned cache_expiration = 7 * 24 * 60 * 60;
+  static uint64_t cache_max_size = 0;
   static std::string obj_path;
   static std::string extra_library_path;
   static std::string triple;
@@ -125,10 +141,30 @@ namespace options {
       TheOutputType = OT_SAVE_TEMPS;
     } else if (opt == "disable-output") {
       TheOutputType = OT_DISABLE;
+    } else if (opt == "thinlto") {
+      thinlto = true;
     } else if (opt.size() == 2 && opt[0] == 'O') {
       if (opt[1] < '0' || opt[1] > '3')
         report_fatal_error("Optimization level must be between 0 and 3");
       OptLevel = opt[1] - '0';
+    } else if (opt.startswith("cache-dir=")) {
+      cache_dir = opt.substr(strlen("cache-dir="));
+    } else if (opt.startswith("cache-pruning-interval=")) {
+      StringRef Interval = opt.substr(strlen("cache-pruning-interval="));
+      if (Interval.getAsInteger(10, cache_pruning_interval))
+        report_fatal_error("Invalid cache pruning interval: " + Interval);
+    } else if (opt.startswith("cache-expiration=")) {
+      StringRef Expiration = opt.substr(strlen("cache-expiration="));
+      if (Expiration.getAsInteger(10, cache_expiration))
+        report_fatal_error("Invalid cache expiration: " + Expiration);
+    } else if (opt.startswith("cache-max-size=")) {
+      StringRef MaxSize = opt.substr(strlen("cache-max-size="));
+      if (MaxSize.getAsInteger(10, cache_max_size))
+        report_fatal_error("Invalid cache size: " + MaxSize);
+    } else if (opt.startswith("jobs=")) {
+      StringRef Jobs = opt.substr(strlen("jobs="));
+      if (Jobs.getAsInteger(10, Parallelism) || Parallelism == 0)
+        report_fatal_error("Invalid parallelism level: " + Jobs);
     } else {
       // Save this option to pass to the code generator.
       // ParseCommandLineOptions() expects argv[0] to be program name. Lazily
@@ -742,6 +778,34 @@ static void saveBCFile(StringRef Path, Module &M) {
   WriteBitcodeToFile(&M, OS, /* ShouldPreserveUseListOrder */ true);
 }
 
+static FileCache getCache() {
+  FileCache Cache;
+  Cache.setPath(options::cache_dir);
+  Cache.setPruningInterval(options::cache_pruning_interval);
+  Cache.setExpiration(options::cache_expiration);
+  Cache.setMaxSize(options::cache_max_size);
+  return Cache;
+}
+
+/// Return the key of the object files generated for the merged module M with
+/// the current options.
+static std::string getCacheKey(Module &M, const TargetMachine &TM) {
+  FileCacheKeyBuilder Key;
+  SmallString<0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS, /* ShouldPreserveUseListOrder */ true);
+    OS.flush();
+  }
+  Key.add(Bitcode);
+  TM.addToCacheKey(Key);
+  Key.add(options::OptLevel);
+  for (const char *Opt : options::extra)
+    Key.add(Opt);
+  Key.add(options::Parallelism);
+  return Key.getKey();
+}
+
 static void codegen(Module &M) {
   const std::string &TripleStr = M.getTargetTriple();
   Triple TheTriple(TripleStr);
@@ -779,45 +843,173 @@ static void codegen(Module &M) {
       TripleStr, options::mcpu, Features.getString(), Options, RelocationModel,
       CodeModel::Default, CGOptLevel));
 
-  runLTOPasses(M, *TM);
+  // If a previous link generated the object files for the same module with
+  // the same options, neither optimization nor code generation is needed.
+  FileCache Cache = getCache();
+  std::string CacheKey;
+  std::vector<std::unique_ptr<MemoryBuffer>> CachedObjects;
+  if (Cache.isEnabled()) {
+    CacheKey = getCacheKey(M, *TM);
+    for (unsigned I = 0; I != options::Parallelism; ++I) {
+      std::unique_ptr<MemoryBuffer> Object =
+          Cache.lookup(CacheKey + "-" + utostr(I));
+      if (!Object) {
+        CachedObjects.clear();
+        break;
+      }
+      CachedObjects.push_back(std::move(Object));
+    }
+  }
 
-  if (options::TheOutputType == options::OT_SAVE_TEMPS)
-    saveBCFile(output_name + ".opt.bc", M);
+  if (CachedObjects.empty()) {
+    runLTOPasses(M, *TM);
 
-  legacy::PassManager CodeGenPasses;
+    if (options::TheOutputType == options::OT_SAVE_TEMPS)
+      saveBCFile(output_name + ".opt.bc", M);
+  }
 
-  SmallString<128> Filename;
-  int FD;
-  if (options::obj_path.empty()) {
-    std::error_code EC =
-        sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
-    if (EC)
-      message(LDPL_FATAL, "Could not create temporary file: %s",
-              EC.message().c_str());
+  std::vector<std::string> Filenames;
+  std::vector<std::unique_ptr<raw_fd_ostream>> OSs;
+  std::vector<raw_pwrite_stream *> OSPtrs;
+  for (unsigned I = 0; I != options::Parallelism; ++I) {
+    SmallString<128> Filename;
+    int FD;
+    if (options::obj_path.empty()) {
+      std::error_code EC =
+          sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
+      if (EC)
+        message(LDPL_FATAL, "Could not create temporary file: %s",
+                EC.message().c_str());
+    } else {
+      Filename = options::obj_path;
+      if (I != 0)
+        Filename += "." + utostr(I);
+      std::error_code EC =
+          sys::fs::openFileForWrite(Filename.c_str(), FD, sys::fs::F_None);
+      if (EC)
+        message(LDPL_FATAL, "Could not open file: %s", EC.message().c_str());
+    }
+    Filenames.push_back(Filename.str());
+    OSs.push_back(make_unique<raw_fd_ostream>(FD, true));
+    OSPtrs.push_back(OSs.back().get());
+  }
+
+  if (!CachedObjects.empty()) {
+    for (unsigned I = 0; I != options::Parallelism; ++I)
+      *OSs[I] << CachedObjects[I]->getBuffer();
+  } else if (!Cache.isEnabled()) {
+    if (splitCodeGen(M, OSPtrs, *TM, TargetMachine::CGFT_ObjectFile))
+      message(LDPL_FATAL, "Failed to setup codegen");
   } else {
-    Filename = options::obj_path;
-    std::error_code EC =
-        sys::fs::openFileForWrite(Filename.c_str(), FD, sys::fs::F_None);
-    if (EC)
-      message(LDPL_FATAL, "Could not open file: %s", EC.message().c_str());
+    // Generate the object files in memory, so that they can be added to the
+    // cache as well.
+    std::vector<SmallString<0>> Objects(options::Parallelism);
+    {
+      std::vector<std::unique_ptr<raw_svector_ostream>> ObjectOSs;
+      std::vector<raw_pwrite_stream *> ObjectOSPtrs;
+      for (SmallString<0> &Object : Objects) {
+        ObjectOSs.push_back(make_unique<raw_svector_ostream>(Object));
+        ObjectOSPtrs.push_back(ObjectOSs.back().get());
+      }
+      if (splitCodeGen(M, ObjectOSPtrs, *TM, TargetMachine::CGFT_ObjectFile))
+        message(LDPL_FATAL, "Failed to setup codegen");
+    }
+    for (unsigned I = 0; I != options::Parallelism; ++I) {
+      Cache.store(CacheKey + "-" + utostr(I), Objects[I]);
+      *OSs[I] << Objects[I];
+    }
+    Cache.prune();
   }
+  OSs.clear();
 
-  {
-    raw_fd_ostream OS(FD, true);
+  for (const std::string &Filename : Filenames) {
+    if (add_input_file(Filename.c_str()) != LDPS_OK)
+      message(LDPL_FATAL,
+              "Unable to add .o file to the link. File left behind in: %s",
+              Filename.c_str());
 
-    if (TM->addPassesToEmitFile(CodeGenPasses, OS,
-                                TargetMachine::CGFT_ObjectFile))
-      message(LDPL_FATAL, "Failed to setup codegen");
-    CodeGenPasses.run(M);
+    if (options::obj_path.empty())
+      Cleanup.push_back(Filename);
   }
+}
+
+/// Compile every claimed module with the ThinLTO code generator and add the
+/// resulting objects to the link. The modules are not linked together and
+/// keep their linkage, so no symbol resolution is needed.
+static void thinLTOLink() {
+  if (unsigned NumOpts = options::extra.size())
+    cl::ParseCommandLineOptions(NumOpts, &options::extra[0]);
 
-  if (add_input_file(Filename.c_str()) != LDPS_OK)
-    message(LDPL_FATAL,
-            "Unable to add .o file to the link. File left behind in: %s",
-            Filename.c_str());
+  ThinLTOCodeGenerator CodeGen;
+  CodeGen.setTargetOptions(InitTargetOptionsFromCodeGenFlags());
+  CodeGen.setCpu(options::mcpu);
+  CodeGen.setAttr(join(MAttrs.begin(), MAttrs.end(), ","));
+  CodeGen.setCodePICModel(RelocationModel);
+  CodeGen.setOptLevel(options::OptLevel);
+  CodeGen.setParallelism(options::Parallelism);
+  CodeGen.setCacheDir(options::cache_dir);
+  CodeGen.setCachePruningInterval(options::cache_pruning_interval);
+  CodeGen.setCacheExpiration(options::cache_expiration);
+  CodeGen.setCacheMaxSize(options::cache_max_size);
+
+  // The views are only valid until the files are released, so keep a copy.
+  std::vector<std::unique_ptr<MemoryBuffer>> Buffers;
+  for (claimed_file &F : Modules) {
+    ld_plugin_input_file File;
+    if (get_input_file(F.handle, &File) != LDPS_OK)
+      message(LDPL_FATAL, "Failed to get file information");
+    const void *View;
+    if (get_view(F.handle, &View) != LDPS_OK)
+      message(LDPL_FATAL, "Failed to get a view of file");
+
+    // Members of the same archive share a name; the offset tells them apart.
+    std::string Identifier = File.name;
+    if (File.offset)
+      Identifier += "(" + utostr(File.offset) + ")";
+    Buffers.push_back(MemoryBuffer::getMemBufferCopy(
+        StringRef((const char *)View, File.filesize), Identifier));
+    CodeGen.addModule(Identifier, Buffers.back()->getBuffer());
 
-  if (options::obj_path.empty())
-    Cleanup.push_back(Filename.c_str());
+    if (release_input_file(F.handle) != LDPS_OK)
+      message(LDPL_FATAL, "Failed to release file information");
+  }
+
+  std::string ErrMsg;
+  if (!CodeGen.run(ErrMsg))
+    message(LDPL_FATAL, "ThinLTO code generation failed: %s", ErrMsg.c_str());
+
+  ArrayRef<std::unique_ptr<MemoryBuffer>> Objects =
+      CodeGen.getProducedBinaries();
+  for (unsigned I = 0, E = Objects.size(); I != E; ++I) {
+    SmallString<128> Filename;
+    int FD;
+    if (options::obj_path.empty()) {
+      std::error_code EC =
+          sys::fs::createTemporaryFile("thinlto-llvm", "o", FD, Filename);
+      if (EC)
+        message(LDPL_FATAL, "Could not create temporary file: %s",
+                EC.message().c_str());
+    } else {
+      Filename = options::obj_path;
+      if (I != 0)
+        Filename += "." + utostr(I);
+      std::error_code EC =
+          sys::fs::openFileForWrite(Filename.c_str(), FD, sys::fs::F_None);
+      if (EC)
+        message(LDPL_FATAL, "Could not open file: %s", EC.message().c_str());
+    }
+    {
+      raw_fd_ostream OS(FD, true);
+      OS << Objects[I]->getBuffer();
+    }
+
+    if (add_input_file(Filename.c_str()) != LDPS_OK)
+      message(LDPL_FATAL,
+              "Unable to add .o file to the link. File left behind in: %s",
+              Filename.c_str());
+    if (options::obj_path.empty())
+      Cleanup.push_back(Filename.str());
+  }
 }
 
 /// gold informs us that all symbols have been read. At this point, we use
@@ -827,6 +1019,14 @@ static ld_plugin_status allSymbolsReadHook(raw_fd_ostream *ApiFile) {
   if (Modules.empty())
     return LDPS_OK;
 
+  if (options::thinlto && options::TheOutputType == options::OT_NORMAL) {
+    thinLTOLink();
+    if (!options::extra_library_path.empty() &&
+        set_extra_library_path(options::extra_library_path.c_str()) != LDPS_OK)
+      message(LDPL_FATAL, "Unable to set the extra library path.");
+    return LDPS_OK;
+  }
+
   LLVMContext Context;
   Context.setDiagnosticHandler(diagnosticHandler, nullptr, true);
 
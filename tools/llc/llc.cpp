@@ -41,6 +41,7 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetSubtargetInfo.h"
@@ -62,6 +63,22 @@ TimeCompilations("time-compilations", cl::Hidden, cl::init(1u),
                  cl::value_desc("N"),
                  cl::desc("Repeat compilation N times for timing"));
 
+static cl::opt<bool>
+TimeTrace("time-trace",
+          cl::desc("Record a trace of the compile time, in the Chrome Trace "
+                   "Event format"));
+
+static cl::opt<unsigned>
+TimeTraceGranularity("time-trace-granularity", cl::init(500),
+                     cl::value_desc("us"),
+                     cl::desc("Leave out events shorter than this many "
+                              "microseconds from the time trace"));
+
+static cl::opt<std::string>
+TimeTraceFile("time-trace-file", cl::value_desc("filename"),
+              cl::desc("Write the time trace to this file (default: the "
+                       "output file with a .time-trace.json suffix)"));
+
 static cl::opt<bool>
 NoIntegratedAssembler("no-integrated-as", cl::Hidden,
                       cl::desc("Disable integrated assembler"));
@@ -195,11 +212,31 @@ int main(int argc, char **argv) {
 
   cl::ParseCommandLineOptions(argc, argv, "llvm system compiler\n");
 
+  if (TimeTrace)
+    timeTraceProfilerInitialize(TimeTraceGranularity, argv[0]);
+
   // Compile the module TimeCompilations times to give better compile time
   // metrics.
-  for (unsigned I = TimeCompilations; I; --I)
-    if (int RetVal = compileModule(argv, Context))
-      return RetVal;
+  {
+    TimeTraceScope TraceScope("CompileModule", InputFilename);
+    for (unsigned I = TimeCompilations; I; --I)
+      if (int RetVal = compileModule(argv, Context))
+        return RetVal;
+  }
+
+  if (TimeTrace) {
+    std::string Path = TimeTraceFile;
+    if (Path.empty())
+      Path = (OutputFilename.empty() || OutputFilename == "-"
+                  ? "llc"
+                  : OutputFilename.getValue()) +
+             ".time-trace.json";
+    if (std::error_code EC = timeTraceProfilerWrite(Path)) {
+      errs() << argv[0] << ": " << Path << ": " << EC.message() << '\n';
+      return 1;
+    }
+    timeTraceProfilerCleanup();
+  }
   return 0;
 }
 
@@ -8,9 +8,16 @@
 //===----------------------------------------------------------------------===//
 
 #include "OrcLazyJIT.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/ExecutionEngine/FileObjectCache.h"
 #include "llvm/ExecutionEngine/Orc/OrcTargetSupport.h"
+#include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include <cstring>
 #include <system_error>
 
 using namespace llvm;
@@ -38,6 +45,269 @@ namespace {
                                              "working directory. (WARNING: "
                                              "will overwrite existing files)."),
                                   clEnumValEnd));
+
+  cl::opt<unsigned>
+  OrcTierUpThreshold("orc-lazy-tier-up-threshold",
+                     cl::desc("Compile functions at -O0 first, and recompile "
+                              "them at -O3 after this many calls "
+                              "(0 = no tiering)."),
+                     cl::init(0));
+
+  cl::opt<bool>
+  OrcPrintTierUps("orc-lazy-print-tier-ups",
+                  cl::desc("Print the functions that are recompiled at a "
+                           "higher tier to stderr."),
+                  cl::init(false));
+
+  // Suffixes that the compile-on-demand layer gives to function bodies and
+  // to the pointers that their stubs jump through.
+  const char *BodySuffix = "$orc_body";
+  const char *AddrSuffix = "$orc_addr";
+
+  class TierUpPrinter : public JITEventListener {
+  public:
+    void NotifyFunctionTierUp(StringRef Name, uint64_t Address,
+                              unsigned Tier) override {
+      errs() << "[tier-up] " << Name << " -> tier " << Tier << "\n";
+    }
+  };
+
+  // Keeps the modules that embed addresses in this process out of the
+  // persistent object cache: the callback manager's resolver and trampoline
+  // blocks, which are written in module-level asm, and the stub pointers,
+  // which start out pointing at trampolines.
+  class ProcessLocalCacheFilter : public ObjectCache {
+  public:
+    ProcessLocalCacheFilter(ObjectCache &Cache) : Cache(Cache) {}
+
+    void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override {
+      if (!isProcessLocal(*M))
+        Cache.notifyObjectCompiled(M, Obj);
+    }
+
+    std::unique_ptr<MemoryBuffer> getObject(const Module *M) override {
+      if (isProcessLocal(*M))
+        return nullptr;
+      return Cache.getObject(M);
+    }
+
+  private:
+    static bool isProcessLocal(const Module &M) {
+      if (!M.getModuleInlineAsm().empty())
+        return true;
+      for (auto &GV : M.globals())
+        if (!GV.isDeclaration() && GV.getName().endswith(AddrSuffix))
+          return true;
+      return false;
+    }
+
+    ObjectCache &Cache;
+  };
+
+  cl::opt<bool>
+  OrcSlabMemory("orc-lazy-slab-memory",
+                cl::desc("Allocate JITed code and data from slabs shared by "
+                         "all modules."),
+                cl::init(false));
+
+  cl::opt<bool>
+  OrcHugePages("orc-lazy-huge-pages",
+               cl::desc("Back the slabs of -orc-lazy-slab-memory with "
+                        "transparent huge pages where available."),
+               cl::init(false));
+
+  cl::opt<bool>
+  OrcSpeculativeCompile("orc-lazy-speculative-compile",
+                        cl::desc("Compile the callees of lazily compiled "
+                                 "functions speculatively on a background "
+                                 "thread."),
+                        cl::init(false));
+}
+
+OrcTierUpCompiler::OrcTierUpCompiler(std::unique_ptr<TargetMachine> OptTM,
+                                     unsigned HotThreshold,
+                                     SymbolLookupFtor Lookup,
+                                     MemoryManagerBuilder BuildMemMgr)
+    : OptTM(std::move(OptTM)), HotThreshold(HotThreshold),
+      Lookup(std::move(Lookup)), BuildMemMgr(std::move(BuildMemMgr)),
+      OptCompileLayer(OptObjectLayer, orc::SimpleCompiler(*this->OptTM)),
+      RecompileThread(1) {}
+
+std::unique_ptr<Module>
+OrcTierUpCompiler::instrumentModule(std::unique_ptr<Module> M) {
+  std::vector<Function*> Bodies;
+  for (auto &F : *M)
+    if (!F.isDeclaration() && F.getName().endswith(BodySuffix))
+      Bodies.push_back(&F);
+  if (Bodies.empty())
+    return M;
+
+  // Keep the uninstrumented module for recompilation. It is written once and
+  // shared by all the bodies it contains.
+  auto Bitcode = std::make_shared<SmallVector<char, 0>>();
+  {
+    raw_svector_ostream BitcodeStream(*Bitcode);
+    WriteBitcodeToFile(M.get(), BitcodeStream);
+  }
+
+  std::vector<uint64_t> FunctionIDs;
+  for (Function *F : Bodies) {
+    auto HF = llvm::make_unique<HotFunction>();
+    HF->BodyName = F->getName();
+    HF->Bitcode = Bitcode;
+    std::lock_guard<std::mutex> Lock(FunctionsMutex);
+    FunctionIDs.push_back(Functions.size());
+    Functions.push_back(std::move(HF));
+  }
+
+  LLVMContext &Context = M->getContext();
+  Type *Int64Ty = Type::getInt64Ty(Context);
+  Type *Int8PtrTy = Type::getInt8PtrTy(Context);
+  Type *TierUpArgs[] = { Int8PtrTy, Int64Ty };
+  FunctionType *TierUpTy =
+    FunctionType::get(Type::getVoidTy(Context), TierUpArgs, false);
+  Constant *TierUpFn =
+    orc::createIRTypedAddress(*TierUpTy,
+                              static_cast<orc::TargetAddress>(
+                                reinterpret_cast<uintptr_t>(&tierUp)));
+  Constant *Self =
+    ConstantExpr::getIntToPtr(
+      ConstantInt::get(Int64Ty, reinterpret_cast<uintptr_t>(this)), Int8PtrTy);
+
+  for (unsigned I = 0, E = Bodies.size(); I != E; ++I) {
+    Function &F = *Bodies[I];
+
+    // Count the calls after the allocas of the entry block, so that they
+    // stay in the entry block. The count is not atomic: a lost update only
+    // delays the tier-up, and threads that race past the threshold may all
+    // call tierUp, which queues the recompile only once.
+    BasicBlock::iterator InsertPt = F.getEntryBlock().begin();
+    while (isa<AllocaInst>(InsertPt))
+      ++InsertPt;
+
+    auto *Counter =
+      new GlobalVariable(*M, Int64Ty, false, GlobalValue::InternalLinkage,
+                         ConstantInt::get(Int64Ty, 0),
+                         F.getName() + "$orc_calls");
+    IRBuilder<> Builder(InsertPt);
+    Value *Calls =
+      Builder.CreateAdd(Builder.CreateLoad(Counter),
+                        ConstantInt::get(Int64Ty, 1));
+    Builder.CreateStore(Calls, Counter);
+    Value *IsHot =
+      Builder.CreateICmpEQ(Calls, ConstantInt::get(Int64Ty, HotThreshold));
+
+    TerminatorInst *ThenTerm = SplitBlockAndInsertIfThen(IsHot, InsertPt,
+                                                         false);
+    Value *TierUpCallArgs[] = {
+      Self, ConstantInt::get(Int64Ty, FunctionIDs[I])
+    };
+    IRBuilder<>(ThenTerm).CreateCall(TierUpFn, TierUpCallArgs);
+  }
+
+  return M;
+}
+
+void OrcTierUpCompiler::tierUp(void *Compiler, uint64_t FunctionID) {
+  auto *C = static_cast<OrcTierUpCompiler*>(Compiler);
+  {
+    std::lock_guard<std::mutex> Lock(C->FunctionsMutex);
+    HotFunction &HF = *C->Functions[FunctionID];
+    if (HF.RecompileQueued)
+      return;
+    HF.RecompileQueued = true;
+  }
+  C->RecompileThread.async([C, FunctionID]() { C->recompile(FunctionID); });
+}
+
+void OrcTierUpCompiler::recompile(uint64_t FunctionID) {
+  HotFunction *HF;
+  {
+    std::lock_guard<std::mutex> Lock(FunctionsMutex);
+    HF = Functions[FunctionID].get();
+  }
+
+  StringRef Bitcode(HF->Bitcode->data(), HF->Bitcode->size());
+  ErrorOr<Module*> MOrErr =
+    parseBitcodeFile(MemoryBufferRef(Bitcode, HF->BodyName), OptContext);
+  if (!MOrErr)
+    return;
+  std::unique_ptr<Module> M(MOrErr.get());
+
+  // Give the optimized body a name of its own, so that looking up the
+  // baseline body still finds the baseline body.
+  StringRef FuncName =
+    StringRef(HF->BodyName).drop_back(strlen(BodySuffix));
+  std::string OptName = (FuncName + "$orc_opt").str();
+  M->getFunction(HF->BodyName)->setName(OptName);
+
+  {
+    PassManagerBuilder Builder;
+    Builder.OptLevel = 3;
+    legacy::PassManager PM;
+    PM.add(createTargetTransformInfoWrapperPass(OptTM->getTargetIRAnalysis()));
+    Builder.populateModulePassManager(PM);
+    PM.run(*M);
+  }
+
+  std::vector<std::unique_ptr<Module>> S;
+  S.push_back(std::move(M));
+  auto Resolver =
+    orc::createLambdaResolver(
+      [this](const std::string &Name) { return Lookup(Name); },
+      [](const std::string &Name) { return RuntimeDyld::SymbolInfo(nullptr); });
+  auto H = OptCompileLayer.addModuleSet(std::move(S), BuildMemMgr(),
+                                        std::move(Resolver));
+
+  auto OptSym = OptCompileLayer.findSymbolIn(H, mangle(OptName), false);
+  auto ImplPointer = Lookup(mangle((FuncName + AddrSuffix).str()));
+  if (!OptSym || !ImplPointer.getAddress())
+    return;
+
+  orc::TargetAddress Addr = OptSym.getAddress();
+  orc::updateImplPointer(
+    reinterpret_cast<void*>(static_cast<uintptr_t>(ImplPointer.getAddress())),
+    Addr);
+
+  for (auto *L : Listeners)
+    L->NotifyFunctionTierUp(FuncName, Addr, 1);
+}
+
+std::string OrcTierUpCompiler::mangle(const std::string &Name) {
+  Mangler Mang(OptTM->getDataLayout());
+  std::string MangledName;
+  {
+    raw_string_ostream MangledNameStream(MangledName);
+    Mang.getNameWithPrefix(MangledNameStream, Name);
+  }
+  return MangledName;
+}
+
+void OrcLazyJIT::enableTiering(std::unique_ptr<TargetMachine> OptTM,
+                               unsigned HotThreshold) {
+  // The baseline compile favors compile time over code quality.
+  TM->setOptLevel(CodeGenOpt::None);
+  TM->setFastISel(true);
+
+  // Same resolution order as for the modules added to the JIT, except that
+  // the optimized bodies also need the hidden symbols of the modules that
+  // they were split from.
+  TierUp = llvm::make_unique<OrcTierUpCompiler>(
+    std::move(OptTM), HotThreshold,
+    [this](const std::string &Name) {
+      if (auto Sym = CODLayer.findSymbol(Name, false))
+        return RuntimeDyld::SymbolInfo(Sym.getAddress(), Sym.getFlags());
+
+      if (auto Sym = CXXRuntimeOverrides.searchOverrides(Name))
+        return Sym;
+
+      if (auto Addr = RTDyldMemoryManager::getSymbolAddressInProcess(Name))
+        return RuntimeDyld::SymbolInfo(Addr, JITSymbolFlags::Exported);
+
+      return RuntimeDyld::SymbolInfo(nullptr);
+    },
+    // Recompiled code is hot by definition: keep it together.
+    [this]() { return createMemoryManager(true); });
 }
 
 OrcLazyJIT::CallbackManagerBuilder
@@ -107,7 +377,8 @@ OrcLazyJIT::TransformFtor OrcLazyJIT::createDebugDumper() {
   llvm_unreachable("Unknown DumpKind");
 }
 
-int llvm::runOrcLazyJIT(std::unique_ptr<Module> M, int ArgC, char* ArgV[]) {
+int llvm::runOrcLazyJIT(std::unique_ptr<Module> M, int ArgC, char* ArgV[],
+                        StringRef CacheDir, uint64_t CacheSizeLimit) {
   // Add the program's symbols into the JIT's search space.
   if (sys::DynamicLibrary::LoadLibraryPermanently(nullptr)) {
     errs() << "Error loading program symbols.\n";
@@ -129,8 +400,35 @@ int llvm::runOrcLazyJIT(std::unique_ptr<Module> M, int ArgC, char* ArgV[]) {
     return 1;
   }
 
-  // Everything looks good. Build the JIT.
-  OrcLazyJIT J(std::move(TM), Context, CallbackMgrBuilder);
+  // Instrumented modules refer to the tier-up compiler by address, so they
+  // are never the same twice and are not worth caching.
+  std::unique_ptr<FileObjectCache> Cache;
+  std::unique_ptr<ProcessLocalCacheFilter> CacheFilter;
+  if (!CacheDir.empty() && !OrcTierUpThreshold) {
+    Cache = llvm::make_unique<FileObjectCache>(CacheDir, *TM, CacheSizeLimit);
+    CacheFilter = llvm::make_unique<ProcessLocalCacheFilter>(*Cache);
+  }
+
+  // Everything looks good. Build the JIT. The tier-up printer and the cache
+  // must outlive the JIT, which finishes pending recompiles when it is
+  // destroyed.
+  TierUpPrinter Printer;
+  OrcLazyJIT J(std::move(TM), Context, CallbackMgrBuilder,
+               OrcSpeculativeCompile);
+
+  if (OrcSlabMemory || OrcHugePages)
+    J.enableSlabMemory(OrcHugePages);
+
+  if (CacheFilter)
+    J.setObjectCache(CacheFilter.get());
+
+  if (OrcTierUpThreshold) {
+    auto OptTM = std::unique_ptr<TargetMachine>(
+      EngineBuilder().setOptLevel(CodeGenOpt::Aggressive).selectTarget());
+    J.enableTiering(std::move(OptTM), OrcTierUpThreshold);
+    if (OrcPrintTierUps)
+      J.addEventListener(&Printer);
+  }
 
   // Add the module, look up main and run it.
   auto MainHandle = J.addModule(std::move(M));
@@ -23,11 +23,83 @@
 #include "llvm/ExecutionEngine/Orc/IRTransformLayer.h"
 #include "llvm/ExecutionEngine/Orc/LazyEmittingLayer.h"
 #include "llvm/ExecutionEngine/Orc/ObjectLinkingLayer.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
+#include "llvm/ExecutionEngine/SlabMemoryManager.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/ThreadPool.h"
 
 namespace llvm {
 
+/// Recompiles hot functions of the orc-lazy JIT at a higher optimization
+/// level.
+///
+///   Function bodies are given a call counter before their baseline compile.
+/// When a counter reaches the hotness threshold, the body is recompiled on a
+/// background thread, in its own LLVMContext and with its own TargetMachine,
+/// and the function's stub is pointed at the new code.
+class OrcTierUpCompiler {
+public:
+  typedef std::function<RuntimeDyld::SymbolInfo(const std::string &)>
+    SymbolLookupFtor;
+  typedef std::function<std::unique_ptr<RuntimeDyld::MemoryManager>()>
+    MemoryManagerBuilder;
+
+  OrcTierUpCompiler(std::unique_ptr<TargetMachine> OptTM,
+                    unsigned HotThreshold, SymbolLookupFtor Lookup,
+                    MemoryManagerBuilder BuildMemMgr);
+
+  /// Add call counters to the function bodies in M. A copy of each body is
+  /// kept, without the counter, for recompilation.
+  std::unique_ptr<Module> instrumentModule(std::unique_ptr<Module> M);
+
+  /// Report tier-up events to L.
+  void addEventListener(JITEventListener *L) { Listeners.push_back(L); }
+
+private:
+  typedef orc::ObjectLinkingLayer<> ObjLayerT;
+  typedef orc::IRCompileLayer<ObjLayerT> CompileLayerT;
+
+  struct HotFunction {
+    HotFunction() : RecompileQueued(false) {}
+
+    std::string BodyName;
+    /// The uninstrumented module that contains the body, shared by all the
+    /// bodies of the module.
+    std::shared_ptr<const SmallVector<char, 0>> Bitcode;
+    /// Set by the first tierUp call for this body. Guarded by
+    /// FunctionsMutex.
+    bool RecompileQueued;
+  };
+
+  /// Called by the instrumented code when a counter reaches the threshold.
+  static void tierUp(void *Compiler, uint64_t FunctionID);
+
+  void recompile(uint64_t FunctionID);
+
+  std::string mangle(const std::string &Name);
+
+  std::unique_ptr<TargetMachine> OptTM;
+  unsigned HotThreshold;
+  SymbolLookupFtor Lookup;
+  MemoryManagerBuilder BuildMemMgr;
+  std::vector<JITEventListener*> Listeners;
+
+  // Guards Functions, which grows while recompiles read it, and the
+  // RecompileQueued flags.
+  std::mutex FunctionsMutex;
+  std::vector<std::unique_ptr<HotFunction>> Functions;
+
+  // Only used by the recompile thread.
+  LLVMContext OptContext;
+  ObjLayerT OptObjectLayer;
+  CompileLayerT OptCompileLayer;
+
+  // Declared last so that queued recompiles finish before the members above
+  // are destroyed.
+  ThreadPool RecompileThread;
+};
+
 class OrcLazyJIT {
 public:
 
@@ -51,15 +123,23 @@ public:
   static CallbackManagerBuilder createCallbackManagerBuilder(Triple T);
 
   OrcLazyJIT(std::unique_ptr<TargetMachine> TM, LLVMContext &Context,
-             CallbackManagerBuilder &BuildCallbackMgr)
+             CallbackManagerBuilder &BuildCallbackMgr,
+             bool CompileSpeculatively = false)
     : TM(std::move(TM)),
       Mang(this->TM->getDataLayout()),
+      DebugDumper(createDebugDumper()),
       ObjectLayer(),
       CompileLayer(ObjectLayer, orc::SimpleCompiler(*this->TM)),
-      IRDumpLayer(CompileLayer, createDebugDumper()),
+      IRDumpLayer(CompileLayer,
+                  [this](std::unique_ptr<Module> M) {
+                    if (TierUp)
+                      M = TierUp->instrumentModule(std::move(M));
+                    return DebugDumper(std::move(M));
+                  }),
       LazyEmitLayer(IRDumpLayer),
       CCMgr(BuildCallbackMgr(IRDumpLayer, CCMgrMemMgr, Context)),
-      CODLayer(LazyEmitLayer, *CCMgr),
+      CODLayer(LazyEmitLayer, *CCMgr, CompileSpeculatively,
+               [this]() { return createMemoryManager(false); }),
       CXXRuntimeOverrides([this](const std::string &S) { return mangle(S); }) {}
 
   ~OrcLazyJIT() {
@@ -70,6 +150,29 @@ public:
       DtorRunner.runViaLayer(CODLayer);
   }
 
+  /// Compile functions at -O0 with FastISel first, and recompile those that
+  /// are called HotThreshold times with OptTM. Must be called before any
+  /// module is added.
+  void enableTiering(std::unique_ptr<TargetMachine> OptTM,
+                     unsigned HotThreshold);
+
+  /// Take the memory for JITed code and data from slabs shared by all
+  /// modules, optionally backed by huge pages, instead of mapping memory for
+  /// each module. Must be called before any module is added.
+  void enableSlabMemory(bool UseHugePages) {
+    MemPool = llvm::make_unique<SlabMemoryPool>(
+      SlabMemoryPool::DefaultSlabSize, UseHugePages);
+  }
+
+  /// Look compiled modules up in Cache before compiling them, and add them to
+  /// it afterwards.
+  void setObjectCache(ObjectCache *Cache) {
+    CompileLayer.setObjectCache(Cache);
+  }
+
+  /// Report tier-up events to L. Tiering must be enabled.
+  void addEventListener(JITEventListener *L) { TierUp->addEventListener(L); }
+
   template <typename PtrTy>
   static PtrTy fromTargetAddress(orc::TargetAddress Addr) {
     return reinterpret_cast<PtrTy>(static_cast<uintptr_t>(Addr));
@@ -147,9 +250,18 @@ private:
 
   static TransformFtor createDebugDumper();
 
+  std::unique_ptr<RuntimeDyld::MemoryManager> createMemoryManager(bool HotCode) {
+    if (MemPool)
+      return llvm::make_unique<SlabMemoryManager>(*MemPool, HotCode);
+    return llvm::make_unique<SectionMemoryManager>();
+  }
+
   std::unique_ptr<TargetMachine> TM;
   Mangler Mang;
   SectionMemoryManager CCMgrMemMgr;
+  TransformFtor DebugDumper;
+  // Must outlive the layers, which own memory managers that use it.
+  std::unique_ptr<SlabMemoryPool> MemPool;
 
   ObjLayerT ObjectLayer;
   CompileLayerT CompileLayer;
@@ -160,9 +272,14 @@ private:
 
   orc::LocalCXXRuntimeOverrides CXXRuntimeOverrides;
   std::vector<orc::CtorDtorRunner<CODLayerT>> IRStaticDestructorRunners;
+
+  // Declared last, so that pending recompiles finish while the layers they
+  // look symbols up in are still alive.
+  std::unique_ptr<OrcTierUpCompiler> TierUp;
 };
 
-int runOrcLazyJIT(std::unique_ptr<Module> M, int ArgC, char* ArgV[]);
+int runOrcLazyJIT(std::unique_ptr<Module> M, int ArgC, char* ArgV[],
+                  StringRef CacheDir, uint64_t CacheSizeLimit);
 
 } // end namespace llvm
 
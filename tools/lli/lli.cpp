@@ -21,6 +21,7 @@
 #include "llvm/ADT/Triple.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
+#include "llvm/ExecutionEngine/FileObjectCache.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/Interpreter.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
@@ -51,6 +52,7 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Instrumentation.h"
 #include <cerrno>
@@ -173,6 +175,29 @@ namespace {
                            "(must be user writable)"),
                   cl::init(""));
 
+  cl::opt<std::string>
+  PersistentCacheDir("persistent-object-cache",
+                     cl::desc("Keep compiled objects in this directory, and "
+                              "reuse them when the same module is compiled "
+                              "for the same target"),
+                     cl::value_desc("directory"), cl::init(""));
+
+  cl::opt<unsigned>
+  PersistentCacheSizeLimit("persistent-object-cache-size-limit",
+                           cl::desc("Remove the least recently used objects "
+                                    "from the persistent object cache when "
+                                    "it grows beyond this many megabytes "
+                                    "(0 = no limit). The size is checked on "
+                                    "exit, at most every 20 minutes"),
+                           cl::init(1024));
+
+  cl::opt<bool>
+  PrintStartupTime("print-startup-time",
+                   cl::desc("Print the time taken before the entry function "
+                            "is run, and the persistent object cache "
+                            "statistics, to stderr"),
+                   cl::init(false));
+
   cl::opt<std::string>
   FakeArgv0("fake-argv0",
             cl::desc("Override the 'argv[0]' value passed into the executing"
@@ -332,6 +357,7 @@ private:
 
 static ExecutionEngine *EE = nullptr;
 static LLIObjectCache *CacheManager = nullptr;
+static FileObjectCache *PersistentCache = nullptr;
 
 static void do_shutdown() {
   // Cygwin-1.5 invokes DLL's dtors before atexit handler.
@@ -339,6 +365,7 @@ static void do_shutdown() {
   delete EE;
   if (CacheManager)
     delete CacheManager;
+  delete PersistentCache;
   llvm_shutdown();
 #endif
 }
@@ -387,6 +414,7 @@ static void addCygMingExtraModule(ExecutionEngine *EE,
 // main Driver function
 //
 int main(int argc, char **argv, char * const *envp) {
+  TimeRecord StartTime = TimeRecord::getCurrentTime(true);
   sys::PrintStackTraceOnErrorSignal();
   PrettyStackTraceProgram X(argc, argv);
 
@@ -415,8 +443,15 @@ int main(int argc, char **argv, char * const *envp) {
     return 1;
   }
 
+  if (EnableCacheManager && !PersistentCacheDir.empty()) {
+    errs() << argv[0] << ": -enable-cache-manager and -persistent-object-cache "
+              "cannot be used together.\n";
+    return 1;
+  }
+
   if (UseJITKind == JITKind::OrcLazy)
-    return runOrcLazyJIT(std::move(Owner), argc, argv);
+    return runOrcLazyJIT(std::move(Owner), argc, argv, PersistentCacheDir,
+                         uint64_t(PersistentCacheSizeLimit) * 1024 * 1024);
 
   if (EnableCacheManager) {
     std::string CacheName("file:");
@@ -510,6 +545,14 @@ int main(int argc, char **argv, char * const *envp) {
     EE->setObjectCache(CacheManager);
   }
 
+  // The interpreter has no target machine, and nothing to cache.
+  if (!PersistentCacheDir.empty() && EE->getTargetMachine()) {
+    PersistentCache =
+      new FileObjectCache(PersistentCacheDir, *EE->getTargetMachine(),
+                          uint64_t(PersistentCacheSizeLimit) * 1024 * 1024);
+    EE->setObjectCache(PersistentCache);
+  }
+
   // Load any additional modules specified on the command line.
   for (unsigned i = 0, e = ExtraModules.size(); i != e; ++i) {
     std::unique_ptr<Module> XMod = parseIRFile(ExtraModules[i], Err, Context);
@@ -628,6 +671,16 @@ int main(int argc, char **argv, char * const *envp) {
     if (RTDyldMM)
       static_cast<SectionMemoryManager*>(RTDyldMM)->invalidateInstructionCache();
 
+    if (PrintStartupTime) {
+      TimeRecord StartupTime = TimeRecord::getCurrentTime(false);
+      StartupTime -= StartTime;
+      errs() << "startup time: "
+             << format("%.6fs", StartupTime.getWallTime()) << "\n";
+      if (PersistentCache)
+        errs() << "object cache hits: " << PersistentCache->getNumHits()
+               << ", misses: " << PersistentCache->getNumMisses() << "\n";
+    }
+
     // Run main.
     Result = EE->runFunctionAsMain(EntryFn, InputArgv, envp);
 
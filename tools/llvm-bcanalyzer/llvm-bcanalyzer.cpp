@@ -110,6 +110,9 @@ static const char *GetBlockName(unsigned BlockID,
   case bitc::METADATA_BLOCK_ID:        return "METADATA_BLOCK";
   case bitc::METADATA_ATTACHMENT_ID:   return "METADATA_ATTACHMENT_BLOCK";
   case bitc::USELIST_BLOCK_ID:         return "USELIST_BLOCK_ID";
+  case bitc::FUNCTION_SUMMARY_BLOCK_ID:
+                                       return "FUNCTION_SUMMARY_BLOCK";
+  case bitc::METADATA_KIND_BLOCK_ID:   return "METADATA_KIND_BLOCK";
   }
 }
 
@@ -275,6 +278,13 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
     case bitc::METADATA_OLD_NODE:    return "METADATA_OLD_NODE";
     case bitc::METADATA_OLD_FN_NODE: return "METADATA_OLD_FN_NODE";
     case bitc::METADATA_NAMED_NODE:  return "METADATA_NAMED_NODE";
+    case bitc::METADATA_INDEX_OFFSET: return "METADATA_INDEX_OFFSET";
+    case bitc::METADATA_INDEX:       return "METADATA_INDEX";
+    }
+  case bitc::METADATA_KIND_BLOCK_ID:
+    switch(CodeID) {
+    default:return nullptr;
+    case bitc::METADATA_KIND:        return "METADATA_KIND";
     }
   case bitc::USELIST_BLOCK_ID:
     switch(CodeID) {
@@ -282,6 +292,13 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
     case bitc::USELIST_CODE_DEFAULT: return "USELIST_CODE_DEFAULT";
     case bitc::USELIST_CODE_BB:      return "USELIST_CODE_BB";
     }
+  case bitc::FUNCTION_SUMMARY_BLOCK_ID:
+    switch(CodeID) {
+    default:return nullptr;
+    case bitc::FS_CODE_MODULE_PATH: return "MODULE_PATH";
+    case bitc::FS_CODE_NAME:        return "NAME";
+    case bitc::FS_CODE_ENTRY:       return "ENTRY";
+    }
   }
 }
 
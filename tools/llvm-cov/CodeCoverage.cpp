@@ -31,13 +31,43 @@
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
+#include <cstring>
 #include <functional>
+#include <mutex>
 #include <system_error>
 
 using namespace llvm;
 using namespace coverage;
 
 namespace {
+/// \brief A string stream that keeps the color escape sequences, so that a
+/// view rendered on a worker thread can be printed in color afterwards.
+///
+/// Only usable when changing colors does not need to flush the output, i.e.
+/// when colors are escape sequences.
+class ColoredStringOstream : public raw_string_ostream {
+public:
+  explicit ColoredStringOstream(std::string &Str) : raw_string_ostream(Str) {}
+
+  raw_ostream &changeColor(enum Colors Color, bool Bold, bool BG) override {
+    writeCode(Color == SAVEDCOLOR ? sys::Process::OutputBold(BG)
+                                  : sys::Process::OutputColor(Color, Bold, BG));
+    return *this;
+  }
+
+  raw_ostream &resetColor() override {
+    writeCode(sys::Process::ResetColor());
+    return *this;
+  }
+
+private:
+  void writeCode(const char *Code) {
+    if (Code)
+      write(Code, strlen(Code));
+  }
+};
+
 /// \brief The implementation of the coverage tool.
 class CodeCoverageTool {
 public:
@@ -67,6 +97,11 @@ public:
   std::unique_ptr<SourceCoverageView>
   createSourceFileView(StringRef SourceFile, CoverageMapping &Coverage);
 
+  /// \brief Render the main source view of \p SourceFile on \p OS, or a
+  /// warning if the file isn't covered.
+  void renderSourceFile(StringRef SourceFile, CoverageMapping &Coverage,
+                        bool ShowFilename, raw_ostream &OS);
+
   /// \brief Load the coverage mapping data. Return true if an error occured.
   std::unique_ptr<CoverageMapping> load();
 
@@ -87,6 +122,11 @@ public:
   std::vector<std::string> SourceFiles;
   std::vector<std::pair<std::string, std::unique_ptr<MemoryBuffer>>>
       LoadedSourceFiles;
+  /// \brief Guards LoadedSourceFiles when views are created in parallel.
+  std::mutex LoadedSourceFilesMutex;
+  /// \brief The number of threads creating and rendering the views of files
+  /// and computing their summaries.
+  unsigned NumThreads;
   bool CompareFilenamesOnly;
   StringMap<std::string> RemappedFilenames;
   llvm::Triple::ArchType CoverageArch;
@@ -102,6 +142,7 @@ void CodeCoverageTool::error(const Twine &Message, StringRef Whence) {
 
 ErrorOr<const MemoryBuffer &>
 CodeCoverageTool::getSourceFile(StringRef SourceFile) {
+  std::lock_guard<std::mutex> Lock(LoadedSourceFilesMutex);
   // If we've remapped filenames, look up the real location for this file.
   if (!RemappedFilenames.empty()) {
     auto Loc = RemappedFilenames.find(SourceFile);
@@ -195,6 +236,26 @@ CodeCoverageTool::createSourceFileView(StringRef SourceFile,
   return View;
 }
 
+void CodeCoverageTool::renderSourceFile(StringRef SourceFile,
+                                        CoverageMapping &Coverage,
+                                        bool ShowFilename, raw_ostream &OS) {
+  auto mainView = createSourceFileView(SourceFile, Coverage);
+  if (!mainView) {
+    ViewOpts.colored_ostream(OS, raw_ostream::RED)
+        << "warning: The file '" << SourceFile << "' isn't covered.";
+    OS << "\n";
+    return;
+  }
+
+  if (ShowFilename) {
+    ViewOpts.colored_ostream(OS, raw_ostream::CYAN) << SourceFile << ":";
+    OS << "\n";
+  }
+  mainView->render(OS, /*Wholefile=*/true);
+  if (SourceFiles.size() > 1)
+    OS << "\n";
+}
+
 std::unique_ptr<CoverageMapping> CodeCoverageTool::load() {
   auto CoverageOrErr = CoverageMapping::load(ObjectFilename, PGOFilename,
                                              CoverageArch);
@@ -298,6 +359,13 @@ int CodeCoverageTool::run(Command Cmd, int argc, const char **argv) {
       "use-color", cl::desc("Emit colored output (default=autodetect)"),
       cl::init(cl::BOU_UNSET));
 
+  cl::opt<unsigned, true> NumThreads(
+      "num-threads", cl::location(this->NumThreads), cl::init(1),
+      cl::desc("Number of threads creating the views of source files and "
+               "computing their summaries"));
+  cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                        cl::aliasopt(NumThreads));
+
   auto commandLineParser = [&, this](int argc, const char **argv) -> int {
     cl::ParseCommandLineOptions(argc, argv, "LLVM code coverage tool\n");
     ViewOpts.Debug = DebugDump;
@@ -443,23 +511,28 @@ int CodeCoverageTool::show(int argc, const char **argv,
     for (StringRef Filename : Coverage->getUniqueSourceFiles())
       SourceFiles.push_back(Filename);
 
-  for (const auto &SourceFile : SourceFiles) {
-    auto mainView = createSourceFileView(SourceFile, *Coverage);
-    if (!mainView) {
-      ViewOpts.colored_ostream(outs(), raw_ostream::RED)
-          << "warning: The file '" << SourceFile << "' isn't covered.";
-      outs() << "\n";
-      continue;
-    }
+  // Colors that need the output to be flushed can't be buffered, so the
+  // files are then rendered serially.
+  if (NumThreads <= 1 || SourceFiles.size() <= 1 ||
+      (ViewOpts.Colors && sys::Process::ColorNeedsFlush())) {
+    for (const auto &SourceFile : SourceFiles)
+      renderSourceFile(SourceFile, *Coverage, ShowFilenames, outs());
+    return 0;
+  }
 
-    if (ShowFilenames) {
-      ViewOpts.colored_ostream(outs(), raw_ostream::CYAN) << SourceFile << ":";
-      outs() << "\n";
-    }
-    mainView->render(outs(), /*Wholefile=*/true);
-    if (SourceFiles.size() > 1)
-      outs() << "\n";
+  // Render each file into a buffer of its own, and print them in order.
+  std::vector<std::string> Rendered(SourceFiles.size());
+  {
+    ThreadPool Pool(std::min<size_t>(NumThreads, SourceFiles.size()));
+    for (unsigned I = 0, E = SourceFiles.size(); I != E; ++I)
+      Pool.async([this, I, ShowFilenames, &Coverage, &Rendered] {
+        ColoredStringOstream OS(Rendered[I]);
+        renderSourceFile(SourceFiles[I], *Coverage, ShowFilenames, OS);
+      });
+    Pool.wait();
   }
+  for (const auto &Buffer : Rendered)
+    outs() << Buffer;
 
   return 0;
 }
@@ -476,7 +549,7 @@ int CodeCoverageTool::report(int argc, const char **argv,
 
   CoverageReport Report(ViewOpts, std::move(Coverage));
   if (SourceFiles.empty())
-    Report.renderFileReports(llvm::outs());
+    Report.renderFileReports(llvm::outs(), NumThreads);
   else
     Report.renderFunctionReports(SourceFiles, llvm::outs());
   return 0;
@@ -15,6 +15,8 @@
 #include "RenderingSupport.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/ThreadPool.h"
+#include <functional>
 
 using namespace llvm;
 namespace {
@@ -190,7 +192,7 @@ void CoverageReport::renderFunctionReports(ArrayRef<std::string> Files,
   }
 }
 
-void CoverageReport::renderFileReports(raw_ostream &OS) {
+void CoverageReport::renderFileReports(raw_ostream &OS, unsigned NumThreads) {
   OS << column("Filename", FileReportColumns[0])
      << column("Regions", FileReportColumns[1], Column::RightAlignment)
      << column("Miss", FileReportColumns[2], Column::RightAlignment)
@@ -200,14 +202,31 @@ void CoverageReport::renderFileReports(raw_ostream &OS) {
      << "\n";
   renderDivider(FileReportColumns, OS);
   OS << "\n";
+  std::vector<StringRef> Filenames = Coverage->getUniqueSourceFiles();
+  std::vector<FileCoverageSummary> Summaries;
+  Summaries.reserve(Filenames.size());
+  for (StringRef Filename : Filenames)
+    Summaries.emplace_back(Filename);
+
+  auto Summarize = [this](FileCoverageSummary &Summary) {
+    for (const auto &F : Coverage->getCoveredFunctions(Summary.Name))
+      Summary.addFunction(FunctionCoverageSummary::get(F));
+  };
+  if (NumThreads <= 1 || Summaries.size() <= 1) {
+    for (auto &Summary : Summaries)
+      Summarize(Summary);
+  } else {
+    ThreadPool Pool(std::min<size_t>(NumThreads, Summaries.size()));
+    for (auto &Summary : Summaries)
+      Pool.async(Summarize, std::ref(Summary));
+    Pool.wait();
+  }
+
+  // Every function is counted in the summary of its primary file only, so
+  // the totals are the sums of the file summaries.
   FileCoverageSummary Totals("TOTAL");
-  for (StringRef Filename : Coverage->getUniqueSourceFiles()) {
-    FileCoverageSummary Summary(Filename);
-    for (const auto &F : Coverage->getCoveredFunctions(Filename)) {
-      FunctionCoverageSummary Function = FunctionCoverageSummary::get(F);
-      Summary.addFunction(Function);
-      Totals.addFunction(Function);
-    }
+  for (const auto &Summary : Summaries) {
+    Totals.addFile(Summary);
     render(Summary, OS);
   }
   renderDivider(FileReportColumns, OS);
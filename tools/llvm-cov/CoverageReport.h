@@ -34,7 +34,9 @@ public:
 
   void renderFunctionReports(ArrayRef<std::string> Files, raw_ostream &OS);
 
-  void renderFileReports(raw_ostream &OS);
+  /// \brief Render the summary of every file, computing the summaries on
+  /// \p NumThreads threads.
+  void renderFileReports(raw_ostream &OS, unsigned NumThreads = 1);
 };
 }
 
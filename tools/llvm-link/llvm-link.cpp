@@ -76,7 +76,10 @@ static std::unique_ptr<Module>
 loadFile(const char *argv0, const std::string &FN, LLVMContext &Context) {
   SMDiagnostic Err;
   if (Verbose) errs() << "Loading '" << FN << "'\n";
-  std::unique_ptr<Module> Result = getLazyIRFileModule(FN, Err, Context);
+  // Only the metadata that the named metadata and the linked functions refer
+  // to is loaded.
+  std::unique_ptr<Module> Result =
+      getLazyIRFileModule(FN, Err, Context, /* ShouldLazyLoadMetadata */ true);
   if (!Result)
     Err.print(argv0, errs());
 
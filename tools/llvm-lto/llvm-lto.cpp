@@ -12,10 +12,14 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/CommandFlags.h"
+#include "llvm/IR/FunctionInfo.h"
 #include "llvm/LTO/LTOCodeGenerator.h"
 #include "llvm/LTO/LTOModule.h"
+#include "llvm/LTO/ThinLTOCodeGenerator.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -46,6 +50,46 @@ static cl::opt<bool>
 DisableLTOVectorization("disable-lto-vectorization", cl::init(false),
   cl::desc("Do not run loop or slp vectorization during LTO"));
 
+static cl::opt<unsigned>
+Parallelism("j", cl::Prefix, cl::init(1),
+  cl::desc("Number of object files (and threads) to use for code generation"));
+
+enum ThinLTOModes {
+  THINLINK,
+  THINALL,
+  THINNONE
+};
+
+static cl::opt<ThinLTOModes> ThinLTOMode(
+    "thinlto-action", cl::desc("Perform thin LTO instead of regular LTO:"),
+    cl::init(THINNONE),
+    cl::values(
+        clEnumValN(THINLINK, "thinlink",
+                   "Write the combined function summary index of the "
+                   "inputs to <output>.thinlto.bc"),
+        clEnumValN(THINALL, "run",
+                   "Import, optimize and compile each input to its own "
+                   "object file: <output>, <output>.1, ..."),
+        clEnumValEnd));
+
+static cl::opt<std::string>
+CacheDir("cache-dir", cl::value_desc("directory"),
+  cl::desc("Cache the object files in the given directory"));
+
+static cl::opt<int>
+CachePruningInterval("cache-pruning-interval", cl::init(20 * 60),
+  cl::desc("Minimum time in seconds between two prunings of the cache "
+           "(negative disables pruning)"));
+
+static cl::opt<unsigned>
+CacheExpiration("cache-expiration", cl::init(7 * 24 * 60 * 60),
+  cl::desc("Time in seconds after which an unused cache entry is pruned "
+           "(0 disables expiration)"));
+
+static cl::opt<unsigned long long>
+CacheMaxSize("cache-max-size", cl::init(0),
+  cl::desc("Maximum size in bytes of the cache (0 disables the limit)"));
+
 static cl::opt<bool>
 UseDiagnosticHandler("use-diagnostic-handler", cl::init(false),
   cl::desc("Use a diagnostic handler to test the handler interface"));
@@ -142,6 +186,100 @@ static int listSymbols(StringRef Command, const TargetOptions &Options) {
   return 0;
 }
 
+/// \brief Write the combined function summary index of the inputs to
+/// <output>.thinlto.bc.
+static int createCombinedFunctionIndex(StringRef Command) {
+  FunctionInfoIndex CombinedIndex;
+  for (auto &Filename : InputFilenames) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+        MemoryBuffer::getFile(Filename);
+    if (std::error_code EC = BufferOrErr.getError()) {
+      errs() << Command << ": error loading file '" << Filename
+             << "': " << EC.message() << "\n";
+      return 1;
+    }
+    ErrorOr<std::unique_ptr<FunctionInfoIndex>> IndexOrErr =
+        getFunctionInfoIndex((*BufferOrErr)->getMemBufferRef());
+    if (std::error_code EC = IndexOrErr.getError()) {
+      errs() << Command << ": error reading the function summary of '"
+             << Filename << "': " << EC.message() << "\n";
+      return 1;
+    }
+    CombinedIndex.mergeFrom(std::move(IndexOrErr.get()));
+  }
+
+  std::error_code EC;
+  std::string IndexFilename = OutputFilename + ".thinlto.bc";
+  raw_fd_ostream OS(IndexFilename, EC, sys::fs::F_None);
+  if (EC) {
+    errs() << Command << ": error opening the file '" << IndexFilename
+           << "': " << EC.message() << "\n";
+    return 1;
+  }
+  WriteFunctionSummaryToFile(CombinedIndex, OS);
+  return 0;
+}
+
+/// \brief Compile each input to its own object file with the thin code
+/// generator.
+static int runThinLTO(StringRef Command, const TargetOptions &Options) {
+  ThinLTOCodeGenerator CodeGen;
+  CodeGen.setTargetOptions(Options);
+  CodeGen.setCpu(MCPU);
+  CodeGen.setCodePICModel(RelocModel);
+  CodeGen.setOptLevel(OptLevel - '0');
+  CodeGen.setParallelism(Parallelism);
+  CodeGen.setCacheDir(CacheDir);
+  CodeGen.setCachePruningInterval(CachePruningInterval);
+  CodeGen.setCacheExpiration(CacheExpiration);
+  CodeGen.setCacheMaxSize(CacheMaxSize);
+
+  std::string Attrs;
+  for (unsigned i = 0; i < MAttrs.size(); ++i) {
+    if (i > 0)
+      Attrs.append(",");
+    Attrs.append(MAttrs[i]);
+  }
+  CodeGen.setAttr(Attrs);
+
+  // The code generator does not copy the inputs.
+  std::vector<std::unique_ptr<MemoryBuffer>> Buffers;
+  for (auto &Filename : InputFilenames) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+        MemoryBuffer::getFile(Filename);
+    if (std::error_code EC = BufferOrErr.getError()) {
+      errs() << Command << ": error loading file '" << Filename
+             << "': " << EC.message() << "\n";
+      return 1;
+    }
+    Buffers.push_back(std::move(BufferOrErr.get()));
+    CodeGen.addModule(Filename, Buffers.back()->getBuffer());
+  }
+
+  std::string ErrorInfo;
+  if (!CodeGen.run(ErrorInfo)) {
+    errs() << Command << ": error compiling the code: " << ErrorInfo << "\n";
+    return 1;
+  }
+
+  ArrayRef<std::unique_ptr<MemoryBuffer>> Objects =
+      CodeGen.getProducedBinaries();
+  for (unsigned I = 0, E = Objects.size(); I != E; ++I) {
+    std::string ObjectFilename = OutputFilename;
+    if (I != 0)
+      ObjectFilename += "." + utostr(I);
+    std::error_code EC;
+    raw_fd_ostream OS(ObjectFilename, EC, sys::fs::F_None);
+    if (EC) {
+      errs() << Command << ": error opening the file '" << ObjectFilename
+             << "': " << EC.message() << "\n";
+      return 1;
+    }
+    OS << Objects[I]->getBuffer();
+  }
+  return 0;
+}
+
 int main(int argc, char **argv) {
   // Print a stack trace if we signal out.
   sys::PrintStackTraceOnErrorSignal();
@@ -167,6 +305,16 @@ int main(int argc, char **argv) {
   if (ListSymbolsOnly)
     return listSymbols(argv[0], Options);
 
+  if (ThinLTOMode != THINNONE) {
+    if (OutputFilename.empty()) {
+      errs() << argv[0] << ": -thinlto-action requires -o\n";
+      return 1;
+    }
+    if (ThinLTOMode == THINLINK)
+      return createCombinedFunctionIndex(argv[0]);
+    return runThinLTO(argv[0], Options);
+  }
+
   unsigned BaseArg = 0;
 
   LTOCodeGenerator CodeGen;
@@ -190,6 +338,10 @@ int main(int argc, char **argv) {
 
   CodeGen.setDebugInfo(LTO_DEBUG_MODEL_DWARF);
   CodeGen.setTargetOptions(Options);
+  CodeGen.setCacheDir(CacheDir.c_str());
+  CodeGen.setCachePruningInterval(CachePruningInterval);
+  CodeGen.setCacheExpiration(CacheExpiration);
+  CodeGen.setCacheMaxSize(CacheMaxSize);
 
   llvm::StringSet<llvm::MallocAllocator> DSOSymbolsSet;
   for (unsigned i = 0; i < DSOSymbols.size(); ++i)
@@ -252,7 +404,32 @@ int main(int argc, char **argv) {
   if (!attrs.empty())
     CodeGen.setAttr(attrs.c_str());
 
-  if (!OutputFilename.empty()) {
+  if (!OutputFilename.empty() && Parallelism > 1) {
+    std::string ErrorInfo;
+    CodeGen.setParallelism(Parallelism);
+    if (!CodeGen.optimize(DisableInline, DisableGVNLoadPRE,
+                          DisableLTOVectorization, ErrorInfo) ||
+        !CodeGen.compileOptimizedToFiles(ErrorInfo)) {
+      errs() << argv[0]
+             << ": error compiling the code: " << ErrorInfo << "\n";
+      return 1;
+    }
+
+    // Name the object files <output>, <output>.1, <output>.2, ...
+    for (unsigned I = 0, E = CodeGen.getNumObjectFiles(); I != E; ++I) {
+      std::string PartFilename = OutputFilename;
+      if (I != 0)
+        PartFilename += "." + utostr(I);
+      const char *ObjectPath = CodeGen.getObjectFilePath(I);
+      std::error_code EC = sys::fs::copy_file(ObjectPath, PartFilename);
+      sys::fs::remove(ObjectPath);
+      if (EC) {
+        errs() << argv[0] << ": error writing the file '" << PartFilename
+               << "': " << EC.message() << "\n";
+        return 1;
+      }
+    }
+  } else if (!OutputFilename.empty()) {
     size_t len = 0;
     std::string ErrorInfo;
     const void *Code =
@@ -25,7 +25,9 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <functional>
 
 using namespace llvm;
 
@@ -39,17 +41,19 @@ static void exitWithError(const Twine &Message, StringRef Whence = "") {
 
 enum ProfileKinds { instr, sample };
 
-static void mergeInstrProfile(const cl::list<std::string> &Inputs,
-                              StringRef OutputFilename) {
-  if (OutputFilename.compare("-") == 0)
-    exitWithError("Cannot write indexed profdata format to stdout.");
+/// The result of merging a run of consecutive inputs on one thread.
+struct WriterContext {
+  InstrProfWriter Writer;
+  /// Whether every input could be read and every record added. If not, the
+  /// inputs are merged again serially, which reports the errors.
+  bool Clean;
 
-  std::error_code EC;
-  raw_fd_ostream Output(OutputFilename.data(), EC, sys::fs::F_None);
-  if (EC)
-    exitWithError(EC.message(), OutputFilename);
+  WriterContext() : Clean(true) {}
+};
 
-  InstrProfWriter Writer;
+/// Add the records of Inputs to Writer, reporting the errors.
+static void addInstrInputs(ArrayRef<std::string> Inputs,
+                           InstrProfWriter &Writer) {
   for (const auto &Filename : Inputs) {
     auto ReaderOrErr = InstrProfReader::create(Filename);
     if (std::error_code ec = ReaderOrErr.getError())
@@ -63,14 +67,104 @@ static void mergeInstrProfile(const cl::list<std::string> &Inputs,
     if (Reader->hasError())
       exitWithError(Reader->getError().message(), Filename);
   }
+}
+
+/// Add the records of Inputs to the writer of WC, giving up silently at the
+/// first error.
+static void addInstrInputsQuietly(ArrayRef<std::string> Inputs,
+                                  WriterContext &WC) {
+  for (const auto &Filename : Inputs) {
+    auto ReaderOrErr = InstrProfReader::create(Filename);
+    if (ReaderOrErr.getError()) {
+      WC.Clean = false;
+      return;
+    }
+
+    auto Reader = std::move(ReaderOrErr.get());
+    for (const auto &I : *Reader)
+      if (WC.Writer.addFunctionCounts(I.Name, I.Hash, I.Counts)) {
+        WC.Clean = false;
+        return;
+      }
+    if (Reader->hasError()) {
+      WC.Clean = false;
+      return;
+    }
+  }
+}
+
+/// Merge Inputs on NumThreads threads: each thread merges a run of
+/// consecutive inputs into a writer of its own, then the writers are combined
+/// in input order. Returns false if any input could not be merged cleanly.
+static bool mergeInstrInputsInParallel(ArrayRef<std::string> Inputs,
+                                       unsigned NumThreads,
+                                       InstrProfWriter &Writer) {
+  unsigned NumRuns = std::min<size_t>(NumThreads, Inputs.size());
+  std::vector<WriterContext> Contexts(NumRuns);
+  ThreadPool Pool(NumRuns);
+  for (unsigned I = 0; I != NumRuns; ++I) {
+    size_t Begin = Inputs.size() * I / NumRuns;
+    size_t End = Inputs.size() * (I + 1) / NumRuns;
+    Pool.async(addInstrInputsQuietly, Inputs.slice(Begin, End - Begin),
+               std::ref(Contexts[I]));
+  }
+  Pool.wait();
+
+  // Combine the writers pairwise. The earlier run of inputs always absorbs
+  // the later one, so the functions end up added in the same order as by the
+  // serial merge.
+  for (unsigned Step = 1; Step < NumRuns; Step *= 2) {
+    for (unsigned I = 0; I + Step < NumRuns; I += 2 * Step) {
+      Pool.async([&Contexts, I, Step] {
+        WriterContext &Dst = Contexts[I];
+        WriterContext &Src = Contexts[I + Step];
+        if (!Dst.Clean || !Src.Clean) {
+          Dst.Clean = false;
+          return;
+        }
+        if (Dst.Writer.mergeRecordsFromWriter(std::move(Src.Writer)))
+          Dst.Clean = false;
+        Src.Writer = InstrProfWriter();
+      });
+    }
+    Pool.wait();
+  }
+
+  if (!Contexts[0].Clean)
+    return false;
+  Writer = std::move(Contexts[0].Writer);
+  return true;
+}
+
+static void mergeInstrProfile(const cl::list<std::string> &Inputs,
+                              StringRef OutputFilename, unsigned NumThreads) {
+  if (OutputFilename.compare("-") == 0)
+    exitWithError("Cannot write indexed profdata format to stdout.");
+
+  std::error_code EC;
+  raw_fd_ostream Output(OutputFilename.data(), EC, sys::fs::F_None);
+  if (EC)
+    exitWithError(EC.message(), OutputFilename);
+
+  // Summing counts is associative, so the parallel merge gives the same
+  // profile unless some record is rejected. The order in which rejections
+  // happen depends on the grouping, so in that case start over serially.
+  InstrProfWriter Writer;
+  if (NumThreads <= 1 || Inputs.size() <= 1 ||
+      !mergeInstrInputsInParallel(Inputs, NumThreads, Writer)) {
+    Writer = InstrProfWriter();
+    addInstrInputs(Inputs, Writer);
+  }
   Writer.write(Output);
 }
 
 static void mergeSampleProfile(const cl::list<std::string> &Inputs,
                                StringRef OutputFilename,
-                               sampleprof::SampleProfileFormat OutputFormat) {
+                               sampleprof::SampleProfileFormat OutputFormat,
+                               bool Compress) {
   using namespace sampleprof;
-  auto WriterOrErr = SampleProfileWriter::create(OutputFilename, OutputFormat);
+  auto WriterOrErr =
+      SampleProfileWriter::create(OutputFilename, OutputFormat, Compress);
   if (std::error_code EC = WriterOrErr.getError())
     exitWithError(EC.message(), OutputFilename);
 
@@ -117,16 +211,31 @@ static int merge_main(int argc, const char *argv[]) {
       cl::init(sampleprof::SPF_Binary),
       cl::values(clEnumValN(sampleprof::SPF_Binary, "binary",
                             "Binary encoding (default)"),
+                 clEnumValN(sampleprof::SPF_Indexed, "indexed",
+                            "Binary encoding with a function index"),
                  clEnumValN(sampleprof::SPF_Text, "text", "Text encoding"),
                  clEnumValN(sampleprof::SPF_GCC, "gcc", "GCC encoding"),
                  clEnumValEnd));
 
+  cl::opt<bool> Compress(
+      "compress", cl::init(false),
+      cl::desc("Compress the output profile (only meaningful with --sample "
+               "--indexed). Readers inflate all of a compressed profile "
+               "before looking up any function"));
+
+  cl::opt<unsigned> NumThreads(
+      "num-threads", cl::init(1),
+      cl::desc("Number of threads merging instrumentation profiles. The "
+               "output is the same whatever the number"));
+  cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                        cl::aliasopt(NumThreads));
+
   cl::ParseCommandLineOptions(argc, argv, "LLVM profile data merger\n");
 
   if (ProfileKind == instr)
-    mergeInstrProfile(Inputs, OutputFilename);
+    mergeInstrProfile(Inputs, OutputFilename, NumThreads);
   else
-    mergeSampleProfile(Inputs, OutputFilename, OutputFormat);
+    mergeSampleProfile(Inputs, OutputFilename, OutputFormat, Compress);
 
   return 0;
 }
@@ -193,7 +302,8 @@ static int showSampleProfile(std::string Filename, bool ShowCounts,
     exitWithError(EC.message(), Filename);
 
   auto Reader = std::move(ReaderOrErr.get());
-  Reader->read();
+  if (std::error_code EC = Reader->read())
+    exitWithError(EC.message(), Filename);
   if (ShowAllFunctions || ShowFunction.empty())
     Reader->dump(OS);
   else
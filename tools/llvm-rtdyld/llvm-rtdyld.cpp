@@ -25,6 +25,7 @@
 #include "llvm/Object/MachO.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Memory.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -32,6 +33,7 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <list>
 #include <system_error>
@@ -46,7 +48,8 @@ InputFileList(cl::Positional, cl::ZeroOrMore,
 enum ActionType {
   AC_Execute,
   AC_PrintLineInfo,
-  AC_Verify
+  AC_Verify,
+  AC_Benchmark
 };
 
 static cl::opt<ActionType>
@@ -58,6 +61,8 @@ Action(cl::desc("Action to perform:"),
                              "Load, link, and print line information for each function."),
                   clEnumValN(AC_Verify, "verify",
                              "Load, link and verify the resulting memory image."),
+                  clEnumValN(AC_Benchmark, "benchmark",
+                             "Load and link the inputs repeatedly, and time it."),
                   clEnumValEnd));
 
 static cl::opt<std::string>
@@ -98,6 +103,12 @@ TargetSectionSep("target-section-sep",
                  cl::init(0),
                  cl::Hidden);
 
+static cl::opt<unsigned>
+BenchmarkIterations("benchmark-iterations",
+                    cl::desc("For -benchmark only: number of times to load "
+                             "and link the inputs."),
+                    cl::init(100));
+
 static cl::list<std::string>
 SpecificSectionMappings("map-section",
                         cl::desc("Map a section to a specific address."),
@@ -112,6 +123,8 @@ public:
   SmallVector<sys::MemoryBlock, 16> FunctionMemory;
   SmallVector<sys::MemoryBlock, 16> DataMemory;
 
+  ~TrivialMemoryManager() override;
+
   uint8_t *allocateCodeSection(uintptr_t Size, unsigned Alignment,
                                unsigned SectionID,
                                StringRef SectionName) override;
@@ -133,6 +146,13 @@ public:
   virtual void invalidateInstructionCache();
 };
 
+TrivialMemoryManager::~TrivialMemoryManager() {
+  for (sys::MemoryBlock &MB : FunctionMemory)
+    sys::Memory::ReleaseRWX(MB);
+  for (sys::MemoryBlock &MB : DataMemory)
+    sys::Memory::ReleaseRWX(MB);
+}
+
 uint8_t *TrivialMemoryManager::allocateCodeSection(uintptr_t Size,
                                                    unsigned Alignment,
                                                    unsigned SectionID,
@@ -331,6 +351,74 @@ static int executeInput() {
   return Main(1, Argv);
 }
 
+// Load and link the objects specified on the command line a number of times,
+// and report how long loading and resolving their relocations took.
+static int benchmarkInput() {
+  // Load any dylibs requested on the command line.
+  loadDylibs();
+
+  // Read all the inputs first, so that only RuntimeDyld is timed.
+  std::vector<std::unique_ptr<MemoryBuffer>> InputBuffers;
+  std::vector<std::unique_ptr<ObjectFile>> Objects;
+  uint64_t NumRelocations = 0;
+
+  // If we don't have any input files, read from stdin.
+  if (!InputFileList.size())
+    InputFileList.push_back("-");
+  for (unsigned i = 0, e = InputFileList.size(); i != e; ++i) {
+    // Load the input memory buffer.
+    ErrorOr<std::unique_ptr<MemoryBuffer>> InputBuffer =
+        MemoryBuffer::getFileOrSTDIN(InputFileList[i]);
+    if (std::error_code EC = InputBuffer.getError())
+      return Error("unable to read input: '" + EC.message() + "'");
+    ErrorOr<std::unique_ptr<ObjectFile>> MaybeObj(
+      ObjectFile::createObjectFile((*InputBuffer)->getMemBufferRef()));
+
+    if (std::error_code EC = MaybeObj.getError())
+      return Error("unable to create object file: '" + EC.message() + "'");
+
+    for (const SectionRef &Section : (*MaybeObj)->sections())
+      for (const RelocationRef &Reloc : Section.relocations()) {
+        (void)Reloc;
+        ++NumRelocations;
+      }
+
+    InputBuffers.push_back(std::move(*InputBuffer));
+    Objects.push_back(std::move(*MaybeObj));
+  }
+
+  double LoadTime = 0, ResolveTime = 0;
+  for (unsigned I = 0; I != BenchmarkIterations; ++I) {
+    // Instantiate a dynamic linker.
+    TrivialMemoryManager MemMgr;
+    RuntimeDyld Dyld(MemMgr, MemMgr);
+
+    TimeRecord Start = TimeRecord::getCurrentTime(true);
+    for (auto &Obj : Objects) {
+      Dyld.loadObject(*Obj);
+      if (Dyld.hasError())
+        return Error(Dyld.getErrorString());
+    }
+    TimeRecord Loaded = TimeRecord::getCurrentTime(false);
+    Dyld.resolveRelocations();
+    TimeRecord Resolved = TimeRecord::getCurrentTime(false);
+
+    LoadTime += Loaded.getWallTime() - Start.getWallTime();
+    ResolveTime += Resolved.getWallTime() - Loaded.getWallTime();
+  }
+
+  double TotalTime = LoadTime + ResolveTime;
+  uint64_t TotalRelocations = NumRelocations * BenchmarkIterations;
+  outs() << "objects: " << Objects.size() << "\n"
+         << "relocations: " << NumRelocations << "\n"
+         << "iterations: " << BenchmarkIterations << "\n"
+         << format("load time: %.6fs\n", LoadTime)
+         << format("resolve time: %.6fs\n", ResolveTime)
+         << format("relocations/sec: %.0f\n",
+                   TotalTime > 0 ? TotalRelocations / TotalTime : 0.0);
+  return 0;
+}
+
 static int checkAllExpressions(RuntimeDyldChecker &Checker) {
   for (const auto& CheckerFileName : CheckFiles) {
     ErrorOr<std::unique_ptr<MemoryBuffer>> CheckerFileBuf =
@@ -596,5 +684,7 @@ int main(int argc, char **argv) {
     return printLineInfoForInput();
   case AC_Verify:
     return linkAndVerify();
+  case AC_Benchmark:
+    return benchmarkInput();
   }
 }
@@ -13,6 +13,8 @@
 
 #include "LLVMSymbolize.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Config/config.h"
 #include "llvm/Object/ELFObjectFile.h"
 #include "llvm/Object/MachO.h"
@@ -22,7 +24,9 @@
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
+#include <algorithm>
 #include <sstream>
 #include <stdlib.h>
 
@@ -43,8 +47,49 @@ getDILineInfoSpecifier(const LLVMSymbolizer::Options &Opts) {
       Opts.PrintFunctions);
 }
 
+static std::string toHexString(ArrayRef<uint8_t> Bytes) {
+  std::string Result;
+  for (uint8_t Byte : Bytes) {
+    Result += hexdigit(Byte >> 4, /*LowerCase=*/true);
+    Result += hexdigit(Byte & 0xf, /*LowerCase=*/true);
+  }
+  return Result;
+}
+
+static std::string computeBuildID(const ObjectFile *Obj) {
+  if (auto *MachO = dyn_cast<MachOObjectFile>(Obj))
+    return toHexString(MachO->getUuid());
+  if (!Obj->isELF())
+    return std::string();
+  for (const SectionRef &Section : Obj->sections()) {
+    StringRef Name;
+    if (Section.getName(Name) || Name != ".note.gnu.build-id")
+      continue;
+    StringRef Data;
+    if (Section.getContents(Data))
+      break;
+    // The note is made of its name size, descriptor size and type, followed
+    // by its name ("GNU") and descriptor (the ID), both padded to 4 bytes.
+    const uint32_t NT_GNU_BUILD_ID = 3;
+    DataExtractor DE(Data, Obj->isLittleEndian(), 0);
+    uint32_t Offset = 0;
+    if (!DE.isValidOffsetForDataOfSize(Offset, 12))
+      break;
+    uint32_t NameSize = DE.getU32(&Offset);
+    uint32_t DescSize = DE.getU32(&Offset);
+    uint32_t Type = DE.getU32(&Offset);
+    Offset += RoundUpToAlignment(NameSize, 4);
+    if (Type != NT_GNU_BUILD_ID || DescSize == 0 ||
+        !DE.isValidOffsetForDataOfSize(Offset, DescSize))
+      break;
+    return toHexString(
+        makeArrayRef(Data.bytes_begin() + Offset, DescSize));
+  }
+  return std::string();
+}
+
 ModuleInfo::ModuleInfo(ObjectFile *Obj, DIContext *DICtx)
-    : Module(Obj), DebugInfoContext(DICtx) {
+    : Module(Obj), DebugInfoContext(DICtx), BuildID(computeBuildID(Obj)) {
   std::unique_ptr<DataExtractor> OpdExtractor;
   uint64_t OpdAddress = 0;
   // Find the .opd (function descriptor) section if any, for big-endian
@@ -75,6 +120,22 @@ ModuleInfo::ModuleInfo(ObjectFile *Obj, DIContext *DICtx)
       addSymbol(*si, OpdExtractor.get(), OpdAddress);
     }
   }
+
+  // Sort the symbols by address. When several symbols have the same address,
+  // keep the first one.
+  for (SymbolTable *Symbols : {&Functions, &Objects}) {
+    std::stable_sort(Symbols->begin(), Symbols->end(),
+                     [](const SymbolTable::value_type &LHS,
+                        const SymbolTable::value_type &RHS) {
+                       return LHS.first < RHS.first;
+                     });
+    Symbols->erase(std::unique(Symbols->begin(), Symbols->end(),
+                               [](const SymbolTable::value_type &LHS,
+                                  const SymbolTable::value_type &RHS) {
+                                 return LHS.first.Addr == RHS.first.Addr;
+                               }),
+                   Symbols->end());
+  }
 }
 
 void ModuleInfo::addSymbol(const SymbolRef &Symbol, DataExtractor *OpdExtractor,
@@ -118,7 +179,7 @@ void ModuleInfo::addSymbol(const SymbolRef &Symbol, DataExtractor *OpdExtractor,
   // with same address size. Make sure we choose the correct one.
   auto &M = SymbolType == SymbolRef::ST_Function ? Functions : Objects;
   SymbolDesc SD = { SymbolAddress, SymbolSize };
-  M.insert(std::make_pair(SD, SymbolName));
+  M.push_back(std::make_pair(SD, SymbolName));
 }
 
 bool ModuleInfo::getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
@@ -127,8 +188,11 @@ bool ModuleInfo::getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
   const auto &SymbolMap = Type == SymbolRef::ST_Function ? Functions : Objects;
   if (SymbolMap.empty())
     return false;
-  SymbolDesc SD = { Address, Address };
-  auto SymbolIterator = SymbolMap.upper_bound(SD);
+  auto SymbolIterator = std::upper_bound(
+      SymbolMap.begin(), SymbolMap.end(), Address,
+      [](uint64_t Address, const SymbolTable::value_type &Symbol) {
+        return Address < Symbol.first.Addr;
+      });
   if (SymbolIterator == SymbolMap.begin())
     return false;
   --SymbolIterator;
@@ -197,6 +261,76 @@ bool ModuleInfo::symbolizeData(uint64_t ModuleOffset, std::string &Name,
                                 Size);
 }
 
+void ResultCache::load() {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MB = MemoryBuffer::getFile(Path);
+  if (!MB)
+    return;
+  // Each entry is a line "C <offset> <size>" or "D <offset> <size>" followed
+  // by the result. Stop at the first malformed entry, which may have been
+  // cut short.
+  StringRef Rest = MB.get()->getBuffer();
+  while (!Rest.empty()) {
+    std::pair<StringRef, StringRef> Line = Rest.split('\n');
+    SmallVector<StringRef, 3> Fields;
+    Line.first.split(Fields, " ");
+    uint64_t ModuleOffset, Size;
+    if (Fields.size() != 3 || (Fields[0] != "C" && Fields[0] != "D") ||
+        Fields[1].getAsInteger(16, ModuleOffset) ||
+        Fields[2].getAsInteger(10, Size) || Size > Line.second.size())
+      return;
+    auto &Results = Fields[0] == "D" ? Data : Code;
+    Results.insert(std::make_pair(ModuleOffset, Line.second.substr(0, Size)));
+    Rest = Line.second.substr(Size);
+  }
+}
+
+void ResultCache::save() {
+  if (!Dirty)
+    return;
+  // Keep what other processes have added since the file was read.
+  load();
+
+  SmallString<128> Dir(Path);
+  sys::path::remove_filename(Dir);
+  if (sys::fs::create_directories(Dir))
+    return;
+  int FD;
+  SmallString<128> TempPath;
+  if (sys::fs::createUniqueFile(Path + ".tmp-%%%%%%%%", FD, TempPath))
+    return;
+  bool WriteFailed;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    for (const auto &Results : {std::make_pair('C', &Code),
+                                std::make_pair('D', &Data)})
+      for (const auto &Result : *Results.second)
+        OS << Results.first << ' ' << utohexstr(Result.first) << ' '
+           << Result.second.size() << '\n' << Result.second;
+    OS.close();
+    WriteFailed = OS.has_error();
+    OS.clear_error();
+  }
+  // Replace the file at once, so that readers never see a partial file.
+  if (WriteFailed || sys::fs::rename(TempPath, Path))
+    sys::fs::remove(TempPath);
+  else
+    Dirty = false;
+}
+
+const std::string *ResultCache::lookup(bool IsData,
+                                       uint64_t ModuleOffset) const {
+  const auto &Results = IsData ? Data : Code;
+  auto I = Results.find(ModuleOffset);
+  return I == Results.end() ? nullptr : &I->second;
+}
+
+void ResultCache::insert(bool IsData, uint64_t ModuleOffset,
+                         const std::string &Result) {
+  auto &Results = IsData ? Data : Code;
+  if (Results.insert(std::make_pair(ModuleOffset, Result)).second)
+    Dirty = true;
+}
+
 const char LLVMSymbolizer::kBadString[] = "??";
 
 std::string LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
@@ -204,20 +338,27 @@ std::string LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
   ModuleInfo *Info = getOrCreateModuleInfo(ModuleName);
   if (!Info)
     return printDILineInfo(DILineInfo());
+  ResultCache *Cache = Info->getResultCache();
+  if (Cache)
+    if (const std::string *Result = Cache->lookup(false, ModuleOffset))
+      return *Result;
+  std::string Result;
   if (Opts.PrintInlining) {
     DIInliningInfo InlinedContext =
         Info->symbolizeInlinedCode(ModuleOffset, Opts);
     uint32_t FramesNum = InlinedContext.getNumberOfFrames();
     assert(FramesNum > 0);
-    std::string Result;
     for (uint32_t i = 0; i < FramesNum; i++) {
       DILineInfo LineInfo = InlinedContext.getFrame(i);
       Result += printDILineInfo(LineInfo);
     }
-    return Result;
+  } else {
+    DILineInfo LineInfo = Info->symbolizeCode(ModuleOffset, Opts);
+    Result = printDILineInfo(LineInfo);
   }
-  DILineInfo LineInfo = Info->symbolizeCode(ModuleOffset, Opts);
-  return printDILineInfo(LineInfo);
+  if (Cache)
+    Cache->insert(false, ModuleOffset, Result);
+  return Result;
 }
 
 std::string LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
@@ -225,18 +366,51 @@ std::string LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
   std::string Name = kBadString;
   uint64_t Start = 0;
   uint64_t Size = 0;
+  ResultCache *Cache = nullptr;
   if (Opts.UseSymbolTable) {
     if (ModuleInfo *Info = getOrCreateModuleInfo(ModuleName)) {
+      Cache = Info->getResultCache();
+      if (Cache)
+        if (const std::string *Result = Cache->lookup(true, ModuleOffset))
+          return *Result;
       if (Info->symbolizeData(ModuleOffset, Name, Start, Size) && Opts.Demangle)
         Name = DemangleName(Name);
     }
   }
   std::stringstream ss;
   ss << Name << "\n" << Start << " " << Size << "\n";
+  if (Cache)
+    Cache->insert(true, ModuleOffset, ss.str());
   return ss.str();
 }
 
+std::vector<std::string>
+LLVMSymbolizer::symbolizeBatch(ArrayRef<Request> Requests) {
+  // The debug info of a module cannot be read by several threads at once, so
+  // each module is symbolized by a single task, in the order of the requests.
+  StringMap<std::vector<size_t>> RequestsPerModule;
+  for (size_t I = 0, E = Requests.size(); I != E; ++I)
+    RequestsPerModule[Requests[I].ModuleName].push_back(I);
+  std::vector<const std::vector<size_t> *> Groups;
+  for (const auto &Group : RequestsPerModule)
+    Groups.push_back(&Group.getValue());
+
+  std::vector<std::string> Results(Requests.size());
+  parallel_for_each(Groups.begin(), Groups.end(),
+                    [&](const std::vector<size_t> *Group) {
+    for (size_t I : *Group) {
+      const Request &R = Requests[I];
+      Results[I] = R.IsData ? symbolizeData(R.ModuleName, R.ModuleOffset)
+                            : symbolizeCode(R.ModuleName, R.ModuleOffset);
+    }
+  });
+  return Results;
+}
+
 void LLVMSymbolizer::flush() {
+  for (const auto &Module : Modules)
+    if (Module.second && Module.second->getResultCache())
+      Module.second->getResultCache()->save();
   DeleteContainerSeconds(Modules);
   ObjectPairForPathArch.clear();
   ObjectFileForArch.clear();
@@ -303,6 +477,17 @@ static bool findDebugBinary(const std::string &OrigPath,
   return false;
 }
 
+static bool hasDWARFDebugInfo(const ObjectFile *Obj) {
+  for (const SectionRef &Section : Obj->sections()) {
+    StringRef Name;
+    Section.getName(Name);
+    Name = Name.substr(Name.find_first_not_of("._"));
+    if (Name == "debug_info")
+      return true;
+  }
+  return false;
+}
+
 static bool getGNUDebuglinkContents(const ObjectFile *Obj, std::string &DebugName,
                                     uint32_t &CRCHash) {
   if (!Obj)
@@ -439,6 +624,7 @@ LLVMSymbolizer::getObjectFileFromBinary(Binary *Bin,
 
 ModuleInfo *
 LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
+  std::unique_lock<std::mutex> LockGuard(Lock);
   const auto &I = Modules.find(ModuleName);
   if (I != Modules.end())
     return I->second;
@@ -460,11 +646,37 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
     Modules.insert(make_pair(ModuleName, (ModuleInfo *)nullptr));
     return nullptr;
   }
+  // Reading the symbol table is the slow part, so let other threads open
+  // their modules meanwhile.
+  LockGuard.unlock();
   DIContext *Context = DIContext::getDWARFContext(*Objects.second);
   assert(Context);
-  ModuleInfo *Info = new ModuleInfo(Objects.first, Context);
-  Modules.insert(make_pair(ModuleName, Info));
-  return Info;
+  std::unique_ptr<ModuleInfo> Info(new ModuleInfo(Objects.first, Context));
+  // The cache is keyed by the build ID of the binary, not by the debug
+  // object that was found for it. Results made from the symbol table alone
+  // (no debug object found yet) are not cached, or a later run that finds
+  // the debug info would keep reading them.
+  if (!Opts.CachePath.empty() && !Info->getBuildID().empty() &&
+      hasDWARFDebugInfo(Objects.second)) {
+    // The results depend on the options, so each set of options has its own
+    // file.
+    unsigned OptionBits = Opts.UseSymbolTable |
+                          static_cast<unsigned>(Opts.PrintFunctions) << 1 |
+                          Opts.PrintInlining << 3 | Opts.Demangle << 4;
+    SmallString<128> CacheFile(Opts.CachePath);
+    sys::path::append(CacheFile,
+                      Info->getBuildID() + "-" + utohexstr(OptionBits));
+    std::unique_ptr<ResultCache> Cache(new ResultCache(CacheFile.str()));
+    Cache->load();
+    Info->setResultCache(std::move(Cache));
+  }
+
+  LockGuard.lock();
+  // Another thread may have created the same module in the meantime.
+  auto Inserted = Modules.insert(make_pair(ModuleName, Info.get()));
+  if (!Inserted.second)
+    return Inserted.first->second;
+  return Info.release();
 }
 
 std::string LLVMSymbolizer::printDILineInfo(DILineInfo LineInfo) const {
@@ -13,6 +13,7 @@
 #ifndef LLVM_TOOLS_LLVM_SYMBOLIZER_LLVMSYMBOLIZE_H
 #define LLVM_TOOLS_LLVM_SYMBOLIZER_LLVMSYMBOLIZE_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/DebugInfo/DWARF/DIContext.h"
 #include "llvm/Object/MachOUniversal.h"
@@ -21,7 +22,9 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace llvm {
 
@@ -41,6 +44,9 @@ public:
     bool Demangle : 1;
     std::string DefaultArch;
     std::vector<std::string> DsymHints;
+    // If not empty, the results for modules with a build ID are kept in
+    // this directory across runs.
+    std::string CachePath;
     Options(bool UseSymbolTable = true,
             FunctionNameKind PrintFunctions = FunctionNameKind::LinkageName,
             bool PrintInlining = true, bool Demangle = true,
@@ -61,6 +67,17 @@ public:
   symbolizeCode(const std::string &ModuleName, uint64_t ModuleOffset);
   std::string
   symbolizeData(const std::string &ModuleName, uint64_t ModuleOffset);
+
+  struct Request {
+    bool IsData;
+    std::string ModuleName;
+    uint64_t ModuleOffset;
+  };
+  // Returns the results for a batch of requests, in the same order. The
+  // requests for different modules are handled in parallel.
+  std::vector<std::string> symbolizeBatch(ArrayRef<Request> Requests);
+
+  // Writes the cached results and frees all the modules.
   void flush();
   static std::string DemangleName(const std::string &Name);
 private:
@@ -99,12 +116,46 @@ private:
 
   Options Opts;
   static const char kBadString[];
+
+  // Guards the modules and object files, so that modules can be symbolized
+  // concurrently. A given module must only be used by one thread at a time.
+  std::mutex Lock;
+};
+
+// The results of earlier symbolizations of a module, which are kept in a
+// file named after the build ID of the module and the options that affect
+// the results.
+class ResultCache {
+public:
+  ResultCache(std::string Path) : Path(std::move(Path)), Dirty(false) {}
+
+  // Reads the file, keeping the entries that are already in memory.
+  void load();
+  // Writes the file if there are new entries. The entries written by other
+  // processes since the file was read are kept too.
+  void save();
+
+  const std::string *lookup(bool IsData, uint64_t ModuleOffset) const;
+  void insert(bool IsData, uint64_t ModuleOffset, const std::string &Result);
+
+private:
+  std::string Path;
+  std::map<uint64_t, std::string> Code;
+  std::map<uint64_t, std::string> Data;
+  bool Dirty;
 };
 
 class ModuleInfo {
 public:
   ModuleInfo(ObjectFile *Obj, DIContext *DICtx);
 
+  // Returns the build ID of the module as an hexadecimal string, or an empty
+  // string if it has none.
+  const std::string &getBuildID() const { return BuildID; }
+
+  ResultCache *getResultCache() const { return Cache.get(); }
+  void setResultCache(std::unique_ptr<ResultCache> C) { Cache = std::move(C); }
+
   DILineInfo symbolizeCode(uint64_t ModuleOffset,
                            const LLVMSymbolizer::Options &Opts) const;
   DIInliningInfo symbolizeInlinedCode(
@@ -133,8 +184,15 @@ private:
       return s1.Addr < s2.Addr;
     }
   };
-  std::map<SymbolDesc, StringRef> Functions;
-  std::map<SymbolDesc, StringRef> Objects;
+  // Sorted by address once all the symbols have been added. There are
+  // millions of symbols in large binaries, so these are flat arrays rather
+  // than maps.
+  typedef std::vector<std::pair<SymbolDesc, StringRef>> SymbolTable;
+  SymbolTable Functions;
+  SymbolTable Objects;
+
+  std::string BuildID;
+  std::unique_ptr<ResultCache> Cache;
 };
 
 } // namespace symbolize
@@ -68,6 +68,16 @@ ClDsymHint("dsym-hint", cl::ZeroOrMore,
            cl::desc("Path to .dSYM bundles to search for debug info for the "
                     "object files"));
 
+static cl::opt<bool>
+ClBatch("batch", cl::init(false),
+        cl::desc("Read all the input before symbolizing it, and symbolize "
+                 "the addresses of different modules in parallel"));
+
+static cl::opt<std::string>
+ClCachePath("cache-path", cl::init(""),
+            cl::desc("Directory where the results for modules with a build "
+                     "ID are kept across runs"));
+
 static bool parseCommand(bool &IsData, std::string &ModuleName,
                          uint64_t &ModuleOffset) {
   const char *kDataCmd = "DATA ";
@@ -134,11 +144,20 @@ int main(int argc, char **argv) {
                 "\" (must have the '.dSYM' extension).\n";
     }
   }
+  Opts.CachePath = ClCachePath;
   LLVMSymbolizer Symbolizer(Opts);
 
   bool IsData = false;
   std::string ModuleName;
   uint64_t ModuleOffset;
+  if (ClBatch) {
+    std::vector<LLVMSymbolizer::Request> Requests;
+    while (parseCommand(IsData, ModuleName, ModuleOffset))
+      Requests.push_back({IsData, ModuleName, ModuleOffset});
+    for (const std::string &Result : Symbolizer.symbolizeBatch(Requests))
+      outs() << Result << "\n";
+    return 0;
+  }
   while (parseCommand(IsData, ModuleName, ModuleOffset)) {
     std::string Result =
         IsData ? Symbolizer.symbolizeData(ModuleName, ModuleOffset)
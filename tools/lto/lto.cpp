@@ -18,6 +18,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/LTO/LTOCodeGenerator.h"
 #include "llvm/LTO/LTOModule.h"
+#include "llvm/LTO/ThinLTOCodeGenerator.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
@@ -75,6 +76,7 @@ static void lto_initialize() {
 
 DEFINE_SIMPLE_CONVERSION_FUNCTIONS(LTOCodeGenerator, lto_code_gen_t)
 DEFINE_SIMPLE_CONVERSION_FUNCTIONS(LTOModule, lto_module_t)
+DEFINE_SIMPLE_CONVERSION_FUNCTIONS(ThinLTOCodeGenerator, thinlto_code_gen_t)
 
 // Convert the subtarget features into a string to pass to LTOCodeGenerator.
 static void lto_add_attrs(lto_code_gen_t cg) {
@@ -321,6 +323,42 @@ const void *lto_codegen_compile_optimized(lto_code_gen_t cg, size_t *length) {
   return unwrap(cg)->compileOptimized(length, sLastErrorString);
 }
 
+void lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned int parallelism) {
+  unwrap(cg)->setParallelism(parallelism ? parallelism : 1);
+}
+
+bool lto_codegen_compile_optimized_to_files(lto_code_gen_t cg) {
+  maybeParseOptions(cg);
+  return !unwrap(cg)->compileOptimizedToFiles(sLastErrorString);
+}
+
+unsigned int lto_codegen_get_num_object_files(lto_code_gen_t cg) {
+  return unwrap(cg)->getNumObjectFiles();
+}
+
+const char *lto_codegen_get_object_file_name(lto_code_gen_t cg,
+                                             unsigned int index) {
+  return unwrap(cg)->getObjectFilePath(index);
+}
+
+void lto_codegen_set_cache_dir(lto_code_gen_t cg, const char *cache_dir) {
+  unwrap(cg)->setCacheDir(cache_dir);
+}
+
+void lto_codegen_set_cache_pruning_interval(lto_code_gen_t cg, int interval) {
+  unwrap(cg)->setCachePruningInterval(interval);
+}
+
+void lto_codegen_set_cache_entry_expiration(lto_code_gen_t cg,
+                                            unsigned int expiration) {
+  unwrap(cg)->setCacheExpiration(expiration);
+}
+
+void lto_codegen_set_cache_size_bytes(lto_code_gen_t cg,
+                                      unsigned long long max_size_bytes) {
+  unwrap(cg)->setCacheMaxSize(max_size_bytes);
+}
+
 bool lto_codegen_compile_to_file(lto_code_gen_t cg, const char **name) {
   maybeParseOptions(cg);
   return !unwrap(cg)->compile_to_file(
@@ -333,3 +371,101 @@ void lto_codegen_debug_options(lto_code_gen_t cg, const char *opt) {
 }
 
 unsigned int lto_api_version() { return LTO_API_VERSION; }
+
+bool lto_module_is_thinlto_in_memory(const void *mem, size_t length) {
+  return LTOModule::isThinLTO(mem, length);
+}
+
+thinlto_code_gen_t thinlto_create_codegen(void) {
+  lto_initialize();
+  ThinLTOCodeGenerator *CodeGen = new ThinLTOCodeGenerator();
+  CodeGen->setTargetOptions(InitTargetOptionsFromCodeGenFlags());
+  return wrap(CodeGen);
+}
+
+void thinlto_codegen_dispose(thinlto_code_gen_t cg) { delete unwrap(cg); }
+
+void thinlto_codegen_add_module(thinlto_code_gen_t cg, const char *Identifier,
+                                const char *Data, int Length) {
+  unwrap(cg)->addModule(Identifier, StringRef(Data, Length));
+}
+
+void thinlto_codegen_set_cpu(thinlto_code_gen_t cg, const char *cpu) {
+  unwrap(cg)->setCpu(cpu);
+}
+
+bool thinlto_codegen_set_pic_model(thinlto_code_gen_t cg,
+                                   lto_codegen_model model) {
+  switch (model) {
+  case LTO_CODEGEN_PIC_MODEL_STATIC:
+    unwrap(cg)->setCodePICModel(Reloc::Static);
+    return false;
+  case LTO_CODEGEN_PIC_MODEL_DYNAMIC:
+    unwrap(cg)->setCodePICModel(Reloc::PIC_);
+    return false;
+  case LTO_CODEGEN_PIC_MODEL_DYNAMIC_NO_PIC:
+    unwrap(cg)->setCodePICModel(Reloc::DynamicNoPIC);
+    return false;
+  case LTO_CODEGEN_PIC_MODEL_DEFAULT:
+    unwrap(cg)->setCodePICModel(Reloc::Default);
+    return false;
+  }
+  sLastErrorString = "Unknown PIC model";
+  return true;
+}
+
+void thinlto_codegen_set_parallelism(thinlto_code_gen_t cg,
+                                     unsigned int parallelism) {
+  unwrap(cg)->setParallelism(parallelism);
+}
+
+void thinlto_codegen_set_cache_dir(thinlto_code_gen_t cg,
+                                   const char *cache_dir) {
+  unwrap(cg)->setCacheDir(cache_dir);
+}
+
+void thinlto_codegen_set_cache_pruning_interval(thinlto_code_gen_t cg,
+                                                int interval) {
+  unwrap(cg)->setCachePruningInterval(interval);
+}
+
+void thinlto_codegen_set_cache_entry_expiration(thinlto_code_gen_t cg,
+                                                unsigned int expiration) {
+  unwrap(cg)->setCacheExpiration(expiration);
+}
+
+void thinlto_codegen_set_cache_size_bytes(thinlto_code_gen_t cg,
+                                          unsigned long long max_size_bytes) {
+  unwrap(cg)->setCacheMaxSize(max_size_bytes);
+}
+
+bool thinlto_codegen_process(thinlto_code_gen_t cg) {
+  if (OptLevel < '0' || OptLevel > '3')
+    report_fatal_error("Optimization level must be between 0 and 3");
+  unwrap(cg)->setOptLevel(OptLevel - '0');
+
+  if (MAttrs.size()) {
+    std::string Attrs;
+    for (unsigned i = 0; i < MAttrs.size(); ++i) {
+      if (i > 0)
+        Attrs.append(",");
+      Attrs.append(MAttrs[i]);
+    }
+    unwrap(cg)->setAttr(Attrs);
+  }
+
+  return !unwrap(cg)->run(sLastErrorString);
+}
+
+unsigned int thinlto_module_get_num_objects(thinlto_code_gen_t cg) {
+  return unwrap(cg)->getProducedBinaries().size();
+}
+
+LTOObjectBuffer thinlto_module_get_object(thinlto_code_gen_t cg,
+                                          unsigned int index) {
+  ArrayRef<std::unique_ptr<MemoryBuffer>> Binaries =
+      unwrap(cg)->getProducedBinaries();
+  assert(index < Binaries.size() && "Index overflow");
+  const MemoryBuffer &Object = *Binaries[index];
+  return LTOObjectBuffer{Object.getBufferStart(), Object.getBufferSize()};
+}
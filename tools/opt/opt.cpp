@@ -48,6 +48,7 @@
 #include "llvm/Support/SystemUtils.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
@@ -97,6 +98,22 @@ OutputAssembly("S", cl::desc("Write output as LLVM assembly"));
 static cl::opt<bool>
 NoVerify("disable-verify", cl::desc("Do not verify result module"), cl::Hidden);
 
+static cl::opt<bool>
+TimeTrace("time-trace",
+          cl::desc("Record a trace of the compile time, in the Chrome Trace "
+                   "Event format"));
+
+static cl::opt<unsigned>
+TimeTraceGranularity("time-trace-granularity", cl::init(500),
+                     cl::value_desc("us"),
+                     cl::desc("Leave out events shorter than this many "
+                              "microseconds from the time trace"));
+
+static cl::opt<std::string>
+TimeTraceFile("time-trace-file", cl::value_desc("filename"),
+              cl::desc("Write the time trace to this file (default: the "
+                       "output file with a .time-trace.json suffix)"));
+
 static cl::opt<bool>
 VerifyEach("verify-each", cl::desc("Verify after each transform"));
 
@@ -185,6 +202,10 @@ static cl::opt<bool> PreserveBitcodeUseListOrder(
     cl::desc("Preserve use-list order when writing LLVM bitcode."),
     cl::init(true), cl::Hidden);
 
+static cl::opt<bool>
+EmitFunctionSummary("function-summary",
+                    cl::desc("Emit function summary for thin LTO"));
+
 static cl::opt<bool> PreserveAssemblyUseListOrder(
     "preserve-ll-uselistorder",
     cl::desc("Preserve use-list order when writing LLVM assembly."),
@@ -343,6 +364,7 @@ int main(int argc, char **argv) {
   // For codegen passes, only passes that do IR to IR transformation are
   // supported.
   initializeCodeGenPreparePass(Registry);
+  initializeScalarizeMaskedGatherScatterPass(Registry);
   initializeAtomicExpandPass(Registry);
   initializeRewriteSymbolsPass(Registry);
   initializeWinEHPreparePass(Registry);
@@ -360,6 +382,9 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  if (TimeTrace)
+    timeTraceProfilerInitialize(TimeTraceGranularity, argv[0]);
+
   SMDiagnostic Err;
 
   // Load the input module...
@@ -600,8 +625,8 @@ int main(int argc, char **argv) {
       Passes.add(
           createPrintModulePass(Out->os(), "", PreserveAssemblyUseListOrder));
     else
-      Passes.add(
-          createBitcodeWriterPass(Out->os(), PreserveBitcodeUseListOrder));
+      Passes.add(createBitcodeWriterPass(
+          Out->os(), PreserveBitcodeUseListOrder, EmitFunctionSummary));
   }
 
   // Before executing passes, print the final values of the LLVM options.
@@ -614,5 +639,19 @@ int main(int argc, char **argv) {
   if (!NoOutput || PrintBreakpoints)
     Out->keep();
 
+  if (TimeTrace) {
+    std::string Path = TimeTraceFile;
+    if (Path.empty())
+      Path = (OutputFilename.empty() || OutputFilename == "-"
+                  ? "opt"
+                  : OutputFilename.getValue()) +
+             ".time-trace.json";
+    if (std::error_code EC = timeTraceProfilerWrite(Path)) {
+      errs() << argv[0] << ": " << Path << ": " << EC.message() << '\n';
+      return 1;
+    }
+    timeTraceProfilerCleanup();
+  }
+
   return 0;
 }
@@ -47,14 +47,15 @@ static void writeModuleToBuffer(std::unique_ptr<Module> Mod,
   WriteBitcodeToFile(Mod.get(), OS);
 }
 
-static std::unique_ptr<Module> getLazyModuleFromAssembly(LLVMContext &Context,
-                                                         SmallString<1024> &Mem,
-                                                         const char *Assembly) {
+static std::unique_ptr<Module>
+getLazyModuleFromAssembly(LLVMContext &Context, SmallString<1024> &Mem,
+                          const char *Assembly,
+                          bool ShouldLazyLoadMetadata = false) {
   writeModuleToBuffer(parseAssembly(Assembly), Mem);
   std::unique_ptr<MemoryBuffer> Buffer =
       MemoryBuffer::getMemBuffer(Mem.str(), "test", false);
-  ErrorOr<Module *> ModuleOrErr =
-      getLazyBitcodeModule(std::move(Buffer), Context);
+  ErrorOr<Module *> ModuleOrErr = getLazyBitcodeModule(
+      std::move(Buffer), Context, nullptr, ShouldLazyLoadMetadata);
   return std::unique_ptr<Module>(ModuleOrErr.get());
 }
 
@@ -164,4 +165,51 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddrInFunctionAfter) {
   EXPECT_FALSE(verifyModule(*M, &dbgs()));
 }
 
+TEST(BitReaderTest, MaterializeMetadataLazily) {
+  SmallString<1024> Mem;
+
+  LLVMContext Context;
+  std::unique_ptr<Module> M = getLazyModuleFromAssembly(
+      Context, Mem, "define void @f() {\n"
+                    "  ret void, !foo !0\n"
+                    "}\n"
+                    "define void @g() {\n"
+                    "  ret void, !foo !1\n"
+                    "}\n"
+                    "!named = !{!2}\n"
+                    "!0 = !{!\"f\", !3}\n"
+                    "!1 = !{!\"g\"}\n"
+                    "!2 = !{!\"named\", !0}\n"
+                    "!3 = distinct !{!3}\n",
+      /* ShouldLazyLoadMetadata */ true);
+  EXPECT_FALSE(M->getNamedMetadata("named"));
+  unsigned FooKind = M->getMDKindID("foo");
+
+  // Materializing @f only loads the nodes its body refers to.
+  EXPECT_FALSE(M->getFunction("f")->materialize());
+  MDNode *FMD = M->getFunction("f")->front().getTerminator()->getMetadata(
+      FooKind);
+  ASSERT_TRUE(FMD);
+  EXPECT_FALSE(FMD->isTemporary());
+  EXPECT_EQ("f", cast<MDString>(FMD->getOperand(0))->getString());
+  MDNode *Distinct = cast<MDNode>(FMD->getOperand(1));
+  EXPECT_TRUE(Distinct->isDistinct());
+  EXPECT_EQ(Distinct, Distinct->getOperand(0));
+  EXPECT_FALSE(M->getNamedMetadata("named"));
+
+  // The named metadata refers to the same nodes.
+  EXPECT_FALSE(M->materializeMetadata());
+  NamedMDNode *Named = M->getNamedMetadata("named");
+  ASSERT_TRUE(Named);
+  ASSERT_EQ(1u, Named->getNumOperands());
+  EXPECT_EQ(FMD, Named->getOperand(0)->getOperand(1));
+
+  EXPECT_FALSE(M->getFunction("g")->materialize());
+  MDNode *GMD = M->getFunction("g")->front().getTerminator()->getMetadata(
+      FooKind);
+  ASSERT_TRUE(GMD);
+  EXPECT_EQ("g", cast<MDString>(GMD->getOperand(0))->getString());
+  EXPECT_FALSE(verifyModule(*M, &dbgs()));
+}
+
 } // end namespace
@@ -0,0 +1,158 @@
+//===- FileObjectCacheTest.cpp - Unit tests for the on-disk object cache --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/FileObjectCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+class FileObjectCacheTest : public testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("FileObjectCacheTest",
+                                                CacheDir));
+  }
+
+  void TearDown() override {
+    std::error_code EC;
+    for (sys::fs::directory_iterator I(CacheDir, EC), E; I != E && !EC;
+         I.increment(EC))
+      sys::fs::remove(I->path());
+    sys::fs::remove(CacheDir);
+  }
+
+  std::unique_ptr<Module> createModule(StringRef FunctionName) {
+    std::unique_ptr<Module> M(new Module("test", Context));
+    Function::Create(FunctionType::get(Type::getVoidTy(Context), false),
+                     GlobalValue::ExternalLinkage, FunctionName, M.get());
+    return M;
+  }
+
+  // An object buffer that looks enough like an ELF file to be accepted.
+  std::string createObject(size_t Size) {
+    std::string Obj(Size, 'x');
+    Obj.replace(0, 4, "\x7f" "ELF");
+    return Obj;
+  }
+
+  std::string getObjectPath(const FileObjectCache &Cache, const Module &M) {
+    SmallString<128> Path(CacheDir);
+    sys::path::append(Path, "llvmcache-" + Cache.getCacheKey(M));
+    return Path.str();
+  }
+
+  void setLastUsed(StringRef Path, uint64_t Seconds) {
+    int FD;
+    ASSERT_FALSE(sys::fs::openFileForWrite(Path, FD, sys::fs::F_Append));
+    sys::TimeValue Time;
+    Time.fromEpochTime(Seconds);
+    EXPECT_FALSE(sys::fs::setLastModificationAndAccessTime(FD, Time));
+    sys::Process::SafelyCloseFileDescriptor(FD);
+  }
+
+  LLVMContext Context;
+  SmallString<128> CacheDir;
+};
+
+TEST_F(FileObjectCacheTest, CacheKeys) {
+  FileObjectCache Cache(CacheDir, "x86_64-unknown-linux-gnu;;;O2");
+  FileObjectCache OtherTargetCache(CacheDir, "x86_64-unknown-linux-gnu;;;O0");
+
+  std::unique_ptr<Module> M1 = createModule("f");
+  std::unique_ptr<Module> M2 = createModule("f");
+  std::unique_ptr<Module> M3 = createModule("g");
+  M2->setModuleIdentifier("another name");
+
+  // The key depends on the contents of the module and on the target only.
+  EXPECT_EQ(Cache.getCacheKey(*M1), Cache.getCacheKey(*M2));
+  EXPECT_NE(Cache.getCacheKey(*M1), Cache.getCacheKey(*M3));
+  EXPECT_NE(Cache.getCacheKey(*M1), OtherTargetCache.getCacheKey(*M1));
+}
+
+TEST_F(FileObjectCacheTest, StoreAndLoad) {
+  std::unique_ptr<Module> M = createModule("f");
+  std::string Obj = createObject(64);
+
+  {
+    FileObjectCache Cache(CacheDir, "target");
+    EXPECT_FALSE(Cache.getObject(M.get()));
+    Cache.notifyObjectCompiled(M.get(),
+                               MemoryBufferRef(Obj, "compiled object"));
+    EXPECT_EQ(0u, Cache.getNumHits());
+    EXPECT_EQ(1u, Cache.getNumMisses());
+  }
+
+  // A new cache, as in another process, finds the object.
+  FileObjectCache Cache(CacheDir, "target");
+  std::unique_ptr<MemoryBuffer> Cached = Cache.getObject(M.get());
+  ASSERT_TRUE(!!Cached);
+  EXPECT_EQ(Obj, Cached->getBuffer());
+  EXPECT_EQ(1u, Cache.getNumHits());
+  EXPECT_EQ(0u, Cache.getNumMisses());
+
+  // But not for another target.
+  FileObjectCache OtherTargetCache(CacheDir, "other target");
+  EXPECT_FALSE(OtherTargetCache.getObject(M.get()));
+}
+
+TEST_F(FileObjectCacheTest, DamagedObjectsAreIgnored) {
+  std::unique_ptr<Module> M = createModule("f");
+  std::string Damaged(64, 'x');
+  std::string Obj = createObject(64);
+
+  FileObjectCache Cache(CacheDir, "target");
+  Cache.notifyObjectCompiled(M.get(),
+                             MemoryBufferRef(Damaged, "not an object"));
+  EXPECT_FALSE(Cache.getObject(M.get()));
+
+  // Compiling the module again replaces the damaged object.
+  Cache.notifyObjectCompiled(M.get(), MemoryBufferRef(Obj, "object"));
+  std::unique_ptr<MemoryBuffer> Cached = Cache.getObject(M.get());
+  ASSERT_TRUE(!!Cached);
+  EXPECT_EQ(Obj, Cached->getBuffer());
+}
+
+TEST_F(FileObjectCacheTest, LeastRecentlyUsedObjectsAreEvicted) {
+  std::unique_ptr<Module> M1 = createModule("f");
+  std::unique_ptr<Module> M2 = createModule("g");
+  std::unique_ptr<Module> M3 = createModule("h");
+  std::string Obj = createObject(100);
+
+  FileObjectCache Cache(CacheDir, "target", 250);
+  Cache.setPruningInterval(0);
+  Cache.notifyObjectCompiled(M1.get(), MemoryBufferRef(Obj, "f"));
+  Cache.notifyObjectCompiled(M2.get(), MemoryBufferRef(Obj, "g"));
+  EXPECT_TRUE(Cache.prune());
+  EXPECT_TRUE(sys::fs::exists(getObjectPath(Cache, *M1)));
+  EXPECT_TRUE(sys::fs::exists(getObjectPath(Cache, *M2)));
+
+  // M1's object was used after M2's, so M2's is the one that goes. Objects
+  // unused for more than the expiration time would be removed regardless, so
+  // keep the times recent.
+  uint64_t Now = sys::TimeValue::now().toEpochTime();
+  setLastUsed(getObjectPath(Cache, *M1), Now - 10);
+  setLastUsed(getObjectPath(Cache, *M2), Now - 20);
+  Cache.notifyObjectCompiled(M3.get(), MemoryBufferRef(Obj, "h"));
+  EXPECT_TRUE(Cache.prune());
+  EXPECT_TRUE(sys::fs::exists(getObjectPath(Cache, *M1)));
+  EXPECT_FALSE(sys::fs::exists(getObjectPath(Cache, *M2)));
+  EXPECT_TRUE(sys::fs::exists(getObjectPath(Cache, *M3)));
+}
+
+}
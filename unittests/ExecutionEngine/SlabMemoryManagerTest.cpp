@@ -0,0 +1,144 @@
+//===- SlabMemoryManagerTest.cpp - Unit tests for the slab memory manager -===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/SlabMemoryManager.h"
+#include "llvm/Support/Process.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(SlabMemoryManagerTest, BasicAllocations) {
+  SlabMemoryPool Pool;
+  std::unique_ptr<SlabMemoryManager> MemMgr(new SlabMemoryManager(Pool));
+
+  uint8_t *code1 = MemMgr->allocateCodeSection(256, 0, 1, "");
+  uint8_t *data1 = MemMgr->allocateDataSection(256, 0, 2, "", true);
+  uint8_t *code2 = MemMgr->allocateCodeSection(256, 0, 3, "");
+  uint8_t *data2 = MemMgr->allocateDataSection(256, 0, 4, "", false);
+
+  EXPECT_NE((uint8_t*)nullptr, code1);
+  EXPECT_NE((uint8_t*)nullptr, code2);
+  EXPECT_NE((uint8_t*)nullptr, data1);
+  EXPECT_NE((uint8_t*)nullptr, data2);
+
+  // Initialize the data
+  for (unsigned i = 0; i < 256; ++i) {
+    code1[i] = 1;
+    code2[i] = 2;
+    data1[i] = 3;
+    data2[i] = 4;
+  }
+
+  // Verify the data (this is checking for overlaps in the addresses)
+  for (unsigned i = 0; i < 256; ++i) {
+    EXPECT_EQ(1, code1[i]);
+    EXPECT_EQ(2, code2[i]);
+    EXPECT_EQ(3, data1[i]);
+    EXPECT_EQ(4, data2[i]);
+  }
+
+  // Sections of the same kind are packed together.
+  EXPECT_EQ(code1 + 256, code2);
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+}
+
+TEST(SlabMemoryManagerTest, LargeAllocations) {
+  SlabMemoryPool Pool(64 * 1024);
+  std::unique_ptr<SlabMemoryManager> MemMgr(new SlabMemoryManager(Pool));
+
+  uint8_t *code1 = MemMgr->allocateCodeSection(0x100000, 0, 1, "");
+  uint8_t *data1 = MemMgr->allocateDataSection(0x100000, 0, 2, "", true);
+  uint8_t *code2 = MemMgr->allocateCodeSection(0x100000, 0, 3, "");
+  uint8_t *data2 = MemMgr->allocateDataSection(0x100000, 0, 4, "", false);
+
+  EXPECT_NE((uint8_t*)nullptr, code1);
+  EXPECT_NE((uint8_t*)nullptr, code2);
+  EXPECT_NE((uint8_t*)nullptr, data1);
+  EXPECT_NE((uint8_t*)nullptr, data2);
+
+  // Initialize the data
+  for (unsigned i = 0; i < 0x100000; ++i) {
+    code1[i] = 1;
+    code2[i] = 2;
+    data1[i] = 3;
+    data2[i] = 4;
+  }
+
+  // Verify the data (this is checking for overlaps in the addresses)
+  for (unsigned i = 0; i < 0x100000; ++i) {
+    EXPECT_EQ(1, code1[i]);
+    EXPECT_EQ(2, code2[i]);
+    EXPECT_EQ(3, data1[i]);
+    EXPECT_EQ(4, data2[i]);
+  }
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+}
+
+TEST(SlabMemoryManagerTest, SharedPool) {
+  SlabMemoryPool Pool;
+  const size_t PageSize = sys::Process::getPageSize();
+
+  std::unique_ptr<SlabMemoryManager> MemMgr1(new SlabMemoryManager(Pool));
+  uint8_t *code1 = MemMgr1->allocateCodeSection(100, 0, 1, "");
+  EXPECT_FALSE(MemMgr1->finalizeMemory());
+
+  // Finalizing returned the unused pages to the pool, so only the page that
+  // holds code1 is taken.
+  EXPECT_EQ(PageSize, Pool.getAllocatedSize());
+
+  // The next memory manager gets the following page: code stays packed, but
+  // never shares a page that has already been made executable.
+  std::unique_ptr<SlabMemoryManager> MemMgr2(new SlabMemoryManager(Pool));
+  uint8_t *code2 = MemMgr2->allocateCodeSection(100, 0, 1, "");
+  EXPECT_EQ(code1 + PageSize, code2);
+  EXPECT_FALSE(MemMgr2->finalizeMemory());
+
+  // Memory is reused once a memory manager is destroyed.
+  MemMgr1.reset();
+  std::unique_ptr<SlabMemoryManager> MemMgr3(new SlabMemoryManager(Pool));
+  uint8_t *code3 = MemMgr3->allocateCodeSection(100, 0, 1, "");
+  EXPECT_EQ(code1, code3);
+  for (unsigned i = 0; i < 100; ++i)
+    code3[i] = 5;
+  EXPECT_FALSE(MemMgr3->finalizeMemory());
+
+  MemMgr2.reset();
+  MemMgr3.reset();
+  EXPECT_EQ(0u, Pool.getAllocatedSize());
+  EXPECT_EQ(SlabMemoryPool::DefaultSlabSize, Pool.getReservedSize());
+}
+
+TEST(SlabMemoryManagerTest, HotCodeIsKeptApart) {
+  SlabMemoryPool Pool;
+  SlabMemoryManager ColdMemMgr(Pool);
+  SlabMemoryManager HotMemMgr(Pool, true);
+
+  uint8_t *Cold = ColdMemMgr.allocateCodeSection(64, 0, 1, "");
+  uint8_t *Hot1 = HotMemMgr.allocateCodeSection(64, 0, 1, "");
+  uint8_t *Data = HotMemMgr.allocateDataSection(64, 0, 2, "", false);
+  uint8_t *Hot2 = HotMemMgr.allocateCodeSection(64, 0, 3, "");
+
+  EXPECT_NE((uint8_t*)nullptr, Cold);
+  EXPECT_NE((uint8_t*)nullptr, Data);
+  EXPECT_EQ(Hot1 + 64, Hot2);
+
+  EXPECT_FALSE(ColdMemMgr.finalizeMemory());
+  EXPECT_FALSE(HotMemMgr.finalizeMemory());
+
+  // Cold code, hot code and read-write data each got a slab of their own.
+  EXPECT_EQ(3 * SlabMemoryPool::DefaultSlabSize, Pool.getReservedSize());
+}
+
+} // end anonymous namespace
@@ -11,6 +11,7 @@
 #include "llvm/Support/Endian.h"
 #include "gtest/gtest.h"
 #include <string>
+#include <vector>
 
 using namespace llvm;
 
@@ -68,4 +69,33 @@ TEST(StringTableBuilderTest, BasicWinCOFF) {
   EXPECT_EQ(23U, B.getOffset("river horse"));
 }
 
+TEST(StringTableBuilderTest, ManyStrings) {
+  StringTableBuilder B;
+
+  // Enough strings for the suffix sort to run in parallel. Every other
+  // string is a suffix of the one before, and so takes no room of its own.
+  std::vector<std::string> Strings;
+  for (unsigned I = 0; I != 40000; ++I) {
+    Strings.push_back("prefix" + std::to_string(I) + "_name");
+    Strings.push_back(std::to_string(I) + "_name");
+  }
+  for (const std::string &S : Strings)
+    B.add(S);
+
+  B.finalize(StringTableBuilder::ELF);
+
+  StringRef Data = B.data();
+  size_t ExpectedSize = 1;
+  for (unsigned I = 0; I != Strings.size(); I += 2)
+    ExpectedSize += Strings[I].size() + 1;
+  EXPECT_EQ(ExpectedSize, Data.size());
+
+  for (const std::string &S : Strings) {
+    size_t Offset = B.getOffset(S);
+    ASSERT_LT(Offset + S.size(), Data.size());
+    EXPECT_EQ(S, Data.substr(Offset, S.size()));
+    EXPECT_EQ('\0', Data[Offset + S.size()]);
+  }
+}
+
 }
@@ -95,4 +95,48 @@ TEST_F(InstrProfTest, get_max_function_count) {
   ASSERT_EQ(1ULL << 63, Reader->getMaximumFunctionCount());
 }
 
+TEST_F(InstrProfTest, merge_records_from_writer) {
+  Writer.addFunctionCounts("foo", 0x1234, {1, 2});
+  Writer.addFunctionCounts("bar", 0, {4});
+  InstrProfWriter Writer2;
+  Writer2.addFunctionCounts("baz", 0x5678, {8, 16, 32});
+  Writer2.addFunctionCounts("foo", 0x1234, {3, 4});
+  Writer2.addFunctionCounts("foo", 0x4321, {5});
+  ASSERT_TRUE(NoError(Writer.mergeRecordsFromWriter(std::move(Writer2))));
+
+  InstrProfWriter Serial;
+  Serial.addFunctionCounts("foo", 0x1234, {1, 2});
+  Serial.addFunctionCounts("bar", 0, {4});
+  Serial.addFunctionCounts("baz", 0x5678, {8, 16, 32});
+  Serial.addFunctionCounts("foo", 0x1234, {3, 4});
+  Serial.addFunctionCounts("foo", 0x4321, {5});
+  auto SerialProfile = Serial.writeBuffer();
+  auto Profile = Writer.writeBuffer();
+  ASSERT_EQ(SerialProfile->getBuffer(), Profile->getBuffer());
+
+  readProfile(std::move(Profile));
+  std::vector<uint64_t> Counts;
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("foo", 0x1234, Counts)));
+  ASSERT_EQ(2U, Counts.size());
+  ASSERT_EQ(4U, Counts[0]);
+  ASSERT_EQ(6U, Counts[1]);
+  ASSERT_EQ(8U, Reader->getMaximumFunctionCount());
+}
+
+TEST_F(InstrProfTest, merge_records_from_writer_mismatch) {
+  Writer.addFunctionCounts("foo", 0x1234, {1, 2});
+  InstrProfWriter Writer2;
+  Writer2.addFunctionCounts("foo", 0x1234, {1, 2, 3});
+  Writer2.addFunctionCounts("bar", 0, {4});
+  std::error_code EC = Writer.mergeRecordsFromWriter(std::move(Writer2));
+  ASSERT_TRUE(ErrorEquals(instrprof_error::count_mismatch, EC));
+
+  // The records that could be merged still are.
+  readProfile(Writer.writeBuffer());
+  std::vector<uint64_t> Counts;
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("bar", 0, Counts)));
+  ASSERT_EQ(1U, Counts.size());
+  ASSERT_EQ(4U, Counts[0]);
+}
+
 } // end anonymous namespace
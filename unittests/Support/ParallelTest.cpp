@@ -0,0 +1,101 @@
+//===- llvm/unittest/Support/ParallelTest.cpp - Parallel algorithm tests --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Parallel.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+TEST(ParallelTest, ForEach) {
+  std::vector<int> Values(10000);
+  for (size_t I = 0; I != Values.size(); ++I)
+    Values[I] = I;
+  parallel_for_each(Values.begin(), Values.end(), [](int &V) { V *= 2; });
+  for (size_t I = 0; I != Values.size(); ++I)
+    EXPECT_EQ(int(I * 2), Values[I]);
+
+  // Empty and one-element ranges.
+  parallel_for_each(Values.begin(), Values.begin(), [](int &V) { V = -1; });
+  EXPECT_EQ(0, Values[0]);
+  parallel_for_each(Values.begin(), Values.begin() + 1,
+                    [](int &V) { V = -1; });
+  EXPECT_EQ(-1, Values[0]);
+  EXPECT_EQ(2, Values[1]);
+}
+
+TEST(ParallelTest, ForEachN) {
+  std::vector<std::atomic<int>> Hits(1000);
+  for (std::atomic<int> &Hit : Hits)
+    Hit = 0;
+  parallel_for_each_n(size_t(0), Hits.size(), [&](size_t I) { ++Hits[I]; });
+  for (std::atomic<int> &Hit : Hits)
+    EXPECT_EQ(1, Hit);
+
+  parallel_for_each_n(5, 5, [&](int I) { ++Hits[I]; });
+  EXPECT_EQ(1, Hits[5]);
+}
+
+TEST(ParallelTest, Sort) {
+  std::mt19937 Generator(0);
+  std::vector<uint32_t> Values(100000);
+  for (uint32_t &V : Values)
+    V = Generator();
+  std::vector<uint32_t> Expected = Values;
+  std::sort(Expected.begin(), Expected.end());
+
+  parallel_sort(Values.begin(), Values.end());
+  EXPECT_EQ(Expected, Values);
+
+  // A comparator, and a range with many equal elements.
+  for (uint32_t &V : Values)
+    V %= 16;
+  parallel_sort(Values.begin(), Values.end(), std::greater<uint32_t>());
+  EXPECT_TRUE(std::is_sorted(Values.begin(), Values.end(),
+                             std::greater<uint32_t>()));
+}
+
+TEST(ParallelTest, TransformReduce) {
+  std::vector<uint64_t> Values(10000);
+  for (size_t I = 0; I != Values.size(); ++I)
+    Values[I] = I;
+  uint64_t Sum = parallel_transform_reduce(
+      Values.begin(), Values.end(), uint64_t(0),
+      [](uint64_t A, uint64_t B) { return A + B; },
+      [](uint64_t V) { return V * V; });
+  uint64_t Expected = 0;
+  for (uint64_t V : Values)
+    Expected += V * V;
+  EXPECT_EQ(Expected, Sum);
+
+  // The results are combined in the order of the range.
+  std::vector<std::string> Strings;
+  for (int I = 0; I < 1000; ++I)
+    Strings.push_back(std::to_string(I % 10));
+  std::string Concatenated = parallel_transform_reduce(
+      Strings.begin(), Strings.end(), std::string(),
+      [](const std::string &A, const std::string &B) { return A + B; },
+      [](const std::string &S) { return S; });
+  std::string ExpectedString;
+  for (const std::string &S : Strings)
+    ExpectedString += S;
+  EXPECT_EQ(ExpectedString, Concatenated);
+
+  EXPECT_EQ(7u, parallel_transform_reduce(
+                    Values.begin(), Values.begin(), 7u,
+                    [](unsigned A, unsigned B) { return A + B; },
+                    [](uint64_t V) { return unsigned(V); }));
+}
+
+} // end anonymous namespace
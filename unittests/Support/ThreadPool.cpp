@@ -0,0 +1,176 @@
+//========- unittests/Support/ThreadPool.cpp - ThreadPool.h tests ---========//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+using namespace llvm;
+
+namespace {
+
+TEST(ThreadPoolTest, AsyncAndWait) {
+  ThreadPool Pool(4);
+  std::atomic<int> Count(0);
+  for (int I = 0; I < 100; ++I)
+    Pool.async([&Count] { ++Count; });
+  Pool.wait();
+  EXPECT_EQ(100, Count);
+}
+
+TEST(ThreadPoolTest, AsyncWithArguments) {
+  ThreadPool Pool(2);
+  std::atomic<int> Sum(0);
+  for (int I = 1; I <= 10; ++I)
+    Pool.async([&Sum](int Value) { Sum += Value; }, I);
+  Pool.wait();
+  EXPECT_EQ(55, Sum);
+}
+
+TEST(ThreadPoolTest, Futures) {
+  ThreadPool Pool(2);
+  int Value = 0;
+  std::shared_future<void> Future = Pool.async([&Value] { Value = 42; });
+  Future.get();
+  EXPECT_EQ(42, Value);
+}
+
+TEST(ThreadPoolTest, SingleThread) {
+  ThreadPool Pool(1);
+  EXPECT_EQ(1u, Pool.getThreadCount());
+  // With one worker the tasks cannot overlap.
+  int Count = 0;
+  for (int I = 0; I < 100; ++I)
+    Pool.async([&Count] { ++Count; });
+  Pool.wait();
+  EXPECT_EQ(100, Count);
+}
+
+TEST(ThreadPoolTest, WaitForTasksQueuedByTasks) {
+  ThreadPool Pool(4);
+  std::atomic<int> Count(0);
+  for (int I = 0; I < 10; ++I)
+    Pool.async([&] {
+      for (int J = 0; J < 10; ++J)
+        Pool.async([&Count] { ++Count; });
+    });
+  Pool.wait();
+  EXPECT_EQ(100, Count);
+}
+
+TEST(ThreadPoolTest, DestructorRunsPendingTasks) {
+  std::atomic<int> Count(0);
+  {
+    ThreadPool Pool(2);
+    for (int I = 0; I < 100; ++I)
+      Pool.async([&Count] { ++Count; });
+  }
+  EXPECT_EQ(100, Count);
+}
+
+TEST(ThreadPoolTest, TaskGroup) {
+  ThreadPool Pool(3);
+  std::atomic<int> Count(0);
+  {
+    TaskGroup TG(Pool);
+    for (int I = 0; I < 50; ++I)
+      TG.spawn([&Count] { ++Count; });
+    TG.wait();
+    EXPECT_EQ(50, Count);
+  }
+  // The destructor waits as well.
+  {
+    TaskGroup TG(Pool);
+    for (int I = 0; I < 50; ++I)
+      TG.spawn([&Count] { ++Count; });
+  }
+  EXPECT_EQ(100, Count);
+}
+
+// Recursively split a count into tasks that wait for their subtasks. With
+// fewer workers than waiting tasks, this only finishes if waiting threads run
+// the queued tasks.
+static void countNested(ThreadPool &Pool, std::atomic<int> &Count,
+                        int Depth) {
+  ++Count;
+  if (Depth == 0)
+    return;
+  TaskGroup TG(Pool);
+  for (int I = 0; I < 2; ++I)
+    TG.spawn([&Pool, &Count, Depth] { countNested(Pool, Count, Depth - 1); });
+  TG.wait();
+}
+
+TEST(ThreadPoolTest, NestedTaskGroups) {
+  ThreadPool Pool(2);
+  std::atomic<int> Count(0);
+  countNested(Pool, Count, 8);
+  EXPECT_EQ((1 << 9) - 1, Count);
+}
+
+TEST(ThreadPoolTest, NestedTaskGroupsInPoolTasks) {
+  ThreadPool Pool(2);
+  std::atomic<int> Count(0);
+  for (int I = 0; I < 4; ++I)
+    Pool.async([&] { countNested(Pool, Count, 5); });
+  Pool.wait();
+  EXPECT_EQ(4 * ((1 << 6) - 1), Count);
+}
+
+// A waiter with nothing to run sleeps until the group is done, and wakes up to
+// help when a task of the group queues more work.
+TEST(ThreadPoolTest, TaskGroupWaitsForRunningTasks) {
+  ThreadPool Pool(2);
+  std::atomic<int> Count(0);
+  TaskGroup TG(Pool);
+  TG.spawn([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    for (int I = 0; I < 10; ++I)
+      TG.spawn([&Count] { ++Count; });
+    ++Count;
+  });
+  TG.wait();
+  EXPECT_EQ(11, Count);
+}
+
+// The time taken to queue and run an empty task. Not run by default; run it
+// with --gtest_also_run_disabled_tests.
+TEST(ThreadPoolTest, DISABLED_TaskOverhead) {
+  const int NumTasks = 1000000;
+  for (unsigned ThreadCount : {1u, 2u, 4u}) {
+    ThreadPool Pool(ThreadCount);
+    auto Start = std::chrono::steady_clock::now();
+    for (int I = 0; I < NumTasks; ++I)
+      Pool.async([] {});
+    Pool.wait();
+    auto Async = std::chrono::steady_clock::now() - Start;
+
+    Start = std::chrono::steady_clock::now();
+    {
+      TaskGroup TG(Pool);
+      for (int I = 0; I < NumTasks; ++I)
+        TG.spawn([] {});
+    }
+    auto Spawn = std::chrono::steady_clock::now() - Start;
+
+    auto NsPerTask = [&](std::chrono::steady_clock::duration D) {
+      return double(
+                 std::chrono::duration_cast<std::chrono::nanoseconds>(D)
+                     .count()) /
+             NumTasks;
+    };
+    std::printf("%u threads: async %.0f ns/task, TaskGroup::spawn %.0f "
+                "ns/task\n",
+                ThreadCount, NsPerTask(Async), NsPerTask(Spawn));
+  }
+}
+
+} // end anonymous namespace
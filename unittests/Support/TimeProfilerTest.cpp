@@ -0,0 +1,92 @@
+//===- unittests/Support/TimeProfilerTest.cpp - TimeProfiler tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <thread>
+
+using namespace llvm;
+
+namespace {
+
+std::string writeTrace() {
+  std::string Trace;
+  raw_string_ostream OS(Trace);
+  timeTraceProfilerWrite(OS);
+  return OS.str();
+}
+
+TEST(TimeProfiler, Disabled) {
+  EXPECT_FALSE(timeTraceProfilerEnabled());
+  // Scopes do nothing, and in particular do not compute their detail.
+  TimeTraceScope Scope("event", [] () -> std::string {
+    ADD_FAILURE() << "detail computed while the profiler is disabled";
+    return "";
+  });
+}
+
+TEST(TimeProfiler, NestedEvents) {
+  timeTraceProfilerInitialize(0, "test");
+  EXPECT_TRUE(timeTraceProfilerEnabled());
+  {
+    TimeTraceScope Outer("outer", "a \"quoted\"\tdetail");
+    TimeTraceScope Inner("inner", [] { return std::string("computed"); });
+  }
+  {
+    TimeTraceScope Outer("outer");
+  }
+  std::string Trace = writeTrace();
+  timeTraceProfilerCleanup();
+  EXPECT_FALSE(timeTraceProfilerEnabled());
+
+  EXPECT_EQ(0u, Trace.find("{\"traceEvents\":["));
+  EXPECT_NE(std::string::npos,
+            Trace.find("\"name\":\"outer\",\"args\":{\"detail\":"
+                       "\"a \\\"quoted\\\"\\u0009detail\"}"));
+  EXPECT_NE(std::string::npos,
+            Trace.find("\"name\":\"inner\",\"args\":{\"detail\":"
+                       "\"computed\"}"));
+  EXPECT_NE(std::string::npos,
+            Trace.find("\"name\":\"Total outer\",\"args\":{\"detail\":"
+                       "\"2 events\"}"));
+  EXPECT_NE(std::string::npos,
+            Trace.find("\"name\":\"process_name\",\"args\":{\"name\":"
+                       "\"test\"}"));
+}
+
+TEST(TimeProfiler, Granularity) {
+  // No event lasts an hour, so only the totals remain.
+  timeTraceProfilerInitialize(3600u * 1000 * 1000, "test");
+  {
+    TimeTraceScope Scope("short");
+  }
+  std::string Trace = writeTrace();
+  timeTraceProfilerCleanup();
+  EXPECT_EQ(std::string::npos, Trace.find("\"name\":\"short\""));
+  EXPECT_NE(std::string::npos, Trace.find("\"name\":\"Total short\""));
+}
+
+TEST(TimeProfiler, Threads) {
+  timeTraceProfilerInitialize(0, "test");
+  {
+    TimeTraceScope Scope("main");
+    std::thread Worker([] { TimeTraceScope Scope("worker"); });
+    Worker.join();
+  }
+  std::string Trace = writeTrace();
+  timeTraceProfilerCleanup();
+  EXPECT_NE(std::string::npos,
+            Trace.find("\"tid\":1,\"ph\":\"X\",\"ts\":"));
+  EXPECT_NE(std::string::npos,
+            Trace.find("\"tid\":2,\"ph\":\"X\",\"ts\":"));
+  EXPECT_NE(std::string::npos, Trace.find("\"name\":\"Thread 2\""));
+}
+
+} // end anonymous namespace
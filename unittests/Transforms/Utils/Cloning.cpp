@@ -414,4 +414,35 @@ TEST_F(CloneFunc, DebugIntrinsics) {
   }
 }
 
+// Test that CloneModule gives the clones of globals and functions the comdats
+// of the originals, in the new module.
+TEST(CloneModule, Comdat) {
+  LLVMContext C;
+  std::unique_ptr<Module> M(new Module("", C));
+  Comdat *CD = M->getOrInsertComdat("c");
+  CD->setSelectionKind(Comdat::NoDuplicates);
+
+  Type *Int32Ty = Type::getInt32Ty(C);
+  auto *GV = new GlobalVariable(*M, Int32Ty, false,
+                                GlobalValue::LinkOnceODRLinkage,
+                                ConstantInt::get(Int32Ty, 0), "v");
+  GV->setComdat(CD);
+  Function *F = Function::Create(FunctionType::get(Type::getVoidTy(C), false),
+                                 GlobalValue::LinkOnceODRLinkage, "f",
+                                 M.get());
+  F->setComdat(CD);
+  ReturnInst::Create(C, BasicBlock::Create(C, "", F));
+
+  std::unique_ptr<Module> New(CloneModule(M.get()));
+  EXPECT_FALSE(verifyModule(*New));
+
+  Comdat *NewCD = New->getGlobalVariable("v")->getComdat();
+  ASSERT_TRUE(NewCD);
+  EXPECT_NE(CD, NewCD);
+  EXPECT_EQ("c", NewCD->getName());
+  EXPECT_EQ(Comdat::NoDuplicates, NewCD->getSelectionKind());
+  EXPECT_EQ(NewCD, &New->getComdatSymbolTable().find("c")->getValue());
+  EXPECT_EQ(NewCD, New->getFunction("f")->getComdat());
+}
+
 }
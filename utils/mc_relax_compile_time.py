@@ -0,0 +1,87 @@
+#!/usr/bin/env python
+"""A compile-time benchmark for branch relaxation in the MC assembler.
+
+This is a python program that generates an x86-64 assembly file with a large
+number of branches and times llvm-mc assembling it to an object file.  The
+branches are laid out so that relaxing one of them pushes earlier ones out of
+the range of a short jump, which makes relaxation take many iterations over
+the fragments of the section.
+
+Use --emit to only print the generated assembly, e.g. to feed it to other
+tools.
+"""
+
+from __future__ import print_function
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def generate(branches, chain):
+  out = ['        .text', 'bench:']
+  for c in range((branches + chain - 1) // chain):
+    length = min(chain, branches - c * chain)
+    # Each branch of a chain jumps over a run of padding and the next branch.
+    # The run is just short enough for a short jump until the next branch is
+    # relaxed. The last branch jumps out of range, so the relaxations cascade
+    # backwards along the chain, one per iteration.
+    for i in range(length):
+      if i + 1 < length:
+        out.append('        jne .Lt%d_%d' % (c, i))
+      else:
+        out.append('        jne .Lfar%d' % c)
+      if i > 0:
+        out.append('.Lt%d_%d:' % (c, i - 1))
+      if i + 1 < length:
+        out.append('        .fill 124, 1, 0x90')
+    out.append('        .fill 200, 1, 0x90')
+    out.append('.Lfar%d:' % c)
+  out.append('        ret')
+  return '\n'.join(out) + '\n'
+
+
+def run(llvm_mc, path, repeat):
+  best = None
+  for _ in range(repeat):
+    start = time.time()
+    subprocess.check_call([llvm_mc, '-triple', 'x86_64-pc-linux-gnu',
+                           '-filetype=obj', '-o', os.devnull, path])
+    elapsed = time.time() - start
+    best = elapsed if best is None else min(best, elapsed)
+  return best
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__)
+  parser.add_argument('--llvm-mc', default='llvm-mc',
+                      help='Path to the llvm-mc binary')
+  parser.add_argument('--branches', type=int, default=1000000,
+                      help='Number of branches in the generated file')
+  parser.add_argument('--chain', type=int, default=64,
+                      help='Number of branches whose relaxation cascades')
+  parser.add_argument('--repeat', type=int, default=3,
+                      help='Report the best of this many runs')
+  parser.add_argument('--emit', action='store_true',
+                      help='Print the generated assembly and exit')
+  args = parser.parse_args()
+
+  asm = generate(args.branches, args.chain)
+  if args.emit:
+    sys.stdout.write(asm)
+    return
+
+  fd, path = tempfile.mkstemp(suffix='.s')
+  try:
+    with os.fdopen(fd, 'w') as f:
+      f.write(asm)
+    print('%d branches: %8.3fs' % (args.branches,
+                                   run(args.llvm_mc, path, args.repeat)))
+  finally:
+    os.remove(path)
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,91 @@
+#!/usr/bin/env python
+"""A benchmark for merging many instrumentation profiles with llvm-profdata.
+
+This is a python program that writes a large number of text format profiles,
+each holding counters for an overlapping subset of a pool of functions, and
+times llvm-profdata merging them serially and with -num-threads.  The merged
+profiles of the serial and the threaded runs are compared byte for byte.
+"""
+
+from __future__ import print_function
+
+import argparse
+import filecmp
+import multiprocessing
+import os
+import random
+import shutil
+import subprocess
+import tempfile
+import time
+
+
+def generate(directory, inputs, functions, per_input, seed):
+  rng = random.Random(seed)
+  paths = []
+  for i in range(inputs):
+    lines = []
+    for f in sorted(rng.sample(range(functions), per_input)):
+      counters = 1 + f % 8
+      lines.append('func%d' % f)
+      lines.append('%d' % (f * 7 + 1))
+      lines.append('%d' % counters)
+      for _ in range(counters):
+        lines.append('%d' % rng.randint(0, 1000))
+      lines.append('')
+    path = os.path.join(directory, 'input%d.proftext' % i)
+    with open(path, 'w') as f:
+      f.write('\n'.join(lines))
+    paths.append(path)
+  return paths
+
+
+def run(llvm_profdata, paths, output, threads, repeat):
+  best = None
+  for _ in range(repeat):
+    start = time.time()
+    subprocess.check_call([llvm_profdata, 'merge',
+                           '-num-threads=%d' % threads, '-o', output] + paths)
+    elapsed = time.time() - start
+    best = elapsed if best is None else min(best, elapsed)
+  return best
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__)
+  parser.add_argument('--llvm-profdata', default='llvm-profdata',
+                      help='Path to the llvm-profdata binary')
+  parser.add_argument('--inputs', type=int, default=10000,
+                      help='Number of profiles to merge')
+  parser.add_argument('--functions', type=int, default=2000,
+                      help='Number of distinct functions across the profiles')
+  parser.add_argument('--per-input', type=int, default=200,
+                      help='Number of functions in each profile')
+  parser.add_argument('--threads', type=int,
+                      default=multiprocessing.cpu_count(),
+                      help='Number of threads for the threaded merge')
+  parser.add_argument('--repeat', type=int, default=3,
+                      help='Report the best of this many runs')
+  parser.add_argument('--seed', type=int, default=0,
+                      help='Seed for the generated counters')
+  args = parser.parse_args()
+
+  directory = tempfile.mkdtemp()
+  try:
+    paths = generate(directory, args.inputs, args.functions,
+                     min(args.per_input, args.functions), args.seed)
+    serial = os.path.join(directory, 'serial.profdata')
+    threaded = os.path.join(directory, 'threaded.profdata')
+    t1 = run(args.llvm_profdata, paths, serial, 1, args.repeat)
+    tn = run(args.llvm_profdata, paths, threaded, args.threads, args.repeat)
+    print('%d inputs, 1 thread:  %8.3fs' % (args.inputs, t1))
+    print('%d inputs, %d threads: %8.3fs' % (args.inputs, args.threads, tn))
+    if not filecmp.cmp(serial, threaded, shallow=False):
+      print('error: the threaded merge differs from the serial merge')
+      return 1
+  finally:
+    shutil.rmtree(directory)
+  return 0
+
+if __name__ == '__main__':
+  raise SystemExit(main())